@@ -0,0 +1,49 @@
+#ifndef ASSET_ARCHIVE_H
+#define ASSET_ARCHIVE_H
+
+// packed asset archive, written offline by asset_packer and mapped whole by the game at startup.
+// shared by both, so it only needs the typedefs
+//
+// file layout
+//   0             AssetArchiveHeader
+//   indexOffset   indexSlots AssetIndexEntry. open addressed on the asset id, a power of two and at most half full
+//   ...           asset blobs, each on an ASSET_ALIGNMENT boundary
+//
+// offsets are from the start of the file, so a blob's address is the mapping plus its offset
+
+const u32 ASSET_ARCHIVE_MAGIC = 0x4B434150; // "PACK"
+const u32 ASSET_ARCHIVE_VERSION = 1;
+const u64 ASSET_ALIGNMENT = 64; // a cache line, enough for any simd load
+
+typedef u64 AssetId; // fnv-1a of the asset's name, never 0: 0 marks an empty index slot
+
+struct AssetArchiveHeader {
+    u32 magic;
+    u32 version;
+
+    u32 assetCount;
+    u32 indexSlots;
+    u64 indexOffset;
+
+    u64 totalBytes; // the whole file, a truncated copy is caught before anything is read from it
+};
+
+struct AssetIndexEntry {
+    AssetId id;
+    u64 offset;
+    u64 byteCount;
+};
+
+// names are hashed as they are spelled, the packer stores paths with forward slashes
+AssetId
+AssetIdFromName(const char name[]) {
+    u64 hash = 0xCBF29CE484222325ull;
+    for(const char* at = name; *at; at++) {
+        hash ^= (u8)*at;
+        hash *= 0x100000001B3ull;
+    }
+
+    return hash ? hash : 1;
+}
+
+#endif
@@ -0,0 +1,285 @@
+// offline asset packer, writes the archive the game maps at startup. see asset_archive.h for the layout
+// build: g++ -O2 asset_packer.cpp -o asset_packer      or      cl /O2 asset_packer.cpp
+// usage: asset_packer assets.pack input.txt sprites/player.bmp ... [--atlas sprites.atlas a.bmp,b.tga,...]
+//
+// an asset's name is its path as given, with forward slashes, so run it from the directory the game's names are relative to.
+// --atlas decodes the images, packs them onto one page and stores that as a single asset under the given name,
+// see atlas_format.h. each sprite is named after its image the same way
+
+#include <cstdio>    // printf, fopen
+#include <cstdlib>   // malloc
+#include <cstring>   // memset, strcmp
+#include "cstdint"   // uint32_t
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t int32;
+
+#include "asset_archive.h"
+#include "bitmap_format.h"
+#include "atlas_format.h"
+
+#if defined(_MSC_VER)
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#else
+#define fseek64 fseeko
+#define ftell64 ftello
+#endif
+
+struct PackedAsset {
+    char name[256];
+    const char* path;
+    const char* atlasImages; // comma separated, when the asset is an atlas built from them
+    AssetId id;
+
+    u8* data;
+    u64 byteCount;
+    u64 offset;
+};
+
+u64
+AlignUp(u64 value, u64 alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+bool
+ReadWholeFile(PackedAsset* asset) {
+    FILE* file = fopen(asset->path, "rb");
+    if(!file) {
+        printf("error opening file: %s\n", asset->path);
+        return false;
+    }
+
+    fseek64(file, 0, SEEK_END);
+    asset->byteCount = ftell64(file);
+    fseek64(file, 0, SEEK_SET);
+
+    // malloc(0) may return null, an empty asset still gets a valid pointer
+    asset->data = (u8*)malloc(asset->byteCount ? asset->byteCount : 1);
+    bool ok = fread(asset->data, 1, asset->byteCount, file) == asset->byteCount;
+    fclose(file);
+
+    if(!ok) {
+        printf("error reading file: %s\n", asset->path);
+    }
+    return ok;
+}
+
+// forward slashes, so names match whatever system the archive was built on
+bool
+AssetName(char* name, u32 nameSize, const char* path, u32 length) {
+    if(length > nameSize - 1) {
+        printf("name too long: %.*s\n", (int)length, path);
+        return false;
+    }
+
+    for(u32 i = 0; i < length; i++) {
+        name[i] = path[i] == '\\' ? '/' : path[i];
+    }
+    name[length] = 0;
+    return true;
+}
+
+// the images are converted like the game converts them at load time, so the page is ready to blit
+bool
+BuildAtlas(PackedAsset* asset) {
+    u32 spriteCount = 1;
+    for(const char* at = asset->atlasImages; *at; at++) {
+        spriteCount += *at == ',';
+    }
+
+    AtlasSprite* sprites = (AtlasSprite*)calloc(spriteCount, sizeof(AtlasSprite));
+    u32** images = (u32**)calloc(spriteCount, sizeof(u32*));
+
+    const char* imagePath = asset->atlasImages;
+    for(u32 i = 0; i < spriteCount; i++) {
+        u32 length = 0;
+        while(imagePath[length] && imagePath[length] != ',') {
+            length++;
+        }
+
+        PackedAsset image = {};
+        char path[256];
+        if(!AssetName(image.name, sizeof(image.name), imagePath, length)) {
+            return false;
+        }
+        memcpy(path, imagePath, length);
+        path[length] = 0;
+        image.path = path;
+
+        BitmapSource source;
+        if(!ReadWholeFile(&image)) {
+            return false;
+        }
+        if(!ParseBitmap(image.data, image.byteCount, &source)) {
+            printf("not a bitmap the game can load: %s\n", path);
+            return false;
+        }
+
+        if(source.width > ATLAS_MAX_PAGE_SIZE || source.height > ATLAS_MAX_PAGE_SIZE) {
+            printf("too big for an atlas page: %s\n", path);
+            return false;
+        }
+
+        images[i] = (u32*)malloc((u64)source.width * source.height * sizeof(u32));
+        sprites[i].id = AssetIdFromName(image.name);
+        sprites[i].width = source.width;
+        sprites[i].height = source.height;
+        sprites[i].opaque = ConvertBitmapPixels(&source, images[i], source.width);
+        free(image.data);
+
+        for(u32 j = 0; j < i; j++) {
+            if(sprites[j].id == sprites[i].id) {
+                printf("%s is in %s twice, or shares an id with another image in it\n", image.name, asset->name);
+                return false;
+            }
+        }
+
+        imagePath += length + (imagePath[length] == ',');
+    }
+
+    AtlasPacker packer = {};
+    packer.order = (u32*)malloc(spriteCount * sizeof(u32));
+    packer.skyline = (AtlasSkyline*)malloc((spriteCount + 1) * sizeof(AtlasSkyline));
+    if(!PackAtlas(&packer, sprites, spriteCount)) {
+        printf("%s doesn't fit on a %dx%d page, split it into several atlases\n", asset->name, ATLAS_MAX_PAGE_SIZE, ATLAS_MAX_PAGE_SIZE);
+        return false;
+    }
+
+    u64 pagePixels = (u64)packer.pageWidth * packer.pageHeight;
+    u32* page = (u32*)calloc(pagePixels, sizeof(u32));
+    u64 used = 0;
+    for(u32 i = 0; i < spriteCount; i++) {
+        for(int32 y = 0; y < sprites[i].height; y++) {
+            memcpy(page + (u64)(sprites[i].y + y) * packer.pageWidth + sprites[i].x,
+                   images[i] + (u64)y * sprites[i].width, sprites[i].width * sizeof(u32));
+        }
+        used += (u64)sprites[i].width * sprites[i].height;
+    }
+
+    asset->byteCount = AtlasAssetBytes(spriteCount, packer.pageWidth, packer.pageHeight);
+    asset->data = (u8*)malloc(asset->byteCount);
+    WriteAtlasAsset(asset->data, sprites, spriteCount, page, packer.pageWidth, packer.pageHeight);
+
+    printf("%s: %u sprites on a %dx%d page, %.1f%% used\n", asset->name, spriteCount, packer.pageWidth, packer.pageHeight,
+           100.0 * used / pagePixels);
+    return true;
+}
+
+bool
+WritePadding(FILE* file, u64 from, u64 to) {
+    static const u8 zeroes[ASSET_ALIGNMENT] = {};
+    return to == from || fwrite(zeroes, 1, to - from, file) == to - from;
+}
+
+int
+main(int argc, char** argv) {
+    if(argc < 3) {
+        printf("usage: asset_packer output.pack file [file ...] [--atlas name image,image,...]\n");
+        return 1;
+    }
+
+    const char* outputPath = argv[1];
+    PackedAsset* assets = (PackedAsset*)calloc(argc - 2, sizeof(PackedAsset));
+
+    u32 assetCount = 0;
+    for(int arg = 2; arg < argc; arg++) {
+        PackedAsset* asset = assets + assetCount++;
+        if(strcmp(argv[arg], "--atlas") == 0) {
+            if(arg + 2 >= argc) {
+                printf("--atlas takes a name and a comma separated list of images\n");
+                return 1;
+            }
+            asset->path = argv[arg + 1];
+            asset->atlasImages = argv[arg + 2];
+            arg += 2;
+        } else {
+            asset->path = argv[arg];
+        }
+    }
+
+    // index at most half full, so a probe finds an empty slot within a step or two
+    u32 indexSlots = 16;
+    while(indexSlots < assetCount * 2) {
+        indexSlots *= 2;
+    }
+    AssetIndexEntry* index = (AssetIndexEntry*)calloc(indexSlots, sizeof(AssetIndexEntry));
+
+    u64 indexOffset = AlignUp(sizeof(AssetArchiveHeader), ASSET_ALIGNMENT);
+    u64 offset = AlignUp(indexOffset + (u64)indexSlots * sizeof(AssetIndexEntry), ASSET_ALIGNMENT);
+
+    for(u32 i = 0; i < assetCount; i++) {
+        PackedAsset* asset = assets + i;
+        if(!AssetName(asset->name, sizeof(asset->name), asset->path, (u32)strlen(asset->path))) {
+            return 1;
+        }
+
+        bool loaded = asset->atlasImages ? BuildAtlas(asset) : ReadWholeFile(asset);
+        if(!loaded) {
+            return 1;
+        }
+
+        asset->id = AssetIdFromName(asset->name);
+        asset->offset = offset;
+        offset = AlignUp(offset + asset->byteCount, ASSET_ALIGNMENT);
+
+        // two names on one id can't both be found, the archive is refused rather than losing one
+        u32 mask = indexSlots - 1;
+        for(u32 probe = 0; ; probe++) {
+            AssetIndexEntry* entry = index + ((asset->id + probe) & mask);
+
+            if(entry->id == asset->id) {
+                printf("%s has the same id as an asset packed before it, rename one of them\n", asset->name);
+                return 1;
+            }
+            if(entry->id == 0) {
+                entry->id = asset->id;
+                entry->offset = asset->offset;
+                entry->byteCount = asset->byteCount;
+                break;
+            }
+        }
+    }
+
+    AssetArchiveHeader header = {};
+    header.magic = ASSET_ARCHIVE_MAGIC;
+    header.version = ASSET_ARCHIVE_VERSION;
+    header.assetCount = assetCount;
+    header.indexSlots = indexSlots;
+    header.indexOffset = indexOffset;
+    header.totalBytes = offset;
+
+    FILE* output = fopen(outputPath, "wb");
+    if(!output) {
+        printf("error creating archive: %s\n", outputPath);
+        return 1;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, output) == 1 &&
+              WritePadding(output, sizeof(header), indexOffset) &&
+              fwrite(index, sizeof(AssetIndexEntry), indexSlots, output) == indexSlots;
+
+    u64 written = indexOffset + (u64)indexSlots * sizeof(AssetIndexEntry);
+    for(u32 i = 0; i < assetCount && ok; i++) {
+        PackedAsset* asset = assets + i;
+        ok = WritePadding(output, written, asset->offset) &&
+             fwrite(asset->data, 1, asset->byteCount, output) == asset->byteCount;
+        written = asset->offset + asset->byteCount;
+    }
+    ok = ok && WritePadding(output, written, header.totalBytes);
+
+    if(fclose(output) != 0 || !ok) {
+        printf("error writing archive: %s\n", outputPath);
+        return 1;
+    }
+
+    for(u32 i = 0; i < assetCount; i++) {
+        printf("%016llx %10llu %s\n", (unsigned long long)assets[i].id, (unsigned long long)assets[i].byteCount, assets[i].name);
+    }
+    printf("%u assets, %llu bytes, %u index slots: %s\n", assetCount, (unsigned long long)header.totalBytes, indexSlots, outputPath);
+
+    return 0;
+}
@@ -0,0 +1,231 @@
+#ifndef ATLAS_FORMAT_H
+#define ATLAS_FORMAT_H
+
+#include "asset_archive.h"
+
+// sprite atlas: many small images packed into one page, so drawing them reads one block of memory instead of
+// one allocation per image. shared by the game, which can pack at load time, and the asset packer, which packs offline.
+// only needs the typedefs
+//
+// an offline atlas is one asset in the archive
+//   0              AtlasHeader
+//   spritesOffset  spriteCount AtlasSprite
+//   pixelsOffset   the page, premultiplied bgra, bottom row first, on an ASSET_ALIGNMENT boundary
+//
+// offsets are from the start of the asset
+
+const u32 ATLAS_MAGIC = 0x534C5441; // "ATLS"
+const u32 ATLAS_VERSION = 1;
+
+const int32 ATLAS_MIN_PAGE_SIZE = 128;
+const int32 ATLAS_MAX_PAGE_SIZE = 4096;
+
+struct AtlasHeader {
+    u32 magic;
+    u32 version;
+
+    u32 spriteCount;
+    int32 pageWidth, pageHeight;
+    u32 unused;
+
+    u64 spritesOffset;
+    u64 pixelsOffset;
+};
+
+// a sprite's rect on the page, in pixels
+struct AtlasSprite {
+    AssetId id; // the name of the image it came from
+    int32 x, y;
+    int32 width, height;
+    u32 opaque;
+    u32 unused;
+};
+
+// one run of the skyline: the page is filled up to y between x and x + width
+struct AtlasSkyline {
+    int32 x, y;
+    int32 width;
+};
+
+struct AtlasPacker {
+    int32 pageWidth, pageHeight;
+
+    // scratch, from the caller: the sprites in packing order, and up to one skyline run per sprite plus one
+    u32* order;
+    AtlasSkyline* skyline;
+    u32 skylineCount;
+};
+
+u64
+AtlasPackerScratchBytes(u32 spriteCount) {
+    return spriteCount * sizeof(u32) + (spriteCount + 1) * sizeof(AtlasSkyline);
+}
+
+// lowest y the rect can sit at with its left edge on run index, or -1 when it doesn't fit there
+int32
+SkylineFit(AtlasPacker* packer, u32 index, int32 width, int32 height) {
+    int32 x = packer->skyline[index].x;
+    if(x + width > packer->pageWidth) {
+        return -1;
+    }
+
+    int32 y = 0;
+    int32 remaining = width;
+    for(u32 i = index; remaining > 0; i++) {
+        y = packer->skyline[i].y > y ? packer->skyline[i].y : y;
+        if(y + height > packer->pageHeight) {
+            return -1;
+        }
+        remaining -= packer->skyline[i].width;
+    }
+
+    return y;
+}
+
+// the rect goes on top of the skyline at run index, the runs under it are cut back or removed
+void
+SkylinePlace(AtlasPacker* packer, u32 index, int32 x, int32 y, int32 width, int32 height) {
+    AtlasSkyline* skyline = packer->skyline;
+
+    for(u32 i = packer->skylineCount; i > index; i--) {
+        skyline[i] = skyline[i - 1];
+    }
+    skyline[index].x = x;
+    skyline[index].y = y + height;
+    skyline[index].width = width;
+    packer->skylineCount++;
+
+    u32 next = index + 1;
+    while(next < packer->skylineCount) {
+        int32 covered = (x + width) - skyline[next].x;
+        if(covered <= 0) {
+            break;
+        }
+
+        if(covered < skyline[next].width) {
+            skyline[next].x += covered;
+            skyline[next].width -= covered;
+            break;
+        }
+
+        for(u32 i = next; i + 1 < packer->skylineCount; i++) {
+            skyline[i] = skyline[i + 1];
+        }
+        packer->skylineCount--;
+    }
+
+    // neighbours at the same height become one run
+    for(u32 i = 0; i + 1 < packer->skylineCount; ) {
+        if(skyline[i].y == skyline[i + 1].y) {
+            skyline[i].width += skyline[i + 1].width;
+            for(u32 j = i + 1; j + 1 < packer->skylineCount; j++) {
+                skyline[j] = skyline[j + 1];
+            }
+            packer->skylineCount--;
+        } else {
+            i++;
+        }
+    }
+}
+
+// skyline bottom left: tallest sprites first, each one where its top ends up lowest.
+// fills in x and y of every sprite, false when they don't all fit on the page
+bool
+PackAtlasPage(AtlasPacker* packer, AtlasSprite* sprites, u32 count) {
+    for(u32 i = 0; i < count; i++) {
+        packer->order[i] = i;
+    }
+
+    // insertion sort, stable so equal sprites keep the order they were given in
+    for(u32 i = 1; i < count; i++) {
+        u32 index = packer->order[i];
+        u32 j = i;
+        while(j > 0) {
+            AtlasSprite* a = sprites + packer->order[j - 1];
+            AtlasSprite* b = sprites + index;
+            if(a->height > b->height || (a->height == b->height && a->width >= b->width)) {
+                break;
+            }
+            packer->order[j] = packer->order[j - 1];
+            j--;
+        }
+        packer->order[j] = index;
+    }
+
+    packer->skyline[0].x = 0;
+    packer->skyline[0].y = 0;
+    packer->skyline[0].width = packer->pageWidth;
+    packer->skylineCount = 1;
+
+    for(u32 i = 0; i < count; i++) {
+        AtlasSprite* sprite = sprites + packer->order[i];
+
+        u32 bestIndex = 0;
+        int32 bestTop = -1;
+        for(u32 run = 0; run < packer->skylineCount; run++) {
+            int32 y = SkylineFit(packer, run, sprite->width, sprite->height);
+            if(y >= 0 && (bestTop < 0 || y + sprite->height < bestTop)) {
+                bestTop = y + sprite->height;
+                bestIndex = run;
+            }
+        }
+
+        if(bestTop < 0) {
+            return false;
+        }
+
+        sprite->x = packer->skyline[bestIndex].x;
+        sprite->y = bestTop - sprite->height;
+        SkylinePlace(packer, bestIndex, sprite->x, sprite->y, sprite->width, sprite->height);
+    }
+
+    return true;
+}
+
+// tries pages in order of area, 128x128, 256x128, 256x256 and so on, and keeps the first everything fits on.
+// false when even the biggest page is too small
+bool
+PackAtlas(AtlasPacker* packer, AtlasSprite* sprites, u32 count) {
+    for(int32 size = ATLAS_MIN_PAGE_SIZE; size <= ATLAS_MAX_PAGE_SIZE; size *= 2) {
+        packer->pageWidth = size;
+        packer->pageHeight = size / 2;
+        if(size / 2 >= ATLAS_MIN_PAGE_SIZE && PackAtlasPage(packer, sprites, count)) {
+            return true;
+        }
+
+        packer->pageHeight = size;
+        if(PackAtlasPage(packer, sprites, count)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+u64
+AtlasAssetBytes(u32 spriteCount, int32 pageWidth, int32 pageHeight) {
+    u64 spritesEnd = sizeof(AtlasHeader) + (u64)spriteCount * sizeof(AtlasSprite);
+    u64 pixelsOffset = (spritesEnd + ASSET_ALIGNMENT - 1) & ~(ASSET_ALIGNMENT - 1);
+    return pixelsOffset + (u64)pageWidth * pageHeight * sizeof(u32);
+}
+
+// lays out an offline atlas in dest, AtlasAssetBytes long. the page is copied in as it is
+void
+WriteAtlasAsset(u8* dest, AtlasSprite* sprites, u32 spriteCount, u32* page, int32 pageWidth, int32 pageHeight) {
+    AtlasHeader* header = (AtlasHeader*)dest;
+    *header = {};
+    header->magic = ATLAS_MAGIC;
+    header->version = ATLAS_VERSION;
+    header->spriteCount = spriteCount;
+    header->pageWidth = pageWidth;
+    header->pageHeight = pageHeight;
+    header->spritesOffset = sizeof(AtlasHeader);
+    header->pixelsOffset = AtlasAssetBytes(spriteCount, pageWidth, pageHeight) - (u64)pageWidth * pageHeight * sizeof(u32);
+
+    u8* spritesAt = dest + header->spritesOffset;
+    memcpy(spritesAt, sprites, spriteCount * sizeof(AtlasSprite));
+    memset(spritesAt + spriteCount * sizeof(AtlasSprite), 0, header->pixelsOffset - header->spritesOffset - spriteCount * sizeof(AtlasSprite));
+    memcpy(dest + header->pixelsOffset, page, (u64)pageWidth * pageHeight * sizeof(u32));
+}
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef BITMAP_FORMAT_H
+#define BITMAP_FORMAT_H
+
+// uncompressed bmp and tga parsing, shared by the game's loader and the offline asset packer, so it only needs the typedefs.
+// files are parsed in place and converted to premultiplied bgra, bottom row first. anything unknown is refused
+
+// x * y / 255 for x, y in 0..255, rounded to nearest
+u32
+MultiplyDivide255(u32 x, u32 y) {
+    u32 t = x * y + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+const u16 BMP_MAGIC = 0x4D42; // "BM"
+const u32 BMP_RGB = 0;        // BI_RGB
+const u32 BMP_BITFIELDS = 3;  // BI_BITFIELDS
+const u32 BMP_ALPHABITFIELDS = 6;
+
+const u8 TGA_TRUECOLOR = 2;           // uncompressed, no color map
+const u8 TGA_TOP_ORIGIN = 0x20;       // descriptor bit 5, rows are stored top first
+const u8 TGA_RIGHT_ORIGIN = 0x10;     // descriptor bit 4, columns right to left
+
+const int32 BITMAP_MAX_SIZE = 16384; // per side, keeps every size computation far from overflowing
+
+u16
+ReadU16(u8* at) {
+    return (u16)(at[0] | (at[1] << 8));
+}
+
+u32
+ReadU32(u8* at) {
+    return (u32)at[0] | ((u32)at[1] << 8) | ((u32)at[2] << 16) | ((u32)at[3] << 24);
+}
+
+// shift of the lowest set bit. the loader only takes masks that are whole bytes
+bool
+ByteMaskShift(u32 mask, u32* shift) {
+    for(u32 s = 0; s < 32; s += 8) {
+        if(mask == (0xFFu << s)) {
+            *shift = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+u32
+Premultiply(u32 blue, u32 green, u32 red, u32 alpha) {
+    blue = MultiplyDivide255(blue, alpha);
+    green = MultiplyDivide255(green, alpha);
+    red = MultiplyDivide255(red, alpha);
+    return (alpha << 24) | (red << 16) | (green << 8) | blue;
+}
+
+// source pixels are bgr or bgra bytes. rows are visited bottom first, whatever order the file has them in
+struct BitmapSource {
+    u8* pixels;
+    int32 width, height;
+    u32 bytesPerPixel;
+    u64 rowBytes;
+    bool topDown;
+
+    // byte shifts of each channel in a 32 bit pixel. no alpha means opaque
+    u32 shifts[4];
+    bool hasAlpha;
+};
+
+bool
+ParseBMP(u8* data, u64 byteCount, BitmapSource* source) {
+    if(byteCount < 54 || ReadU16(data) != BMP_MAGIC) {
+        return false;
+    }
+
+    u32 pixelOffset = ReadU32(data + 10);
+    u32 infoSize = ReadU32(data + 14);
+    int32 width = (int32)ReadU32(data + 18);
+    int32 height = (int32)ReadU32(data + 22);
+    u16 bitsPerPixel = ReadU16(data + 28);
+    u32 compression = ReadU32(data + 30);
+
+    if(infoSize < 40 || width <= 0 || width > BITMAP_MAX_SIZE || height == 0 ||
+       height < -BITMAP_MAX_SIZE || height > BITMAP_MAX_SIZE) {
+        return false;
+    }
+
+    *source = {};
+    source->width = width;
+    source->height = height < 0 ? -height : height;
+    source->topDown = height < 0;
+    source->shifts[0] = 0;
+    source->shifts[1] = 8;
+    source->shifts[2] = 16;
+    source->shifts[3] = 24;
+
+    if(bitsPerPixel == 24 && compression == BMP_RGB) {
+        source->bytesPerPixel = 3;
+    } else if(bitsPerPixel == 32 && compression == BMP_RGB) {
+        // the fourth byte is officially unused, but plenty of tools put alpha there. all zero means it really is unused
+        source->bytesPerPixel = 4;
+        source->hasAlpha = true;
+    } else if(bitsPerPixel == 32 && (compression == BMP_BITFIELDS || compression == BMP_ALPHABITFIELDS)) {
+        // the masks follow a 40 byte header, and are part of the bigger ones at the same place
+        bool alphaMask = compression == BMP_ALPHABITFIELDS || infoSize >= 56;
+        u64 masksEnd = 14 + 40 + (alphaMask ? 16 : 12);
+        if(byteCount < masksEnd) {
+            return false;
+        }
+
+        source->bytesPerPixel = 4;
+        if(!ByteMaskShift(ReadU32(data + 62), &source->shifts[0]) ||
+           !ByteMaskShift(ReadU32(data + 58), &source->shifts[1]) ||
+           !ByteMaskShift(ReadU32(data + 54), &source->shifts[2])) {
+            return false;
+        }
+
+        u32 mask = alphaMask ? ReadU32(data + 66) : 0;
+        source->hasAlpha = mask != 0;
+        if(mask && !ByteMaskShift(mask, &source->shifts[3])) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    // rows are padded to 4 bytes
+    source->rowBytes = ((u64)source->width * source->bytesPerPixel + 3) & ~3ull;
+    if(pixelOffset > byteCount || source->rowBytes * source->height > byteCount - pixelOffset) {
+        return false;
+    }
+    source->pixels = data + pixelOffset;
+
+    if(bitsPerPixel == 32 && compression == BMP_RGB) {
+        bool anyAlpha = false;
+        for(int32 y = 0; y < source->height && !anyAlpha; y++) {
+            u8* row = source->pixels + y * source->rowBytes;
+            for(int32 x = 0; x < source->width; x++) {
+                if(row[x * 4 + 3]) {
+                    anyAlpha = true;
+                    break;
+                }
+            }
+        }
+        source->hasAlpha = anyAlpha;
+    }
+
+    return true;
+}
+
+bool
+ParseTGA(u8* data, u64 byteCount, BitmapSource* source) {
+    if(byteCount < 18) {
+        return false;
+    }
+
+    u8 idLength = data[0];
+    u8 colorMapType = data[1];
+    u8 imageType = data[2];
+    int32 width = ReadU16(data + 12);
+    int32 height = ReadU16(data + 14);
+    u8 bitsPerPixel = data[16];
+    u8 descriptor = data[17];
+
+    if(colorMapType != 0 || imageType != TGA_TRUECOLOR || (bitsPerPixel != 24 && bitsPerPixel != 32) ||
+       (descriptor & TGA_RIGHT_ORIGIN) || width == 0 || height == 0 || width > BITMAP_MAX_SIZE || height > BITMAP_MAX_SIZE) {
+        return false;
+    }
+
+    *source = {};
+    source->width = width;
+    source->height = height;
+    source->bytesPerPixel = bitsPerPixel / 8;
+    source->rowBytes = (u64)width * source->bytesPerPixel;
+    source->topDown = (descriptor & TGA_TOP_ORIGIN) != 0;
+    source->shifts[0] = 0;
+    source->shifts[1] = 8;
+    source->shifts[2] = 16;
+    source->shifts[3] = 24;
+    source->hasAlpha = bitsPerPixel == 32 && (descriptor & 0x0F) == 8; // attribute bits, 0 means no alpha
+
+    u64 pixelOffset = 18 + idLength;
+    if(pixelOffset > byteCount || source->rowBytes * height > byteCount - pixelOffset) {
+        return false;
+    }
+    source->pixels = data + pixelOffset;
+
+    return true;
+}
+
+// returns whether every pixel came out opaque
+bool
+ConvertBitmapPixels(BitmapSource* source, u32* pixels, int32 pitch) {
+    bool opaque = true;
+
+    for(int32 y = 0; y < source->height; y++) {
+        int32 sourceRow = source->topDown ? source->height - 1 - y : y;
+        u8* in = source->pixels + sourceRow * source->rowBytes;
+        u32* out = pixels + (u64)y * pitch;
+
+        for(int32 x = 0; x < source->width; x++) {
+            u32 blue, green, red, alpha = 255;
+
+            if(source->bytesPerPixel == 3) {
+                blue = in[0];
+                green = in[1];
+                red = in[2];
+            } else {
+                u32 pixel = ReadU32(in);
+                blue = (pixel >> source->shifts[0]) & 0xFF;
+                green = (pixel >> source->shifts[1]) & 0xFF;
+                red = (pixel >> source->shifts[2]) & 0xFF;
+                if(source->hasAlpha) {
+                    alpha = (pixel >> source->shifts[3]) & 0xFF;
+                }
+            }
+
+            opaque = opaque && alpha == 255;
+            out[x] = Premultiply(blue, green, red, alpha);
+            in += source->bytesPerPixel;
+        }
+    }
+
+    return opaque;
+}
+
+// a bmp says so in its first two bytes, anything else has to parse as a tga
+bool
+ParseBitmap(u8* data, u64 byteCount, BitmapSource* source) {
+    if(byteCount >= 2 && ReadU16(data) == BMP_MAGIC) {
+        return ParseBMP(data, byteCount, source);
+    }
+    return ParseTGA(data, byteCount, source);
+}
+
+#endif
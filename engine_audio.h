@@ -0,0 +1,529 @@
+#ifndef ENGINE_AUDIO_H
+#define ENGINE_AUDIO_H
+
+// audio output, shared by the platform layers
+// the game's samples go into a single producer, single consumer ring on the main thread. a dedicated audio thread
+// drains the ring into the device at the device's own pace, so a slow frame only eats into what is queued
+//
+//   main thread    GameUpdate -> AudioOutputWrite -> ring
+//   audio thread   device wait -> ring -> device submit, silence when the ring runs dry
+//
+// frames are interleaved stereo int16, the same layout as SoundBuffer
+//
+// latency is two numbers, each tuned on the thread that feels it
+//   device write-ahead   how far past the play cursor the audio thread keeps the device filled
+//   ring target          how much game audio waits in the ring, covers the longest frame and the most the device
+//                        took in one
+// each is a measurement plus a margin. a miss doubles the margin, a near miss grows it a little,
+// a quiet stretch shrinks it a little, so both settle at the smallest value that stays clean
+
+const u32 AUDIO_SCRATCH_FRAMES = 1024; // most the audio thread moves per submit
+
+const u32 LATENCY_WINDOW_SECONDS = 1; // measurements are the max over the last one to two of these
+const u32 LATENCY_QUIET_SECONDS = 2;  // this long without a near miss and a margin shrinks a step
+
+// largest value seen over the last one to two windows. two buckets, so old spikes age out
+struct WindowMax {
+    u32 previous;
+    u32 current;
+    u32 elapsed;
+};
+
+struct LatencyMargin {
+    u32 frames;
+    u32 minFrames, maxFrames;
+    u32 quietFrames; // played since the last near miss
+};
+
+// written by the device on the audio thread, read by anyone
+struct DeviceLatency {
+    WindowMax cursorStep; // how far the play cursor moves between two wakeups, granularity and wake jitter together
+    WindowMax writeGap;   // play cursor to write cursor, the part of the buffer the hardware owns
+    LatencyMargin margin;
+
+    u32 volatile writeAhead; // frames past the play cursor the device is filled to
+    u32 volatile measuredStep;
+    u32 volatile measuredGap;
+    u32 volatile nearMisses; // woke up with less headroom past the write cursor than the smallest margin
+    u32 volatile misses;     // woke up to find the write cursor already past our data, an audible glitch
+
+    u32 seededStep; // cursor step taken out of the starting margin so far, see UpdateDeviceLatency
+};
+
+struct AudioRing {
+    int16* samples;
+    u32 capacity; // in frames, a power of two so indices wrap with a mask
+
+    // free running indices, each on its own cache line so the two threads never share one
+    alignas(64) u32 volatile writeIndex; // written by the producer only
+    alignas(64) u32 volatile readIndex;  // written by the consumer only
+};
+
+// a platform output. wait blocks until the device can take more and returns how many frames,
+// 0 lets the audio thread check whether it should stop
+struct AudioDevice;
+typedef u32 AudioDeviceWaitFunc(AudioDevice* device);
+typedef void AudioDeviceSubmitFunc(AudioDevice* device, int16* frames, u32 frameCount);
+
+struct AudioDevice {
+    u32 samplesPerSecond;
+    AudioDeviceWaitFunc* wait;
+    AudioDeviceSubmitFunc* submit;
+
+    DeviceLatency latency; // updated by wait
+};
+
+struct AudioOutputStats {
+    u32 underruns;      // device wakeups the ring could not satisfy
+    u32 underrunFrames; // silence played because of them
+    u32 framesPlayed;
+
+    u32 ringFill;     // frames queued right now
+    u32 ringLowest;   // least left queued after a device pull, the real safety margin
+    u32 ringCapacity;
+    u32 targetFill;   // what the producer tops the ring up to
+
+    // latency, in milliseconds
+    f32 deviceLatencyMs; // device write-ahead
+    f32 ringLatencyMs;   // ring target
+    f32 totalLatencyMs;  // from the game writing a sample to it playing, at worst
+    f32 cursorStepMs;    // measured play cursor movement between wakeups
+    f32 writeGapMs;      // measured play to write cursor distance
+    f32 frameTimeMs;     // measured longest frame
+
+    u32 ringNearMisses;   // pulls that left the ring almost empty
+    u32 deviceNearMisses;
+    u32 deviceMisses;
+};
+
+struct AudioOutput {
+    AudioRing ring;
+    AudioDevice* device;
+    u32 volatile targetFill;
+
+    // ring target controller, main thread only
+    WindowMax frameTime;
+    WindowMax frameDrain; // frames the device took from the ring in one frame
+    u32 lastReadIndex;
+    LatencyMargin ringMargin;
+    u32 underrunsSeen;
+    u32 ringNearMissesSeen;
+
+    u32 volatile running;
+
+    // audio thread only
+    int16 scratch[AUDIO_SCRATCH_FRAMES * 2];
+    bool primed; // no underruns are counted before the game's first write
+
+    // written by the audio thread, read by anyone
+    u32 volatile underruns;
+    u32 volatile underrunFrames;
+    u32 volatile framesPlayed;
+    u32 volatile ringLowest;
+    u32 volatile ringNearMisses;
+};
+
+void
+WindowMaxAdd(WindowMax* window, u32 value, u32 elapsedFrames, u32 windowFrames) {
+    window->elapsed += elapsedFrames;
+    if(window->elapsed >= windowFrames) {
+        window->previous = window->current;
+        window->current = 0;
+        window->elapsed = 0;
+    }
+
+    if(value > window->current) {
+        window->current = value;
+    }
+}
+
+u32
+WindowMaxGet(WindowMax* window) {
+    return window->previous > window->current ? window->previous : window->current;
+}
+
+void
+InitializeLatencyMargin(LatencyMargin* margin, u32 startFrames, u32 minFrames, u32 maxFrames) {
+    margin->frames = startFrames;
+    margin->minFrames = minFrames;
+    margin->maxFrames = maxFrames;
+    margin->quietFrames = 0;
+}
+
+void
+LatencyMarginMiss(LatencyMargin* margin) {
+    u32 frames = margin->frames * 2;
+    margin->frames = frames < margin->maxFrames ? frames : margin->maxFrames;
+    margin->quietFrames = 0;
+}
+
+void
+LatencyMarginNearMiss(LatencyMargin* margin) {
+    u32 frames = margin->frames + margin->frames / 4 + 1;
+    margin->frames = frames < margin->maxFrames ? frames : margin->maxFrames;
+    margin->quietFrames = 0;
+}
+
+void
+LatencyMarginQuiet(LatencyMargin* margin, u32 elapsedFrames, u32 samplesPerSecond) {
+    margin->quietFrames += elapsedFrames;
+    if(margin->quietFrames >= LATENCY_QUIET_SECONDS * samplesPerSecond) {
+        u32 frames = margin->frames - margin->frames / 8;
+        margin->frames = frames > margin->minFrames ? frames : margin->minFrames;
+        margin->quietFrames = 0;
+    }
+}
+
+// device side, 1 ms to 100 ms of margin. starts at the old fixed 50 ms and works down from there
+void
+InitializeDeviceLatency(DeviceLatency* latency, u32 samplesPerSecond) {
+    *latency = {};
+    InitializeLatencyMargin(&latency->margin, samplesPerSecond / 20, samplesPerSecond / 1000, samplesPerSecond / 10);
+    latency->writeAhead = samplesPerSecond / 20;
+}
+
+// called by a device on every wakeup, with distances it measured on its own buffer, in frames.
+// headroom is how far our data reaches past the write cursor, negative when the hardware has already passed it.
+// returns the write-ahead to fill to, counted from the play cursor
+u32
+UpdateDeviceLatency(AudioDevice* device, u32 cursorStep, u32 writeGap, int32 headroom) {
+    DeviceLatency* latency = &device->latency;
+    u32 windowFrames = LATENCY_WINDOW_SECONDS * device->samplesPerSecond;
+
+    WindowMaxAdd(&latency->cursorStep, cursorStep, cursorStep, windowFrames);
+    WindowMaxAdd(&latency->writeGap, writeGap, cursorStep, windowFrames);
+
+    u32 step = WindowMaxGet(&latency->cursorStep);
+    u32 gap = WindowMaxGet(&latency->writeGap);
+
+    // the starting margin stands in for the cursor step until the first window has seen it. whatever the step
+    // grows by until then comes out of the margin, so the write-ahead stays where it started: otherwise the wakeup
+    // the step grows in pulls the growth on top of a step, more than the ring holds that early. a coarse cursor
+    // shows its biggest step a few wakeups in
+    if(latency->cursorStep.previous == 0 && step > latency->seededStep) {
+        u32 growth = step - latency->seededStep;
+        u32 margin = latency->margin.frames > growth ? latency->margin.frames - growth : 0;
+        latency->margin.frames = margin > latency->margin.minFrames ? margin : latency->margin.minFrames;
+        latency->seededStep = step;
+    }
+
+    // with the cursor where it was, negative headroom is a miss already counted, or the first wakeup before
+    // anything was written
+    if(headroom < 0 && cursorStep > 0) {
+        AtomicStore(&latency->misses, latency->misses + 1);
+        LatencyMarginMiss(&latency->margin);
+    } else if(cursorStep > 0 && (u32)headroom < latency->margin.minFrames) {
+        // the write-ahead already covers a step, what is left past it is the margin. almost none of that left
+        // and a little more jitter would have been a miss
+        AtomicStore(&latency->nearMisses, latency->nearMisses + 1);
+        LatencyMarginNearMiss(&latency->margin);
+    } else {
+        LatencyMarginQuiet(&latency->margin, cursorStep, device->samplesPerSecond);
+    }
+
+    // past the write cursor we need to cover the play cursor's next move, plus the margin
+    u32 writeAhead = gap + step + latency->margin.frames;
+
+    AtomicStore(&latency->measuredStep, step);
+    AtomicStore(&latency->measuredGap, gap);
+    AtomicStore(&latency->writeAhead, writeAhead);
+    return writeAhead;
+}
+
+u32
+AudioRingFill(AudioRing* ring) {
+    return AtomicLoad(&ring->writeIndex) - AtomicLoad(&ring->readIndex);
+}
+
+// producer side. returns how many frames fit
+u32
+AudioRingWrite(AudioRing* ring, int16* frames, u32 frameCount) {
+    u32 write = ring->writeIndex;
+    u32 space = ring->capacity - (write - AtomicLoad(&ring->readIndex));
+    if(frameCount > space) {
+        frameCount = space;
+    }
+
+    u32 start = write & (ring->capacity - 1);
+    u32 firstCount = frameCount < ring->capacity - start ? frameCount : ring->capacity - start;
+
+    memcpy(ring->samples + start * 2, frames, firstCount * 2 * sizeof(int16));
+    memcpy(ring->samples, frames + firstCount * 2, (frameCount - firstCount) * 2 * sizeof(int16));
+
+    // publishes the frames to the consumer
+    AtomicStore(&ring->writeIndex, write + frameCount);
+    return frameCount;
+}
+
+// consumer side. returns how many frames were there
+u32
+AudioRingRead(AudioRing* ring, int16* frames, u32 frameCount) {
+    u32 read = ring->readIndex;
+    u32 available = AtomicLoad(&ring->writeIndex) - read;
+    if(frameCount > available) {
+        frameCount = available;
+    }
+
+    u32 start = read & (ring->capacity - 1);
+    u32 firstCount = frameCount < ring->capacity - start ? frameCount : ring->capacity - start;
+
+    memcpy(frames, ring->samples + start * 2, firstCount * 2 * sizeof(int16));
+    memcpy(frames + firstCount * 2, ring->samples, (frameCount - firstCount) * 2 * sizeof(int16));
+
+    // hands the space back to the producer
+    AtomicStore(&ring->readIndex, read + frameCount);
+    return frameCount;
+}
+
+// ring memory is the caller's, capacity frames of stereo int16
+void
+InitializeAudioOutput(AudioOutput* output, AudioDevice* device, int16* ringMemory, u32 capacity, u32 targetFill) {
+    assert((capacity & (capacity - 1)) == 0);
+    assert(targetFill <= capacity);
+
+    output->ring.samples = ringMemory;
+    output->ring.capacity = capacity;
+    output->ring.writeIndex = 0;
+    output->ring.readIndex = 0;
+
+    output->device = device;
+    output->targetFill = targetFill;
+    output->running = 1;
+
+    // ring side, 2 ms to 200 ms of margin on top of the longest frame
+    u32 samplesPerSecond = device->samplesPerSecond;
+    output->frameTime = {};
+    output->frameDrain = {};
+    output->lastReadIndex = 0;
+    InitializeLatencyMargin(&output->ringMargin, samplesPerSecond / 100, samplesPerSecond / 500, samplesPerSecond / 5);
+    output->underrunsSeen = 0;
+    output->ringNearMissesSeen = 0;
+
+    output->primed = false;
+    output->underruns = 0;
+    output->underrunFrames = 0;
+    output->framesPlayed = 0;
+    output->ringLowest = capacity;
+    output->ringNearMisses = 0;
+}
+
+// main thread, once a frame. the ring has to hold at least the longest frame's audio, plus a margin for
+// whatever the frame time alone doesn't show. a coarse play cursor takes whole steps, so a frame can drain more
+// than its own length: that is measured too, as the ring's read index moving between two calls
+void
+UpdateAudioLatency(AudioOutput* output, f32 frameSeconds) {
+    u32 samplesPerSecond = output->device->samplesPerSecond;
+    u32 frameFrames = (u32)(frameSeconds * samplesPerSecond);
+
+    u32 windowFrames = LATENCY_WINDOW_SECONDS * samplesPerSecond;
+    WindowMaxAdd(&output->frameTime, frameFrames, frameFrames, windowFrames);
+
+    u32 readIndex = AtomicLoad(&output->ring.readIndex);
+    WindowMaxAdd(&output->frameDrain, readIndex - output->lastReadIndex, frameFrames, windowFrames);
+    output->lastReadIndex = readIndex;
+
+    u32 underruns = AtomicLoad(&output->underruns);
+    u32 nearMisses = AtomicLoad(&output->ringNearMisses);
+
+    if(underruns != output->underrunsSeen) {
+        LatencyMarginMiss(&output->ringMargin);
+    } else if(nearMisses != output->ringNearMissesSeen) {
+        LatencyMarginNearMiss(&output->ringMargin);
+    } else {
+        LatencyMarginQuiet(&output->ringMargin, frameFrames, samplesPerSecond);
+    }
+
+    output->underrunsSeen = underruns;
+    output->ringNearMissesSeen = nearMisses;
+
+    u32 longest = WindowMaxGet(&output->frameTime);
+    u32 drain = WindowMaxGet(&output->frameDrain);
+    u32 target = (drain > longest ? drain : longest) + output->ringMargin.frames;
+    if(target > output->ring.capacity) {
+        target = output->ring.capacity;
+    }
+
+    AtomicStore(&output->targetFill, target);
+}
+
+// main thread: how many frames the game should write this frame to keep the ring at its target
+u32
+AudioOutputFramesWanted(AudioOutput* output) {
+    u32 fill = AudioRingFill(&output->ring);
+    u32 target = output->targetFill;
+    return fill < target ? target - fill : 0;
+}
+
+void
+AudioOutputWrite(AudioOutput* output, int16* frames, u32 frameCount) {
+    AudioRingWrite(&output->ring, frames, frameCount);
+}
+
+AudioOutputStats
+GetAudioOutputStats(AudioOutput* output) {
+    AudioOutputStats stats = {};
+    stats.underruns = AtomicLoad(&output->underruns);
+    stats.underrunFrames = AtomicLoad(&output->underrunFrames);
+    stats.framesPlayed = AtomicLoad(&output->framesPlayed);
+    stats.ringFill = AudioRingFill(&output->ring);
+    stats.ringLowest = AtomicLoad(&output->ringLowest);
+    stats.ringCapacity = output->ring.capacity;
+    stats.targetFill = AtomicLoad(&output->targetFill);
+
+    DeviceLatency* latency = &output->device->latency;
+    f32 framesToMs = 1000.0f / output->device->samplesPerSecond;
+    stats.deviceLatencyMs = AtomicLoad(&latency->writeAhead) * framesToMs;
+    stats.ringLatencyMs = stats.targetFill * framesToMs;
+    stats.totalLatencyMs = stats.deviceLatencyMs + stats.ringLatencyMs;
+    stats.cursorStepMs = AtomicLoad(&latency->measuredStep) * framesToMs;
+    stats.writeGapMs = AtomicLoad(&latency->measuredGap) * framesToMs;
+    stats.frameTimeMs = WindowMaxGet(&output->frameTime) * framesToMs;
+
+    stats.ringNearMisses = AtomicLoad(&output->ringNearMisses);
+    stats.deviceNearMisses = AtomicLoad(&latency->nearMisses);
+    stats.deviceMisses = AtomicLoad(&latency->misses);
+    return stats;
+}
+
+// body of the audio thread, returns once running is cleared
+void
+RunAudioOutput(AudioOutput* output) {
+    AudioDevice* device = output->device;
+
+    while(AtomicLoad(&output->running)) {
+        u32 wanted = device->wait(device);
+        bool pulled = wanted > 0;
+        u32 silentFrames = 0;
+
+        while(wanted > 0) {
+            u32 frameCount = wanted < AUDIO_SCRATCH_FRAMES ? wanted : AUDIO_SCRATCH_FRAMES;
+
+            if(!output->primed && AudioRingFill(&output->ring) > 0) {
+                output->primed = true;
+            }
+
+            u32 got = AudioRingRead(&output->ring, output->scratch, frameCount);
+            if(got < frameCount) {
+                // the device plays no matter what, so it gets silence instead
+                memset(output->scratch + got * 2, 0, (frameCount - got) * 2 * sizeof(int16));
+                silentFrames += frameCount - got;
+            }
+
+            device->submit(device, output->scratch, frameCount);
+
+            AtomicStore(&output->framesPlayed, output->framesPlayed + frameCount);
+            wanted -= frameCount;
+        }
+
+        if(output->primed && pulled) {
+            u32 left = AudioRingFill(&output->ring);
+            if(left < output->ringLowest) {
+                AtomicStore(&output->ringLowest, left);
+            }
+
+            if(silentFrames > 0) {
+                AtomicStore(&output->underruns, output->underruns + 1);
+                AtomicStore(&output->underrunFrames, output->underrunFrames + silentFrames);
+            } else if(left < output->ringMargin.minFrames) {
+                AtomicStore(&output->ringNearMisses, output->ringNearMisses + 1);
+            }
+        }
+    }
+}
+
+void
+StopAudioOutput(AudioOutput* output) {
+    AtomicStore(&output->running, 0);
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Simulated device
+// ---------------------------------------------------------------------------------
+
+// a device whose clock is whatever its driver says, so underruns and latency can be tested without hardware.
+// the driver advances the clock by each frame's simulated dt. the play cursor follows the clock in steps of
+// granularity and the write cursor sits writeGap past it, like a real device
+struct SimulatedAudioDevice {
+    AudioDevice device;
+
+    void (*sleep)(u32 microseconds); // the platform's, used while there is nothing to play
+
+    u32 granularity;
+    u32 writeGap;
+
+    u32 volatile clockFrames;    // frames the device has been told to play
+    u32 volatile servicedClock;  // last clock the audio thread had nothing more to do for
+    u32 volatile consumedFrames; // frames it has been handed
+    u32 lastPlayCursor;
+
+    u64 checksum; // over everything submitted, so the output can't be optimized away
+};
+
+u32
+SimulatedAudioDeviceWait(AudioDevice* device) {
+    SimulatedAudioDevice* simulated = (SimulatedAudioDevice*)device;
+
+    u32 clock = AtomicLoad(&simulated->clockFrames);
+    u32 playCursor = clock - (clock % simulated->granularity);
+    u32 writeCursor = playCursor + simulated->writeGap;
+
+    u32 cursorStep = playCursor - simulated->lastPlayCursor;
+    simulated->lastPlayCursor = playCursor;
+
+    int32 headroom = (int32)(simulated->consumedFrames - writeCursor);
+    u32 writeAhead = UpdateDeviceLatency(device, cursorStep, simulated->writeGap, headroom);
+
+    int32 due = (int32)(playCursor + writeAhead - simulated->consumedFrames);
+    if(due <= 0) {
+        AtomicStore(&simulated->servicedClock, clock);
+        simulated->sleep(100);
+        return 0;
+    }
+
+    return (u32)due;
+}
+
+void
+SimulatedAudioDeviceSubmit(AudioDevice* device, int16* frames, u32 frameCount) {
+    SimulatedAudioDevice* simulated = (SimulatedAudioDevice*)device;
+
+    u64 checksum = simulated->checksum;
+    for(u32 i = 0; i < frameCount * 2; i++) {
+        checksum = (checksum * 31) + (u16)frames[i];
+    }
+    simulated->checksum = checksum;
+
+    AtomicStore(&simulated->consumedFrames, simulated->consumedFrames + frameCount);
+}
+
+void
+InitializeSimulatedAudioDevice(SimulatedAudioDevice* simulated, u32 samplesPerSecond, u32 granularity, u32 writeGap,
+                               void (*sleep)(u32 microseconds)) {
+    *simulated = {};
+    simulated->device.samplesPerSecond = samplesPerSecond;
+    simulated->device.wait = SimulatedAudioDeviceWait;
+    simulated->device.submit = SimulatedAudioDeviceSubmit;
+    InitializeDeviceLatency(&simulated->device.latency, samplesPerSecond);
+
+    simulated->servicedClock = ~0u; // not even the starting clock is serviced until the audio thread has run
+    simulated->granularity = granularity > 0 ? granularity : 1;
+    simulated->writeGap = writeGap;
+    simulated->sleep = sleep;
+}
+
+void
+AdvanceSimulatedAudioDevice(SimulatedAudioDevice* simulated, u32 frameCount) {
+    AtomicStore(&simulated->clockFrames, simulated->clockFrames + frameCount);
+}
+
+// blocks until the audio thread has caught up with the clock. keeps a simulated run deterministic
+void
+SyncSimulatedAudioDevice(SimulatedAudioDevice* simulated) {
+    while(AtomicLoad(&simulated->servicedClock) != AtomicLoad(&simulated->clockFrames)) {
+        simulated->sleep(50);
+    }
+}
+
+#endif
@@ -0,0 +1,286 @@
+#ifndef ENGINE_IO_H
+#define ENGINE_IO_H
+
+// asynchronous file reads, shared by the platform layers
+//   submit     the game thread copies the request into a slot and appends it to a queue. nothing touches the disk yet
+//   dispatch   queued requests go to the io threads in batches: small requests share one work queue entry,
+//              so hundreds of tiny files cost a few wakeups instead of hundreds. dispatch stops while the bytes
+//              in flight are over a budget, a level load can't run away with memory bandwidth or the page cache
+//   complete   an io thread reads the batch with FileOpen / FileReadAt and publishes each slot's status.
+//              the slot goes back to the free list when the game sees the final status
+// a thread pool rather than io_uring or overlapped io, it runs on the same FileReadAt on both platforms
+
+const u32 FILE_READ_MAX_REQUESTS = 1024;                      // slots, submits past this many unfinished reads fail
+const u32 FILE_READ_MAX_IN_FLIGHT_BYTES = 8 * 1024 * 1024;   // bytes handed to the io threads at once
+const u32 FILE_READ_MAX_IN_FLIGHT_BATCHES = 64;               // stays well under the work queue's capacity
+const u32 FILE_READ_BATCH_BYTES = 256 * 1024;                 // requests are grouped until a batch reaches this
+const u32 FILE_READ_BATCH_REQUESTS = 32;
+const u32 FILE_READ_CHUNK_BYTES = 64 * 1024 * 1024;           // FileReadAt takes 32 bit sizes
+const u32 FILE_READ_PATH_LENGTH = 256;
+
+enum FileReadSlotState {
+    FileReadSlot_Free,
+    FileReadSlot_Queued,   // waiting for room in the budget
+    FileReadSlot_InFlight, // handed to an io thread
+    FileReadSlot_Done,
+    FileReadSlot_Failed,
+};
+
+struct FileReadSlot {
+    u32 volatile state;
+    u32 generation; // part of the handle, a stale handle can't see the slot's next request
+
+    char path[FILE_READ_PATH_LENGTH];
+    u64 offset;
+    void* destination;
+    u64 byteCount;
+    u64 bytesRead; // written by the io thread before the final state
+
+    FileReadSlot* nextInBatch;
+    u32 batchBytes; // first slot of a batch: what dispatch counted in flight for it
+};
+
+struct FileReadStats {
+    u32 submitted;
+    u32 completed;
+    u32 failed;
+    u32 batches;
+    u32 maxInFlightBytes;
+    u32 maxInFlightBatches;
+};
+
+// everything but the in flight counters belongs to the game thread, submits and polls come from there only
+struct FileReadQueue {
+    WorkQueue* workers;
+
+    FileReadSlot slots[FILE_READ_MAX_REQUESTS];
+    u32 freeSlots[FILE_READ_MAX_REQUESTS];
+    u32 freeCount;
+
+    // submitted but not dispatched, oldest first
+    u32 pending[FILE_READ_MAX_REQUESTS];
+    u32 pendingRead;
+    u32 pendingCount;
+
+    // added by dispatch, given back by the io threads
+    u32 volatile inFlightBytes;
+    u32 volatile inFlightBatches;
+
+    FileReadStats stats;
+};
+
+FileReadQueue GlobalFileReads;
+
+void
+InitializeFileReads(WorkQueue* workers) {
+    FileReadQueue* reads = &GlobalFileReads;
+    *reads = {};
+    reads->workers = workers;
+
+    for(u32 i = 0; i < FILE_READ_MAX_REQUESTS; i++) {
+        reads->freeSlots[i] = FILE_READ_MAX_REQUESTS - 1 - i;
+    }
+    reads->freeCount = FILE_READ_MAX_REQUESTS;
+}
+
+void
+FileReadBatchJob(void* data) {
+    PROFILE_ZONE("FileReadBatch");
+
+    FileReadSlot* slot = (FileReadSlot*)data;
+    u32 batchBytes = slot->batchBytes;
+
+    while(slot) {
+        // the next pointer is read first, the slot may be reused the moment its final state is out
+        FileReadSlot* next = slot->nextInBatch;
+
+        u32 result = FileReadSlot_Failed;
+        FileHandle* file = FileOpen(slot->path);
+        if(file) {
+            u64 bytesRead = 0;
+            while(bytesRead < slot->byteCount) {
+                u64 remaining = slot->byteCount - bytesRead;
+                u32 chunk = remaining < FILE_READ_CHUNK_BYTES ? (u32)remaining : FILE_READ_CHUNK_BYTES;
+
+                u32 read = FileReadAt(file, slot->offset + bytesRead, (u8*)slot->destination + bytesRead, chunk);
+                bytesRead += read;
+                if(read < chunk) {
+                    break; // end of the file
+                }
+            }
+            FileClose(file);
+
+            slot->bytesRead = bytesRead;
+            result = FileReadSlot_Done;
+        }
+
+        AtomicStore(&slot->state, result);
+        slot = next;
+    }
+
+    AtomicAdd(&GlobalFileReads.inFlightBytes, 0 - batchBytes);
+    AtomicAdd(&GlobalFileReads.inFlightBatches, (u32)-1);
+}
+
+// hands queued requests to the io threads, oldest first, as far as the budget allows.
+// called on every poll and once a frame by the engine. not on submit: requests made in the same frame
+// pile up first, so the small ones leave together
+void
+DispatchFileReads() {
+    FileReadQueue* reads = &GlobalFileReads;
+
+    while(reads->pendingCount > 0) {
+        u32 inFlightBytes = AtomicLoad(&reads->inFlightBytes);
+        u32 inFlightBatches = AtomicLoad(&reads->inFlightBatches);
+        if(inFlightBatches >= FILE_READ_MAX_IN_FLIGHT_BATCHES) {
+            break;
+        }
+
+        // build one batch. a request bigger than the whole budget still goes, alone, once nothing else is in flight
+        FileReadSlot* first = 0;
+        FileReadSlot* last = 0;
+        u64 batchBytes = 0;
+        u32 batchCount = 0;
+
+        while(reads->pendingCount > 0 && batchCount < FILE_READ_BATCH_REQUESTS && batchBytes < FILE_READ_BATCH_BYTES) {
+            FileReadSlot* slot = reads->slots + reads->pending[reads->pendingRead];
+
+            u64 total = inFlightBytes + batchBytes + slot->byteCount;
+            bool fits = total <= FILE_READ_MAX_IN_FLIGHT_BYTES || (inFlightBytes == 0 && batchCount == 0);
+            if(!fits) {
+                break;
+            }
+
+            reads->pendingRead = (reads->pendingRead + 1) % FILE_READ_MAX_REQUESTS;
+            reads->pendingCount--;
+
+            slot->state = FileReadSlot_InFlight;
+            slot->nextInBatch = 0;
+            if(last) {
+                last->nextInBatch = slot;
+            } else {
+                first = slot;
+            }
+            last = slot;
+
+            batchBytes += slot->byteCount;
+            batchCount++;
+        }
+
+        if(!first) {
+            break; // the next request waits for bytes to come back
+        }
+
+        // an oversized request is clamped in the counter, it is the only thing in flight anyway
+        first->batchBytes = batchBytes < FILE_READ_MAX_IN_FLIGHT_BYTES ? (u32)batchBytes : FILE_READ_MAX_IN_FLIGHT_BYTES;
+        u32 nowInFlight = AtomicAdd(&reads->inFlightBytes, first->batchBytes);
+        u32 nowBatches = AtomicAdd(&reads->inFlightBatches, 1);
+
+        reads->stats.batches++;
+        reads->stats.maxInFlightBytes = nowInFlight > reads->stats.maxInFlightBytes ? nowInFlight : reads->stats.maxInFlightBytes;
+        reads->stats.maxInFlightBatches = nowBatches > reads->stats.maxInFlightBatches ? nowBatches : reads->stats.maxInFlightBatches;
+
+        WorkQueueAdd(reads->workers, FileReadBatchJob, first);
+    }
+}
+
+FileReadHandle
+FileReadAsync(const char path[], u64 offset, void* destination, u64 byteCount) {
+    FileReadQueue* reads = &GlobalFileReads;
+    FileReadHandle handle = {};
+
+    u32 length = 0;
+    while(path[length]) {
+        length++;
+    }
+    if(length >= FILE_READ_PATH_LENGTH || reads->freeCount == 0) {
+        return handle;
+    }
+
+    u32 index = reads->freeSlots[--reads->freeCount];
+    FileReadSlot* slot = reads->slots + index;
+
+    memcpy(slot->path, path, length + 1);
+    slot->offset = offset;
+    slot->destination = destination;
+    slot->byteCount = byteCount;
+    slot->bytesRead = 0;
+    slot->generation = (slot->generation + 1) & 0xFFFF;
+    slot->state = FileReadSlot_Queued;
+
+    u32 pendingWrite = (reads->pendingRead + reads->pendingCount) % FILE_READ_MAX_REQUESTS;
+    reads->pending[pendingWrite] = index;
+    reads->pendingCount++;
+    reads->stats.submitted++;
+
+    handle.value = (slot->generation << 16) | (index + 1);
+    return handle;
+}
+
+FileReadSlot*
+GetFileReadSlot(FileReadHandle handle) {
+    u32 index = (handle.value & 0xFFFF) - 1;
+    if(handle.value == 0 || index >= FILE_READ_MAX_REQUESTS) {
+        return 0;
+    }
+
+    FileReadSlot* slot = GlobalFileReads.slots + index;
+    if(slot->state == FileReadSlot_Free || slot->generation != (handle.value >> 16)) {
+        return 0;
+    }
+
+    return slot;
+}
+
+FileReadStatus
+FileReadPoll(FileReadHandle handle, u64* bytesRead) {
+    FileReadQueue* reads = &GlobalFileReads;
+    DispatchFileReads();
+
+    FileReadSlot* slot = GetFileReadSlot(handle);
+    if(!slot) {
+        return FileRead_Invalid;
+    }
+
+    u32 state = AtomicLoad(&slot->state);
+    if(state != FileReadSlot_Done && state != FileReadSlot_Failed) {
+        return FileRead_Pending;
+    }
+
+    if(bytesRead) {
+        *bytesRead = slot->bytesRead;
+    }
+
+    // the final status has been seen, the slot is free for the next submit
+    slot->state = FileReadSlot_Free;
+    reads->freeSlots[reads->freeCount++] = (u32)(slot - reads->slots);
+
+    if(state == FileReadSlot_Done) {
+        reads->stats.completed++;
+        return FileRead_Done;
+    }
+
+    reads->stats.failed++;
+    return FileRead_Failed;
+}
+
+FileReadStatus
+FileReadWait(FileReadHandle handle, u64* bytesRead) {
+    for(;;) {
+        FileReadStatus status = FileReadPoll(handle, bytesRead);
+        if(status != FileRead_Pending) {
+            return status;
+        }
+
+        // read alongside the io threads instead of sleeping. everything in flight finishes, which frees budget
+        // for whatever is still queued ahead of this request
+        WorkQueueCompleteAll(GlobalFileReads.workers);
+    }
+}
+
+FileReadStats
+GetFileReadStats() {
+    return GlobalFileReads.stats;
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef ENGINE_MEMORY_H
+#define ENGINE_MEMORY_H
+
+// game memory, shared by the platform layers
+//   reserve   permanent and transient get their address space at a fixed base up front, so pointers inside a
+//             recorded snapshot are still valid when it is replayed. reserving costs no memory
+//   commit    the engine commits the first ARENA_COMMIT_STEP of permanent, the game's arena commits the rest in
+//             steps as it grows. transient is touched every frame and is committed whole, on large pages when
+//             the system hands them out: one tlb entry covers the frame's scratch
+//   guard     the gap after each block is reserved and never committed, running off the end of one faults
+//             instead of scribbling over the next
+//
+// layout from the base, every block starting on a GAME_MEMORY_ALIGN boundary
+//   permanent | guard, GAME_MEMORY_ALIGN | transient | guard, GAME_MEMORY_ALIGN
+
+const u64 GAME_MEMORY_ALIGN = 2 * 1024 * 1024; // the usual large page, a multiple of every page size in use
+
+struct GameMemoryLayout {
+    u64 permanentReserved;
+    u64 transientReserved;
+    bool transientLargePages;
+};
+
+u64
+AlignMemorySize(u64 size, u64 alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+// fills in memory's blocks and sizes. false when the range at base is taken or the first commit fails
+bool
+ReserveGameMemory(GameMemory* memory, u64 base, u64 permanentSize, u64 transientSize, GameMemoryLayout* layout) {
+    *layout = {};
+    layout->permanentReserved = AlignMemorySize(permanentSize, GAME_MEMORY_ALIGN);
+
+    u8* permanent = (u8*)base;
+    if(!MemoryReserve(permanent, layout->permanentReserved + GAME_MEMORY_ALIGN)) {
+        return false;
+    }
+
+    u64 firstCommit = ARENA_COMMIT_STEP < permanentSize ? ARENA_COMMIT_STEP : permanentSize;
+    if(!MemoryCommit(permanent, firstCommit)) {
+        MemoryRelease(permanent, layout->permanentReserved + GAME_MEMORY_ALIGN);
+        return false;
+    }
+
+    // large pages are reserved and committed in one go, they can't go into a range that is reserved already.
+    // the guard after them is reserved on its own then, otherwise it is the end of transient's reservation
+    u8* transient = permanent + layout->permanentReserved + GAME_MEMORY_ALIGN;
+    layout->transientReserved = AlignMemorySize(transientSize, GAME_MEMORY_ALIGN);
+
+    u64 largePageSize = MemoryLargePageSize();
+    if(largePageSize > 0 && GAME_MEMORY_ALIGN % largePageSize == 0) {
+        layout->transientLargePages = MemoryAllocateLarge(transient, layout->transientReserved) != 0;
+    }
+
+    if(layout->transientLargePages) {
+        MemoryReserve(transient + layout->transientReserved, GAME_MEMORY_ALIGN);
+    } else if(!MemoryReserve(transient, layout->transientReserved + GAME_MEMORY_ALIGN) || !MemoryCommit(transient, transientSize)) {
+        MemoryRelease(permanent, layout->permanentReserved + GAME_MEMORY_ALIGN);
+        return false;
+    }
+
+    memory->permanent = permanent;
+    memory->permanentSize = permanentSize;
+    memory->permanentCommitted = firstCommit;
+    memory->transient = transient;
+    memory->transientSize = transientSize;
+    return true;
+}
+
+// the guard after large pages is a reservation of its own, see above
+void
+ReleaseGameMemory(GameMemory* memory, GameMemoryLayout* layout) {
+    u8* transient = (u8*)memory->transient;
+    MemoryRelease(memory->permanent, layout->permanentReserved + GAME_MEMORY_ALIGN);
+
+    if(layout->transientLargePages) {
+        MemoryRelease(transient, layout->transientReserved);
+        MemoryRelease(transient + layout->transientReserved, GAME_MEMORY_ALIGN);
+    } else {
+        MemoryRelease(transient, layout->transientReserved + GAME_MEMORY_ALIGN);
+    }
+}
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef ENGINE_PACING_H
+#define ENGINE_PACING_H
+
+// frame pacing, shared by the platform layers
+//   clock      u64 ticks from the platform's high resolution counter. only differences are ever turned into seconds,
+//              so nothing loses precision however long the machine has been up
+//   wait       sleeps most of the way to the frame's deadline, then spins the rest. how early it stops sleeping
+//              follows the worst of the recent oversleeps, so a coarse scheduler costs spinning instead of late frames
+//   timestep   the game updates in fixed steps. a frame runs as many steps as its time covers, up to a limit,
+//              and what is left over becomes the interpolation factor for GameRender
+
+const u32 PACING_MAX_STEPS = 4;         // catch-up limit, time past this many steps in one frame is dropped
+const u32 PACING_HISTORY_FRAMES = 256;  // frame intervals kept for the stats
+const u32 PACING_SLEEP_HISTORY = 64;    // oversleeps the sleep margin is taken from
+
+struct PacingClock;
+typedef u64 PacingNowFunc(PacingClock* clock);
+typedef void PacingSleepFunc(PacingClock* clock, u32 milliseconds);
+
+struct PacingClock {
+    u64 ticksPerSecond;
+    PacingNowFunc* now;
+    PacingSleepFunc* sleep; // may oversleep by the scheduler's granularity
+    bool canSleep;          // false when the scheduler is too coarse to trust at all, the wait then only spins
+};
+
+struct FramePacer {
+    PacingClock* clock;
+
+    u64 frameTicks; // display interval
+    u64 stepTicks;  // simulation step
+    u32 maxSteps;
+
+    u64 deadline;   // when the current frame should end
+    u64 lastFrameEnd;
+    u64 accumulator; // simulation time owed, less than one step after BeginFrameSteps
+
+    // stop sleeping this long before a deadline. only changes when a sleep happens, so a scheduler too coarse
+    // to ever sleep under it keeps it there and the wait keeps spinning
+    u64 sleepMargin;
+    u64 minSleepMargin;
+    u64 oversleeps[PACING_SLEEP_HISTORY];
+    u32 sleepCount;
+
+    // stats
+    u64 intervals[PACING_HISTORY_FRAMES];
+    u32 intervalCount;
+    u32 missedDeadlines; // frames that ended more than a whole frame late, the schedule restarts after them
+    u32 droppedSteps;    // steps skipped by the catch-up limit
+};
+
+struct PacingStats {
+    f32 targetMs;
+    f32 meanMs, minMs, maxMs;
+    f32 jitterMs; // largest distance of any interval from the target
+    f32 sleepMarginMs;
+    u32 frames;
+    u32 missedDeadlines;
+    u32 droppedSteps;
+};
+
+u64
+SecondsToTicks(PacingClock* clock, f64 seconds) {
+    return (u64)(seconds * clock->ticksPerSecond + 0.5);
+}
+
+f64
+TicksToSeconds(PacingClock* clock, u64 ticks) {
+    return (f64)ticks / clock->ticksPerSecond;
+}
+
+void
+InitializeFramePacer(FramePacer* pacer, PacingClock* clock, f64 refreshHz, f64 simulationHz) {
+    *pacer = {};
+    pacer->clock = clock;
+
+    pacer->frameTicks = SecondsToTicks(clock, 1.0 / refreshHz);
+    pacer->stepTicks = SecondsToTicks(clock, 1.0 / simulationHz);
+    pacer->maxSteps = PACING_MAX_STEPS;
+
+    // 2 ms covers a 1 ms scheduler, anything worse is learned on the first oversleep
+    pacer->minSleepMargin = SecondsToTicks(clock, 0.002);
+    pacer->sleepMargin = pacer->minSleepMargin;
+
+    u64 now = clock->now(clock);
+    pacer->deadline = now + pacer->frameTicks;
+    pacer->lastFrameEnd = now;
+}
+
+f32
+PacerStepSeconds(FramePacer* pacer) {
+    return (f32)TicksToSeconds(pacer->clock, pacer->stepTicks);
+}
+
+// adds the last frame's time and returns how many fixed steps to run now
+u32
+BeginFrameSteps(FramePacer* pacer, u64 elapsedTicks) {
+    pacer->accumulator += elapsedTicks;
+
+    u64 steps = pacer->accumulator / pacer->stepTicks;
+    pacer->accumulator -= steps * pacer->stepTicks;
+
+    // a long stall would otherwise ask for more steps than a frame can run, and the next frame for even more
+    if(steps > pacer->maxSteps) {
+        pacer->droppedSteps += (u32)(steps - pacer->maxSteps);
+        steps = pacer->maxSteps;
+    }
+
+    return (u32)steps;
+}
+
+// how far between the last two simulated states the display is, 0..1
+f32
+PacerInterpolation(FramePacer* pacer) {
+    return (f32)pacer->accumulator / (f32)pacer->stepTicks;
+}
+
+void
+WaitUntil(FramePacer* pacer, u64 deadline) {
+    PacingClock* clock = pacer->clock;
+
+    for(;;) {
+        u64 now = clock->now(clock);
+        if(now >= deadline) {
+            break;
+        }
+
+        u64 remaining = deadline - now;
+        if(clock->canSleep && remaining > pacer->sleepMargin) {
+            u32 milliseconds = (u32)((remaining - pacer->sleepMargin) * 1000 / clock->ticksPerSecond);
+
+            if(milliseconds > 0) {
+                clock->sleep(clock, milliseconds);
+
+                // learn how late the scheduler wakes us, that much of every wait has to be spun
+                u64 slept = clock->now(clock) - now;
+                u64 requested = milliseconds * clock->ticksPerSecond / 1000;
+                pacer->oversleeps[pacer->sleepCount % PACING_SLEEP_HISTORY] = slept > requested ? slept - requested : 0;
+                pacer->sleepCount++;
+
+                u32 count = pacer->sleepCount < PACING_SLEEP_HISTORY ? pacer->sleepCount : PACING_SLEEP_HISTORY;
+                u64 worst = 0;
+                for(u32 i = 0; i < count; i++) {
+                    worst = pacer->oversleeps[i] > worst ? pacer->oversleeps[i] : worst;
+                }
+
+                // half the minimum on top, the spin needs a little room to see the deadline coming
+                u64 margin = worst + pacer->minSleepMargin / 2;
+                pacer->sleepMargin = margin > pacer->minSleepMargin ? margin : pacer->minSleepMargin;
+                continue;
+            }
+        }
+
+        _mm_pause();
+    }
+}
+
+// ends the frame on its deadline and returns the frame's length, wait included
+u64
+WaitForFrameDeadline(FramePacer* pacer) {
+    WaitUntil(pacer, pacer->deadline);
+
+    u64 now = pacer->clock->now(pacer->clock);
+    u64 elapsed = now - pacer->lastFrameEnd;
+    pacer->lastFrameEnd = now;
+
+    pacer->intervals[pacer->intervalCount % PACING_HISTORY_FRAMES] = elapsed;
+    pacer->intervalCount++;
+
+    // deadlines follow a fixed grid so small overshoots don't add up. after a long miss the grid restarts from now,
+    // otherwise the next frames would rush to catch up
+    pacer->deadline += pacer->frameTicks;
+    if(now > pacer->deadline) {
+        pacer->missedDeadlines++;
+        pacer->deadline = now + pacer->frameTicks;
+    }
+
+    return elapsed;
+}
+
+PacingStats
+GetPacingStats(FramePacer* pacer) {
+    PacingStats stats = {};
+
+    f64 toMs = 1000.0 / pacer->clock->ticksPerSecond;
+    stats.targetMs = (f32)(pacer->frameTicks * toMs);
+    stats.sleepMarginMs = (f32)(pacer->sleepMargin * toMs);
+    stats.missedDeadlines = pacer->missedDeadlines;
+    stats.droppedSteps = pacer->droppedSteps;
+
+    u32 count = pacer->intervalCount < PACING_HISTORY_FRAMES ? pacer->intervalCount : PACING_HISTORY_FRAMES;
+    stats.frames = count;
+    if(count == 0) {
+        return stats;
+    }
+
+    u64 total = 0;
+    u64 shortest = ~0ull;
+    u64 longest = 0;
+    for(u32 i = 0; i < count; i++) {
+        u64 interval = pacer->intervals[i];
+        total += interval;
+        shortest = interval < shortest ? interval : shortest;
+        longest = interval > longest ? interval : longest;
+    }
+
+    stats.meanMs = (f32)(total * toMs / count);
+    stats.minMs = (f32)(shortest * toMs);
+    stats.maxMs = (f32)(longest * toMs);
+
+    f32 early = stats.targetMs - stats.minMs;
+    f32 late = stats.maxMs - stats.targetMs;
+    stats.jitterMs = early > late ? early : late;
+
+    return stats;
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Mock clock
+// ---------------------------------------------------------------------------------
+
+// time only moves when something asks it to: every read costs a little, like a spin loop iteration,
+// and every sleep oversleeps by a fixed amount plus some noise, like a real scheduler
+struct MockClock {
+    PacingClock clock;
+
+    u64 ticks;
+    u64 ticksPerRead;
+    u64 oversleepTicks;
+    u64 oversleepNoiseTicks;
+    u32 seed;
+};
+
+u64
+MockClockNow(PacingClock* clock) {
+    MockClock* mock = (MockClock*)clock;
+    mock->ticks += mock->ticksPerRead;
+    return mock->ticks;
+}
+
+void
+MockClockSleep(PacingClock* clock, u32 milliseconds) {
+    MockClock* mock = (MockClock*)clock;
+
+    mock->seed = mock->seed * 1664525 + 1013904223;
+    u64 noise = mock->oversleepNoiseTicks ? (mock->seed >> 8) % mock->oversleepNoiseTicks : 0;
+
+    mock->ticks += milliseconds * clock->ticksPerSecond / 1000 + mock->oversleepTicks + noise;
+}
+
+void
+InitializeMockClock(MockClock* mock, u64 ticksPerSecond, u64 ticksPerRead, u64 oversleepTicks, u64 oversleepNoiseTicks) {
+    *mock = {};
+    mock->clock.ticksPerSecond = ticksPerSecond;
+    mock->clock.now = MockClockNow;
+    mock->clock.sleep = MockClockSleep;
+    mock->clock.canSleep = true;
+
+    mock->ticksPerRead = ticksPerRead;
+    mock->oversleepTicks = oversleepTicks;
+    mock->oversleepNoiseTicks = oversleepNoiseTicks;
+    mock->seed = 1;
+}
+
+// simulated frame work
+void
+AdvanceMockClock(MockClock* mock, u64 ticks) {
+    mock->ticks += ticks;
+}
+
+#endif
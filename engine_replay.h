@@ -0,0 +1,70 @@
+#ifndef ENGINE_REPLAY_H
+#define ENGINE_REPLAY_H
+
+// input recording, shared by the platform layers
+// a recording is the permanent memory at the moment recording started plus every update step's input and dt.
+// playback restores the snapshot and feeds the frames back in a loop, so the same workload runs again and again
+//
+// file layout
+//   0                        ReplayHeader
+//   REPLAY_SNAPSHOT_OFFSET   snapshot of the used part of permanent memory, whole pages
+//   frameOffset              one RecordedFrame per frame
+//
+// the snapshot starts on a 64 KB boundary, the coarsest granularity a view can be mapped at (windows),
+// so both platforms can map it straight from the file
+
+const u32 REPLAY_MAGIC = 0x59504C52; // "RLPY"
+const u32 REPLAY_VERSION = 1;
+
+const u64 REPLAY_SNAPSHOT_OFFSET = 64 * 1024;
+const u64 REPLAY_PAGE_SIZE = 4096;
+
+enum ReplayMode {
+    Replay_Idle,
+    Replay_Recording,
+    Replay_Playing,
+};
+
+struct ReplayHeader {
+    u32 magic;
+    u32 version;
+
+    u64 permanentSize;
+    u64 snapshotBytes;
+
+    u64 frameOffset;
+    u64 frameCount;
+    u32 frameSize; // a GameInput layout change makes old recordings unreadable
+};
+
+struct RecordedFrame {
+    GameInput input;
+    f32 dt;
+};
+
+// only the used front of permanent memory is saved, rounded up to whole pages
+u64
+ReplaySnapshotBytes(GameMemory* memory) {
+    u64 used = memory->stats.memory.permanentUsed;
+    u64 bytes = (used + REPLAY_PAGE_SIZE - 1) & ~(REPLAY_PAGE_SIZE - 1);
+
+    if(bytes == 0) {
+        bytes = REPLAY_PAGE_SIZE;
+    }
+    if(bytes > (u64)memory->permanentSize) {
+        bytes = memory->permanentSize;
+    }
+
+    return bytes;
+}
+
+bool
+ReplayHeaderIsValid(ReplayHeader* header, GameMemory* memory) {
+    return header->magic == REPLAY_MAGIC &&
+           header->version == REPLAY_VERSION &&
+           header->permanentSize == (u64)memory->permanentSize &&
+           header->frameSize == sizeof(RecordedFrame) &&
+           header->frameCount > 0;
+}
+
+#endif
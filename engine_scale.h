@@ -0,0 +1,485 @@
+#ifndef ENGINE_SCALE_H
+#define ENGINE_SCALE_H
+
+// presentation scaler, shared by the platform layers. the game draws at its own resolution, this stretches it
+// to the window's before present, so the os only ever copies pixels 1:1
+//   nearest    whole number factors. a source row is widened once, then copied to the other rows it covers
+//   bilinear   anything else. separable: every source row that is needed is filtered horizontally once, into
+//              a two row cache, and each output row is a vertical blend of the two rows around it.
+//              the vertical blend is the only per output pixel work, and it is a straight simd loop
+// only the dirty rects are scaled. each one is split into bands of output rows, run on a work queue
+
+const u32 SCALE_MAX_BANDS = 16;     // per rect, each band has a row cache of its own
+const int32 SCALE_MIN_BAND_ROWS = 16; // fewer rows than this aren't worth a job
+
+enum ScaleFilter {
+    ScaleFilter_Nearest,  // integer factors only
+    ScaleFilter_Bilinear,
+};
+
+// where an output column or row samples the source: between index0 and index1, weight is index1's share of 256
+struct ScaleTap {
+    int32 index0, index1;
+    u32 weight;
+};
+
+// vertical: two whole rows blended with one weight. horizontal: every output pixel from its own pair of source pixels
+typedef void ScaleBlendRowsFunc(u32* dest, u32* a, u32* b, u32 weight, int32 count);
+typedef void ScaleFilterRowFunc(u32* dest, u32* source, ScaleTap* taps, int32 count);
+
+void ScaleBlendRows_Scalar(u32* dest, u32* a, u32* b, u32 weight, int32 count);
+void ScaleBlendRows_SSE2(u32* dest, u32* a, u32* b, u32 weight, int32 count);
+TARGET_AVX2 void ScaleBlendRows_AVX2(u32* dest, u32* a, u32* b, u32 weight, int32 count);
+
+void ScaleFilterRow_Scalar(u32* dest, u32* source, ScaleTap* taps, int32 count);
+void ScaleFilterRow_SSE2(u32* dest, u32* source, ScaleTap* taps, int32 count);
+TARGET_AVX2 void ScaleFilterRow_AVX2(u32* dest, u32* source, ScaleTap* taps, int32 count);
+
+struct Scaler;
+
+struct ScaleBand {
+    Scaler* scaler;
+    GraphicsBuffer* source;
+    Rect32 rect; // output pixels
+
+    u32* rows[2];  // bilinear: the cached source rows, filtered horizontally over the rect's columns
+    int32 cached[2]; // which source rows they are, -1 for none
+};
+
+struct Scaler {
+    GraphicsBuffer output;
+    int32 sourceWidth, sourceHeight;
+
+    ScaleFilter filter;
+    int32 factorX, factorY; // nearest
+    ScaleTap* tapsX;        // bilinear, one per output column
+    ScaleTap* tapsY;        // and one per output row
+
+    ScaleBlendRowsFunc* blendRows;
+    ScaleFilterRowFunc* filterRow;
+    u32* rowMemory; // two rows of output width per band
+
+    ScaleBand bands[SCALE_MAX_BANDS];
+};
+
+// memory the platform hands to InitializeScaler for an output this size: pixels, taps and row caches, cache line aligned
+u64
+ScalerMemoryBytes(int32 outputWidth, int32 outputHeight) {
+    u64 pixels = (u64)outputWidth * outputHeight * sizeof(u32);
+    u64 taps = (u64)(outputWidth + outputHeight) * sizeof(ScaleTap);
+    u64 rows = (u64)SCALE_MAX_BANDS * 2 * outputWidth * sizeof(u32);
+    return pixels + taps + rows + 2 * 64;
+}
+
+// centres line up: output pixel i covers the same spot as source position (i + 0.5) * source / output - 0.5.
+// 16.16 fixed point, the weight keeps the top 8 bits of the fraction
+void
+BuildScaleTaps(ScaleTap* taps, int32 outputCount, int32 sourceCount) {
+    for(int32 i = 0; i < outputCount; i++) {
+        int64 position = ((int64)(2 * i + 1) * sourceCount * 65536) / (2 * outputCount) - 32768;
+        position = position < 0 ? 0 : position;
+
+        int32 index = (int32)(position >> 16);
+        u32 weight = (u32)(position >> 8) & 0xFF;
+        if(index >= sourceCount - 1) {
+            index = sourceCount - 1;
+            weight = 0;
+        }
+
+        taps[i].index0 = index;
+        taps[i].index1 = index + 1 < sourceCount ? index + 1 : index;
+        taps[i].weight = weight;
+    }
+}
+
+// the output is bottom row first like the game's buffer, the platform presents it as it is.
+// nearest is picked when both factors are whole numbers, unless filter says bilinear
+void
+InitializeScaler(Scaler* scaler, void* memory, int32 sourceWidth, int32 sourceHeight,
+                 int32 outputWidth, int32 outputHeight, ScaleFilter filter) {
+    *scaler = {};
+    scaler->sourceWidth = sourceWidth;
+    scaler->sourceHeight = sourceHeight;
+
+    u8* at = (u8*)(((u64)memory + 63) & ~63ull);
+    scaler->output.width = outputWidth;
+    scaler->output.height = outputHeight;
+    scaler->output.bytesPerPixel = 4;
+    scaler->output.bytesPerRow = outputWidth * 4;
+    scaler->output.data = at;
+    at += (u64)outputWidth * outputHeight * sizeof(u32);
+
+    bool whole = (outputWidth % sourceWidth) == 0 && (outputHeight % sourceHeight) == 0;
+    scaler->filter = whole ? filter : ScaleFilter_Bilinear;
+    scaler->factorX = outputWidth / sourceWidth;
+    scaler->factorY = outputHeight / sourceHeight;
+
+    scaler->tapsX = (ScaleTap*)at;
+    at += (u64)outputWidth * sizeof(ScaleTap);
+    scaler->tapsY = (ScaleTap*)at;
+    at += (u64)outputHeight * sizeof(ScaleTap);
+    BuildScaleTaps(scaler->tapsX, outputWidth, sourceWidth);
+    BuildScaleTaps(scaler->tapsY, outputHeight, sourceHeight);
+
+    scaler->rowMemory = (u32*)(((u64)at + 63) & ~63ull);
+    bool avx2 = QueryCpuFeatures().avx2;
+    scaler->blendRows = avx2 ? ScaleBlendRows_AVX2 : ScaleBlendRows_SSE2;
+    scaler->filterRow = avx2 ? ScaleFilterRow_AVX2 : ScaleFilterRow_SSE2;
+}
+
+// the output pixels a source rect reaches. bilinear output pixels also read the source pixel next to them
+Rect32
+ScaledRect(Scaler* scaler, Rect32 rect) {
+    Rect32 result;
+    if(scaler->filter == ScaleFilter_Nearest) {
+        result.minX = rect.minX * scaler->factorX;
+        result.minY = rect.minY * scaler->factorY;
+        result.maxX = rect.maxX * scaler->factorX;
+        result.maxY = rect.maxY * scaler->factorY;
+    } else {
+        int64 outputWidth = scaler->output.width;
+        int64 outputHeight = scaler->output.height;
+        result.minX = (int32)(((int64)rect.minX - 1) * outputWidth / scaler->sourceWidth);
+        result.minY = (int32)(((int64)rect.minY - 1) * outputHeight / scaler->sourceHeight);
+        result.maxX = (int32)((((int64)rect.maxX + 1) * outputWidth + scaler->sourceWidth - 1) / scaler->sourceWidth);
+        result.maxY = (int32)((((int64)rect.maxY + 1) * outputHeight + scaler->sourceHeight - 1) / scaler->sourceHeight);
+    }
+
+    Rect32 output = { 0, 0, scaler->output.width, scaler->output.height };
+    return Intersect(result, output);
+}
+
+// ---------------------------------------------------------------------------------
+// Nearest
+// ---------------------------------------------------------------------------------
+
+// one source row out to dest, every pixel factor times
+void
+ScaleWidenRow(u32* dest, u32* source, int32 count, int32 factor) {
+    int32 i = 0;
+
+    if(factor == 2) {
+        for(; i + 4 <= count; i += 4) {
+            __m128i pixels = _mm_loadu_si128((__m128i*)(source + i));
+            _mm_storeu_si128((__m128i*)(dest + 2 * i), _mm_unpacklo_epi32(pixels, pixels));
+            _mm_storeu_si128((__m128i*)(dest + 2 * i + 4), _mm_unpackhi_epi32(pixels, pixels));
+        }
+    } else if(factor == 3) {
+        for(; i + 4 <= count; i += 4) {
+            __m128i pixels = _mm_loadu_si128((__m128i*)(source + i));
+            _mm_storeu_si128((__m128i*)(dest + 3 * i), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 0, 0, 0)));
+            _mm_storeu_si128((__m128i*)(dest + 3 * i + 4), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(2, 2, 1, 1)));
+            _mm_storeu_si128((__m128i*)(dest + 3 * i + 8), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 2)));
+        }
+    } else if(factor == 4) {
+        for(; i + 4 <= count; i += 4) {
+            __m128i pixels = _mm_loadu_si128((__m128i*)(source + i));
+            _mm_storeu_si128((__m128i*)(dest + 4 * i), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(0, 0, 0, 0)));
+            _mm_storeu_si128((__m128i*)(dest + 4 * i + 4), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 1, 1, 1)));
+            _mm_storeu_si128((__m128i*)(dest + 4 * i + 8), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(2, 2, 2, 2)));
+            _mm_storeu_si128((__m128i*)(dest + 4 * i + 12), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 3)));
+        }
+    }
+
+    for(; i < count; i++) {
+        for(int32 k = 0; k < factor; k++) {
+            dest[i * factor + k] = source[i];
+        }
+    }
+}
+
+// the band's rect in output pixels is widened from the source a row at a time. the rect's edges can cut
+// through a source pixel, so a whole source span is widened into the first row and the rect's part copied out
+void
+ScaleBandNearest(ScaleBand* band) {
+    Scaler* scaler = band->scaler;
+    GraphicsBuffer* source = band->source;
+    GraphicsBuffer* output = &scaler->output;
+    Rect32 rect = band->rect;
+
+    int32 sourceMinX = rect.minX / scaler->factorX;
+    int32 sourceMaxX = (rect.maxX + scaler->factorX - 1) / scaler->factorX;
+    int32 skip = rect.minX - sourceMinX * scaler->factorX;
+    int32 width = rect.maxX - rect.minX;
+    u32* widened = band->rows[0];
+
+    int32 y = rect.minY;
+    while(y < rect.maxY) {
+        int32 sourceY = y / scaler->factorY;
+        int32 rowsFromSource = (sourceY + 1) * scaler->factorY;
+        rowsFromSource = (rowsFromSource < rect.maxY ? rowsFromSource : rect.maxY) - y;
+
+        u32* sourceRow = (u32*)(source->data + (u64)sourceY * source->bytesPerRow) + sourceMinX;
+        u32* first = (u32*)(output->data + (u64)y * output->bytesPerRow) + rect.minX;
+
+        if(skip == 0 && width == (sourceMaxX - sourceMinX) * scaler->factorX) {
+            ScaleWidenRow(first, sourceRow, sourceMaxX - sourceMinX, scaler->factorX);
+        } else {
+            ScaleWidenRow(widened, sourceRow, sourceMaxX - sourceMinX, scaler->factorX);
+            memcpy(first, widened + skip, width * sizeof(u32));
+        }
+
+        for(int32 k = 1; k < rowsFromSource; k++) {
+            memcpy((u8*)first + (u64)k * output->bytesPerRow, first, width * sizeof(u32));
+        }
+
+        y += rowsFromSource;
+    }
+}
+
+// ---------------------------------------------------------------------------------
+// Bilinear
+// ---------------------------------------------------------------------------------
+
+// per channel (a * (256 - weight) + b * weight) >> 8, in every kernel. two channels at a time in a u32,
+// each product stays under 16 bits so the lanes never carry into each other
+inline u32
+ScaleBlendPixel(u32 a, u32 b, u32 weight) {
+    u32 inverse = 256 - weight;
+    u32 evenChannels = ((a & 0x00FF00FF) * inverse + (b & 0x00FF00FF) * weight) >> 8;
+    u32 oddChannels = ((a >> 8) & 0x00FF00FF) * inverse + ((b >> 8) & 0x00FF00FF) * weight;
+    return (evenChannels & 0x00FF00FF) | (oddChannels & 0xFF00FF00);
+}
+
+void
+ScaleBlendRows_Scalar(u32* dest, u32* a, u32* b, u32 weight, int32 count) {
+    for(int32 i = 0; i < count; i++) {
+        dest[i] = ScaleBlendPixel(a[i], b[i], weight);
+    }
+}
+
+// widened to 16 bits a channel. a * inverse + b * weight is at most 255 * 256, it fits without saturating
+CALLED_FROM_AVX2 void
+ScaleBlendRows_SSE2(u32* dest, u32* a, u32* b, u32 weight, int32 count) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i weightB = _mm_set1_epi16((short)weight);
+    __m128i weightA = _mm_set1_epi16((short)(256 - weight));
+
+    int32 i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128i pixelsA = _mm_loadu_si128((__m128i*)(a + i));
+        __m128i pixelsB = _mm_loadu_si128((__m128i*)(b + i));
+
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixelsA, zero), weightA),
+                                    _mm_mullo_epi16(_mm_unpacklo_epi8(pixelsB, zero), weightB));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixelsA, zero), weightA),
+                                     _mm_mullo_epi16(_mm_unpackhi_epi8(pixelsB, zero), weightB));
+
+        _mm_storeu_si128((__m128i*)(dest + i), _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8)));
+    }
+
+    ScaleBlendRows_Scalar(dest + i, a + i, b + i, weight, count - i);
+}
+
+TARGET_AVX2 void
+ScaleBlendRows_AVX2(u32* dest, u32* a, u32* b, u32 weight, int32 count) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i weightB = _mm256_set1_epi16((short)weight);
+    __m256i weightA = _mm256_set1_epi16((short)(256 - weight));
+
+    int32 i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256i pixelsA = _mm256_loadu_si256((__m256i*)(a + i));
+        __m256i pixelsB = _mm256_loadu_si256((__m256i*)(b + i));
+
+        __m256i low = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(pixelsA, zero), weightA),
+                                       _mm256_mullo_epi16(_mm256_unpacklo_epi8(pixelsB, zero), weightB));
+        __m256i high = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(pixelsA, zero), weightA),
+                                        _mm256_mullo_epi16(_mm256_unpackhi_epi8(pixelsB, zero), weightB));
+
+        _mm256_storeu_si256((__m256i*)(dest + i), _mm256_packus_epi16(_mm256_srli_epi16(low, 8), _mm256_srli_epi16(high, 8)));
+    }
+
+    ScaleBlendRows_SSE2(dest + i, a + i, b + i, weight, count - i);
+}
+
+void
+ScaleFilterRow_Scalar(u32* dest, u32* source, ScaleTap* taps, int32 count) {
+    for(int32 i = 0; i < count; i++) {
+        dest[i] = ScaleBlendPixel(source[taps[i].index0], source[taps[i].index1], taps[i].weight);
+    }
+}
+
+// 4 pixels at a time. the source pixels are picked up one by one, the blend is the same as ScaleBlendRows
+// with a weight per pixel: each weight is copied to both 16 bit halves of its lane, then next to itself
+CALLED_FROM_AVX2 void
+ScaleFilterRow_SSE2(u32* dest, u32* source, ScaleTap* taps, int32 count) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i full = _mm_set1_epi16(256);
+
+    int32 i = 0;
+    for(; i + 4 <= count; i += 4) {
+        ScaleTap* tap = taps + i;
+        __m128i a = _mm_setr_epi32(source[tap[0].index0], source[tap[1].index0], source[tap[2].index0], source[tap[3].index0]);
+        __m128i b = _mm_setr_epi32(source[tap[0].index1], source[tap[1].index1], source[tap[2].index1], source[tap[3].index1]);
+        __m128i weight = _mm_setr_epi32(tap[0].weight, tap[1].weight, tap[2].weight, tap[3].weight);
+        weight = _mm_or_si128(weight, _mm_slli_epi32(weight, 16));
+
+        __m128i weightLow = _mm_unpacklo_epi32(weight, weight);
+        __m128i weightHigh = _mm_unpackhi_epi32(weight, weight);
+
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_sub_epi16(full, weightLow)),
+                                    _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), weightLow));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_sub_epi16(full, weightHigh)),
+                                     _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), weightHigh));
+
+        _mm_storeu_si128((__m128i*)(dest + i), _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8)));
+    }
+
+    ScaleFilterRow_Scalar(dest + i, source, taps + i, count - i);
+}
+
+// 8 pixels at a time, taps and pixels both gathered. unpacks work inside 128 bit lanes, and so do the weights
+TARGET_AVX2 void
+ScaleFilterRow_AVX2(u32* dest, u32* source, ScaleTap* taps, int32 count) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i full = _mm256_set1_epi16(256);
+    __m256i tapOffsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21); // ScaleTap is three ints
+
+    int32 i = 0;
+    for(; i + 8 <= count; i += 8) {
+        int* tap = (int*)(taps + i);
+        __m256i index0 = _mm256_i32gather_epi32(tap, tapOffsets, 4);
+        __m256i index1 = _mm256_i32gather_epi32(tap + 1, tapOffsets, 4);
+        __m256i weight = _mm256_i32gather_epi32(tap + 2, tapOffsets, 4);
+
+        __m256i a = _mm256_i32gather_epi32((int*)source, index0, 4);
+        __m256i b = _mm256_i32gather_epi32((int*)source, index1, 4);
+        weight = _mm256_or_si256(weight, _mm256_slli_epi32(weight, 16));
+
+        __m256i weightLow = _mm256_unpacklo_epi32(weight, weight);
+        __m256i weightHigh = _mm256_unpackhi_epi32(weight, weight);
+
+        __m256i low = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_sub_epi16(full, weightLow)),
+                                       _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), weightLow));
+        __m256i high = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_sub_epi16(full, weightHigh)),
+                                        _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), weightHigh));
+
+        _mm256_storeu_si256((__m256i*)(dest + i), _mm256_packus_epi16(_mm256_srli_epi16(low, 8), _mm256_srli_epi16(high, 8)));
+    }
+
+    ScaleFilterRow_SSE2(dest + i, source, taps + i, count - i);
+}
+
+// a source row filtered horizontally over the band's columns, from the cache when it is already there
+u32*
+ScaleCachedRow(ScaleBand* band, int32 sourceY) {
+    for(u32 i = 0; i < 2; i++) {
+        if(band->cached[i] == sourceY) {
+            return band->rows[i];
+        }
+    }
+
+    // output rows only move up, so the row further down is never needed again
+    u32 slot = band->cached[0] < band->cached[1] ? 0 : 1;
+    band->cached[slot] = sourceY;
+
+    u32* sourceRow = (u32*)(band->source->data + (u64)sourceY * band->source->bytesPerRow);
+    band->scaler->filterRow(band->rows[slot], sourceRow, band->scaler->tapsX + band->rect.minX, band->rect.maxX - band->rect.minX);
+
+    return band->rows[slot];
+}
+
+void
+ScaleBandBilinear(ScaleBand* band) {
+    Scaler* scaler = band->scaler;
+    GraphicsBuffer* output = &scaler->output;
+    Rect32 rect = band->rect;
+
+    band->cached[0] = -1;
+    band->cached[1] = -1;
+
+    for(int32 y = rect.minY; y < rect.maxY; y++) {
+        ScaleTap* tap = scaler->tapsY + y;
+        u32* a = ScaleCachedRow(band, tap->index0);
+        u32* b = ScaleCachedRow(band, tap->index1);
+
+        u32* dest = (u32*)(output->data + (u64)y * output->bytesPerRow) + rect.minX;
+        scaler->blendRows(dest, a, b, tap->weight, rect.maxX - rect.minX);
+    }
+}
+
+void
+ScaleBandCallback(void* data) {
+    PROFILE_ZONE("ScaleBand");
+
+    ScaleBand* band = (ScaleBand*)data;
+    if(band->scaler->filter == ScaleFilter_Nearest) {
+        ScaleBandNearest(band);
+    } else {
+        ScaleBandBilinear(band);
+    }
+}
+
+// ---------------------------------------------------------------------------------
+// Scale
+// ---------------------------------------------------------------------------------
+
+// one output rect, in bands of rows on the queue. null runs it on the calling thread.
+// nearest bands start on a source row boundary, so no two bands widen the same source row
+void
+ScaleOutputRect(Scaler* scaler, WorkQueue* queue, GraphicsBuffer* source, Rect32 rect) {
+    if(IsEmpty(rect)) {
+        return;
+    }
+
+    int32 rows = rect.maxY - rect.minY;
+    int32 bandCount = queue ? rows / SCALE_MIN_BAND_ROWS : 1;
+    bandCount = bandCount < 1 ? 1 : bandCount > (int32)SCALE_MAX_BANDS ? (int32)SCALE_MAX_BANDS : bandCount;
+
+    int32 rowAlign = scaler->filter == ScaleFilter_Nearest ? scaler->factorY : 1;
+    int32 bandRows = (rows + bandCount - 1) / bandCount;
+
+    int32 y = rect.minY;
+    u32 used = 0;
+    while(y < rect.maxY) {
+        int32 end = y + bandRows;
+        end = ((end + rowAlign - 1) / rowAlign) * rowAlign;
+        end = end < rect.maxY ? end : rect.maxY;
+
+        ScaleBand* band = scaler->bands + used;
+        band->scaler = scaler;
+        band->source = source;
+        band->rect = { rect.minX, y, rect.maxX, end };
+        band->rows[0] = scaler->rowMemory + (u64)used * 2 * scaler->output.width;
+        band->rows[1] = band->rows[0] + scaler->output.width;
+        used++;
+
+        if(queue) {
+            WorkQueueAdd(queue, ScaleBandCallback, band);
+        } else {
+            ScaleBandCallback(band);
+        }
+        y = end;
+    }
+
+    if(queue) {
+        WorkQueueCompleteAll(queue);
+    }
+}
+
+// the source's dirty rects into the output. returns the output rects that changed in dirtyOutput,
+// for the platform to present
+void
+ScaleBuffer(Scaler* scaler, WorkQueue* queue, GraphicsBuffer* source, DirtyRegion* dirty, DirtyRegion* dirtyOutput) {
+    PROFILE_ZONE("ScaleBuffer");
+
+    ClearDirtyRegion(dirtyOutput);
+
+    if(dirty->full) {
+        MarkDirtyFull(dirtyOutput);
+        ScaleOutputRect(scaler, queue, source, BufferRect(&scaler->output));
+        return;
+    }
+
+    // scaled rects can overlap where they didn't before, the region folds them together again
+    for(u32 i = 0; i < dirty->rectCount; i++) {
+        AddDirtyRect(dirtyOutput, ScaledRect(scaler, Intersect(dirty->rects[i], BufferRect(source))));
+    }
+
+    for(u32 i = 0; i < dirtyOutput->rectCount; i++) {
+        ScaleOutputRect(scaler, queue, source, dirtyOutput->rects[i]);
+    }
+}
+
+#endif
@@ -1,14 +1,63 @@
 #include "game.h"
+#include "intrinsics.h"
+#include "profile.h"
+#include "game_raster.h"
+#include "game_fill.cpp"
+#include "game_blit.cpp"
 
 void ClearBufferWithColor(GraphicsBuffer* buffer, Color32 color);
 void DrawRectangle(GraphicsBuffer* buffer, int32 xPos, int32 yPos, int32 xSize, int32 ySize, Color32 color);
 void DrawBorder(GraphicsBuffer* buffer, Color32 color);
 
-void WriteSound(f32 note, SoundBuffer* soundBuffer);
+// clipped versions, only pixels inside clip are touched. used to render one tile at a time
+void ClearBufferWithColor(GraphicsBuffer* buffer, Rect32 clip, Color32 color);
+void DrawRectangle(GraphicsBuffer* buffer, Rect32 clip, int32 xPos, int32 yPos, int32 xSize, int32 ySize, Color32 color);
+void DrawBorder(GraphicsBuffer* buffer, Rect32 clip, Color32 color);
+void DrawBitmap(GraphicsBuffer* buffer, Rect32 clip, LoadedBitmap* bitmap, int32 xPos, int32 yPos);
+void DrawSprite(GraphicsBuffer* buffer, Rect32 clip, SpriteAtlas* atlas, u32 index, int32 xPos, int32 yPos);
+void DrawConvexPolygon(GraphicsBuffer* buffer, Rect32 clip, RasterVertex* vertices, u32 count, Color32 color, bool shaded);
+Rect32 RasterPolygonBounds(RasterVertex* vertices, u32 count);
+void DrawParticles(GraphicsBuffer* buffer, Rect32 clip, ParticlePool* pool);
+void BinParticles(ParticlePool* pool);
+Rect32 ParticleBounds(ParticlePool* pool);
+void DrawTilemap(GraphicsBuffer* buffer, Rect32 clip, Tilemap* map, int32 xPos, int32 yPos);
+void PrepareTilemap(Tilemap* map, Rect32 area, int32 xPos, int32 yPos);
+Rect32 TilemapBounds(Tilemap* map, int32 xPos, int32 yPos);
+
+void ReportMemoryStats(GameMemory* memory, GameState* state);
 
 const int32 PLAYER_SIZE = 50;
 const int32 HALF_PLAYER_SIZE = 25;
 
+// render layers, drawn bottom to top
+const u8 LAYER_BACKGROUND = 0;
+const u8 LAYER_PLAYER = 1;
+const u8 LAYER_OVERLAY = 2;
+
+// the command buffer comes out of transient memory every frame: 96 bytes a command, 384 KB in all. sorting adds
+// 4 bytes a command. tile binning takes what is left and draws unbinned when that isn't enough
+const u32 MAX_RENDER_COMMANDS = 4096;
+
+const u32 MAX_ENTITIES = 128 * 1024;
+const f32 ENTITY_AREA_SIZE = 512; // entities bounce around the buffer's pixels
+const f32 ENTITY_RADIUS = 4;
+const f32 ENTITY_GRID_CELL_SIZE = 2 * ENTITY_RADIUS; // the smallest cell that still finds every touching pair
+
+const u32 MAX_PARTICLES = 256 * 1024;
+const f32 PARTICLE_GRAVITY = -200; // pixels per second squared, y is up
+const f32 PLAYER_SPARK_RATE = 3000; // particles per second
+const f32 PLAYER_SPARK_SPEED = 120;
+const f32 PLAYER_SPARK_LIFE = 1.0f;
+
+const f32 NOTE_VOLUME = 10000.0f / 32767.0f;
+const f32 MUSIC_VOLUME = 0.5f;
+
+const char MUSIC_PATH[] = "music.wav"; // streamed, 16 bit pcm at the output rate
+
+const char ASSET_ARCHIVE_PATH[] = "assets.pack"; // built by asset_packer, next to the executable
+const char PLAYER_BITMAP_NAME[] = "player.bmp";
+const char ECHO_OUTPUT_PATH[] = "output.txt";     // input.txt from the archive is copied here at startup
+
 int32 clamp(int32 current, int32 min, int32 max) {
     if(current > max) {
         return max;
@@ -19,34 +68,127 @@ int32 clamp(int32 current, int32 min, int32 max) {
     return current;
 }
 
+Rect32
+BufferRect(GraphicsBuffer* buffer) {
+    Rect32 rect = { 0, 0, buffer->width, buffer->height };
+    return rect;
+}
+
+Rect32
+Intersect(Rect32 a, Rect32 b) {
+    Rect32 result;
+    result.minX = a.minX > b.minX ? a.minX : b.minX;
+    result.minY = a.minY > b.minY ? a.minY : b.minY;
+    result.maxX = a.maxX < b.maxX ? a.maxX : b.maxX;
+    result.maxY = a.maxY < b.maxY ? a.maxY : b.maxY;
+    return result;
+}
+
+#include "game_render.cpp"
+#include "game_tiles.cpp"
+#include "game_dirty.cpp"
+#include "game_stream.cpp"
+#include "game_mixer.cpp"
+#include "game_assets.cpp"
+#include "game_bitmap.cpp"
+#include "game_atlas.cpp"
+#include "game_raster.cpp"
+#include "game_entity.cpp"
+#include "game_spatial.cpp"
+#include "game_particles.cpp"
+#include "game_tilemap.cpp"
+#include "game_text.cpp"
+
 void 
 GameInit(GameMemory* memory) {
-    assert(sizeof(GameState) <= (memory->permanentSize));
+    assert(sizeof(GameState) <= (u64)memory->permanentCommitted);
     
     GameState* state = (GameState*) memory->permanent;
     
+    // the game state sits at the front of permanent memory, the arena gets the rest and commits it as it grows
+    InitializeArena(&state->permanentArena, (u8*)memory->permanent + sizeof(GameState), memory->permanentSize - sizeof(GameState),
+                    memory->permanentCommitted - sizeof(GameState));
+    InitializeArena(&state->transientArena, memory->transient, memory->transientSize);
+    
+    // a full command buffer still leaves half of transient for mixing and binning
+    assert(MAX_RENDER_COMMANDS * sizeof(RenderCommand) <= (u64)memory->transientSize / 2);
+    
+    InitFillKernels();
+    InitBlitKernels();
+    InitRasterKernels();
+    InitEntityKernels();
+    InitParticleKernels();
+    
     state->backgroundColor.packed = 0xFF000000;
     
     state->playerColor.packed = 0xFF0000FF;
     state->playerX = 0;
     state->playerY = 0;
+    state->lastPlayerX = 0;
+    state->lastPlayerY = 0;
     
     state->note = 261; // middle c to start
     
-    FileContent content = FileReadAll("c:\\users\\chris\\github\\win32-engine\\input.txt");
+    InitializeMixer(&state->mixer);
+    state->noteVoice = PlayTone(&state->mixer, state->note, NOTE_VOLUME, 0);
+    
+    InitializeAudioStream(&state->music, &state->permanentArena);
+    OpenAudioStream(&state->music, memory->backgroundQueue, MUSIC_PATH, true);
+    state->musicVoice = PlayStream(&state->mixer, &state->music, MUSIC_VOLUME, 0);
+    
+    // a missing archive leaves every lookup empty, the game runs without its assets
+    OpenAssetArchive(&state->assets, ASSET_ARCHIVE_PATH);
+    
+    AssetBlob input = GetAsset(&state->assets, "input.txt");
+    if(input.data) {
+        FileWriteAll(ECHO_OUTPUT_PATH, input.data, input.byteCount);
+    }
+    
+    LoadBitmapAsset(&state->permanentArena, &state->assets, PLAYER_BITMAP_NAME, &state->playerBitmap);
+    
+    InitializeEntityStore(&state->entities, &state->permanentArena, MAX_ENTITIES, 0, 0, ENTITY_AREA_SIZE, ENTITY_AREA_SIZE);
+    InitializeSpatialGrid(&state->entityGrid, &state->permanentArena, MAX_ENTITIES, 0, 0, ENTITY_AREA_SIZE, ENTITY_AREA_SIZE,
+                          ENTITY_GRID_CELL_SIZE);
+    state->entityGridDirty = true;
     
-    if(content.data) {
-        FileWriteAll("c:\\users\\chris\\github\\win32-engine\\output.txt", content.data, content.byteCount);
-        FileReleaseMemory(content.data);
+    InitializeParticlePool(&state->particles, &state->permanentArena, MAX_PARTICLES, 0, 0, ENTITY_AREA_SIZE, ENTITY_AREA_SIZE);
+    state->particles.accelerationY = PARTICLE_GRAVITY;
+    
+    state->playerSparks = {};
+    state->playerSparks.speed = PLAYER_SPARK_SPEED;
+    state->playerSparks.life = PLAYER_SPARK_LIFE;
+    state->playerSparks.seed = 0x9E3779B9;
+    
+    InitializeRenderHistory(&state->renderHistory, &state->permanentArena, MAX_RENDER_COMMANDS);
+    
+    ReportMemoryStats(memory, state);
+}
+
+// entities whose circle overlaps the circle at x, y, same results convention as QuerySpatialGridRadius.
+// the first query after the entities moved rebuilds the grid, so updates nothing asks about don't pay for it
+u32
+QueryEntitiesNear(GameState* state, f32 x, f32 y, f32 radius, u32* results, u32 maxResults) {
+    if(state->entityGridDirty) {
+        BuildSpatialGrid(&state->entityGrid, state->entities.x, state->entities.y, state->entities.count, ENTITY_RADIUS);
+        state->entityGridDirty = false;
     }
+    return QuerySpatialGridRadius(&state->entityGrid, x, y, radius, results, maxResults);
 }
 
 void 
 GameUpdate(GameMemory* memory, GameInput input, SoundBuffer* soundBuffer, f32 dt) {
+    PROFILE_ZONE("GameUpdate");
+    
     // cast memory to state
     // the engine to provides a fixed memory region for the game to operate in
     GameState* state = (GameState*)memory->permanent;
     
+    // new frame, last frame's scratch is gone
+    ResetArena(&state->transientArena);
+    
+    state->lastPlayerX = state->playerX;
+    state->lastPlayerY = state->playerY;
+    
     f64 growth = 100 * dt;
     int32 moveSpeed = 1;
 
@@ -90,30 +232,129 @@ GameUpdate(GameMemory* memory, GameInput input, SoundBuffer* soundBuffer, f32 dt
     state->playerX -= HALF_PLAYER_SIZE;
     state->playerY -= HALF_PLAYER_SIZE;
     
-    WriteSound(state->note, soundBuffer);
+    UpdateEntities(&state->entities, dt);
+    state->entityGridDirty = true;
+    
+    // sparks in a dim version of the player's color, they add up where they bunch
+    UpdateParticles(&state->particles, dt);
+    
+    ParticleEmitter* sparks = &state->playerSparks;
+    sparks->x = (f32)(state->playerX + HALF_PLAYER_SIZE);
+    sparks->y = (f32)(state->playerY + HALF_PLAYER_SIZE);
+    sparks->rate = input.Alpha1.isDown || input.Alpha2.isDown || input.Alpha3.isDown ? PLAYER_SPARK_RATE : 0;
+    sparks->color = (state->playerColor.packed >> 2) & 0x3F3F3F3F;
+    EmitParticles(&state->particles, sparks, dt);
+    
+    SetVoiceFrequency(&state->mixer, state->noteVoice, state->note);
+    MixSound(&state->mixer, &state->transientArena, soundBuffer);
+    
+    memory->stats.audio.voicesMixed = state->mixer.voicesMixed;
+    memory->stats.audio.streamUnderruns = state->music.underruns;
 }
 
 void 
-GameRender(GameMemory* memory, GraphicsBuffer* graphicsBuffer) {
+GameRender(GameMemory* memory, GraphicsBuffer* graphicsBuffer, f32 interpolation) {
+    PROFILE_ZONE("GameRender");
+    
     GameState* state = (GameState*) memory->permanent;
     // TODO I can see how... knowing the position and desired color of things you'd be able to translate that into screen space
 
-    ClearBufferWithColor(graphicsBuffer, state->backgroundColor);
-    DrawRectangle(graphicsBuffer, state->playerX, state->playerY, PLAYER_SIZE, PLAYER_SIZE, state->playerColor);
-    DrawBorder(graphicsBuffer, state->playerColor);
+    // the command buffer lives in transient memory, it is rebuilt every frame.
+    // a frame can render without an update in between, so it gives its memory back
+    TemporaryMemory renderMemory = BeginTemporaryMemory(&state->transientArena);
+    RenderGroup* group = BeginRenderGroup(&state->transientArena, graphicsBuffer, MAX_RENDER_COMMANDS);
+    
+    // the display is somewhere between the last two updates
+    int32 playerX = state->lastPlayerX + (int32)((state->playerX - state->lastPlayerX) * interpolation);
+    int32 playerY = state->lastPlayerY + (int32)((state->playerY - state->lastPlayerY) * interpolation);
+    
+    PushClear(group, LAYER_BACKGROUND, state->backgroundColor);
+    if(state->playerBitmap.pixels) {
+        PushBitmap(group, LAYER_PLAYER, &state->playerBitmap, playerX, playerY);
+    } else {
+        PushRect(group, LAYER_PLAYER, playerX, playerY, PLAYER_SIZE, PLAYER_SIZE, state->playerColor);
+    }
+    PushParticles(group, LAYER_PLAYER, &state->particles);
+    PushBorder(group, LAYER_OVERLAY, state->playerColor);
+    
+    EndRenderGroup(group);
+    
+    // only what changed is drawn, along with whatever the engine drew over since last frame
+    ClearDirtyRegion(&memory->dirty);
+    AddDirtyRegion(&memory->dirty, &memory->overdrawn);
+    ClearDirtyRegion(&memory->overdrawn);
+    
+    TrackRenderChanges(&state->renderHistory, group, graphicsBuffer, &memory->dirty);
+    RenderDirty(memory->renderQueue, group, graphicsBuffer, &memory->dirty);
+    
+    memory->stats.render = group->stats;
+    EndTemporaryMemory(renderMemory);
+    
+    // end of the frame, every temporary scope has to be closed by now
+    assert(state->transientArena.tempCount == 0);
+    
+    ReportMemoryStats(memory, state);
+}
+
+void
+GameSuspend(GameMemory* memory) {
+    GameState* state = (GameState*)memory->permanent;
+    SuspendAudioStream(&state->music);
+    SuspendAssetArchive(&state->assets);
+}
+
+void
+GameResume(GameMemory* memory) {
+    GameState* state = (GameState*)memory->permanent;
+    RecommitArena(&state->permanentArena);
+    ResumeAudioStream(&state->music, memory->backgroundQueue);
+    ResumeAssetArchive(&state->assets);
+    
+    // the history may be from a snapshot and the buffer isn't
+    state->renderHistory.valid = false;
+}
+
+void
+ReportMemoryStats(GameMemory* memory, GameState* state) {
+    MemoryStats* memoryStats = &memory->stats.memory;
+    
+    // the game state itself counts, the engine treats everything up to permanentUsed as live
+    memoryStats->permanentSize = memory->permanentSize;
+    memoryStats->permanentCommitted = sizeof(GameState) + state->permanentArena.committed;
+    memoryStats->permanentUsed = sizeof(GameState) + state->permanentArena.used;
+    memoryStats->permanentHighWater = sizeof(GameState) + state->permanentArena.highWater;
+    
+    memoryStats->transientSize = state->transientArena.size;
+    memoryStats->transientPeak = state->transientArena.peak;
+    memoryStats->transientHighWater = state->transientArena.highWater;
 }
 
 void 
 ClearBufferWithColor(GraphicsBuffer* buffer, Color32 color) {
-    u8* row = buffer->data; // current row
+    ClearBufferWithColor(buffer, BufferRect(buffer), color);
+}
+
+void 
+ClearBufferWithColor(GraphicsBuffer* buffer, Rect32 clip, Color32 color) {
+    PROFILE_ZONE("ClearBufferWithColor");
     
-    for(int32 y = 0; y < buffer->height; y++) {
-        u32* pixel = (u32*)row;
-        
-        for(int32 x = 0; x < buffer->width; x++) {
-            *pixel = color.packed;
-            pixel++;
-        }
+    clip = Intersect(clip, BufferRect(buffer));
+    
+    int64 rowBytes = (int64)buffer->width * buffer->bytesPerPixel;
+    int64 totalBytes = rowBytes * buffer->height;
+    bool wholeBuffer = (clip.minX == 0 && clip.minY == 0 && clip.maxX == buffer->width && clip.maxY == buffer->height);
+    
+    // no padding between rows: the whole buffer is one span
+    if(wholeBuffer && rowBytes == buffer->bytesPerRow && totalBytes >= NONTEMPORAL_MIN_BYTES) {
+        FillSpanStream((u32*)buffer->data, (int64)buffer->width * buffer->height, color.packed);
+        return;
+    }
+    
+    int32 xPixels = clip.maxX - clip.minX;
+    u8* row = buffer->data + (buffer->bytesPerRow*clip.minY) + (clip.minX*buffer->bytesPerPixel); // current row
+    
+    for(int32 y = clip.minY; y < clip.maxY; y++) {
+        FillSpan((u32*)row, xPixels, color.packed);
         
         // move to next row
         row += buffer->bytesPerRow;
@@ -122,18 +363,27 @@ ClearBufferWithColor(GraphicsBuffer* buffer, Color32 color) {
 
 void
 DrawRectangle(GraphicsBuffer* buffer, int32 xPos, int32 yPos, int32 xSize, int32 ySize, Color32 color) {
+    DrawRectangle(buffer, BufferRect(buffer), xPos, yPos, xSize, ySize, color);
+}
+
+void
+DrawRectangle(GraphicsBuffer* buffer, Rect32 clip, int32 xPos, int32 yPos, int32 xSize, int32 ySize, Color32 color) {
+    PROFILE_ZONE("DrawRectangle");
+    
+    clip = Intersect(clip, BufferRect(buffer));
+    
     int32 xMin = xPos;
     int32 yMin = yPos; 
     int32 xMax = xPos+xSize;
     int32 yMax = yPos+ySize;
     
     // max pos bounds
-    xMax = clamp(xMax, 0, buffer->width);
-    yMax = clamp(yMax, 0, buffer->height);
+    xMax = clamp(xMax, clip.minX, clip.maxX);
+    yMax = clamp(yMax, clip.minY, clip.maxY);
     
     // min pos bounds
-    xMin = max(0, xMin);
-    yMin = max(0, yMin);
+    xMin = clamp(xMin, clip.minX, clip.maxX);
+    yMin = clamp(yMin, clip.minY, clip.maxY);
     
     
     // pixels to render
@@ -141,18 +391,12 @@ DrawRectangle(GraphicsBuffer* buffer, int32 xPos, int32 yPos, int32 xSize, int32
     int32 yPixels = yMax - yMin;
     
     u32 xOffset = (xMin*buffer->bytesPerPixel);
-    u32 yOffset = (yMin*buffer->bytesPerPixel);
     
     u8* row = buffer->data;
     row += (buffer->bytesPerRow*yMin) + xOffset;
     
     for(int32 y = 0; y < yPixels; y++) {
-        u32* pixel = (u32*)row;
-        
-        for(int32 x = 0; x < xPixels; x++) {
-            *pixel = color.packed;
-            pixel++;
-        }
+        FillSpan((u32*)row, xPixels, color.packed);
         
         row += buffer->bytesPerRow;
     }
@@ -160,47 +404,18 @@ DrawRectangle(GraphicsBuffer* buffer, int32 xPos, int32 yPos, int32 xSize, int32
 
 void
 DrawBorder(GraphicsBuffer* buffer, Color32 color) {
-    // vertical
-    u32* left = (u32*)buffer->data;
-    u32* right = (u32*)(buffer->data + (buffer->bytesPerPixel*(buffer->width-1)));
-    
-    for(int32 y = 0; y < buffer->height; y++) {
-        *left = color.packed;
-        *right = color.packed;
-        
-        left += (buffer->bytesPerRow / buffer->bytesPerPixel);
-        right += (buffer->bytesPerRow / buffer->bytesPerPixel);
-    }
-    
-    // horizontal
-    u32* bot = (u32*)buffer->data;
-    u32* top = (u32*)(buffer->data + buffer->bytesPerRow * (buffer->height-1));
-    
-    for(int32 x = 0; x < buffer->width; x++) {
-        *bot = color.packed;
-        *top = color.packed;
-        
-        bot++;
-        top++;
-    }
+    DrawBorder(buffer, BufferRect(buffer), color);
 }
 
 void
-WriteSound(f32 note, SoundBuffer* soundBuffer) {    
-    static f32 sine;
-    const f32 volume = 10000;
+DrawBorder(GraphicsBuffer* buffer, Rect32 clip, Color32 color) {
+    PROFILE_ZONE("DrawBorder");
     
-    // sine wave for the tone
-    f32 period = soundBuffer->samplesPerSecond / note;
+    // vertical
+    DrawRectangle(buffer, clip, 0, 0, 1, buffer->height, color);
+    DrawRectangle(buffer, clip, buffer->width-1, 0, 1, buffer->height, color);
     
-    int16* output = soundBuffer->samples;
-    for(int i = 0; i < soundBuffer->numSamplesToWrite; i++) {
-        int16 sample = (int16)(sinf(sine) * volume);
-        
-        // left and right channels have the same sample
-        *(output++) = sample;
-        *(output++) = sample;
-        
-        sine += 2.0f * PI * 1.0f / period;
-    }
-}
\ No newline at end of file
+    // horizontal
+    DrawRectangle(buffer, clip, 0, 0, buffer->width, 1, color);
+    DrawRectangle(buffer, clip, 0, buffer->height-1, buffer->width, 1, color);
+}
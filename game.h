@@ -1,6 +1,18 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include "game_arena.h"
+#include "game_stream.h"
+#include "game_mixer.h"
+#include "game_assets.h"
+#include "game_bitmap.h"
+#include "game_atlas.h"
+#include "game_entity.h"
+#include "game_spatial.h"
+#include "game_particles.h"
+#include "game_tilemap.h"
+#include "game_text.h"
+
 typedef union {
     u32 packed; // packed bgra color union
     
@@ -15,12 +27,55 @@ typedef union {
 
 
 
-struct GameMemory {
-    int64 permanentSize;
-    void* permanent;
+// what the renderer saved this frame
+struct RenderStats {
+    u32 issued;   // commands pushed by the game
+    u32 culled;   // off screen or completely covered by a later command
+    u32 merged;   // rects folded into a neighbour of the same color
+    u32 executed; // commands that actually drew
     
-    int64 transientSize;
-    void* transient;
+    u32 dirtyRects;  // regions redrawn, 0 when the whole buffer was
+    u32 redrawnPixels;
+    u32 fullRedraws; // 1 when the frame fell back to redrawing everything
+};
+
+// arena usage, in bytes
+struct MemoryStats {
+    u64 permanentSize;      // reserved
+    u64 permanentCommitted; // backed by memory, the rest is address space only
+    u64 permanentUsed;      // from the start of the block, everything past it is free
+    u64 permanentHighWater; // most ever used, temporary memory included
+    
+    u64 transientSize;
+    u64 transientPeak;      // most transient memory used this frame
+    u64 transientHighWater; // most ever used in one frame
+};
+
+struct AudioStats {
+    u32 voicesMixed;
+    u32 streamUnderruns; // total, since the stream was opened
+};
+
+// per frame numbers the game reports back to the engine
+struct GameStats {
+    RenderStats render;
+    MemoryStats memory;
+    AudioStats audio;
+};
+
+// pixel rect, max is exclusive
+struct Rect32 {
+    int32 minX, minY;
+    int32 maxX, maxY;
+};
+
+const u32 MAX_DIRTY_RECTS = 16;
+
+// pixels that changed, as a few rects that never overlap. full covers the whole buffer, rects is unused then
+struct DirtyRegion {
+    bool full;
+    u32 rectCount;
+    Rect32 rects[MAX_DIRTY_RECTS];
 };
 
 struct GraphicsBuffer {
@@ -30,6 +85,26 @@ struct GraphicsBuffer {
     u8* data;
 };
 
+struct GameMemory {
+    int64 permanentSize;      // reserved, only the front is committed
+    int64 permanentCommitted; // by the engine before GameInit, the game's arena commits the rest as it grows
+    void* permanent;
+    
+    int64 transientSize;
+    void* transient;
+    
+    WorkQueue* renderQueue;     // optional, null renders on the calling thread
+    WorkQueue* backgroundQueue; // optional, slow jobs like file reads. never joined, null runs them on the calling thread
+    
+    GameStats stats; // written by the game, read by the engine
+    
+    // dirty rects: GameRender redraws what changed since the last frame and leaves it in dirty, the engine presents
+    // only that. whatever the engine draws into the buffer itself, overlays, goes into overdrawn, which the game
+    // paints over next frame. GameRender clears it
+    DirtyRegion dirty;
+    DirtyRegion overdrawn;
+};
+
 struct SoundBuffer {
     int samplesPerSecond;
     int numSamplesToWrite; // engine requests the number of samples for the game to write
@@ -49,17 +124,65 @@ struct GameInput {
     int32 mouseX, mouseY;
 };
 
+// what the last frame executed, one key per command in execution order
+struct RenderCommandKey {
+    u8 type;
+    u8 layer;
+    Rect32 bounds;
+    u32 color;
+    u64 content; // a hash of everything else that decides the pixels: which bitmap and where, the sprite draws
+};
+
+struct RenderHistory {
+    bool valid; // false redraws everything. set by the first frame, cleared when the game resumes from a snapshot
+    u32 count;
+    u32 maxCount;
+    RenderCommandKey* keys;
+};
+
 struct GameState {
+    // permanent holds everything after this struct, transient is thrown away every frame
+    MemoryArena permanentArena;
+    MemoryArena transientArena;
+    
     Color32 backgroundColor;
     
     Color32 playerColor;
     int32 playerX, playerY;
+    int32 lastPlayerX, lastPlayerY; // before the latest update, render blends from here
     
     f32 note;
+    
+    Mixer mixer;
+    VoiceId noteVoice; // the player's tone, pitch follows note
+    
+    AudioStream music;
+    VoiceId musicVoice;
+    
+    AssetArchive assets;
+    LoadedBitmap playerBitmap; // no pixels when the archive has none, the player is a plain rect then
+    
+    EntityStore entities;
+    SpatialGrid entityGrid; // what is near what, see QueryEntitiesNear
+    bool entityGridDirty;   // the entities moved since the grid was built
+    
+    ParticlePool particles;
+    ParticleEmitter playerSparks; // on while a color key is held
+    
+    RenderHistory renderHistory;
 };
 
+// the engine runs updates in fixed steps of 1 / GAME_UPDATE_HZ seconds, as many per frame as the frame's time covers.
+// render gets how far the display is between the last two updates, 0..1
+const f64 GAME_UPDATE_HZ = 60.0;
+
 void GameInit(GameMemory* memory);
 void GameUpdate(GameMemory* memory, GameInput input, SoundBuffer* soundBuffer, f32 dt);
-void GameRender(GameMemory* memory, GraphicsBuffer* graphicBuffer);
+void GameRender(GameMemory* memory, GraphicsBuffer* graphicBuffer, f32 interpolation);
+
+// replay snapshots copy permanent memory as it is. the engine suspends the game before it takes or replaces one,
+// so nothing in there is an open file or a job in flight, and resumes it afterwards
+void GameSuspend(GameMemory* memory);
+void GameResume(GameMemory* memory);
 
 #endif
\ No newline at end of file
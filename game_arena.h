@@ -0,0 +1,153 @@
+#ifndef GAME_ARENA_H
+#define GAME_ARENA_H
+
+// linear allocator over one of the engine's memory blocks
+// pushes bump a pointer, nothing is freed individually. temporary memory rewinds to a checkpoint.
+// a block may be only partly committed, pushes past what is commit more of it in steps, see engine_memory.h
+
+// big enough that growing costs a handful of system calls, small enough that a game using little memory commits little
+const u64 ARENA_COMMIT_STEP = 1024 * 1024;
+
+struct MemoryArena {
+    u8* base;
+    u64 size;
+    u64 used;
+    u64 committed; // from base, everything past it is only reserved. never goes back down
+
+    u64 peak;      // most used since the last reset
+    u64 highWater; // most ever used
+
+    u32 tempCount; // open temporary memory scopes
+};
+
+struct TemporaryMemory {
+    MemoryArena* arena;
+    u64 used;
+    u32 depth;
+};
+
+#define PushStruct(arena, type) (type*)PushSize_(arena, sizeof(type), alignof(type))
+#define PushArray(arena, count, type) (type*)PushSize_(arena, (u64)(count)*sizeof(type), alignof(type))
+#define PushArrayAligned(arena, count, type, alignment) (type*)PushSize_(arena, (u64)(count)*sizeof(type), alignment)
+#define PushSize(arena, size) PushSize_(arena, size, 16)
+
+// committed is how much of the block is backed already, all of it when memory came from the heap
+void
+InitializeArena(MemoryArena* arena, void* base, u64 size, u64 committed) {
+    assert(committed <= size);
+
+    arena->base = (u8*)base;
+    arena->size = size;
+    arena->used = 0;
+    arena->committed = committed;
+    arena->peak = 0;
+    arena->highWater = 0;
+    arena->tempCount = 0;
+}
+
+void
+InitializeArena(MemoryArena* arena, void* base, u64 size) {
+    InitializeArena(arena, base, size, size);
+}
+
+// commits up to used, rounded up to a whole step
+void
+CommitArena(MemoryArena* arena, u64 used) {
+    u64 committed = (used + ARENA_COMMIT_STEP - 1) / ARENA_COMMIT_STEP * ARENA_COMMIT_STEP;
+    committed = committed < arena->size ? committed : arena->size;
+
+    // failing to commit memory that is reserved means the machine is out of it, like running off the end
+    bool ok = MemoryCommit(arena->base + arena->committed, committed - arena->committed);
+    assert(ok);
+
+    arena->committed = committed;
+}
+
+// commits everything the arena counts as committed, again. a restored snapshot brings back an arena that may have
+// grown further than the memory under it has in this run. only for arenas over reserved memory
+void
+RecommitArena(MemoryArena* arena) {
+    bool ok = MemoryCommit(arena->base, arena->committed);
+    assert(ok);
+}
+
+u64
+GetAlignmentOffset(MemoryArena* arena, u64 alignment) {
+    // alignment has to be a power of two
+    assert((alignment & (alignment - 1)) == 0);
+
+    u64 next = (u64)(arena->base + arena->used);
+    u64 mask = alignment - 1;
+    return (next & mask) ? alignment - (next & mask) : 0;
+}
+
+u64
+GetArenaSizeRemaining(MemoryArena* arena, u64 alignment = 16) {
+    u64 offset = GetAlignmentOffset(arena, alignment);
+    if(arena->used + offset >= arena->size) {
+        return 0;
+    }
+    return arena->size - (arena->used + offset);
+}
+
+void*
+PushSize_(MemoryArena* arena, u64 size, u64 alignment) {
+    u64 offset = GetAlignmentOffset(arena, alignment);
+
+    // out of memory. the blocks are sized up front, so this is a bug, not a runtime condition
+    assert(arena->used + offset + size <= arena->size);
+
+    void* result = arena->base + arena->used + offset;
+    arena->used += offset + size;
+
+    if(arena->used > arena->committed) {
+        CommitArena(arena, arena->used);
+    }
+
+    if(arena->used > arena->peak) {
+        arena->peak = arena->used;
+    }
+    if(arena->used > arena->highWater) {
+        arena->highWater = arena->used;
+    }
+
+    return result;
+}
+
+// carves a child arena out of the parent, for systems that want to own their memory
+void
+SubArena(MemoryArena* result, MemoryArena* arena, u64 size, u64 alignment = 16) {
+    InitializeArena(result, PushSize_(arena, size, alignment), size);
+}
+
+TemporaryMemory
+BeginTemporaryMemory(MemoryArena* arena) {
+    TemporaryMemory result;
+    result.arena = arena;
+    result.used = arena->used;
+    result.depth = ++arena->tempCount;
+    return result;
+}
+
+void
+EndTemporaryMemory(TemporaryMemory temp) {
+    MemoryArena* arena = temp.arena;
+
+    // scopes have to close in the order they opened
+    assert(arena->tempCount == temp.depth);
+    assert(arena->used >= temp.used);
+
+    arena->used = temp.used;
+    arena->tempCount--;
+}
+
+// everything is thrown away. only valid with no temporary memory open
+void
+ResetArena(MemoryArena* arena) {
+    assert(arena->tempCount == 0);
+
+    arena->used = 0;
+    arena->peak = 0;
+}
+
+#endif
@@ -0,0 +1,115 @@
+// a broken archive is refused as a whole at open, so lookups don't have to check anything
+bool
+AssetArchiveIsValid(FileMapping* mapping) {
+    if(mapping->byteCount < sizeof(AssetArchiveHeader)) {
+        return false;
+    }
+
+    AssetArchiveHeader* header = (AssetArchiveHeader*)mapping->data;
+    if(header->magic != ASSET_ARCHIVE_MAGIC || header->version != ASSET_ARCHIVE_VERSION ||
+       header->totalBytes != mapping->byteCount) {
+        return false;
+    }
+
+    u32 slots = header->indexSlots;
+    if(slots == 0 || (slots & (slots - 1)) != 0 || header->assetCount >= slots ||
+       (header->indexOffset % alignof(AssetIndexEntry)) != 0 ||
+       header->indexOffset + (u64)slots * sizeof(AssetIndexEntry) > mapping->byteCount) {
+        return false;
+    }
+
+    // only the index is read, the blobs stay on disk until something asks for them
+    AssetIndexEntry* index = (AssetIndexEntry*)((u8*)mapping->data + header->indexOffset);
+    for(u32 i = 0; i < slots; i++) {
+        AssetIndexEntry* entry = index + i;
+        if(entry->id && (entry->offset > mapping->byteCount || entry->byteCount > mapping->byteCount - entry->offset)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+MapAssetArchive(AssetArchive* archive) {
+    archive->mapping = FileMapReadOnly(archive->path);
+    if(!archive->mapping.data) {
+        return false;
+    }
+
+    if(!AssetArchiveIsValid(&archive->mapping)) {
+        FileUnmap(&archive->mapping);
+        return false;
+    }
+
+    archive->header = (AssetArchiveHeader*)archive->mapping.data;
+    archive->index = (AssetIndexEntry*)((u8*)archive->mapping.data + archive->header->indexOffset);
+    return true;
+}
+
+// one open and one map, whatever is in the archive
+bool
+OpenAssetArchive(AssetArchive* archive, const char path[]) {
+    *archive = {};
+
+    u32 length = 0;
+    while(path[length] && length < ASSET_PATH_LENGTH - 1) {
+        archive->path[length] = path[length];
+        length++;
+    }
+    if(path[length]) {
+        archive->path[0] = 0;
+        return false;
+    }
+
+    return MapAssetArchive(archive);
+}
+
+void
+SuspendAssetArchive(AssetArchive* archive) {
+    if(archive->header) {
+        FileUnmap(&archive->mapping);
+    }
+
+    archive->mapping = {};
+    archive->header = 0;
+    archive->index = 0;
+}
+
+void
+ResumeAssetArchive(AssetArchive* archive) {
+    // snapshots are taken suspended, so the mapping is always gone by the time the archive resumes
+    if(archive->path[0] && !archive->header) {
+        MapAssetArchive(archive);
+    }
+}
+
+AssetBlob
+GetAsset(AssetArchive* archive, AssetId id) {
+    AssetBlob blob = {};
+    if(!archive->header) {
+        return blob;
+    }
+
+    // linear probing, the index is at most half full so a miss ends at an empty slot quickly
+    u32 mask = archive->header->indexSlots - 1;
+    for(u32 probe = 0; probe <= mask; probe++) {
+        AssetIndexEntry* entry = archive->index + ((id + probe) & mask);
+
+        if(entry->id == id) {
+            blob.data = (u8*)archive->mapping.data + entry->offset;
+            blob.byteCount = entry->byteCount;
+            break;
+        }
+        if(entry->id == 0) {
+            break;
+        }
+    }
+
+    return blob;
+}
+
+AssetBlob
+GetAsset(AssetArchive* archive, const char name[]) {
+    return GetAsset(archive, AssetIdFromName(name));
+}
@@ -0,0 +1,26 @@
+#ifndef GAME_ASSETS_H
+#define GAME_ASSETS_H
+
+#include "asset_archive.h"
+
+// assets come straight out of the mapped archive. a lookup is a probe or two into the index,
+// the blob is a pointer into the mapping: nothing is copied and nothing is allocated per asset
+
+const u32 ASSET_PATH_LENGTH = 256;
+
+struct AssetBlob {
+    void* data; // null when the archive doesn't have the asset
+    u64 byteCount;
+};
+
+// the mapping belongs to the process. it is let go when the game suspends and mapped again when it resumes,
+// so blob pointers are only good until the next suspend
+struct AssetArchive {
+    char path[ASSET_PATH_LENGTH];
+    FileMapping mapping;
+
+    AssetArchiveHeader* header; // null while the archive isn't mapped or didn't check out
+    AssetIndexEntry* index;
+};
+
+#endif
@@ -0,0 +1,185 @@
+// sprite atlases and the batched sprite draw
+// DrawSprites bins its sprites into bands of target rows and finishes one band before the next,
+// so the rows being blended stay in cache however the sprites are spread over the screen
+
+// packs already loaded images into a new page at load time. ids name the sprites, FindSprite looks them up
+bool
+BuildSpriteAtlas(MemoryArena* arena, LoadedBitmap* images, AssetId* ids, u32 count, SpriteAtlas* atlas) {
+    *atlas = {};
+
+    AtlasSprite* sprites = PushArray(arena, count, AtlasSprite);
+    for(u32 i = 0; i < count; i++) {
+        sprites[i] = {};
+        sprites[i].id = ids[i];
+        sprites[i].width = images[i].width;
+        sprites[i].height = images[i].height;
+        sprites[i].opaque = images[i].opaque;
+    }
+
+    AtlasPacker packer = {};
+    TemporaryMemory scratch = BeginTemporaryMemory(arena);
+    packer.order = PushArray(arena, count, u32);
+    packer.skyline = PushArray(arena, count + 1, AtlasSkyline);
+    bool packed = PackAtlas(&packer, sprites, count);
+    EndTemporaryMemory(scratch);
+
+    if(!packed) {
+        return false;
+    }
+
+    // the gaps stay zero, a premultiplied pixel that draws nothing
+    LoadedBitmap* page = &atlas->page;
+    page->width = packer.pageWidth;
+    page->height = packer.pageHeight;
+    page->pitch = packer.pageWidth;
+    page->pixels = PushArrayAligned(arena, (u64)page->width * page->height, u32, 32);
+    memset(page->pixels, 0, (u64)page->width * page->height * sizeof(u32));
+
+    for(u32 i = 0; i < count; i++) {
+        AtlasSprite* sprite = sprites + i;
+        for(int32 y = 0; y < sprite->height; y++) {
+            memcpy(page->pixels + (u64)(sprite->y + y) * page->pitch + sprite->x,
+                   images[i].pixels + (u64)y * images[i].pitch, sprite->width * sizeof(u32));
+        }
+    }
+
+    atlas->spriteCount = count;
+    atlas->sprites = sprites;
+    return true;
+}
+
+// an atlas the asset packer made offline. nothing is copied, the atlas points into the data
+bool
+LoadSpriteAtlas(void* data, u64 byteCount, SpriteAtlas* atlas) {
+    *atlas = {};
+    if(!data || byteCount < sizeof(AtlasHeader)) {
+        return false;
+    }
+
+    AtlasHeader* header = (AtlasHeader*)data;
+    if(header->magic != ATLAS_MAGIC || header->version != ATLAS_VERSION ||
+       header->pageWidth <= 0 || header->pageWidth > ATLAS_MAX_PAGE_SIZE ||
+       header->pageHeight <= 0 || header->pageHeight > ATLAS_MAX_PAGE_SIZE ||
+       header->spritesOffset > byteCount || (u64)header->spriteCount * sizeof(AtlasSprite) > byteCount - header->spritesOffset ||
+       header->pixelsOffset > byteCount || (u64)header->pageWidth * header->pageHeight * sizeof(u32) > byteCount - header->pixelsOffset ||
+       (header->pixelsOffset % sizeof(u32)) != 0 || (header->spritesOffset % alignof(AtlasSprite)) != 0) {
+        return false;
+    }
+
+    AtlasSprite* sprites = (AtlasSprite*)((u8*)data + header->spritesOffset);
+    for(u32 i = 0; i < header->spriteCount; i++) {
+        AtlasSprite* sprite = sprites + i;
+        if(sprite->x < 0 || sprite->y < 0 || sprite->width < 0 || sprite->height < 0 ||
+           sprite->x + sprite->width > header->pageWidth || sprite->y + sprite->height > header->pageHeight) {
+            return false;
+        }
+    }
+
+    atlas->page.width = header->pageWidth;
+    atlas->page.height = header->pageHeight;
+    atlas->page.pitch = header->pageWidth;
+    atlas->page.pixels = (u32*)((u8*)data + header->pixelsOffset);
+    atlas->spriteCount = header->spriteCount;
+    atlas->sprites = sprites;
+    return true;
+}
+
+bool
+LoadSpriteAtlasAsset(AssetArchive* assets, const char name[], SpriteAtlas* atlas) {
+    AssetBlob blob = GetAsset(assets, name);
+    return LoadSpriteAtlas(blob.data, blob.byteCount, atlas);
+}
+
+// a linear search, for load time. draws carry the index
+u32
+FindSprite(SpriteAtlas* atlas, AssetId id) {
+    for(u32 i = 0; i < atlas->spriteCount; i++) {
+        if(atlas->sprites[i].id == id) {
+            return i;
+        }
+    }
+    return ATLAS_NO_SPRITE;
+}
+
+u32
+FindSprite(SpriteAtlas* atlas, const char name[]) {
+    return FindSprite(atlas, AssetIdFromName(name));
+}
+
+void
+DrawSprite(GraphicsBuffer* buffer, Rect32 clip, SpriteAtlas* atlas, u32 index, int32 xPos, int32 yPos) {
+    AtlasSprite* sprite = atlas->sprites + index;
+    u32* pixels = atlas->page.pixels + (u64)sprite->y * atlas->page.pitch + sprite->x;
+    BlitPixels(buffer, clip, pixels, atlas->page.pitch, sprite->width, sprite->height, sprite->opaque != 0, xPos, yPos);
+}
+
+// draws in the order given where sprites overlap: every band draws its own sprites in that order,
+// and bands share no pixels. scratch for the bins comes from the arena and is given back before returning
+void
+DrawSprites(GraphicsBuffer* buffer, Rect32 clip, SpriteAtlas* atlas, SpriteDraw* draws, u32 count, MemoryArena* arena) {
+    PROFILE_ZONE("DrawSprites");
+
+    clip = Intersect(clip, BufferRect(buffer));
+    if(IsEmpty(clip) || count == 0) {
+        return;
+    }
+
+    int32 firstBand = clip.minY / SPRITE_BAND_HEIGHT;
+    int32 bandCount = (clip.maxY - 1) / SPRITE_BAND_HEIGHT - firstBand + 1;
+
+    TemporaryMemory scratch = BeginTemporaryMemory(arena);
+
+    // count, then place, like the tile bins. a sprite goes into every band it touches
+    u32* bandStart = PushArray(arena, bandCount + 1, u32);
+    memset(bandStart, 0, (bandCount + 1) * sizeof(u32));
+
+    u32 pairCount = 0;
+    for(u32 i = 0; i < count; i++) {
+        AtlasSprite* sprite = atlas->sprites + draws[i].sprite;
+        int32 minY = draws[i].yPos > clip.minY ? draws[i].yPos : clip.minY;
+        int32 maxY = draws[i].yPos + sprite->height < clip.maxY ? draws[i].yPos + sprite->height : clip.maxY;
+        if(minY >= maxY || draws[i].xPos >= clip.maxX || draws[i].xPos + sprite->width <= clip.minX) {
+            continue;
+        }
+
+        for(int32 band = minY / SPRITE_BAND_HEIGHT; band <= (maxY - 1) / SPRITE_BAND_HEIGHT; band++) {
+            bandStart[band - firstBand + 1]++;
+            pairCount++;
+        }
+    }
+
+    for(int32 band = 0; band < bandCount; band++) {
+        bandStart[band + 1] += bandStart[band];
+    }
+
+    u32* bins = PushArray(arena, pairCount, u32);
+    u32* bandNext = PushArray(arena, bandCount, u32);
+    memcpy(bandNext, bandStart, bandCount * sizeof(u32));
+
+    for(u32 i = 0; i < count; i++) {
+        AtlasSprite* sprite = atlas->sprites + draws[i].sprite;
+        int32 minY = draws[i].yPos > clip.minY ? draws[i].yPos : clip.minY;
+        int32 maxY = draws[i].yPos + sprite->height < clip.maxY ? draws[i].yPos + sprite->height : clip.maxY;
+        if(minY >= maxY || draws[i].xPos >= clip.maxX || draws[i].xPos + sprite->width <= clip.minX) {
+            continue;
+        }
+
+        for(int32 band = minY / SPRITE_BAND_HEIGHT; band <= (maxY - 1) / SPRITE_BAND_HEIGHT; band++) {
+            bins[bandNext[band - firstBand]++] = i;
+        }
+    }
+
+    for(int32 band = 0; band < bandCount; band++) {
+        Rect32 bandClip = clip;
+        bandClip.minY = (firstBand + band) * SPRITE_BAND_HEIGHT;
+        bandClip.maxY = bandClip.minY + SPRITE_BAND_HEIGHT;
+        bandClip = Intersect(bandClip, clip);
+
+        for(u32 bin = bandStart[band]; bin < bandStart[band + 1]; bin++) {
+            SpriteDraw* draw = draws + bins[bin];
+            DrawSprite(buffer, bandClip, atlas, draw->sprite, draw->xPos, draw->yPos);
+        }
+    }
+
+    EndTemporaryMemory(scratch);
+}
@@ -0,0 +1,23 @@
+#ifndef GAME_ATLAS_H
+#define GAME_ATLAS_H
+
+#include "atlas_format.h"
+
+const u32 ATLAS_NO_SPRITE = 0xFFFFFFFF;
+const int32 SPRITE_BAND_HEIGHT = 32; // rows of the target drawn together, 64 KB at 512 pixels wide
+
+// the page is a LoadedBitmap, its opaque flag is never set: every sprite says for itself.
+// an atlas loaded from the archive points into the mapping, good until the next suspend like any asset
+struct SpriteAtlas {
+    LoadedBitmap page;
+    u32 spriteCount;
+    AtlasSprite* sprites;
+};
+
+// one sprite to draw, bottom left corner at xPos, yPos
+struct SpriteDraw {
+    u32 sprite; // index into the atlas
+    int32 xPos, yPos;
+};
+
+#endif
@@ -0,0 +1,61 @@
+// bitmap loading and the blit that draws the result. the parsing itself is in bitmap_format.h
+
+// straight out of an asset blob, the pixels go into the arena
+bool
+LoadBitmap(MemoryArena* arena, void* data, u64 byteCount, LoadedBitmap* result) {
+    *result = {};
+
+    BitmapSource source;
+    if(!data || !ParseBitmap((u8*)data, byteCount, &source)) {
+        return false;
+    }
+
+    result->width = source.width;
+    result->height = source.height;
+    result->pitch = source.width;
+    result->pixels = PushArrayAligned(arena, (u64)source.width * source.height, u32, 32);
+    result->opaque = ConvertBitmapPixels(&source, result->pixels, result->pitch);
+    return true;
+}
+
+bool
+LoadBitmapAsset(MemoryArena* arena, AssetArchive* assets, const char name[], LoadedBitmap* result) {
+    AssetBlob blob = GetAsset(assets, name);
+    return LoadBitmap(arena, blob.data, blob.byteCount, result);
+}
+
+// pixels with their own pitch, bottom left corner at xPos, yPos like DrawRectangle. bitmaps and atlas sprites both end up here
+void
+BlitPixels(GraphicsBuffer* buffer, Rect32 clip, u32* pixels, int32 pitch, int32 width, int32 height, bool opaque, int32 xPos, int32 yPos) {
+    Rect32 bounds = { xPos, yPos, xPos + width, yPos + height };
+    clip = Intersect(Intersect(clip, BufferRect(buffer)), bounds);
+    if(IsEmpty(clip)) {
+        return;
+    }
+
+    int32 xPixels = clip.maxX - clip.minX;
+    u8* row = buffer->data + (buffer->bytesPerRow*clip.minY) + (clip.minX*buffer->bytesPerPixel);
+    u32* source = pixels + (u64)(clip.minY - yPos) * pitch + (clip.minX - xPos);
+
+    for(int32 y = clip.minY; y < clip.maxY; y++) {
+        if(opaque) {
+            memcpy(row, source, xPixels * sizeof(u32));
+        } else {
+            BlendSpan((u32*)row, source, xPixels);
+        }
+
+        row += buffer->bytesPerRow;
+        source += pitch;
+    }
+}
+
+void
+DrawBitmap(GraphicsBuffer* buffer, Rect32 clip, LoadedBitmap* bitmap, int32 xPos, int32 yPos) {
+    PROFILE_ZONE("DrawBitmap");
+    BlitPixels(buffer, clip, bitmap->pixels, bitmap->pitch, bitmap->width, bitmap->height, bitmap->opaque, xPos, yPos);
+}
+
+void
+DrawBitmap(GraphicsBuffer* buffer, LoadedBitmap* bitmap, int32 xPos, int32 yPos) {
+    DrawBitmap(buffer, BufferRect(buffer), bitmap, xPos, yPos);
+}
@@ -0,0 +1,16 @@
+#ifndef GAME_BITMAP_H
+#define GAME_BITMAP_H
+
+#include "bitmap_format.h"
+
+// bitmaps are converted once at load time to what the blitter wants: premultiplied bgra,
+// bottom row first like the graphics buffer, in the arena they were loaded into
+
+struct LoadedBitmap {
+    int32 width, height;
+    int32 pitch;  // in pixels
+    u32* pixels;
+    bool opaque;  // every alpha is 255, drawn with plain row copies
+};
+
+#endif
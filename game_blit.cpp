@@ -0,0 +1,112 @@
+// span blend kernels used by DrawBitmap
+// sources are premultiplied bgra, so a pixel is src + dest * (255 - srcAlpha) / 255 on every channel, alpha included.
+// the divide is rounded like MultiplyDivide255 in every kernel, the wide ones match the scalar one bit for bit
+
+typedef void BlendSpanFunc(u32* dest, u32* src, int32 count);
+
+void BlendSpan_Scalar(u32* dest, u32* src, int32 count);
+void BlendSpan_SSE2(u32* dest, u32* src, int32 count);
+TARGET_AVX2 void BlendSpan_AVX2(u32* dest, u32* src, int32 count);
+
+// sse2 is always there, so this is valid before InitBlitKernels runs
+BlendSpanFunc* BlendSpan = BlendSpan_SSE2;
+
+void
+InitBlitKernels() {
+    BlendSpan = QueryCpuFeatures().avx2 ? BlendSpan_AVX2 : BlendSpan_SSE2;
+}
+
+void
+BlendSpan_Scalar(u32* dest, u32* src, int32 count) {
+    for(int32 i = 0; i < count; i++) {
+        u32 s = src[i];
+        u32 d = dest[i];
+        u32 inverseAlpha = 255 - (s >> 24);
+
+        u32 result = 0;
+        for(u32 shift = 0; shift < 32; shift += 8) {
+            u32 channel = ((s >> shift) & 0xFF) + MultiplyDivide255((d >> shift) & 0xFF, inverseAlpha);
+            result |= (channel > 255 ? 255 : channel) << shift;
+        }
+
+        dest[i] = result;
+    }
+}
+
+// two pixels widened to 16 bits per channel, times their own inverse alpha, divided by 255
+inline __m128i
+BlendScaleHalf_SSE2(__m128i dest16, __m128i src16) {
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src16, 0xFF), 0xFF); // each pixel's alpha in all four lanes
+    __m128i inverseAlpha = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(dest16, inverseAlpha), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// 4 pixels per iteration. groups that are fully opaque are copied and groups that are all zero are skipped,
+// sprites are mostly one or the other with a thin blended edge. premultiplied, zero is the only pixel that changes nothing
+CALLED_FROM_AVX2 void
+BlendSpan_SSE2(u32* dest, u32* src, int32 count) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+
+    while(count >= 4) {
+        __m128i s = _mm_loadu_si128((__m128i*)src);
+        __m128i alpha = _mm_and_si128(s, alphaMask);
+
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask)) == 0xFFFF) {
+            _mm_storeu_si128((__m128i*)dest, s);
+        } else if(_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) != 0xFFFF) {
+            __m128i d = _mm_loadu_si128((__m128i*)dest);
+
+            __m128i low = BlendScaleHalf_SSE2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero));
+            __m128i high = BlendScaleHalf_SSE2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero));
+
+            _mm_storeu_si128((__m128i*)dest, _mm_adds_epu8(s, _mm_packus_epi16(low, high)));
+        }
+
+        dest += 4;
+        src += 4;
+        count -= 4;
+    }
+
+    BlendSpan_Scalar(dest, src, count);
+}
+
+TARGET_AVX2 inline __m256i
+BlendScaleHalf_AVX2(__m256i dest16, __m256i src16) {
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(src16, 0xFF), 0xFF);
+    __m256i inverseAlpha = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(dest16, inverseAlpha), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+// 8 pixels per iteration. unpack and pack both work inside 128 bit lanes, so the pixels come back in order
+TARGET_AVX2 void
+BlendSpan_AVX2(u32* dest, u32* src, int32 count) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i alphaMask = _mm256_set1_epi32(0xFF000000);
+
+    while(count >= 8) {
+        __m256i s = _mm256_loadu_si256((__m256i*)src);
+        __m256i alpha = _mm256_and_si256(s, alphaMask);
+
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, alphaMask)) == -1) {
+            _mm256_storeu_si256((__m256i*)dest, s);
+        } else if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(s, zero)) != -1) {
+            __m256i d = _mm256_loadu_si256((__m256i*)dest);
+
+            __m256i low = BlendScaleHalf_AVX2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero));
+            __m256i high = BlendScaleHalf_AVX2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero));
+
+            _mm256_storeu_si256((__m256i*)dest, _mm256_adds_epu8(s, _mm256_packus_epi16(low, high)));
+        }
+
+        dest += 8;
+        src += 8;
+        count -= 8;
+    }
+
+    BlendSpan_SSE2(dest, src, count);
+}
@@ -0,0 +1,234 @@
+// dirty rects
+// a frame redraws only the pixels whose commands changed since the last frame. commands are compared one by one
+// in execution order: one that changed, appeared or went away dirties where it was and where it is now.
+// a pixel outside every dirty rect has exactly the same commands over it as last frame, so it is left alone.
+// this needs an opaque command under everything, the clear, otherwise a redrawn pixel would blend over itself
+
+const u32 DIRTY_FULL_REDRAW_PERCENT = 50; // past this much of the buffer, one full pass beats many small ones
+
+u64
+RectArea(Rect32 rect) {
+    return IsEmpty(rect) ? 0 : (u64)(rect.maxX - rect.minX) * (rect.maxY - rect.minY);
+}
+
+Rect32
+Union(Rect32 a, Rect32 b) {
+    Rect32 result;
+    result.minX = a.minX < b.minX ? a.minX : b.minX;
+    result.minY = a.minY < b.minY ? a.minY : b.minY;
+    result.maxX = a.maxX > b.maxX ? a.maxX : b.maxX;
+    result.maxY = a.maxY > b.maxY ? a.maxY : b.maxY;
+    return result;
+}
+
+void
+ClearDirtyRegion(DirtyRegion* region) {
+    region->full = false;
+    region->rectCount = 0;
+}
+
+void
+MarkDirtyFull(DirtyRegion* region) {
+    region->full = true;
+    region->rectCount = 0;
+}
+
+// overlapping rects are folded into one, so every pixel is drawn once. when there is no room left
+// the rect joins whichever existing one grows the least
+void
+AddDirtyRect(DirtyRegion* region, Rect32 rect) {
+    if(region->full || IsEmpty(rect)) {
+        return;
+    }
+
+    for(u32 i = 0; i < region->rectCount; ) {
+        if(!IsEmpty(Intersect(region->rects[i], rect))) {
+            // the union may reach rects that were checked already
+            rect = Union(rect, region->rects[i]);
+            region->rects[i] = region->rects[--region->rectCount];
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+
+    if(region->rectCount == MAX_DIRTY_RECTS) {
+        u32 best = 0;
+        u64 bestGrowth = ~0ull;
+        for(u32 i = 0; i < region->rectCount; i++) {
+            u64 growth = RectArea(Union(region->rects[i], rect)) - RectArea(region->rects[i]);
+            if(growth < bestGrowth) {
+                bestGrowth = growth;
+                best = i;
+            }
+        }
+
+        rect = Union(rect, region->rects[best]);
+        region->rects[best] = region->rects[--region->rectCount];
+        AddDirtyRect(region, rect);
+        return;
+    }
+
+    region->rects[region->rectCount++] = rect;
+}
+
+void
+AddDirtyRegion(DirtyRegion* region, DirtyRegion* other) {
+    if(other->full) {
+        MarkDirtyFull(region);
+        return;
+    }
+
+    for(u32 i = 0; i < other->rectCount; i++) {
+        AddDirtyRect(region, other->rects[i]);
+    }
+}
+
+u64
+DirtyPixels(DirtyRegion* region, GraphicsBuffer* buffer) {
+    if(region->full) {
+        return (u64)buffer->width * buffer->height;
+    }
+
+    u64 pixels = 0;
+    for(u32 i = 0; i < region->rectCount; i++) {
+        pixels += RectArea(Intersect(region->rects[i], BufferRect(buffer)));
+    }
+    return pixels;
+}
+
+void
+InitializeRenderHistory(RenderHistory* history, MemoryArena* arena, u32 maxCount) {
+    history->valid = false;
+    history->count = 0;
+    history->maxCount = maxCount;
+    history->keys = PushArray(arena, maxCount, RenderCommandKey);
+}
+
+// fnv-1a
+u64
+HashBytes(u64 hash, void* data, u64 byteCount) {
+    u8* at = (u8*)data;
+    for(u64 i = 0; i < byteCount; i++) {
+        hash = (hash ^ at[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// a bitmap is compared by address, not by its pixels. a game that changes a bitmap's pixels redraws everything
+RenderCommandKey
+MakeRenderCommandKey(RenderCommand* command) {
+    RenderCommandKey key = {};
+    key.type = command->type;
+    key.layer = command->layer;
+    key.bounds = command->bounds;
+    key.color = command->color.packed;
+
+    u64 hash = 0xCBF29CE484222325ull;
+    if(command->type == RenderCommand_Bitmap) {
+        hash = HashBytes(hash, &command->bitmap, sizeof(command->bitmap));
+        hash = HashBytes(hash, &command->xPos, sizeof(command->xPos));
+        hash = HashBytes(hash, &command->yPos, sizeof(command->yPos));
+    } else if(command->type == RenderCommand_Sprites) {
+        // the draws are rebuilt every frame, maybe at the same address, so it is what they say that counts
+        hash = HashBytes(hash, &command->atlas, sizeof(command->atlas));
+        hash = HashBytes(hash, command->draws, command->drawCount * sizeof(SpriteDraw));
+    } else if(command->type == RenderCommand_Polygon) {
+        hash = HashBytes(hash, command->vertices, command->vertexCount * sizeof(RasterVertex));
+        hash = HashBytes(hash, &command->shaded, sizeof(command->shaded));
+    } else if(command->type == RenderCommand_Particles) {
+        // hashing every particle would cost more than drawing them, the pool counts its changes instead
+        hash = HashBytes(hash, &command->particles, sizeof(command->particles));
+        hash = HashBytes(hash, &command->particles->version, sizeof(command->particles->version));
+    } else if(command->type == RenderCommand_Tilemap) {
+        // the same goes for tiles. any change redraws the whole map on screen, scrolling does that anyway
+        hash = HashBytes(hash, &command->tilemap, sizeof(command->tilemap));
+        hash = HashBytes(hash, &command->tilemap->version, sizeof(command->tilemap->version));
+        hash = HashBytes(hash, &command->xPos, sizeof(command->xPos));
+        hash = HashBytes(hash, &command->yPos, sizeof(command->yPos));
+    }
+    key.content = hash;
+
+    return key;
+}
+
+bool
+SameRenderCommandKey(RenderCommandKey* a, RenderCommandKey* b) {
+    return a->type == b->type && a->layer == b->layer && a->color == b->color && a->content == b->content &&
+           a->bounds.minX == b->bounds.minX && a->bounds.minY == b->bounds.minY &&
+           a->bounds.maxX == b->bounds.maxX && a->bounds.maxY == b->bounds.maxY;
+}
+
+// a border only draws the edges of its bounds. the corners go with the sides, four rects that touch
+// would otherwise overlap and fold into the whole buffer
+void
+AddCommandDirtyRects(DirtyRegion* dirty, RenderCommandKey* key) {
+    if(key->type != RenderCommand_Border) {
+        AddDirtyRect(dirty, key->bounds);
+        return;
+    }
+
+    Rect32 bounds = key->bounds;
+    AddDirtyRect(dirty, { bounds.minX, bounds.minY, bounds.minX + 1, bounds.maxY });
+    AddDirtyRect(dirty, { bounds.maxX - 1, bounds.minY, bounds.maxX, bounds.maxY });
+    AddDirtyRect(dirty, { bounds.minX + 1, bounds.minY, bounds.maxX - 1, bounds.minY + 1 });
+    AddDirtyRect(dirty, { bounds.minX + 1, bounds.maxY - 1, bounds.maxX - 1, bounds.maxY });
+}
+
+// compares the ended group with last frame's and adds what changed to dirty, then remembers this frame
+void
+TrackRenderChanges(RenderHistory* history, RenderGroup* group, GraphicsBuffer* buffer, DirtyRegion* dirty) {
+    PROFILE_ZONE("TrackRenderChanges");
+
+    RenderCommand* commands = group->commands;
+    u32 count = group->commandCount;
+
+    bool covered = count > 0 && IsOpaque(commands) && Contains(commands[0].bounds, group->target);
+    if(!history->valid || !covered || count > history->maxCount) {
+        MarkDirtyFull(dirty);
+    }
+
+    u32 longest = count > history->count ? count : history->count;
+    longest = longest < history->maxCount ? longest : history->maxCount;
+
+    for(u32 i = 0; i < longest; i++) {
+        RenderCommandKey* previous = i < history->count ? history->keys + i : 0;
+        if(i >= count) {
+            AddCommandDirtyRects(dirty, previous);
+            continue;
+        }
+
+        RenderCommandKey key = MakeRenderCommandKey(commands + i);
+        if(!previous || !SameRenderCommandKey(previous, &key)) {
+            if(previous) {
+                AddCommandDirtyRects(dirty, previous);
+            }
+            AddCommandDirtyRects(dirty, &key);
+        }
+        history->keys[i] = key;
+    }
+
+    history->count = count < history->maxCount ? count : history->maxCount;
+    history->valid = true;
+
+    u64 bufferPixels = (u64)buffer->width * buffer->height;
+    if(!dirty->full && DirtyPixels(dirty, buffer) * 100 > bufferPixels * DIRTY_FULL_REDRAW_PERCENT) {
+        MarkDirtyFull(dirty);
+    }
+}
+
+// a full region is one pass over the buffer like before, otherwise each rect is tiled on its own
+void
+RenderDirty(WorkQueue* queue, RenderGroup* group, GraphicsBuffer* buffer, DirtyRegion* dirty) {
+    if(dirty->full) {
+        RenderTiled(queue, group, buffer);
+    } else {
+        for(u32 i = 0; i < dirty->rectCount; i++) {
+            RenderTiled(queue, group, buffer, Intersect(dirty->rects[i], BufferRect(buffer)));
+        }
+    }
+
+    group->stats.dirtyRects = dirty->full ? 0 : dirty->rectCount;
+    group->stats.redrawnPixels = (u32)DirtyPixels(dirty, buffer);
+    group->stats.fullRedraws = dirty->full ? 1 : 0;
+}
@@ -0,0 +1,259 @@
+// entity store, see game_entity.h
+// UpdateEntities moves everything that is not frozen by its velocity and bounces it off the edges of the area.
+// the wide kernels do 4 or 8 entities per step with no branches: every choice is a compare mask and a select.
+// a step is a multiply then an add, never fused, so every kernel leaves exactly the values the scalar one does
+
+typedef void UpdateEntitiesFunc(EntityStore* store, f32 dt);
+
+void UpdateEntities_Scalar(EntityStore* store, f32 dt);
+void UpdateEntities_SSE2(EntityStore* store, f32 dt);
+TARGET_AVX2 void UpdateEntities_AVX2(EntityStore* store, f32 dt);
+
+// sse2 is always there, so this is valid before InitEntityKernels runs
+UpdateEntitiesFunc* UpdateEntities = UpdateEntities_SSE2;
+
+void
+InitEntityKernels() {
+    UpdateEntities = QueryCpuFeatures().avx2 ? UpdateEntities_AVX2 : UpdateEntities_SSE2;
+}
+
+void
+InitializeEntityStore(EntityStore* store, MemoryArena* arena, u32 capacity, f32 minX, f32 minY, f32 maxX, f32 maxY) {
+    assert(capacity <= MAX_ENTITY_CAPACITY);
+
+    // the wide kernels run past count up to the next multiple of 8, the padding is zeroed so they only ever see numbers
+    u32 padded = (capacity + 7) & ~7;
+
+    store->capacity = capacity;
+    store->count = 0;
+
+    store->x = PushArrayAligned(arena, padded, f32, 32);
+    store->y = PushArrayAligned(arena, padded, f32, 32);
+    store->velocityX = PushArrayAligned(arena, padded, f32, 32);
+    store->velocityY = PushArrayAligned(arena, padded, f32, 32);
+    store->color = PushArrayAligned(arena, padded, u32, 32);
+    store->flags = PushArrayAligned(arena, padded, u32, 32);
+    store->slot = PushArray(arena, padded, u32);
+
+    memset(store->x, 0, padded * sizeof(f32));
+    memset(store->y, 0, padded * sizeof(f32));
+    memset(store->velocityX, 0, padded * sizeof(f32));
+    memset(store->velocityY, 0, padded * sizeof(f32));
+    memset(store->color, 0, padded * sizeof(u32));
+    memset(store->flags, 0, padded * sizeof(u32));
+
+    store->slotIndex = PushArray(arena, capacity, u32);
+    store->slotGeneration = PushArray(arena, capacity, u16);
+    for(u32 i = 0; i < capacity; i++) {
+        store->slotIndex[i] = i + 1 < capacity ? i + 1 : ENTITY_NONE;
+        store->slotGeneration[i] = 1;
+    }
+    store->freeSlot = capacity > 0 ? 0 : ENTITY_NONE;
+
+    store->minX = minX;
+    store->minY = minY;
+    store->maxX = maxX;
+    store->maxY = maxY;
+}
+
+// dense index of a live entity, ENTITY_NONE for a destroyed one or the null id
+u32
+GetEntityIndex(EntityStore* store, EntityId id) {
+    u32 slot = id.value & ENTITY_SLOT_MASK;
+    u32 generation = id.value >> ENTITY_SLOT_BITS;
+
+    if(id.value == 0 || slot >= store->capacity || store->slotGeneration[slot] != generation) {
+        return ENTITY_NONE;
+    }
+
+    return store->slotIndex[slot];
+}
+
+bool
+IsEntityAlive(EntityStore* store, EntityId id) {
+    return GetEntityIndex(store, id) != ENTITY_NONE;
+}
+
+// returns the null id when the store is full
+EntityId
+CreateEntity(EntityStore* store, f32 x, f32 y, f32 velocityX, f32 velocityY, u32 color, u32 flags) {
+    EntityId id = {};
+
+    u32 slot = store->freeSlot;
+    if(slot == ENTITY_NONE) {
+        return id;
+    }
+    store->freeSlot = store->slotIndex[slot];
+
+    u32 index = store->count++;
+    store->slotIndex[slot] = index;
+
+    store->x[index] = x;
+    store->y[index] = y;
+    store->velocityX[index] = velocityX;
+    store->velocityY[index] = velocityY;
+    store->color[index] = color;
+    store->flags[index] = flags;
+    store->slot[index] = slot;
+
+    id.value = ((u32)store->slotGeneration[slot] << ENTITY_SLOT_BITS) | slot;
+    return id;
+}
+
+// the last entity moves into the hole, so indices of other entities can change. ids stay valid
+void
+DestroyEntity(EntityStore* store, EntityId id) {
+    u32 index = GetEntityIndex(store, id);
+    if(index == ENTITY_NONE) {
+        return;
+    }
+
+    u32 slot = id.value & ENTITY_SLOT_MASK;
+    u32 last = --store->count;
+
+    if(index != last) {
+        store->x[index] = store->x[last];
+        store->y[index] = store->y[last];
+        store->velocityX[index] = store->velocityX[last];
+        store->velocityY[index] = store->velocityY[last];
+        store->color[index] = store->color[last];
+        store->flags[index] = store->flags[last];
+        store->slot[index] = store->slot[last];
+        store->slotIndex[store->slot[index]] = index;
+    }
+
+    u16 generation = (store->slotGeneration[slot] + 1) & ENTITY_GENERATION_MASK;
+    store->slotGeneration[slot] = generation ? generation : 1; // keeps every id nonzero
+
+    store->slotIndex[slot] = store->freeSlot;
+    store->freeSlot = slot;
+}
+
+// one axis of one entity. below min the velocity turns positive, above max negative, so an entity
+// that starts outside the area heads back in instead of flipping back and forth
+inline bool
+MoveAxis(f32* position, f32* velocity, f32 dt, f32 min, f32 max) {
+    f32 step = *velocity * dt;
+    f32 moved = *position + step;
+
+    bool below = moved < min;
+    bool above = moved > max;
+
+    f32 speed = fabsf(*velocity);
+    *velocity = below ? speed : (above ? -speed : *velocity);
+    *position = below ? min : (above ? max : moved);
+
+    return below || above;
+}
+
+void
+UpdateEntities_Scalar(EntityStore* store, f32 dt) {
+    for(u32 i = 0; i < store->count; i++) {
+        u32 flags = store->flags[i];
+        if(flags & ENTITY_FROZEN) {
+            continue;
+        }
+
+        bool hitX = MoveAxis(store->x + i, store->velocityX + i, dt, store->minX, store->maxX);
+        bool hitY = MoveAxis(store->y + i, store->velocityY + i, dt, store->minY, store->maxY);
+
+        store->flags[i] = (flags & ~ENTITY_BOUNCED) | (hitX || hitY ? ENTITY_BOUNCED : 0);
+    }
+}
+
+// mask ? a : b
+inline __m128
+Select_SSE2(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// MoveAxis on 4 entities, returns the lanes that hit an edge
+inline __m128
+MoveAxis_SSE2(f32* position, f32* velocity, __m128 dt, __m128 min, __m128 max, __m128 moving) {
+    __m128 signBit = _mm_set1_ps(-0.0f);
+    __m128 p = _mm_load_ps(position);
+    __m128 v = _mm_load_ps(velocity);
+
+    __m128 moved = _mm_add_ps(p, _mm_mul_ps(v, dt));
+    __m128 below = _mm_cmplt_ps(moved, min);
+    __m128 above = _mm_cmpgt_ps(moved, max);
+
+    __m128 speed = _mm_andnot_ps(signBit, v);
+    __m128 bounced = Select_SSE2(below, speed, Select_SSE2(above, _mm_or_ps(speed, signBit), v));
+    __m128 clamped = Select_SSE2(below, min, Select_SSE2(above, max, moved));
+
+    _mm_store_ps(velocity, Select_SSE2(moving, bounced, v));
+    _mm_store_ps(position, Select_SSE2(moving, clamped, p));
+
+    return _mm_and_ps(moving, _mm_or_ps(below, above));
+}
+
+void
+UpdateEntities_SSE2(EntityStore* store, f32 dt) {
+    __m128 step = _mm_set1_ps(dt);
+    __m128 minX = _mm_set1_ps(store->minX);
+    __m128 minY = _mm_set1_ps(store->minY);
+    __m128 maxX = _mm_set1_ps(store->maxX);
+    __m128 maxY = _mm_set1_ps(store->maxY);
+    __m128i frozen = _mm_set1_epi32(ENTITY_FROZEN);
+    __m128i bounced = _mm_set1_epi32(ENTITY_BOUNCED);
+    __m128i zero = _mm_setzero_si128();
+
+    for(u32 i = 0; i < store->count; i += 4) {
+        __m128i flags = _mm_load_si128((__m128i*)(store->flags + i));
+        __m128 moving = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(flags, frozen), zero));
+
+        __m128 hitX = MoveAxis_SSE2(store->x + i, store->velocityX + i, step, minX, maxX, moving);
+        __m128 hitY = MoveAxis_SSE2(store->y + i, store->velocityY + i, step, minY, maxY, moving);
+        __m128i hit = _mm_castps_si128(_mm_or_ps(hitX, hitY));
+
+        // frozen lanes keep their flags, moving ones get bounced set or cleared
+        __m128i cleared = _mm_andnot_si128(_mm_and_si128(_mm_castps_si128(moving), bounced), flags);
+        _mm_store_si128((__m128i*)(store->flags + i), _mm_or_si128(cleared, _mm_and_si128(hit, bounced)));
+    }
+}
+
+// MoveAxis on 8 entities, the same steps as MoveAxis_SSE2
+TARGET_AVX2 inline __m256
+MoveAxis_AVX2(f32* position, f32* velocity, __m256 dt, __m256 min, __m256 max, __m256 moving) {
+    __m256 signBit = _mm256_set1_ps(-0.0f);
+    __m256 p = _mm256_load_ps(position);
+    __m256 v = _mm256_load_ps(velocity);
+
+    __m256 moved = _mm256_add_ps(p, _mm256_mul_ps(v, dt));
+    __m256 below = _mm256_cmp_ps(moved, min, _CMP_LT_OQ);
+    __m256 above = _mm256_cmp_ps(moved, max, _CMP_GT_OQ);
+
+    __m256 speed = _mm256_andnot_ps(signBit, v);
+    __m256 bounced = _mm256_blendv_ps(_mm256_blendv_ps(v, _mm256_or_ps(speed, signBit), above), speed, below);
+    __m256 clamped = _mm256_blendv_ps(_mm256_blendv_ps(moved, max, above), min, below);
+
+    _mm256_store_ps(velocity, _mm256_blendv_ps(v, bounced, moving));
+    _mm256_store_ps(position, _mm256_blendv_ps(p, clamped, moving));
+
+    return _mm256_and_ps(moving, _mm256_or_ps(below, above));
+}
+
+TARGET_AVX2 void
+UpdateEntities_AVX2(EntityStore* store, f32 dt) {
+    __m256 step = _mm256_set1_ps(dt);
+    __m256 minX = _mm256_set1_ps(store->minX);
+    __m256 minY = _mm256_set1_ps(store->minY);
+    __m256 maxX = _mm256_set1_ps(store->maxX);
+    __m256 maxY = _mm256_set1_ps(store->maxY);
+    __m256i frozen = _mm256_set1_epi32(ENTITY_FROZEN);
+    __m256i bounced = _mm256_set1_epi32(ENTITY_BOUNCED);
+    __m256i zero = _mm256_setzero_si256();
+
+    for(u32 i = 0; i < store->count; i += 8) {
+        __m256i flags = _mm256_load_si256((__m256i*)(store->flags + i));
+        __m256 moving = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(flags, frozen), zero));
+
+        __m256 hitX = MoveAxis_AVX2(store->x + i, store->velocityX + i, step, minX, maxX, moving);
+        __m256 hitY = MoveAxis_AVX2(store->y + i, store->velocityY + i, step, minY, maxY, moving);
+        __m256i hit = _mm256_castps_si256(_mm256_or_ps(hitX, hitY));
+
+        __m256i cleared = _mm256_andnot_si256(_mm256_and_si256(_mm256_castps_si256(moving), bounced), flags);
+        _mm256_store_si256((__m256i*)(store->flags + i), _mm256_or_si256(cleared, _mm256_and_si256(hit, bounced)));
+    }
+}
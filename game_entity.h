@@ -0,0 +1,48 @@
+#ifndef GAME_ENTITY_H
+#define GAME_ENTITY_H
+
+// entity store: every property is its own array, indexed by a dense entity index. an update pass reads
+// exactly the arrays it needs, a whole cache line of one property at a time, and the simd kernels load
+// 4 or 8 entities per instruction. removal moves the last entity into the hole, so 0..count stays packed.
+// handles go through a slot table, so they survive the moves
+
+const u32 ENTITY_SLOT_BITS = 20;
+const u32 ENTITY_SLOT_MASK = (1 << ENTITY_SLOT_BITS) - 1;
+const u32 ENTITY_GENERATION_MASK = (1 << (32 - ENTITY_SLOT_BITS)) - 1;
+const u32 MAX_ENTITY_CAPACITY = 1 << ENTITY_SLOT_BITS;
+const u32 ENTITY_NONE = 0xFFFFFFFF;
+
+// flags
+const u32 ENTITY_FROZEN = 1 << 0;  // not moved by UpdateEntities
+const u32 ENTITY_BOUNCED = 1 << 1; // set by UpdateEntities when it hit an edge of the area this update, cleared otherwise
+
+// handle to an entity. the generation makes handles to destroyed entities harmless
+struct EntityId {
+    u32 value; // slot in the low bits, generation above. generations start at 1, so 0 is never a valid entity
+};
+
+struct EntityStore {
+    u32 capacity;
+    u32 count;
+
+    // dense, 0..count. padded to a multiple of 8 and 32 byte aligned, so kernels never need a masked load
+    f32* x;
+    f32* y;
+    f32* velocityX; // pixels per second
+    f32* velocityY;
+    u32* color;     // packed bgra, like Color32
+    u32* flags;
+    u32* slot;      // the slot that points here, fixed up when an entity is moved
+
+    // sparse, 0..capacity. a live slot holds its entity's dense index, a free one the next free slot.
+    // destroying an entity bumps its slot's generation, so the old id stops matching right away
+    u32* slotIndex;
+    u16* slotGeneration;
+    u32 freeSlot; // head of the free list, ENTITY_NONE when full
+
+    // moving entities bounce off the edges of this area
+    f32 minX, minY;
+    f32 maxX, maxY;
+};
+
+#endif
@@ -0,0 +1,169 @@
+// span fill kernels used by the draw functions
+// every kernel writes exactly the same pixels as a plain u32 loop, only faster
+
+// clears at least this big bypass the cache. the buffer won't be read back before it is presented
+const int64 NONTEMPORAL_MIN_BYTES = 256 * 1024;
+
+typedef void FillSpanFunc(u32* dest, int32 count, u32 color);
+
+void FillSpan_Scalar(u32* dest, int32 count, u32 color);
+void FillSpan_SSE2(u32* dest, int32 count, u32 color);
+void FillSpanStream_SSE2(u32* dest, int64 count, u32 color);
+TARGET_AVX2 void FillSpan_AVX2(u32* dest, int32 count, u32 color);
+TARGET_AVX2 void FillSpanStream_AVX2(u32* dest, int64 count, u32 color);
+
+// sse2 is always there, so this is valid before InitFillKernels runs
+FillSpanFunc* FillSpan = FillSpan_SSE2;
+bool FillUseAVX2 = false;
+
+void
+InitFillKernels() {
+    FillUseAVX2 = QueryCpuFeatures().avx2;
+    FillSpan = FillUseAVX2 ? FillSpan_AVX2 : FillSpan_SSE2;
+}
+
+// fills a large contiguous run with streaming stores
+void
+FillSpanStream(u32* dest, int64 count, u32 color) {
+    if(FillUseAVX2) {
+        FillSpanStream_AVX2(dest, count, color);
+    } else {
+        FillSpanStream_SSE2(dest, count, color);
+    }
+}
+
+void
+FillSpan_Scalar(u32* dest, int32 count, u32 color) {
+    for(int32 i = 0; i < count; i++) {
+        *dest++ = color;
+    }
+}
+
+CALLED_FROM_AVX2 void
+FillSpan_SSE2(u32* dest, int32 count, u32 color) {
+    // a pitch that isn't a multiple of 4 leaves pixels that can never reach 16 byte alignment
+    bool canAlign = ((u64)dest & 3) == 0;
+
+    if(canAlign) {
+        // scalar head up to the first 16 byte boundary
+        while(count > 0 && ((u64)dest & 15)) {
+            *dest++ = color;
+            count--;
+        }
+    }
+
+    __m128i wide = _mm_set1_epi32(color);
+
+    if(canAlign) {
+        while(count >= 16) {
+            _mm_store_si128((__m128i*)dest + 0, wide);
+            _mm_store_si128((__m128i*)dest + 1, wide);
+            _mm_store_si128((__m128i*)dest + 2, wide);
+            _mm_store_si128((__m128i*)dest + 3, wide);
+            dest += 16;
+            count -= 16;
+        }
+    }
+
+    while(count >= 4) {
+        _mm_storeu_si128((__m128i*)dest, wide);
+        dest += 4;
+        count -= 4;
+    }
+
+    // scalar tail
+    FillSpan_Scalar(dest, count, color);
+}
+
+TARGET_AVX2 void
+FillSpan_AVX2(u32* dest, int32 count, u32 color) {
+    // short spans (borders, small rects) are done before the head loop would even finish
+    if(count < 32 || ((u64)dest & 3)) {
+        FillSpan_SSE2(dest, count, color);
+        return;
+    }
+
+    while((u64)dest & 31) {
+        *dest++ = color;
+        count--;
+    }
+
+    __m256i wide = _mm256_set1_epi32(color);
+
+    while(count >= 32) {
+        _mm256_store_si256((__m256i*)dest + 0, wide);
+        _mm256_store_si256((__m256i*)dest + 1, wide);
+        _mm256_store_si256((__m256i*)dest + 2, wide);
+        _mm256_store_si256((__m256i*)dest + 3, wide);
+        dest += 32;
+        count -= 32;
+    }
+
+    while(count >= 8) {
+        _mm256_store_si256((__m256i*)dest, wide);
+        dest += 8;
+        count -= 8;
+    }
+
+    FillSpan_Scalar(dest, count, color);
+}
+
+void
+FillSpanStream_SSE2(u32* dest, int64 count, u32 color) {
+    if((u64)dest & 3) {
+        // can't align, regular stores will have to do
+        for(int64 i = 0; i < count; i++) {
+            *dest++ = color;
+        }
+        return;
+    }
+
+    while(count > 0 && ((u64)dest & 15)) {
+        *dest++ = color;
+        count--;
+    }
+
+    __m128i wide = _mm_set1_epi32(color);
+
+    while(count >= 16) {
+        _mm_stream_si128((__m128i*)dest + 0, wide);
+        _mm_stream_si128((__m128i*)dest + 1, wide);
+        _mm_stream_si128((__m128i*)dest + 2, wide);
+        _mm_stream_si128((__m128i*)dest + 3, wide);
+        dest += 16;
+        count -= 16;
+    }
+
+    // streaming stores are weakly ordered. fence before anyone else touches the buffer
+    _mm_sfence();
+
+    FillSpan_SSE2(dest, (int32)count, color);
+}
+
+TARGET_AVX2 void
+FillSpanStream_AVX2(u32* dest, int64 count, u32 color) {
+    if((u64)dest & 3) {
+        FillSpanStream_SSE2(dest, count, color);
+        return;
+    }
+
+    while(count > 0 && ((u64)dest & 31)) {
+        *dest++ = color;
+        count--;
+    }
+
+    __m256i wide = _mm256_set1_epi32(color);
+
+    while(count >= 32) {
+        _mm256_stream_si256((__m256i*)dest + 0, wide);
+        _mm256_stream_si256((__m256i*)dest + 1, wide);
+        _mm256_stream_si256((__m256i*)dest + 2, wide);
+        _mm256_stream_si256((__m256i*)dest + 3, wide);
+        dest += 32;
+        count -= 32;
+    }
+
+    _mm_sfence();
+
+    FillSpan_SSE2(dest, (int32)count, color);
+}
@@ -0,0 +1,393 @@
+// mixer voices are summed with sse2, 4 frames at a time
+// accumulation is planar (all left, then all right) so every add is a straight vector op
+
+const f32 FULL_SCALE = 32767.0f;
+
+void
+InitializeMixer(Mixer* mixer) {
+    for(u32 i = 0; i < MAX_VOICES; i++) {
+        mixer->voices[i] = {};
+    }
+    mixer->masterVolume = 1.0f;
+    mixer->voicesMixed = 0;
+}
+
+MixerVoice*
+GetVoice(Mixer* mixer, VoiceId id) {
+    u32 index = id.value & 0xFFFF;
+    u32 generation = id.value >> 16;
+
+    if(id.value == 0 || index >= MAX_VOICES) {
+        return 0;
+    }
+
+    MixerVoice* voice = mixer->voices + index;
+    if(voice->type == Voice_Off || voice->generation != generation) {
+        return 0;
+    }
+
+    return voice;
+}
+
+// returns an invalid id when all voices are busy
+VoiceId
+AllocateVoice(Mixer* mixer, VoiceType type, f32 volume, f32 pan) {
+    VoiceId id = {};
+
+    for(u32 i = 0; i < MAX_VOICES; i++) {
+        MixerVoice* voice = mixer->voices + i;
+        if(voice->type != Voice_Off) {
+            continue;
+        }
+
+        u16 generation = voice->generation + 1;
+        if(generation == 0) {
+            generation = 1; // keeps every id nonzero
+        }
+
+        *voice = {};
+        voice->type = (u8)type;
+        voice->generation = generation;
+        voice->volume = volume;
+        voice->pan = pan;
+
+        id.value = ((u32)generation << 16) | i;
+        break;
+    }
+
+    return id;
+}
+
+VoiceId
+PlayTone(Mixer* mixer, f32 frequency, f32 volume, f32 pan) {
+    VoiceId id = AllocateVoice(mixer, Voice_Tone, volume, pan);
+    MixerVoice* voice = GetVoice(mixer, id);
+    if(voice) {
+        voice->frequency = frequency;
+    }
+    return id;
+}
+
+VoiceId
+PlaySamples(Mixer* mixer, SoundSamples* sound, f32 volume, f32 pan, bool loop) {
+    VoiceId id = AllocateVoice(mixer, Voice_Samples, volume, pan);
+    MixerVoice* voice = GetVoice(mixer, id);
+    if(voice) {
+        voice->sound = sound;
+        voice->loop = loop;
+    }
+    return id;
+}
+
+// the voice is silent until the stream's first chunk is in, and stops when the stream ends or fails
+VoiceId
+PlayStream(Mixer* mixer, AudioStream* stream, f32 volume, f32 pan) {
+    VoiceId id = AllocateVoice(mixer, Voice_Stream, volume, pan);
+    MixerVoice* voice = GetVoice(mixer, id);
+    if(voice) {
+        voice->stream = stream;
+    }
+    return id;
+}
+
+void
+StopVoice(Mixer* mixer, VoiceId id) {
+    MixerVoice* voice = GetVoice(mixer, id);
+    if(voice) {
+        voice->type = Voice_Off;
+    }
+}
+
+void
+SetVoiceFrequency(Mixer* mixer, VoiceId id, f32 frequency) {
+    MixerVoice* voice = GetVoice(mixer, id);
+    if(voice) {
+        voice->frequency = frequency;
+    }
+}
+
+void
+SetVoiceVolume(Mixer* mixer, VoiceId id, f32 volume, f32 pan) {
+    MixerVoice* voice = GetVoice(mixer, id);
+    if(voice) {
+        voice->volume = volume;
+        voice->pan = pan;
+    }
+}
+
+// balance pan: center leaves both channels at full volume, moving right only turns the left down
+void
+VoiceGains(Mixer* mixer, MixerVoice* voice, f32* left, f32* right) {
+    f32 pan = voice->pan < -1.0f ? -1.0f : (voice->pan > 1.0f ? 1.0f : voice->pan);
+    f32 volume = voice->volume * mixer->masterVolume;
+
+    *left = volume * (pan > 0 ? 1.0f - pan : 1.0f);
+    *right = volume * (pan < 0 ? 1.0f + pan : 1.0f);
+}
+
+// sin(2 pi t) for t in cycles. parabola plus one refinement step, error is about 0.001 of full scale.
+// the vector version below does the same math, lane for lane
+f32
+FastSinCycles(f32 t) {
+    t = t - floorf(t + 0.5f); // -0.5..0.5
+
+    f32 y = 8.0f * t - 16.0f * t * fabsf(t);
+    return 0.225f * (y * fabsf(y) - y) + y;
+}
+
+__m128
+FastSinCycles4(__m128 t) {
+    __m128 signMask = _mm_set1_ps(-0.0f);
+
+    // t - round(t), without sse4.1 rounding
+    __m128 shifted = _mm_add_ps(t, _mm_set1_ps(0.5f));
+    __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(shifted));
+    __m128 floored = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmplt_ps(shifted, truncated), _mm_set1_ps(1.0f)));
+    t = _mm_sub_ps(t, floored);
+
+    __m128 absT = _mm_andnot_ps(signMask, t);
+    __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(8.0f), t), _mm_mul_ps(_mm_set1_ps(16.0f), _mm_mul_ps(t, absT)));
+
+    __m128 absY = _mm_andnot_ps(signMask, y);
+    return _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.225f), _mm_sub_ps(_mm_mul_ps(y, absY), y)), y);
+}
+
+void
+MixTone(MixerVoice* voice, f32 gainLeft, f32 gainRight, f32* left, f32* right, u32 frameCount, u32 samplesPerSecond) {
+    f32 step = voice->frequency / samplesPerSecond; // cycles per frame
+    f32 phase = voice->phase;
+
+    __m128 gainL = _mm_set1_ps(gainLeft * FULL_SCALE);
+    __m128 gainR = _mm_set1_ps(gainRight * FULL_SCALE);
+    __m128 laneOffsets = _mm_set_ps(3 * step, 2 * step, step, 0);
+
+    u32 i = 0;
+    for(; i + 4 <= frameCount; i += 4) {
+        __m128 t = _mm_add_ps(_mm_set1_ps(phase), laneOffsets);
+        __m128 value = FastSinCycles4(t);
+
+        _mm_store_ps(left + i, _mm_add_ps(_mm_load_ps(left + i), _mm_mul_ps(value, gainL)));
+        _mm_store_ps(right + i, _mm_add_ps(_mm_load_ps(right + i), _mm_mul_ps(value, gainR)));
+
+        // wrap every block so the phase never loses precision
+        phase += 4 * step;
+        phase -= floorf(phase);
+    }
+
+    for(; i < frameCount; i++) {
+        f32 value = FastSinCycles(phase);
+        left[i] += value * gainLeft * FULL_SCALE;
+        right[i] += value * gainRight * FULL_SCALE;
+
+        phase += step;
+        phase -= floorf(phase);
+    }
+
+    voice->phase = phase;
+}
+
+// mixes a contiguous run of source frames, no wrap inside.
+// a loop that wraps starts the next run mid vector, so the accumulators may be unaligned here
+void
+MixSampleRun(SoundSamples* sound, u32 position, f32 gainLeft, f32 gainRight, f32* left, f32* right, u32 frameCount) {
+    __m128 gainL = _mm_set1_ps(gainLeft);
+    __m128 gainR = _mm_set1_ps(gainRight);
+
+    u32 i = 0;
+
+    if(sound->channelCount == 1) {
+        int16* source = sound->samples + position;
+
+        for(; i + 4 <= frameCount; i += 4) {
+            // 4 int16 -> 4 int32, sign extended by shifting down from the high half
+            __m128i packed = _mm_loadl_epi64((__m128i*)(source + i));
+            __m128 value = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16));
+
+            _mm_storeu_ps(left + i, _mm_add_ps(_mm_loadu_ps(left + i), _mm_mul_ps(value, gainL)));
+            _mm_storeu_ps(right + i, _mm_add_ps(_mm_loadu_ps(right + i), _mm_mul_ps(value, gainR)));
+        }
+
+        for(; i < frameCount; i++) {
+            left[i] += source[i] * gainLeft;
+            right[i] += source[i] * gainRight;
+        }
+    } else {
+        int16* source = sound->samples + position * 2;
+
+        for(; i + 4 <= frameCount; i += 4) {
+            // l r l r l r l r -> low halves are left, high halves are right
+            __m128i packed = _mm_loadu_si128((__m128i*)(source + i * 2));
+            __m128 valueL = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(packed, 16), 16));
+            __m128 valueR = _mm_cvtepi32_ps(_mm_srai_epi32(packed, 16));
+
+            _mm_storeu_ps(left + i, _mm_add_ps(_mm_loadu_ps(left + i), _mm_mul_ps(valueL, gainL)));
+            _mm_storeu_ps(right + i, _mm_add_ps(_mm_loadu_ps(right + i), _mm_mul_ps(valueR, gainR)));
+        }
+
+        for(; i < frameCount; i++) {
+            left[i] += source[i * 2] * gainLeft;
+            right[i] += source[i * 2 + 1] * gainRight;
+        }
+    }
+}
+
+void
+MixSamples(MixerVoice* voice, f32 gainLeft, f32 gainRight, f32* left, f32* right, u32 frameCount) {
+    SoundSamples* sound = voice->sound;
+    u32 written = 0;
+
+    while(written < frameCount) {
+        if(voice->position >= sound->frameCount) {
+            if(!voice->loop || sound->frameCount == 0) {
+                voice->type = Voice_Off; // one shot is done
+                return;
+            }
+            voice->position = 0;
+        }
+
+        u32 run = sound->frameCount - voice->position;
+        if(run > frameCount - written) {
+            run = frameCount - written;
+        }
+
+        MixSampleRun(sound, voice->position, gainLeft, gainRight, left + written, right + written, run);
+
+        voice->position += run;
+        written += run;
+    }
+}
+
+// plays whatever the reader has filled. running dry mid mix is an underrun, the rest of the mix stays silent
+void
+MixStream(MixerVoice* voice, f32 gainLeft, f32 gainRight, f32* left, f32* right, u32 frameCount) {
+    AudioStream* stream = voice->stream;
+
+    u32 state = AtomicLoad(&stream->state);
+    if(state == Stream_Closed || state == Stream_Failed) {
+        voice->type = Voice_Off;
+        return;
+    }
+
+    u32 frameBytes = stream->channelCount * sizeof(int16);
+    u32 written = 0;
+
+    while(state == Stream_Playing && written < frameCount) {
+        // end of data first: once it is set, filled is final
+        u32 endOfData = AtomicLoad(&stream->endOfData);
+        u32 filled = AtomicLoad(&stream->filled);
+
+        if(filled == stream->consumed) {
+            if(endOfData) {
+                voice->type = Voice_Off;
+            } else {
+                stream->underruns++;
+            }
+            break;
+        }
+
+        u32 chunkIndex = stream->consumed % STREAM_CHUNK_COUNT;
+        u32 chunkBytes = stream->chunkBytes[chunkIndex];
+
+        SoundSamples run = {};
+        run.channelCount = stream->channelCount;
+        run.frameCount = (chunkBytes - stream->chunkOffset) / frameBytes;
+        run.samples = (int16*)(stream->ring + (u64)chunkIndex * STREAM_CHUNK_BYTES + stream->chunkOffset);
+
+        if(run.frameCount > frameCount - written) {
+            run.frameCount = frameCount - written;
+        }
+
+        MixSampleRun(&run, 0, gainLeft, gainRight, left + written, right + written, run.frameCount);
+
+        written += run.frameCount;
+        stream->chunkOffset += run.frameCount * frameBytes;
+
+        if(stream->chunkOffset == chunkBytes) {
+            // hands the chunk back to the reader
+            stream->chunkOffset = 0;
+            AtomicStore(&stream->consumed, stream->consumed + 1);
+        }
+    }
+
+    RequestStreamRead(stream);
+}
+
+// float to int16 with saturation, interleaving left and right on the way
+void
+ConvertToOutput(f32* left, f32* right, int16* output, u32 frameCount) {
+    __m128 maxValue = _mm_set1_ps(32767.0f);
+    __m128 minValue = _mm_set1_ps(-32768.0f);
+
+    u32 i = 0;
+    for(; i + 4 <= frameCount; i += 4) {
+        // clamp first: cvtps turns anything out of int32 range into 0x80000000
+        __m128 l = _mm_max_ps(_mm_min_ps(_mm_load_ps(left + i), maxValue), minValue);
+        __m128 r = _mm_max_ps(_mm_min_ps(_mm_load_ps(right + i), maxValue), minValue);
+
+        __m128i l32 = _mm_cvtps_epi32(l);
+        __m128i r32 = _mm_cvtps_epi32(r);
+
+        // l0 r0 l1 r1 | l2 r2 l3 r3, packed down to int16 with saturation
+        __m128i low = _mm_unpacklo_epi32(l32, r32);
+        __m128i high = _mm_unpackhi_epi32(l32, r32);
+        _mm_storeu_si128((__m128i*)(output + i * 2), _mm_packs_epi32(low, high));
+    }
+
+    for(; i < frameCount; i++) {
+        f32 l = left[i] > 32767.0f ? 32767.0f : (left[i] < -32768.0f ? -32768.0f : left[i]);
+        f32 r = right[i] > 32767.0f ? 32767.0f : (right[i] < -32768.0f ? -32768.0f : right[i]);
+
+        // same round to nearest even as cvtps
+        output[i * 2] = (int16)_mm_cvtss_si32(_mm_set_ss(l));
+        output[i * 2 + 1] = (int16)_mm_cvtss_si32(_mm_set_ss(r));
+    }
+}
+
+void
+MixSound(Mixer* mixer, MemoryArena* scratch, SoundBuffer* soundBuffer) {
+    PROFILE_ZONE("MixSound");
+
+    u32 frameCount = soundBuffer->numSamplesToWrite;
+    mixer->voicesMixed = 0;
+
+    if(frameCount == 0) {
+        return;
+    }
+
+    TemporaryMemory temp = BeginTemporaryMemory(scratch);
+
+    // rounded up to whole vectors, the vector loops never need a tail on these
+    u32 paddedCount = (frameCount + 3) & ~3;
+    f32* left = PushArrayAligned(scratch, paddedCount, f32, 16);
+    f32* right = PushArrayAligned(scratch, paddedCount, f32, 16);
+
+    __m128 zero = _mm_setzero_ps();
+    for(u32 i = 0; i < paddedCount; i += 4) {
+        _mm_store_ps(left + i, zero);
+        _mm_store_ps(right + i, zero);
+    }
+
+    for(u32 v = 0; v < MAX_VOICES; v++) {
+        MixerVoice* voice = mixer->voices + v;
+        if(voice->type == Voice_Off) {
+            continue;
+        }
+
+        f32 gainLeft, gainRight;
+        VoiceGains(mixer, voice, &gainLeft, &gainRight);
+
+        if(voice->type == Voice_Tone) {
+            MixTone(voice, gainLeft, gainRight, left, right, frameCount, soundBuffer->samplesPerSecond);
+        } else if(voice->type == Voice_Samples) {
+            MixSamples(voice, gainLeft, gainRight, left, right, frameCount);
+        } else if(voice->type == Voice_Stream) {
+            MixStream(voice, gainLeft, gainRight, left, right, frameCount);
+        }
+
+        mixer->voicesMixed++;
+    }
+
+    ConvertToOutput(left, right, soundBuffer->samples, frameCount);
+
+    EndTemporaryMemory(temp);
+}
@@ -0,0 +1,55 @@
+#ifndef GAME_MIXER_H
+#define GAME_MIXER_H
+
+// software mixer. every voice is summed into a float buffer, then converted to the engine's
+// interleaved stereo int16 samples in one saturating pass
+
+const u32 MAX_VOICES = 128;
+
+enum VoiceType {
+    Voice_Off,
+    Voice_Tone,    // sine at a frequency
+    Voice_Samples, // plays a SoundSamples buffer, looping or once
+    Voice_Stream,  // plays an AudioStream's read ahead ring
+};
+
+// pcm owned by whoever loaded it, the mixer only reads
+struct SoundSamples {
+    u32 frameCount;   // one frame = one sample per channel
+    u32 channelCount; // 1 or 2, stereo is interleaved
+    int16* samples;
+};
+
+// handle to a playing voice. the generation makes handles to finished voices harmless
+struct VoiceId {
+    u32 value; // 0 is never a valid voice
+};
+
+struct MixerVoice {
+    u8 type;
+    bool loop;
+    u16 generation;
+
+    f32 volume; // 1 = full scale
+    f32 pan;    // -1 left, 0 center, 1 right
+
+    // tone
+    f32 frequency;
+    f32 phase; // in cycles, 0..1
+
+    // samples
+    SoundSamples* sound;
+    u32 position; // next frame to play
+
+    // stream
+    AudioStream* stream;
+};
+
+struct Mixer {
+    MixerVoice voices[MAX_VOICES];
+    f32 masterVolume;
+
+    u32 voicesMixed; // last mix
+};
+
+#endif
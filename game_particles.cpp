@@ -0,0 +1,429 @@
+// particles, see game_particles.h
+// an update moves every particle, ages it, dims it, and writes the survivors back packed to the front of the arrays.
+// write never passes read, so it all happens in place in one pass. there is no branch per particle: a survivor is
+// whatever the alive mask says, a table turns the mask into the order lanes are stored in.
+// velocity and position are a multiply then an add, never fused, so every kernel leaves exactly the same pool
+
+typedef void UpdateParticlesFunc(ParticlePool* pool, f32 dt);
+
+void UpdateParticles_Scalar(ParticlePool* pool, f32 dt);
+void UpdateParticles_SSE2(ParticlePool* pool, f32 dt);
+TARGET_AVX2 void UpdateParticles_AVX2(ParticlePool* pool, f32 dt);
+
+// sse2 is always there, so this is valid before InitParticleKernels runs
+UpdateParticlesFunc* UpdateParticles = UpdateParticles_SSE2;
+
+// for every 4 bit alive mask: the set lanes lowest first, one octal digit each from the right, and how many there are.
+// the high table is for lanes 4..7 of an 8 bit mask
+const u32 PARTICLE_LANES_LOW[16] = { 0, 0, 01, 010, 02, 020, 021, 0210, 03, 030, 031, 0310, 032, 0320, 0321, 03210 };
+const u32 PARTICLE_LANES_HIGH[16] = { 0, 04, 05, 054, 06, 064, 065, 0654, 07, 074, 075, 0754, 076, 0764, 0765, 07654 };
+const u32 PARTICLE_LANE_COUNT[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+void
+InitParticleKernels() {
+    UpdateParticles = QueryCpuFeatures().avx2 ? UpdateParticles_AVX2 : UpdateParticles_SSE2;
+}
+
+void
+InitializeParticlePool(ParticlePool* pool, MemoryArena* arena, u32 capacity, f32 minX, f32 minY, f32 maxX, f32 maxY) {
+    // splats hold pixel coordinates in 16 bits
+    assert(minX >= 0 && minY >= 0 && maxX > minX && maxY > minY && maxX < 32767 && maxY < 32767);
+
+    // the wide kernels run past count up to the next multiple of 8, the padding is zeroed so they only ever see numbers
+    u32 padded = (capacity + 7) & ~7;
+
+    pool->capacity = capacity;
+    pool->count = 0;
+
+    pool->x = PushArrayAligned(arena, padded, f32, 32);
+    pool->y = PushArrayAligned(arena, padded, f32, 32);
+    pool->velocityX = PushArrayAligned(arena, padded, f32, 32);
+    pool->velocityY = PushArrayAligned(arena, padded, f32, 32);
+    pool->life = PushArrayAligned(arena, padded, f32, 32);
+    pool->color = PushArrayAligned(arena, padded, u32, 32);
+    pool->fade = PushArrayAligned(arena, padded, u32, 32);
+
+    memset(pool->x, 0, padded * sizeof(f32));
+    memset(pool->y, 0, padded * sizeof(f32));
+    memset(pool->velocityX, 0, padded * sizeof(f32));
+    memset(pool->velocityY, 0, padded * sizeof(f32));
+    memset(pool->life, 0, padded * sizeof(f32));
+    memset(pool->color, 0, padded * sizeof(u32));
+    memset(pool->fade, 0, padded * sizeof(u32));
+
+    pool->accelerationX = 0;
+    pool->accelerationY = 0;
+
+    pool->minX = minX;
+    pool->minY = minY;
+    pool->maxX = maxX;
+    pool->maxY = maxY;
+
+    // bins start at pixel 0, not at min, so a splat's bin is just its pixel over the bin size
+    pool->binsX = ((int32)maxX + PARTICLE_BIN_SIZE) / PARTICLE_BIN_SIZE;
+    pool->binsY = ((int32)maxY + PARTICLE_BIN_SIZE) / PARTICLE_BIN_SIZE;
+    u32 binCount = pool->binsX * pool->binsY;
+    pool->binStart = PushArray(arena, binCount + 1, u32);
+    memset(pool->binStart, 0, (binCount + 1) * sizeof(u32));
+    pool->bin = PushArrayAligned(arena, padded, u32, 16);
+    pool->pixel = PushArrayAligned(arena, padded, u32, 16);
+    pool->splats = PushArray(arena, capacity, ParticleSplat);
+
+    pool->version = 1;
+    pool->binnedVersion = 0;
+}
+
+// false when the pool is full, or when x, y is outside the area: the particle would be dead already, and binning
+// only has bins for the area
+bool
+SpawnParticle(ParticlePool* pool, f32 x, f32 y, f32 velocityX, f32 velocityY, f32 life, u32 color, u32 fade) {
+    if(pool->count == pool->capacity) {
+        return false;
+    }
+    if(!(x >= pool->minX && x < pool->maxX && y >= pool->minY && y < pool->maxY)) {
+        return false; // nan too
+    }
+
+    u32 i = pool->count++;
+    pool->x[i] = x;
+    pool->y[i] = y;
+    pool->velocityX[i] = velocityX;
+    pool->velocityY[i] = velocityY;
+    pool->life[i] = life;
+    pool->color[i] = color;
+    pool->fade[i] = fade;
+    pool->version++;
+    return true;
+}
+
+// 0..1
+inline f32
+EmitterRandom(ParticleEmitter* emitter) {
+    emitter->seed = emitter->seed * 1664525 + 1013904223;
+    return (emitter->seed >> 8) * (1.0f / (1 << 24));
+}
+
+// the emitter's share of particles for an update of dt seconds. their color fades to nothing in about life seconds
+// of updates this long. an emitter outside the pool's area spawns nothing
+void
+EmitParticles(ParticlePool* pool, ParticleEmitter* emitter, f32 dt) {
+    emitter->pending += emitter->rate * dt;
+    u32 count = (u32)emitter->pending;
+    emitter->pending -= count;
+
+    u32 steps = emitter->life > dt ? (u32)(emitter->life / dt) : 1;
+    u32 fade = 0;
+    for(u32 shift = 0; shift < 32; shift += 8) {
+        u32 channel = (emitter->color >> shift) & 0xFF;
+        fade |= ((channel + steps - 1) / steps) << shift;
+    }
+
+    for(u32 i = 0; i < count; i++) {
+        // uniform over the disc: points of the square outside it are tried again
+        f32 dx, dy;
+        do {
+            dx = EmitterRandom(emitter) * 2 - 1;
+            dy = EmitterRandom(emitter) * 2 - 1;
+        } while(dx * dx + dy * dy > 1);
+
+        if(!SpawnParticle(pool, emitter->x, emitter->y, dx * emitter->speed, dy * emitter->speed, emitter->life,
+                          emitter->color, fade)) {
+            emitter->pending = 0;
+            break;
+        }
+    }
+}
+
+// one particle of the scalar kernel, returns whether it lives on. writes it to write either way
+inline bool
+UpdateParticle(ParticlePool* pool, u32 read, u32 write, f32 dt, f32 stepX, f32 stepY) {
+    f32 velocityX = pool->velocityX[read] + stepX;
+    f32 velocityY = pool->velocityY[read] + stepY;
+    f32 x = pool->x[read] + velocityX * dt;
+    f32 y = pool->y[read] + velocityY * dt;
+    f32 life = pool->life[read] - dt;
+
+    u32 color = pool->color[read];
+    u32 fade = pool->fade[read];
+    u32 faded = 0;
+    for(u32 shift = 0; shift < 32; shift += 8) {
+        u32 channel = (color >> shift) & 0xFF;
+        u32 amount = (fade >> shift) & 0xFF;
+        faded |= (channel > amount ? channel - amount : 0) << shift;
+    }
+
+    pool->x[write] = x;
+    pool->y[write] = y;
+    pool->velocityX[write] = velocityX;
+    pool->velocityY[write] = velocityY;
+    pool->life[write] = life;
+    pool->color[write] = faded;
+    pool->fade[write] = fade;
+
+    return life > 0 && x >= pool->minX && x < pool->maxX && y >= pool->minY && y < pool->maxY;
+}
+
+void
+UpdateParticles_Scalar(ParticlePool* pool, f32 dt) {
+    f32 stepX = pool->accelerationX * dt;
+    f32 stepY = pool->accelerationY * dt;
+
+    u32 write = 0;
+    for(u32 read = 0; read < pool->count; read++) {
+        write += UpdateParticle(pool, read, write, dt, stepX, stepY);
+    }
+
+    pool->count = write;
+    pool->version++;
+}
+
+// the set lanes of mask, packed to the front of 4 at dest. the lanes after them get whatever, dest has room
+inline void
+CompactLanes_SSE2(f32* dest, __m128 values, u32 mask) {
+    alignas(16) f32 lanes[4];
+    _mm_store_ps(lanes, values);
+
+    u32 order = PARTICLE_LANES_LOW[mask];
+    dest[0] = lanes[order & 7];
+    dest[1] = lanes[(order >> 3) & 7];
+    dest[2] = lanes[(order >> 6) & 7];
+    dest[3] = lanes[(order >> 9) & 7];
+}
+
+// 4 particles at a time. blocks where all 4 live, nearly all of them, are stored as they are
+void
+UpdateParticles_SSE2(ParticlePool* pool, f32 dt) {
+    __m128 step = _mm_set1_ps(dt);
+    __m128 stepX = _mm_set1_ps(pool->accelerationX * dt);
+    __m128 stepY = _mm_set1_ps(pool->accelerationY * dt);
+    __m128 minX = _mm_set1_ps(pool->minX);
+    __m128 minY = _mm_set1_ps(pool->minY);
+    __m128 maxX = _mm_set1_ps(pool->maxX);
+    __m128 maxY = _mm_set1_ps(pool->maxY);
+    __m128 zero = _mm_setzero_ps();
+
+    u32 count = pool->count;
+    u32 write = 0;
+    for(u32 read = 0; read < count; read += 4) {
+        __m128 velocityX = _mm_add_ps(_mm_load_ps(pool->velocityX + read), stepX);
+        __m128 velocityY = _mm_add_ps(_mm_load_ps(pool->velocityY + read), stepY);
+        __m128 x = _mm_add_ps(_mm_load_ps(pool->x + read), _mm_mul_ps(velocityX, step));
+        __m128 y = _mm_add_ps(_mm_load_ps(pool->y + read), _mm_mul_ps(velocityY, step));
+        __m128 life = _mm_sub_ps(_mm_load_ps(pool->life + read), step);
+        __m128i fade = _mm_load_si128((__m128i*)(pool->fade + read));
+        __m128i color = _mm_subs_epu8(_mm_load_si128((__m128i*)(pool->color + read)), fade);
+
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(x, minX), _mm_cmplt_ps(x, maxX)),
+                                   _mm_and_ps(_mm_cmpge_ps(y, minY), _mm_cmplt_ps(y, maxY)));
+        u32 alive = _mm_movemask_ps(_mm_and_ps(_mm_cmpgt_ps(life, zero), inside));
+        alive &= count - read >= 4 ? 0xF : (1 << (count - read)) - 1; // past count is padding
+
+        if(alive == 0xF) {
+            _mm_storeu_ps(pool->x + write, x);
+            _mm_storeu_ps(pool->y + write, y);
+            _mm_storeu_ps(pool->velocityX + write, velocityX);
+            _mm_storeu_ps(pool->velocityY + write, velocityY);
+            _mm_storeu_ps(pool->life + write, life);
+            _mm_storeu_si128((__m128i*)(pool->color + write), color);
+            _mm_storeu_si128((__m128i*)(pool->fade + write), fade);
+        } else {
+            CompactLanes_SSE2(pool->x + write, x, alive);
+            CompactLanes_SSE2(pool->y + write, y, alive);
+            CompactLanes_SSE2(pool->velocityX + write, velocityX, alive);
+            CompactLanes_SSE2(pool->velocityY + write, velocityY, alive);
+            CompactLanes_SSE2(pool->life + write, life, alive);
+            CompactLanes_SSE2((f32*)(pool->color + write), _mm_castsi128_ps(color), alive);
+            CompactLanes_SSE2((f32*)(pool->fade + write), _mm_castsi128_ps(fade), alive);
+        }
+        write += PARTICLE_LANE_COUNT[alive];
+    }
+
+    pool->count = write;
+    pool->version++;
+}
+
+// 8 particles at a time. the survivors are moved to the front of the register by one permute per array,
+// so there is no branch at all
+TARGET_AVX2 void
+UpdateParticles_AVX2(ParticlePool* pool, f32 dt) {
+    __m256 step = _mm256_set1_ps(dt);
+    __m256 stepX = _mm256_set1_ps(pool->accelerationX * dt);
+    __m256 stepY = _mm256_set1_ps(pool->accelerationY * dt);
+    __m256 minX = _mm256_set1_ps(pool->minX);
+    __m256 minY = _mm256_set1_ps(pool->minY);
+    __m256 maxX = _mm256_set1_ps(pool->maxX);
+    __m256 maxY = _mm256_set1_ps(pool->maxY);
+    __m256 zero = _mm256_setzero_ps();
+    __m256i laneShift = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    __m256i laneBits = _mm256_set1_epi32(7);
+
+    u32 count = pool->count;
+    u32 write = 0;
+    for(u32 read = 0; read < count; read += 8) {
+        __m256 velocityX = _mm256_add_ps(_mm256_load_ps(pool->velocityX + read), stepX);
+        __m256 velocityY = _mm256_add_ps(_mm256_load_ps(pool->velocityY + read), stepY);
+        __m256 x = _mm256_add_ps(_mm256_load_ps(pool->x + read), _mm256_mul_ps(velocityX, step));
+        __m256 y = _mm256_add_ps(_mm256_load_ps(pool->y + read), _mm256_mul_ps(velocityY, step));
+        __m256 life = _mm256_sub_ps(_mm256_load_ps(pool->life + read), step);
+        __m256i fade = _mm256_load_si256((__m256i*)(pool->fade + read));
+        __m256i color = _mm256_subs_epu8(_mm256_load_si256((__m256i*)(pool->color + read)), fade);
+
+        __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(x, minX, _CMP_GE_OQ), _mm256_cmp_ps(x, maxX, _CMP_LT_OQ)),
+                                      _mm256_and_ps(_mm256_cmp_ps(y, minY, _CMP_GE_OQ), _mm256_cmp_ps(y, maxY, _CMP_LT_OQ)));
+        u32 alive = _mm256_movemask_ps(_mm256_and_ps(_mm256_cmp_ps(life, zero, _CMP_GT_OQ), inside));
+        alive &= count - read >= 8 ? 0xFF : (1 << (count - read)) - 1; // past count is padding
+
+        u32 lowCount = PARTICLE_LANE_COUNT[alive & 0xF];
+        u32 lanes = PARTICLE_LANES_LOW[alive & 0xF] | (PARTICLE_LANES_HIGH[alive >> 4] << (3 * lowCount));
+        __m256i order = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(lanes), laneShift), laneBits);
+
+        _mm256_storeu_ps(pool->x + write, _mm256_permutevar8x32_ps(x, order));
+        _mm256_storeu_ps(pool->y + write, _mm256_permutevar8x32_ps(y, order));
+        _mm256_storeu_ps(pool->velocityX + write, _mm256_permutevar8x32_ps(velocityX, order));
+        _mm256_storeu_ps(pool->velocityY + write, _mm256_permutevar8x32_ps(velocityY, order));
+        _mm256_storeu_ps(pool->life + write, _mm256_permutevar8x32_ps(life, order));
+        _mm256_storeu_si256((__m256i*)(pool->color + write), _mm256_permutevar8x32_epi32(color, order));
+        _mm256_storeu_si256((__m256i*)(pool->fade + write), _mm256_permutevar8x32_epi32(fade, order));
+
+        write += lowCount + PARTICLE_LANE_COUNT[alive >> 4];
+    }
+
+    pool->count = write;
+    pool->version++;
+}
+
+// sorts the particles into bins as splats, the counting sort of the spatial grid. does nothing when the pool
+// hasn't changed since the last time
+void
+BinParticles(ParticlePool* pool) {
+    PROFILE_ZONE("BinParticles");
+
+    if(pool->binnedVersion == pool->version) {
+        return;
+    }
+    pool->binnedVersion = pool->version;
+
+    u32 binCount = pool->binsX * pool->binsY;
+    u32* binStart = pool->binStart;
+    memset(binStart, 0, (binCount + 1) * sizeof(u32));
+
+    // 4 at a time: truncated to pixels, packed as x | y << 16 like a splat, then the bin from the pixel over the
+    // bin size. positions are inside the area, never negative, so truncating is the floor and 16 bits hold them.
+    // the bounds come from 16 bit min and max on the packed pixels, x and y in their own halves
+    __m128i binStride = _mm_set1_epi32((pool->binsX << 16) | 1);
+    __m128i lowest = _mm_set1_epi16(0x7FFF);
+    __m128i highest = _mm_setzero_si128();
+
+    u32 count = pool->count;
+    u32 i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128i x = _mm_cvttps_epi32(_mm_load_ps(pool->x + i));
+        __m128i y = _mm_cvttps_epi32(_mm_load_ps(pool->y + i));
+        __m128i pixel = _mm_or_si128(x, _mm_slli_epi32(y, 16));
+        __m128i bin = _mm_madd_epi16(_mm_srli_epi16(pixel, 4), binStride);
+
+        lowest = _mm_min_epi16(lowest, pixel);
+        highest = _mm_max_epi16(highest, pixel);
+
+        _mm_store_si128((__m128i*)(pool->pixel + i), pixel);
+        _mm_store_si128((__m128i*)(pool->bin + i), bin);
+    }
+    for(; i < count; i++) {
+        u32 x = (u32)(int32)pool->x[i];
+        u32 y = (u32)(int32)pool->y[i];
+        __m128i pixel = _mm_set1_epi32(x | (y << 16));
+        lowest = _mm_min_epi16(lowest, pixel);
+        highest = _mm_max_epi16(highest, pixel);
+
+        pool->pixel[i] = x | (y << 16);
+        pool->bin[i] = (y / PARTICLE_BIN_SIZE) * pool->binsX + x / PARTICLE_BIN_SIZE;
+    }
+
+    for(i = 0; i < count; i++) {
+        binStart[pool->bin[i]]++;
+    }
+
+    // the 4 lanes folded into the first
+    lowest = _mm_min_epi16(lowest, _mm_shuffle_epi32(lowest, _MM_SHUFFLE(1, 0, 3, 2)));
+    lowest = _mm_min_epi16(lowest, _mm_shuffle_epi32(lowest, _MM_SHUFFLE(2, 3, 0, 1)));
+    highest = _mm_max_epi16(highest, _mm_shuffle_epi32(highest, _MM_SHUFFLE(1, 0, 3, 2)));
+    highest = _mm_max_epi16(highest, _mm_shuffle_epi32(highest, _MM_SHUFFLE(2, 3, 0, 1)));
+    u32 minPixel = (u32)_mm_cvtsi128_si32(lowest);
+    u32 maxPixel = (u32)_mm_cvtsi128_si32(highest);
+
+    pool->splatMinX = (int32)(minPixel & 0xFFFF);
+    pool->splatMinY = (int32)(minPixel >> 16);
+    pool->splatMaxX = (int32)(maxPixel & 0xFFFF) + PARTICLE_SPLAT_SIZE;
+    pool->splatMaxY = (int32)(maxPixel >> 16) + PARTICLE_SPLAT_SIZE;
+
+    u32 end = 0;
+    for(u32 b = 0; b < binCount; b++) {
+        end += binStart[b];
+        binStart[b] = end;
+    }
+    binStart[binCount] = pool->count;
+
+    for(i = count; i-- > 0; ) {
+        ParticleSplat* splat = pool->splats + --binStart[pool->bin[i]];
+        splat->x = (int16)(pool->pixel[i] & 0xFFFF);
+        splat->y = (int16)(pool->pixel[i] >> 16);
+        splat->color = pool->color[i];
+    }
+}
+
+// pixels the binned particles touch
+Rect32
+ParticleBounds(ParticlePool* pool) {
+    Rect32 bounds = { pool->splatMinX, pool->splatMinY, pool->splatMaxX, pool->splatMaxY };
+    return bounds;
+}
+
+// adds every binned particle to the pixels it covers inside clip, saturating each channel.
+// saturating adds of values that are never negative give the same pixel in any order, so tiles can't disagree
+void
+DrawParticles(GraphicsBuffer* buffer, Rect32 clip, ParticlePool* pool) {
+    clip = Intersect(clip, BufferRect(buffer));
+    if(IsEmpty(clip) || pool->count == 0) {
+        return;
+    }
+
+    // a splat reaches PARTICLE_SPLAT_SIZE - 1 pixels past its bin
+    int32 reachX = clip.minX - (PARTICLE_SPLAT_SIZE - 1);
+    int32 reachY = clip.minY - (PARTICLE_SPLAT_SIZE - 1);
+    int32 firstBinX = (reachX > 0 ? reachX : 0) / PARTICLE_BIN_SIZE;
+    int32 firstBinY = (reachY > 0 ? reachY : 0) / PARTICLE_BIN_SIZE;
+    int32 lastBinX = (clip.maxX - 1) / PARTICLE_BIN_SIZE;
+    int32 lastBinY = (clip.maxY - 1) / PARTICLE_BIN_SIZE;
+    lastBinX = lastBinX < pool->binsX - 1 ? lastBinX : pool->binsX - 1;
+    lastBinY = lastBinY < pool->binsY - 1 ? lastBinY : pool->binsY - 1;
+
+    for(int32 binY = firstBinY; binY <= lastBinY; binY++) {
+        u32 row = binY * pool->binsX;
+        u32 end = pool->binStart[row + lastBinX + 1];
+
+        for(u32 i = pool->binStart[row + firstBinX]; i < end; i++) {
+            ParticleSplat splat = pool->splats[i];
+            __m128i color = _mm_set1_epi32(splat.color);
+
+            // whole splats are one 64 bit add per row, PARTICLE_SPLAT_SIZE is 2 pixels
+            if(splat.x >= clip.minX && splat.x + PARTICLE_SPLAT_SIZE <= clip.maxX &&
+               splat.y >= clip.minY && splat.y + PARTICLE_SPLAT_SIZE <= clip.maxY) {
+                u8* at = buffer->data + (u64)splat.y * buffer->bytesPerRow + splat.x * buffer->bytesPerPixel;
+                for(int32 y = 0; y < PARTICLE_SPLAT_SIZE; y++, at += buffer->bytesPerRow) {
+                    _mm_storel_epi64((__m128i*)at, _mm_adds_epu8(_mm_loadl_epi64((__m128i*)at), color));
+                }
+                continue;
+            }
+
+            // cut by the clip, pixel by pixel
+            for(int32 y = splat.y; y < splat.y + PARTICLE_SPLAT_SIZE; y++) {
+                for(int32 x = splat.x; x < splat.x + PARTICLE_SPLAT_SIZE; x++) {
+                    if(x >= clip.minX && x < clip.maxX && y >= clip.minY && y < clip.maxY) {
+                        u32* pixel = (u32*)(buffer->data + (u64)y * buffer->bytesPerRow) + x;
+                        *pixel = (u32)_mm_cvtsi128_si32(_mm_adds_epu8(_mm_cvtsi32_si128(*pixel), color));
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef GAME_PARTICLES_H
+#define GAME_PARTICLES_H
+
+// particles: short lived points drawn by adding their color to the pixels under them, saturating at white.
+// a pool is one array per property like the entity store, dense 0..count. dead particles are squeezed out
+// during the update that kills them, so nothing ever looks at a dead one
+
+// a particle covers this many pixels each way, from the pixel its position is in. DrawParticles adds a row of them
+// as one 64 bit value, so this is 2
+const int32 PARTICLE_SPLAT_SIZE = 2;
+
+// the renderer sorts particles into square bins of this many pixels, so a tile only walks the particles over it
+const int32 PARTICLE_BIN_SIZE = 16;
+
+// a particle ready to draw, in bin order
+struct ParticleSplat {
+    int16 x, y;
+    u32 color;
+};
+
+struct ParticlePool {
+    u32 capacity;
+    u32 count;
+
+    // dense, 0..count. padded to a multiple of 8 and 32 byte aligned, so kernels never need a masked load
+    f32* x;
+    f32* y;
+    f32* velocityX; // pixels per second
+    f32* velocityY;
+    f32* life;      // seconds left
+    u32* color;     // packed bgra, added to the pixels
+    u32* fade;      // taken off color every update, per channel, so particles dim out over their life
+
+    f32 accelerationX, accelerationY; // the same for every particle, gravity
+
+    // particles die when they leave this area and are never spawned outside it. in pixels, min at 0 or more
+    f32 minX, minY;
+    f32 maxX, maxY;
+
+    // splats for the renderer, rebuilt by BinParticles. bins cover the area in rows
+    int32 binsX, binsY;
+    u32* binStart; // binsX * binsY + 1
+    u32* bin;      // capacity, scratch for the sort
+    u32* pixel;    // capacity, x | y << 16, scratch for the sort
+    ParticleSplat* splats;
+    int32 splatMinX, splatMinY; // pixels the splats touch, max exclusive
+    int32 splatMaxX, splatMaxY;
+
+    u32 version;       // bumped by every change, the renderer redraws when it moves on
+    u32 binnedVersion; // what the splats were built from
+};
+
+// spawns rate particles a second at x, y, flying off in random directions
+struct ParticleEmitter {
+    f32 x, y;
+    f32 rate;
+    f32 speed; // most pixels per second, directions and speeds are uniform over a disc
+    f32 life;  // seconds
+    u32 color;
+
+    f32 pending; // particles owed, fractions carry over to the next update
+    u32 seed;
+};
+
+#endif
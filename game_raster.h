@@ -0,0 +1,42 @@
+#ifndef GAME_RASTER_H
+#define GAME_RASTER_H
+
+// triangles and convex polygons, filled by edge functions in 28.4 fixed point.
+// vertices are in pixels, y up like the graphics buffer. a pixel is drawn when its centre is inside,
+// top left fill rule for centres exactly on an edge, so triangles that share an edge never both draw a pixel on it
+
+const int32 RASTER_SUBPIXEL_BITS = 4;
+const int32 RASTER_SUBPIXELS = 1 << RASTER_SUBPIXEL_BITS;
+
+// vertex coordinates are clamped to this many pixels either way, keeps 28.4 in 32 bits
+const f32 RASTER_MAX_COORD = (f32)(1 << 24);
+
+// past this many pixels wide or tall, edge values can leave 32 bits and the triangle takes the 64 bit scalar path
+const int32 RASTER_MAX_EXTENT = 1024;
+
+// narrower than this, an avx2 triangle is walked with sse2 instead, see RasterizeTriangle
+const int32 RASTER_AVX2_MIN_WIDTH = 48;
+
+struct RasterVertex {
+    f32 x, y;
+    u32 color; // packed bgra, only read when shading per vertex
+};
+
+// a triangle ready to walk. edge i at pixel x, y is stepX[i] * x + stepY[i] * y + offset[i],
+// the centre is inside when all three are >= 0. the fill rule's bias is in the offset
+struct RasterTriangle {
+    Rect32 bounds; // pixels whose centres can be inside, not clipped
+    bool wide;     // bigger than RASTER_MAX_EXTENT
+
+    int64 stepX[3], stepY[3], offset[3];
+
+    bool shaded;
+    u32 color; // flat
+
+    // per vertex: blue, green, red, alpha in 16.16 at the centre of bounds' min pixel, and their steps per pixel.
+    // wrapping u32 math, a channel is exact modulo 2^32 even where a thin triangle's gradient is huge
+    u32 colorBase[4];
+    u32 colorStepX[4], colorStepY[4];
+};
+
+#endif
@@ -0,0 +1,394 @@
+// render commands
+// the game pushes commands into a buffer in transient memory instead of drawing right away,
+// so the renderer can reorder, cull and merge them before one pass over the pixels
+
+enum RenderCommandType {
+    RenderCommand_Clear,
+    RenderCommand_Rect,
+    RenderCommand_Border,
+    RenderCommand_Bitmap,
+    RenderCommand_Sprites,
+    RenderCommand_Polygon,
+    RenderCommand_Particles,
+    RenderCommand_Tilemap,
+};
+
+const u32 RENDER_LAYER_COUNT = 256;
+
+// how many later commands are searched for an occluder. keeps culling linear
+const u32 OCCLUSION_WINDOW = 16;
+
+struct RenderCommand {
+    u8 type;
+    u8 layer;
+    Rect32 bounds; // pixels the command can touch, already clipped to the target
+    Color32 color;
+
+    // bitmaps and tilemaps: bounds is clipped, so the unclipped bottom left corner is kept here
+    LoadedBitmap* bitmap;
+    int32 xPos, yPos;
+
+    // sprites: bounds is the union of the draws
+    SpriteAtlas* atlas;
+    SpriteDraw* draws;
+    u32 drawCount;
+
+    // polygons: convex, filled with color unless shaded per vertex
+    RasterVertex* vertices;
+    u32 vertexCount;
+    bool shaded;
+
+    // particles: bounds is around the splats
+    ParticlePool* particles;
+
+    // tilemaps: the chunks under bounds are cached and current by the time the command executes
+    Tilemap* tilemap;
+};
+
+struct RenderGroup {
+    Rect32 target;
+
+    u32 maxCommandCount;
+    u32 commandCount;
+    RenderCommand* commands;
+
+    // sorting and tile binning take their scratch from here
+    MemoryArena* arena;
+
+    RenderStats stats;
+};
+
+bool
+IsEmpty(Rect32 rect) {
+    return rect.minX >= rect.maxX || rect.minY >= rect.maxY;
+}
+
+bool
+Contains(Rect32 outer, Rect32 inner) {
+    return outer.minX <= inner.minX && outer.minY <= inner.minY &&
+           outer.maxX >= inner.maxX && outer.maxY >= inner.maxY;
+}
+
+RenderGroup*
+BeginRenderGroup(MemoryArena* arena, GraphicsBuffer* buffer, u32 maxCommandCount) {
+    RenderGroup* group = PushStruct(arena, RenderGroup);
+
+    group->target = BufferRect(buffer);
+    group->maxCommandCount = maxCommandCount;
+    group->commandCount = 0;
+    group->commands = PushArray(arena, maxCommandCount, RenderCommand);
+    group->arena = arena;
+
+    group->stats = {};
+
+    return group;
+}
+
+// null when the command is entirely off screen
+RenderCommand*
+PushCommand(RenderGroup* group, RenderCommandType type, u8 layer, Rect32 bounds, Color32 color) {
+    group->stats.issued++;
+
+    bounds = Intersect(bounds, group->target);
+    if(IsEmpty(bounds)) {
+        group->stats.culled++;
+        return 0;
+    }
+
+    assert(group->commandCount < group->maxCommandCount);
+
+    RenderCommand* command = group->commands + group->commandCount++;
+    *command = {};
+    command->type = (u8)type;
+    command->layer = layer;
+    command->bounds = bounds;
+    command->color = color;
+    return command;
+}
+
+void
+PushClear(RenderGroup* group, u8 layer, Color32 color) {
+    PushCommand(group, RenderCommand_Clear, layer, group->target, color);
+}
+
+void
+PushRect(RenderGroup* group, u8 layer, int32 xPos, int32 yPos, int32 xSize, int32 ySize, Color32 color) {
+    Rect32 bounds = { xPos, yPos, xPos + xSize, yPos + ySize };
+    PushCommand(group, RenderCommand_Rect, layer, bounds, color);
+}
+
+void
+PushBorder(RenderGroup* group, u8 layer, Color32 color) {
+    PushCommand(group, RenderCommand_Border, layer, group->target, color);
+}
+
+// the bitmap has to stay where it is until the group has executed
+void
+PushBitmap(RenderGroup* group, u8 layer, LoadedBitmap* bitmap, int32 xPos, int32 yPos) {
+    Rect32 bounds = { xPos, yPos, xPos + bitmap->width, yPos + bitmap->height };
+    Color32 unused = {};
+    RenderCommand* command = PushCommand(group, RenderCommand_Bitmap, layer, bounds, unused);
+    if(command) {
+        command->bitmap = bitmap;
+        command->xPos = xPos;
+        command->yPos = yPos;
+    }
+}
+
+// many sprites from one atlas as one command. atlas and draws have to stay where they are until the group has executed
+void
+PushSprites(RenderGroup* group, u8 layer, SpriteAtlas* atlas, SpriteDraw* draws, u32 drawCount) {
+    if(drawCount == 0) {
+        return;
+    }
+
+    Rect32 bounds = { INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN };
+    for(u32 i = 0; i < drawCount; i++) {
+        AtlasSprite* sprite = atlas->sprites + draws[i].sprite;
+        bounds.minX = draws[i].xPos < bounds.minX ? draws[i].xPos : bounds.minX;
+        bounds.minY = draws[i].yPos < bounds.minY ? draws[i].yPos : bounds.minY;
+        bounds.maxX = draws[i].xPos + sprite->width > bounds.maxX ? draws[i].xPos + sprite->width : bounds.maxX;
+        bounds.maxY = draws[i].yPos + sprite->height > bounds.maxY ? draws[i].yPos + sprite->height : bounds.maxY;
+    }
+
+    Color32 unused = {};
+    RenderCommand* command = PushCommand(group, RenderCommand_Sprites, layer, bounds, unused);
+    if(command) {
+        command->atlas = atlas;
+        command->draws = draws;
+        command->drawCount = drawCount;
+    }
+}
+
+// a convex polygon, triangles and rotated quads included. the vertices have to stay where they are until the group has executed
+void
+PushPolygon(RenderGroup* group, u8 layer, RasterVertex* vertices, u32 vertexCount, Color32 color, bool shaded) {
+    if(vertexCount < 3) {
+        return;
+    }
+
+    RenderCommand* command = PushCommand(group, RenderCommand_Polygon, layer, RasterPolygonBounds(vertices, vertexCount), color);
+    if(command) {
+        command->vertices = vertices;
+        command->vertexCount = vertexCount;
+        command->shaded = shaded;
+    }
+}
+
+// every live particle of the pool, added to the pixels. the pool can't change until the group has executed
+void
+PushParticles(RenderGroup* group, u8 layer, ParticlePool* pool) {
+    if(pool->count == 0) {
+        return;
+    }
+
+    BinParticles(pool);
+
+    Color32 unused = {};
+    RenderCommand* command = PushCommand(group, RenderCommand_Particles, layer, ParticleBounds(pool), unused);
+    if(command) {
+        command->particles = pool;
+    }
+}
+
+// a tilemap with its bottom left corner at xPos, yPos, negative to scroll. the chunks on screen are rasterized here
+// if they have to be, drawing only copies them. the map can't change until the group has executed
+void
+PushTilemap(RenderGroup* group, u8 layer, Tilemap* map, int32 xPos, int32 yPos) {
+    Color32 unused = {};
+    RenderCommand* command = PushCommand(group, RenderCommand_Tilemap, layer, TilemapBounds(map, xPos, yPos), unused);
+    if(command) {
+        PrepareTilemap(map, command->bounds, xPos, yPos);
+        command->tilemap = map;
+        command->xPos = xPos;
+        command->yPos = yPos;
+    }
+}
+
+// stable counting sort on layer. submission order is kept inside a layer, that is the painter's order.
+// commands are big, so only their destinations go in scratch and the commands are swapped into place
+void
+SortRenderCommands(RenderGroup* group) {
+    TemporaryMemory temp = BeginTemporaryMemory(group->arena);
+
+    u32 layerStart[RENDER_LAYER_COUNT] = {};
+    for(u32 i = 0; i < group->commandCount; i++) {
+        layerStart[group->commands[i].layer]++;
+    }
+
+    u32 total = 0;
+    for(u32 layer = 0; layer < RENDER_LAYER_COUNT; layer++) {
+        u32 count = layerStart[layer];
+        layerStart[layer] = total;
+        total += count;
+    }
+
+    u32* destination = PushArray(group->arena, group->commandCount, u32);
+    for(u32 i = 0; i < group->commandCount; i++) {
+        destination[i] = layerStart[group->commands[i].layer]++;
+    }
+
+    // every swap puts one command where it belongs for good, so this is at most commandCount swaps
+    for(u32 i = 0; i < group->commandCount; i++) {
+        while(destination[i] != i) {
+            u32 to = destination[i];
+
+            RenderCommand swap = group->commands[to];
+            group->commands[to] = group->commands[i];
+            group->commands[i] = swap;
+
+            destination[i] = destination[to];
+            destination[to] = to;
+        }
+    }
+
+    EndTemporaryMemory(temp);
+}
+
+bool
+IsOpaque(RenderCommand* command) {
+    // a border only writes its edges and a polygon only part of its bounds, they hide nothing for sure.
+    // particles add to what is under them
+    // a bitmap with any alpha shows what is under it
+    if(command->type == RenderCommand_Bitmap) {
+        return command->bitmap->opaque;
+    }
+    return command->type != RenderCommand_Border && command->type != RenderCommand_Sprites &&
+           command->type != RenderCommand_Polygon && command->type != RenderCommand_Particles;
+}
+
+void
+CullRenderCommands(RenderGroup* group) {
+    RenderCommand* commands = group->commands;
+    u32 count = group->commandCount;
+
+    // nothing under the last command that covers the whole target can be seen
+    u32 first = 0;
+    for(u32 i = count; i > 0; i--) {
+        RenderCommand* command = commands + (i - 1);
+        if(IsOpaque(command) && Contains(command->bounds, group->target)) {
+            first = i - 1;
+            break;
+        }
+    }
+
+    group->stats.culled += first;
+
+    // then anything that a single command shortly after it covers completely
+    u32 writeIndex = 0;
+    for(u32 i = first; i < count; i++) {
+        bool covered = false;
+
+        u32 windowEnd = (i + 1 + OCCLUSION_WINDOW) < count ? (i + 1 + OCCLUSION_WINDOW) : count;
+        for(u32 j = i + 1; j < windowEnd; j++) {
+            if(IsOpaque(commands + j) && Contains(commands[j].bounds, commands[i].bounds)) {
+                covered = true;
+                break;
+            }
+        }
+
+        if(covered) {
+            group->stats.culled++;
+        } else {
+            commands[writeIndex++] = commands[i];
+        }
+    }
+
+    group->commandCount = writeIndex;
+}
+
+bool
+CanMerge(RenderCommand* a, RenderCommand* b) {
+    if(a->type != RenderCommand_Rect || b->type != RenderCommand_Rect ||
+       a->layer != b->layer || a->color.packed != b->color.packed) {
+        return false;
+    }
+
+    // the union has to be exactly the two rects, so they must share a whole edge
+    bool sameRows = a->bounds.minY == b->bounds.minY && a->bounds.maxY == b->bounds.maxY;
+    bool sameColumns = a->bounds.minX == b->bounds.minX && a->bounds.maxX == b->bounds.maxX;
+
+    bool touchX = a->bounds.maxX == b->bounds.minX || b->bounds.maxX == a->bounds.minX;
+    bool touchY = a->bounds.maxY == b->bounds.minY || b->bounds.maxY == a->bounds.minY;
+
+    return (sameRows && touchX) || (sameColumns && touchY);
+}
+
+// only neighbours in draw order are merged, nothing can be drawn between them
+void
+MergeRenderCommands(RenderGroup* group) {
+    RenderCommand* commands = group->commands;
+    u32 writeIndex = 0;
+
+    for(u32 i = 0; i < group->commandCount; i++) {
+        RenderCommand* previous = writeIndex > 0 ? commands + (writeIndex - 1) : 0;
+
+        if(previous && CanMerge(previous, commands + i)) {
+            Rect32 a = previous->bounds;
+            Rect32 b = commands[i].bounds;
+            previous->bounds.minX = a.minX < b.minX ? a.minX : b.minX;
+            previous->bounds.minY = a.minY < b.minY ? a.minY : b.minY;
+            previous->bounds.maxX = a.maxX > b.maxX ? a.maxX : b.maxX;
+            previous->bounds.maxY = a.maxY > b.maxY ? a.maxY : b.maxY;
+
+            group->stats.merged++;
+        } else {
+            commands[writeIndex++] = commands[i];
+        }
+    }
+
+    group->commandCount = writeIndex;
+}
+
+void
+EndRenderGroup(RenderGroup* group) {
+    SortRenderCommands(group);
+    CullRenderCommands(group);
+    MergeRenderCommands(group);
+
+    group->stats.executed = group->commandCount;
+}
+
+void
+ExecuteRenderCommand(GraphicsBuffer* buffer, Rect32 clip, RenderCommand* command) {
+    switch(command->type) {
+        case RenderCommand_Clear:
+            ClearBufferWithColor(buffer, clip, command->color);
+            break;
+
+        case RenderCommand_Rect:
+        {
+            Rect32 bounds = command->bounds;
+            DrawRectangle(buffer, clip, bounds.minX, bounds.minY, bounds.maxX - bounds.minX, bounds.maxY - bounds.minY, command->color);
+            break;
+        }
+
+        case RenderCommand_Border:
+            DrawBorder(buffer, clip, command->color);
+            break;
+
+        case RenderCommand_Bitmap:
+            DrawBitmap(buffer, clip, command->bitmap, command->xPos, command->yPos);
+            break;
+
+        // the clip is one tile already, that is the band DrawSprites would bin into
+        case RenderCommand_Sprites:
+            for(u32 i = 0; i < command->drawCount; i++) {
+                SpriteDraw* draw = command->draws + i;
+                DrawSprite(buffer, clip, command->atlas, draw->sprite, draw->xPos, draw->yPos);
+            }
+            break;
+
+        case RenderCommand_Polygon:
+            DrawConvexPolygon(buffer, clip, command->vertices, command->vertexCount, command->color, command->shaded);
+            break;
+
+        case RenderCommand_Particles:
+            DrawParticles(buffer, clip, command->particles);
+            break;
+
+        case RenderCommand_Tilemap:
+            DrawTilemap(buffer, clip, command->tilemap, command->xPos, command->yPos);
+            break;
+    }
+}
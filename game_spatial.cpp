@@ -0,0 +1,251 @@
+// spatial grid, see game_spatial.h
+// rebuilding is two passes over the objects and one over the cells, no per cell lists: count objects per cell,
+// turn the counts into ends with a running sum, then place every object by counting its cell's end back down.
+// queries and pairs walk runs of whole cell rows, the positions they read sit next to each other in sortedX/Y
+
+void
+InitializeSpatialGrid(SpatialGrid* grid, MemoryArena* arena, u32 capacity, f32 minX, f32 minY, f32 maxX, f32 maxY, f32 cellSize) {
+    assert(cellSize > 0 && maxX > minX && maxY > minY);
+
+    grid->minX = minX;
+    grid->minY = minY;
+    grid->cellSize = cellSize;
+    grid->inverseCellSize = 1.0f / cellSize;
+    grid->cellsX = (int32)((maxX - minX) * grid->inverseCellSize) + 1;
+    grid->cellsY = (int32)((maxY - minY) * grid->inverseCellSize) + 1;
+
+    grid->capacity = capacity;
+    grid->count = 0;
+    grid->radius = 0;
+
+    u32 cellCount = grid->cellsX * grid->cellsY;
+    grid->cellStart = PushArray(arena, cellCount + 1, u32);
+    memset(grid->cellStart, 0, (cellCount + 1) * sizeof(u32));
+
+    grid->object = PushArray(arena, capacity + 3, u32);
+    grid->sortedX = PushArray(arena, capacity + 3, f32);
+    grid->sortedY = PushArray(arena, capacity + 3, f32);
+    memset(grid->sortedX + capacity, 0, 3 * sizeof(f32));
+    memset(grid->sortedY + capacity, 0, 3 * sizeof(f32));
+    grid->cell = PushArray(arena, capacity, u32);
+}
+
+// column or row of a coordinate, outside the grid clamps to its edge. nan lands in cell 0
+inline int32
+SpatialCoord(f32 value, f32 min, f32 inverseCellSize, int32 cells) {
+    f32 scaled = (value - min) * inverseCellSize;
+    if(!(scaled >= 0)) {
+        return 0;
+    }
+    return scaled < (f32)cells ? (int32)scaled : cells - 1;
+}
+
+// x and y are read count times, every object is a circle of radius. anything over capacity is left out
+void
+BuildSpatialGrid(SpatialGrid* grid, f32* x, f32* y, u32 count, f32 radius) {
+    PROFILE_ZONE("BuildSpatialGrid");
+
+    // a pair closer than two radii can only be in the same or a neighbouring cell
+    assert(radius * 2 <= grid->cellSize);
+
+    count = count < grid->capacity ? count : grid->capacity;
+    grid->count = count;
+    grid->radius = radius;
+
+    u32 cellCount = grid->cellsX * grid->cellsY;
+    u32* cellStart = grid->cellStart;
+    memset(cellStart, 0, (cellCount + 1) * sizeof(u32));
+
+    for(u32 i = 0; i < count; i++) {
+        int32 cellX = SpatialCoord(x[i], grid->minX, grid->inverseCellSize, grid->cellsX);
+        int32 cellY = SpatialCoord(y[i], grid->minY, grid->inverseCellSize, grid->cellsY);
+        u32 cell = cellY * grid->cellsX + cellX;
+        grid->cell[i] = cell;
+        cellStart[cell]++;
+    }
+
+    u32 end = 0;
+    for(u32 c = 0; c < cellCount; c++) {
+        end += cellStart[c];
+        cellStart[c] = end;
+    }
+    cellStart[cellCount] = count;
+
+    // backwards, so every cell keeps its objects in input order and its end ends up as its start
+    for(u32 i = count; i-- > 0; ) {
+        u32 at = --cellStart[grid->cell[i]];
+        grid->object[at] = i;
+        grid->sortedX[at] = x[i];
+        grid->sortedY[at] = y[i];
+    }
+}
+
+// the runs of sorted objects that can touch a rect grown by reach, one per row of cells
+struct SpatialCellRange {
+    int32 minX, minY;
+    int32 maxX, maxY; // inclusive
+};
+
+SpatialCellRange
+SpatialCellsAround(SpatialGrid* grid, f32 minX, f32 minY, f32 maxX, f32 maxY, f32 reach) {
+    SpatialCellRange range;
+    range.minX = SpatialCoord(minX - reach, grid->minX, grid->inverseCellSize, grid->cellsX);
+    range.minY = SpatialCoord(minY - reach, grid->minY, grid->inverseCellSize, grid->cellsY);
+    range.maxX = SpatialCoord(maxX + reach, grid->minX, grid->inverseCellSize, grid->cellsX);
+    range.maxY = SpatialCoord(maxY + reach, grid->minY, grid->inverseCellSize, grid->cellsY);
+    return range;
+}
+
+// objects whose circle overlaps the rect. writes up to maxResults object indices, returns how many there are
+u32
+QuerySpatialGridRect(SpatialGrid* grid, f32 minX, f32 minY, f32 maxX, f32 maxY, u32* results, u32 maxResults) {
+    f32 radiusSquared = grid->radius * grid->radius;
+    SpatialCellRange range = SpatialCellsAround(grid, minX, minY, maxX, maxY, grid->radius);
+
+    u32 found = 0;
+    for(int32 cellY = range.minY; cellY <= range.maxY; cellY++) {
+        u32 row = cellY * grid->cellsX;
+        u32 end = grid->cellStart[row + range.maxX + 1];
+
+        for(u32 i = grid->cellStart[row + range.minX]; i < end; i++) {
+            // distance from the centre to the nearest point of the rect
+            f32 px = grid->sortedX[i], py = grid->sortedY[i];
+            f32 dx = px < minX ? minX - px : (px > maxX ? px - maxX : 0);
+            f32 dy = py < minY ? minY - py : (py > maxY ? py - maxY : 0);
+
+            if(dx * dx + dy * dy <= radiusSquared) {
+                if(found < maxResults) {
+                    results[found] = grid->object[i];
+                }
+                found++;
+            }
+        }
+    }
+
+    return found;
+}
+
+// objects whose circle overlaps the circle at x, y. same results convention as QuerySpatialGridRect
+u32
+QuerySpatialGridRadius(SpatialGrid* grid, f32 x, f32 y, f32 radius, u32* results, u32 maxResults) {
+    f32 reach = radius + grid->radius;
+    f32 reachSquared = reach * reach;
+    SpatialCellRange range = SpatialCellsAround(grid, x, y, x, y, reach);
+
+    u32 found = 0;
+    for(int32 cellY = range.minY; cellY <= range.maxY; cellY++) {
+        u32 row = cellY * grid->cellsX;
+        u32 end = grid->cellStart[row + range.maxX + 1];
+
+        for(u32 i = grid->cellStart[row + range.minX]; i < end; i++) {
+            f32 dx = grid->sortedX[i] - x;
+            f32 dy = grid->sortedY[i] - y;
+
+            if(dx * dx + dy * dy <= reachSquared) {
+                if(found < maxResults) {
+                    results[found] = grid->object[i];
+                }
+                found++;
+            }
+        }
+    }
+
+    return found;
+}
+
+// the lanes set in a 4 bit compare mask, lowest first, and how many there are
+const u8 SPATIAL_HIT_LANES[16][4] = {
+    { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 1, 0, 0, 0 }, { 0, 1, 0, 0 },
+    { 2, 0, 0, 0 }, { 0, 2, 0, 0 }, { 1, 2, 0, 0 }, { 0, 1, 2, 0 },
+    { 3, 0, 0, 0 }, { 0, 3, 0, 0 }, { 1, 3, 0, 0 }, { 0, 1, 3, 0 },
+    { 2, 3, 0, 0 }, { 0, 2, 3, 0 }, { 1, 2, 3, 0 }, { 0, 1, 2, 3 },
+};
+const u8 SPATIAL_HIT_COUNT[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+// every pair of objects whose circles overlap, once each. writes up to maxPairs, returns how many there are.
+// an object only looks forward: later objects in its own cell and the cell to its right, which follow it in the
+// sorted order, and the three neighbouring cells of the next row, also one run. that meets every pair exactly once
+u32
+FindSpatialGridPairs(SpatialGrid* grid, SpatialPair* pairs, u32 maxPairs) {
+    PROFILE_ZONE("FindSpatialGridPairs");
+
+    f32 reach = grid->radius * 2;
+    __m128 reach4 = _mm_set1_ps(reach * reach);
+    u32* cellStart = grid->cellStart;
+    f32* sortedX = grid->sortedX;
+    f32* sortedY = grid->sortedY;
+
+    __m128i unsignedBias = _mm_set1_epi32(0x80000000); // sse2 only compares signed
+    u64 spare[4];
+    u32 found = 0;
+    for(int32 cellY = 0; cellY < grid->cellsY; cellY++) {
+        u32 row = cellY * grid->cellsX;
+
+        for(int32 cellX = 0; cellX < grid->cellsX; cellX++) {
+            u32 cell = row + cellX;
+            u32 first = cellStart[cell];
+            u32 last = cellStart[cell + 1];
+            if(first == last) {
+                continue;
+            }
+
+            u32 sideEnd = cellX + 1 < grid->cellsX ? cellStart[cell + 2] : last;
+
+            u32 nextRowStart = 0, nextRowEnd = 0;
+            if(cellY + 1 < grid->cellsY) {
+                u32 nextRow = row + grid->cellsX;
+                nextRowStart = cellStart[nextRow + (cellX > 0 ? cellX - 1 : 0)];
+                nextRowEnd = cellStart[nextRow + (cellX + 1 < grid->cellsX ? cellX + 2 : cellX + 1)];
+            }
+
+            for(u32 i = first; i < last; i++) {
+                __m128 x = _mm_set1_ps(sortedX[i]);
+                __m128 y = _mm_set1_ps(sortedY[i]);
+                __m128i a = _mm_set1_epi32(grid->object[i]);
+
+                for(u32 run = 0; run < 2; run++) {
+                    u32 j = run == 0 ? i + 1 : nextRowStart;
+                    u32 end = run == 0 ? sideEnd : nextRowEnd;
+
+                    // 4 tests at a time, hits come out of the compare mask. lanes past the run are masked off,
+                    // the arrays are padded so those loads stay inside them
+                    for(; j < end; j += 4) {
+                        __m128 dx = _mm_sub_ps(_mm_loadu_ps(sortedX + j), x);
+                        __m128 dy = _mm_sub_ps(_mm_loadu_ps(sortedY + j), y);
+                        __m128 distanceSquared = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+                        u32 hits = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, reach4));
+                        hits &= end - j >= 4 ? 0xF : (1 << (end - j)) - 1;
+
+                        // all 4 pairs are made, the hits are copied to the front by a table. no branch per hit
+                        __m128i b = _mm_loadu_si128((__m128i*)(grid->object + j));
+                        __m128i aFirst = _mm_cmplt_epi32(_mm_xor_si128(a, unsignedBias), _mm_xor_si128(b, unsignedBias));
+                        __m128i low = _mm_or_si128(_mm_and_si128(aFirst, a), _mm_andnot_si128(aFirst, b));
+                        __m128i high = _mm_or_si128(_mm_and_si128(aFirst, b), _mm_andnot_si128(aFirst, a));
+
+                        u64 lanes[4];
+                        _mm_storeu_si128((__m128i*)lanes, _mm_unpacklo_epi32(low, high));
+                        _mm_storeu_si128((__m128i*)(lanes + 2), _mm_unpackhi_epi32(low, high));
+
+                        const u8* order = SPATIAL_HIT_LANES[hits];
+                        u64* out = found + 4 <= maxPairs ? (u64*)(pairs + found) : spare;
+                        out[0] = lanes[order[0]];
+                        out[1] = lanes[order[1]];
+                        out[2] = lanes[order[2]];
+                        out[3] = lanes[order[3]];
+
+                        // the last few pairs before maxPairs went to spare, copied out one by one
+                        if(out == spare) {
+                            for(u32 k = 0; k < SPATIAL_HIT_COUNT[hits] && found + k < maxPairs; k++) {
+                                memcpy(pairs + found + k, spare + k, sizeof(SpatialPair));
+                            }
+                        }
+                        found += SPATIAL_HIT_COUNT[hits];
+                    }
+                }
+            }
+        }
+    }
+
+    return found;
+}
@@ -0,0 +1,33 @@
+#ifndef GAME_SPATIAL_H
+#define GAME_SPATIAL_H
+
+// uniform grid over a rect of the play area, for "what is near here" questions and broadphase pairs.
+// objects are circles of one radius. the grid is rebuilt from positions every frame by a counting sort:
+// objects end up grouped by cell, cells in row order, so a row of neighbouring cells is one contiguous run.
+// objects outside the rect count as in the nearest edge cell, queries still find them
+
+struct SpatialPair {
+    u32 a, b; // object indices as passed to BuildSpatialGrid, a < b
+};
+
+struct SpatialGrid {
+    f32 minX, minY;
+    f32 cellSize;
+    f32 inverseCellSize;
+    int32 cellsX, cellsY;
+
+    u32 capacity;
+    u32 count;
+    f32 radius; // of every object, at most half a cell so touching objects are never more than a cell apart
+
+    u32* cellStart; // cellsX * cellsY + 1, objects of cell c are sorted cellStart[c]..cellStart[c + 1]
+
+    // capacity each, in sorted order. queries only read these
+    u32* object;
+    f32* sortedX;
+    f32* sortedY;
+
+    u32* cell; // capacity, the cell of each object in input order. scratch for the sort
+};
+
+#endif
@@ -0,0 +1,242 @@
+// wav streaming
+// the reader runs as a background job. it parses the header on its first run, then fills every free chunk
+// and exits. the mixer kicks a new job whenever it frees a chunk and no job is in flight
+
+const u32 WAV_FORMAT_PCM = 1;
+const u32 WAV_FORMAT_EXTENSIBLE = 0xFFFE;
+
+#pragma pack(push, 1)
+struct WavChunkHeader {
+    u32 id;
+    u32 size;
+};
+
+struct WavFormat {
+    u16 formatTag;
+    u16 channelCount;
+    u32 samplesPerSecond;
+    u32 bytesPerSecond;
+    u16 blockAlign;
+    u16 bitsPerSample;
+};
+#pragma pack(pop)
+
+u32
+FourCC(const char code[5]) {
+    return (u32)code[0] | ((u32)code[1] << 8) | ((u32)code[2] << 16) | ((u32)code[3] << 24);
+}
+
+// walks the riff chunks for "fmt " and "data". only 16 bit pcm in mono or stereo is playable
+bool
+ParseWavHeader(AudioStream* stream) {
+    u64 fileSize = FileGetSize(stream->file);
+
+    u32 riff[3]; // "RIFF", size, "WAVE"
+    if(FileReadAt(stream->file, 0, riff, sizeof(riff)) != sizeof(riff) ||
+       riff[0] != FourCC("RIFF") || riff[2] != FourCC("WAVE")) {
+        return false;
+    }
+
+    bool hasFormat = false;
+    u64 offset = sizeof(riff);
+
+    while(offset + sizeof(WavChunkHeader) <= fileSize) {
+        WavChunkHeader chunk;
+        if(FileReadAt(stream->file, offset, &chunk, sizeof(chunk)) != sizeof(chunk)) {
+            return false;
+        }
+        offset += sizeof(chunk);
+
+        if(chunk.id == FourCC("fmt ")) {
+            WavFormat format;
+            if(chunk.size < sizeof(format) || FileReadAt(stream->file, offset, &format, sizeof(format)) != sizeof(format)) {
+                return false;
+            }
+
+            // extensible headers carry the real format in a subformat guid, its first two bytes are the tag
+            u16 formatTag = format.formatTag;
+            if(formatTag == WAV_FORMAT_EXTENSIBLE && chunk.size >= 26) {
+                if(FileReadAt(stream->file, offset + 24, &formatTag, sizeof(formatTag)) != sizeof(formatTag)) {
+                    return false;
+                }
+            }
+
+            if(formatTag != WAV_FORMAT_PCM || format.bitsPerSample != 16 ||
+               format.channelCount < 1 || format.channelCount > 2) {
+                return false;
+            }
+
+            stream->channelCount = format.channelCount;
+            stream->samplesPerSecond = format.samplesPerSecond;
+            hasFormat = true;
+        } else if(chunk.id == FourCC("data")) {
+            if(!hasFormat) {
+                return false;
+            }
+
+            // a truncated file plays what is there
+            u64 size = chunk.size;
+            if(offset + size > fileSize) {
+                size = fileSize - offset;
+            }
+
+            u32 frameBytes = stream->channelCount * sizeof(int16);
+            stream->dataOffset = offset;
+            stream->dataBytes = size - (size % frameBytes);
+            return stream->dataBytes > 0;
+        }
+
+        offset += chunk.size + (chunk.size & 1); // chunks are padded to an even size
+    }
+
+    return false;
+}
+
+void
+ReadStreamChunks(AudioStream* stream) {
+    if(AtomicLoad(&stream->state) == Stream_Opening) {
+        stream->file = FileOpen(stream->path);
+
+        if(!stream->file || !ParseWavHeader(stream)) {
+            AtomicStore(&stream->state, Stream_Failed);
+            AtomicStore(&stream->readPending, 0);
+            return;
+        }
+
+        AtomicStore(&stream->state, Stream_Playing);
+    }
+
+    u32 frameBytes = stream->channelCount * sizeof(int16);
+    u32 filled = stream->filled;
+
+    while(!stream->endOfData) {
+        if(filled - AtomicLoad(&stream->consumed) >= STREAM_CHUNK_COUNT) {
+            break; // ring is full
+        }
+
+        u64 remaining = stream->dataBytes - stream->fileCursor;
+        u32 wanted = remaining < STREAM_CHUNK_BYTES ? (u32)remaining : STREAM_CHUNK_BYTES;
+
+        u32 chunkIndex = filled % STREAM_CHUNK_COUNT;
+        u32 bytesRead = FileReadAt(stream->file, stream->dataOffset + stream->fileCursor,
+                                   stream->ring + (u64)chunkIndex * STREAM_CHUNK_BYTES, wanted);
+        bytesRead -= bytesRead % frameBytes;
+
+        if(bytesRead > 0) {
+            stream->chunkBytes[chunkIndex] = bytesRead;
+            stream->fileCursor += bytesRead;
+            stream->chunksRead++;
+
+            // publishes the chunk, the mixer can start on it right away
+            filled++;
+            AtomicStore(&stream->filled, filled);
+        }
+
+        if(bytesRead == 0 || stream->fileCursor >= stream->dataBytes) {
+            if(stream->loop && bytesRead > 0) {
+                stream->fileCursor = 0;
+            } else {
+                AtomicStore(&stream->endOfData, 1); // also ends a file that got shorter under us
+            }
+        }
+    }
+
+    AtomicStore(&stream->readPending, 0);
+}
+
+void
+ReadStreamCallback(void* data) {
+    ReadStreamChunks((AudioStream*)data);
+}
+
+// called from the game thread only, so at most one reader job is ever in flight
+void
+RequestStreamRead(AudioStream* stream) {
+    if(AtomicLoad(&stream->readPending) || stream->endOfData) {
+        return;
+    }
+
+    u32 state = AtomicLoad(&stream->state);
+    if(state == Stream_Closed || state == Stream_Failed) {
+        return;
+    }
+
+    if(state == Stream_Playing && AtomicLoad(&stream->filled) - stream->consumed >= STREAM_CHUNK_COUNT) {
+        return;
+    }
+
+    AtomicStore(&stream->readPending, 1);
+
+    if(stream->queue) {
+        WorkQueueAdd(stream->queue, ReadStreamCallback, stream);
+    } else {
+        ReadStreamChunks(stream);
+    }
+}
+
+// the ring is the only allocation, it is reused by every track opened on this stream
+void
+InitializeAudioStream(AudioStream* stream, MemoryArena* arena) {
+    *stream = {};
+    stream->ring = PushArrayAligned(arena, STREAM_CHUNK_BYTES * STREAM_CHUNK_COUNT, u8, 64);
+}
+
+// replay snapshots copy the stream with the rest of permanent memory. the reader has to be done with it
+// and the file closed before one is taken or replaced
+void
+SuspendAudioStream(AudioStream* stream) {
+    // the reader may still be writing into the ring
+    while(AtomicLoad(&stream->readPending)) {
+        _mm_pause();
+    }
+
+    if(stream->file) {
+        FileClose(stream->file);
+        stream->file = 0;
+    }
+}
+
+// reopens what the stream was playing. the read ahead already in the ring plays on from where it was
+void
+ResumeAudioStream(AudioStream* stream, WorkQueue* queue) {
+    stream->queue = queue;
+
+    if(stream->state == Stream_Playing) {
+        stream->file = FileOpen(stream->path);
+        if(!stream->file) {
+            stream->state = Stream_Failed;
+        }
+    }
+}
+
+void
+CloseAudioStream(AudioStream* stream) {
+    SuspendAudioStream(stream);
+
+    u8* ring = stream->ring;
+    *stream = {};
+    stream->ring = ring;
+}
+
+// returns right away, the header is parsed by the first reader job
+void
+OpenAudioStream(AudioStream* stream, WorkQueue* queue, const char path[], bool loop) {
+    CloseAudioStream(stream);
+
+    // a path that doesn't fit fails to open rather than opening something else
+    u32 length = 0;
+    while(path[length] && length < STREAM_PATH_LENGTH - 1) {
+        stream->path[length] = path[length];
+        length++;
+    }
+    if(path[length]) {
+        stream->state = Stream_Failed;
+        return;
+    }
+
+    stream->queue = queue;
+    stream->loop = loop;
+    stream->state = Stream_Opening;
+
+    RequestStreamRead(stream);
+}
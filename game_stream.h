@@ -0,0 +1,52 @@
+#ifndef GAME_STREAM_H
+#define GAME_STREAM_H
+
+// streamed pcm from a wav file. a background job reads the file ahead in fixed size chunks into a ring,
+// the mixer plays the ring. memory is the ring and nothing else, however long the track is
+
+const u32 STREAM_CHUNK_BYTES = 16 * 1024; // 4096 stereo frames, about 85 ms at 48 kHz
+const u32 STREAM_CHUNK_COUNT = 8;         // read ahead of about 0.7 s
+const u32 STREAM_PATH_LENGTH = 256;
+
+enum StreamState {
+    Stream_Closed,
+    Stream_Opening, // header not parsed yet
+    Stream_Playing,
+    Stream_Failed,  // missing file or a format the mixer can't play
+};
+
+// one reader job and one mixer at a time. the reader owns filled and the file cursor,
+// the mixer owns consumed and the offset into the current chunk
+struct AudioStream {
+    u32 volatile state;
+
+    // the path is a copy, so the stream still knows what it plays when a replay snapshot brings it back.
+    // the file and the queue belong to the process and are set again when the stream resumes
+    char path[STREAM_PATH_LENGTH];
+    FileHandle* file;
+    WorkQueue* queue;
+    bool loop;
+
+    // from the header, written by the reader before state goes to Stream_Playing
+    u32 channelCount;
+    u32 samplesPerSecond; // not resampled, tracks should match the output rate
+    u64 dataOffset;
+    u64 dataBytes;
+
+    // chunk ring. chunks [consumed, filled) hold audio, the rest are free for the reader
+    u8* ring;
+    u32 chunkBytes[STREAM_CHUNK_COUNT]; // the last chunk of a track can be short
+    u32 volatile filled;
+    u32 volatile consumed;
+    u32 volatile endOfData; // set after the last chunk is filled, never when looping
+
+    u32 volatile readPending; // a reader job is queued or running
+
+    u64 fileCursor;  // reader: next byte of the data chunk to read
+    u32 chunkOffset; // mixer: next byte of the current chunk to play
+
+    u32 chunksRead;
+    u32 underruns; // mixes that ran out of read ahead
+};
+
+#endif
@@ -0,0 +1,253 @@
+// text, see game_text.h
+// strings are laid out while they are drawn, straight from the characters: no glyph list, no allocation.
+// a glyph that is inside the clip is drawn 8 pixels a row with sse2, one that straddles an edge pixel by pixel
+
+// printable ascii, ' ' to '~'. the public domain font8x8 by daniel hepper, after the ibm pc bios font
+const u8 BUILTIN_FONT_GLYPHS[95][8] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+    { 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 }, // !
+    { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // "
+    { 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 }, // #
+    { 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 }, // $
+    { 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 }, // %
+    { 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 }, // &
+    { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '
+    { 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 }, // (
+    { 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 }, // )
+    { 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 }, // *
+    { 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 }, // +
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ,
+    { 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 }, // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // .
+    { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 }, // /
+    { 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 }, // 0
+    { 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 }, // 1
+    { 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 }, // 2
+    { 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 }, // 3
+    { 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 }, // 4
+    { 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 }, // 5
+    { 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 }, // 6
+    { 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 }, // 7
+    { 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 }, // 8
+    { 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 }, // 9
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // :
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ;
+    { 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 }, // <
+    { 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 }, // =
+    { 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 }, // >
+    { 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 }, // ?
+    { 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 }, // @
+    { 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 }, // A
+    { 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 }, // B
+    { 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 }, // C
+    { 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 }, // D
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 }, // E
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 }, // F
+    { 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 }, // G
+    { 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 }, // H
+    { 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // I
+    { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 }, // J
+    { 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 }, // K
+    { 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 }, // L
+    { 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 }, // M
+    { 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 }, // N
+    { 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 }, // O
+    { 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 }, // P
+    { 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 }, // Q
+    { 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 }, // R
+    { 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 }, // S
+    { 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // T
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 }, // U
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // V
+    { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 }, // W
+    { 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 }, // X
+    { 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 }, // Y
+    { 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 }, // Z
+    { 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 }, // [
+    { 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 }, // backslash
+    { 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 }, // ]
+    { 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 }, // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF }, // _
+    { 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 }, // `
+    { 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 }, // a
+    { 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 }, // b
+    { 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 }, // c
+    { 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 }, // d
+    { 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 }, // e
+    { 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 }, // f
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // g
+    { 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 }, // h
+    { 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // i
+    { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E }, // j
+    { 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 }, // k
+    { 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // l
+    { 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 }, // m
+    { 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 }, // n
+    { 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 }, // o
+    { 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F }, // p
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 }, // q
+    { 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 }, // r
+    { 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 }, // s
+    { 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 }, // t
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 }, // u
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // v
+    { 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 }, // w
+    { 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 }, // x
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // y
+    { 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 }, // z
+    { 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 }, // {
+    { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 }, // |
+    { 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 }, // }
+    { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ~
+};
+
+// needs no memory, the glyphs are in the executable
+BitmapFont
+BuiltinFont() {
+    BitmapFont font = {};
+    font.glyphWidth = 8;
+    font.glyphHeight = 8;
+    font.advance = 8;
+    font.lineHeight = 8 + FONT_LINE_GAP;
+    font.firstChar = ' ';
+    font.glyphCount = sizeof(BUILTIN_FONT_GLYPHS) / sizeof(BUILTIN_FONT_GLYPHS[0]);
+    font.glyphs = &BUILTIN_FONT_GLYPHS[0][0];
+    return font;
+}
+
+// cuts glyphs out of a sheet of equal cells, in rows from the top left, as many columns as fit.
+// a pixel at least half opaque is ink. the masks are packed one after the other into the arena
+bool
+LoadBitmapFont(MemoryArena* arena, LoadedBitmap* sheet, int32 glyphWidth, int32 glyphHeight, u8 firstChar, u32 glyphCount, BitmapFont* font) {
+    *font = {};
+    if(!sheet->pixels || glyphWidth <= 0 || glyphWidth > FONT_MAX_GLYPH_WIDTH ||
+       glyphHeight <= 0 || glyphHeight > FONT_MAX_GLYPH_HEIGHT) {
+        return false;
+    }
+
+    u32 columns = sheet->width / glyphWidth;
+    u32 rows = sheet->height / glyphHeight;
+    if(glyphCount == 0 || glyphCount > columns * rows || firstChar + glyphCount > 256) {
+        return false;
+    }
+
+    u8* glyphs = PushArray(arena, glyphCount * glyphHeight, u8);
+    for(u32 glyph = 0; glyph < glyphCount; glyph++) {
+        int32 cellX = (glyph % columns) * glyphWidth;
+        int32 cellTop = sheet->height - (glyph / columns) * glyphHeight; // the sheet is bottom row first
+
+        for(int32 row = 0; row < glyphHeight; row++) {
+            u32* pixels = sheet->pixels + (u64)(cellTop - 1 - row) * sheet->pitch + cellX;
+            u8 bits = 0;
+            for(int32 x = 0; x < glyphWidth; x++) {
+                bits |= (pixels[x] >> 24 >= 128) << x;
+            }
+            glyphs[glyph * glyphHeight + row] = bits;
+        }
+    }
+
+    font->glyphWidth = glyphWidth;
+    font->glyphHeight = glyphHeight;
+    font->advance = glyphWidth;
+    font->lineHeight = glyphHeight + FONT_LINE_GAP;
+    font->firstChar = firstChar;
+    font->glyphCount = glyphCount;
+    font->glyphs = glyphs;
+    return true;
+}
+
+// pixels the string covers with its top left corner at xPos, yPos. '\n' starts a line further down the screen
+Rect32
+StringBounds(BitmapFont* font, const char text[], int32 xPos, int32 yPos) {
+    int32 lines = 1;
+    int32 column = 0, widest = 0;
+    for(const char* at = text; *at; at++) {
+        if(*at == '\n') {
+            lines++;
+            column = 0;
+        } else {
+            column++;
+            widest = column > widest ? column : widest;
+        }
+    }
+
+    int32 width = widest > 0 ? (widest - 1) * font->advance + font->glyphWidth : 0;
+    int32 height = (lines - 1) * font->lineHeight + font->glyphHeight;
+    Rect32 bounds = { xPos, yPos - height, xPos + width, yPos };
+    return bounds;
+}
+
+// glyph ink in color, everything else is left alone. top left corner at xPos, yPos like StringBounds
+void
+DrawString(GraphicsBuffer* buffer, Rect32 clip, BitmapFont* font, const char text[], int32 xPos, int32 yPos, u32 color) {
+    PROFILE_ZONE("DrawString");
+
+    clip = Intersect(clip, BufferRect(buffer));
+    if(IsEmpty(clip)) {
+        return;
+    }
+
+    // the lane of each pixel's bit, a row's byte against these gives the mask of 8 pixels
+    __m128i bitsLow = _mm_setr_epi32(1, 2, 4, 8);
+    __m128i bitsHigh = _mm_setr_epi32(16, 32, 64, 128);
+    __m128i color4 = _mm_set1_epi32(color);
+
+    int32 x = xPos;
+    int32 top = yPos; // one past the top row of the line
+    for(const char* at = text; *at; at++) {
+        if(*at == '\n') {
+            x = xPos;
+            top -= font->lineHeight;
+            if(top <= clip.minY) {
+                break; // every line from here on is below the clip
+            }
+            continue;
+        }
+
+        u32 glyph = (u8)*at - font->firstChar;
+        int32 bottom = top - font->glyphHeight;
+        if(glyph >= font->glyphCount || x >= clip.maxX || x + font->glyphWidth <= clip.minX ||
+           bottom >= clip.maxY || top <= clip.minY) {
+            x += font->advance;
+            continue;
+        }
+
+        const u8* rows = font->glyphs + glyph * font->glyphHeight;
+        u8* row = buffer->data + (int64)(top - 1) * buffer->bytesPerRow + (int64)x * buffer->bytesPerPixel;
+
+        if(x >= clip.minX && x + FONT_MAX_GLYPH_WIDTH <= clip.maxX && bottom >= clip.minY && top <= clip.maxY) {
+            // all 8 pixels of every row are inside, the ones past the glyph's width have clear bits and keep their value
+            for(int32 r = 0; r < font->glyphHeight; r++, row -= buffer->bytesPerRow) {
+                if(rows[r] == 0) {
+                    continue;
+                }
+
+                __m128i bits = _mm_set1_epi32(rows[r]);
+                __m128i maskLow = _mm_cmpeq_epi32(_mm_and_si128(bits, bitsLow), bitsLow);
+                __m128i maskHigh = _mm_cmpeq_epi32(_mm_and_si128(bits, bitsHigh), bitsHigh);
+
+                __m128i* pixels = (__m128i*)row;
+                __m128i low = _mm_loadu_si128(pixels);
+                __m128i high = _mm_loadu_si128(pixels + 1);
+                _mm_storeu_si128(pixels, _mm_or_si128(_mm_and_si128(maskLow, color4), _mm_andnot_si128(maskLow, low)));
+                _mm_storeu_si128(pixels + 1, _mm_or_si128(_mm_and_si128(maskHigh, color4), _mm_andnot_si128(maskHigh, high)));
+            }
+        } else {
+            for(int32 r = 0; r < font->glyphHeight; r++, row -= buffer->bytesPerRow) {
+                int32 y = top - 1 - r;
+                if(y < clip.minY || y >= clip.maxY) {
+                    continue;
+                }
+
+                u32* pixels = (u32*)row;
+                for(int32 i = 0; i < font->glyphWidth; i++) {
+                    if((rows[r] >> i) & 1 && x + i >= clip.minX && x + i < clip.maxX) {
+                        pixels[i] = color;
+                    }
+                }
+            }
+        }
+
+        x += font->advance;
+    }
+}
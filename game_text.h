@@ -0,0 +1,22 @@
+#ifndef GAME_TEXT_H
+#define GAME_TEXT_H
+
+// bitmap fonts for debug text. a glyph is a 1 bit mask, one byte per row with bit 0 the leftmost pixel,
+// so a row of a glyph is drawn as 8 pixels at once: the mask picks between the text color and what is there.
+// there is a built in 8x8 font, fonts can also be cut out of a sheet of cells
+
+const int32 FONT_MAX_GLYPH_WIDTH = 8; // a row is one byte
+const int32 FONT_MAX_GLYPH_HEIGHT = 32;
+const int32 FONT_LINE_GAP = 2; // pixels between lines, below the glyphs' own
+
+struct BitmapFont {
+    int32 glyphWidth, glyphHeight;
+    int32 advance;    // pixels from one character to the next
+    int32 lineHeight; // pixels from one line to the next
+
+    u8 firstChar;   // the character of glyph 0, characters outside the font draw nothing but still advance
+    u32 glyphCount;
+    const u8* glyphs; // glyphHeight rows per glyph, top row first. bits past glyphWidth are clear
+};
+
+#endif
@@ -0,0 +1,213 @@
+// tilemap, see game_tilemap.h
+// chunk bitmaps are only made or replaced by PrepareTilemap, on the thread building the frame. drawing only reads
+// them, so render tiles copy out of the cache in parallel. the cache is small: a linear scan of lastUsed finds
+// the least recently used slot faster than keeping a list in order would
+
+void
+InitializeTilemap(Tilemap* map, MemoryArena* arena, int32 chunksX, int32 chunksY, u32 slotCount) {
+    assert(chunksX > 0 && chunksY > 0 && slotCount > 0);
+
+    map->chunksX = chunksX;
+    map->chunksY = chunksY;
+
+    u32 chunkCount = chunksX * chunksY;
+    map->chunks = PushArray(arena, chunkCount, TilemapChunk);
+    for(u32 i = 0; i < chunkCount; i++) {
+        memset(map->chunks[i].tiles, 0, sizeof(map->chunks[i].tiles));
+        map->chunks[i].version = 0;
+        map->chunks[i].slot = TILEMAP_NO_SLOT;
+    }
+
+    for(u32 i = 0; i < 256; i++) {
+        map->palette[i] = 0xFF000000;
+    }
+
+    map->slotCount = slotCount;
+    map->slots = PushArray(arena, slotCount, TilemapCacheSlot);
+    for(u32 i = 0; i < slotCount; i++) {
+        map->slots[i].pixels = PushArrayAligned(arena, TILEMAP_CHUNK_PIXELS * TILEMAP_CHUNK_PIXELS, u32, 32);
+        map->slots[i].chunk = TILEMAP_NO_SLOT;
+        map->slots[i].version = 0;
+        map->slots[i].lastUsed = 0;
+    }
+    map->useClock = 0;
+
+    map->stats = {};
+    map->version = 0;
+}
+
+// 0 outside the map
+u8
+GetTile(Tilemap* map, int32 tileX, int32 tileY) {
+    if(tileX < 0 || tileY < 0 || tileX >= map->chunksX * TILEMAP_CHUNK_TILES || tileY >= map->chunksY * TILEMAP_CHUNK_TILES) {
+        return 0;
+    }
+
+    TilemapChunk* chunk = map->chunks + (tileY / TILEMAP_CHUNK_TILES) * map->chunksX + tileX / TILEMAP_CHUNK_TILES;
+    return chunk->tiles[(tileY % TILEMAP_CHUNK_TILES) * TILEMAP_CHUNK_TILES + tileX % TILEMAP_CHUNK_TILES];
+}
+
+// outside the map does nothing. only the chunk holding the tile is rasterized again
+void
+SetTile(Tilemap* map, int32 tileX, int32 tileY, u8 tile) {
+    if(tileX < 0 || tileY < 0 || tileX >= map->chunksX * TILEMAP_CHUNK_TILES || tileY >= map->chunksY * TILEMAP_CHUNK_TILES) {
+        return;
+    }
+
+    TilemapChunk* chunk = map->chunks + (tileY / TILEMAP_CHUNK_TILES) * map->chunksX + tileX / TILEMAP_CHUNK_TILES;
+    u8* at = chunk->tiles + (tileY % TILEMAP_CHUNK_TILES) * TILEMAP_CHUNK_TILES + tileX % TILEMAP_CHUNK_TILES;
+    if(*at != tile) {
+        *at = tile;
+        chunk->version++;
+        map->version++;
+    }
+}
+
+// tiles are opaque, alpha is ignored. every cached chunk may show the old color, so the whole cache is dropped:
+// meant for setting up the map, not for every frame
+void
+SetTileColor(Tilemap* map, u8 tile, u32 color) {
+    color |= 0xFF000000;
+    if(map->palette[tile] == color) {
+        return;
+    }
+
+    map->palette[tile] = color;
+    map->version++;
+
+    for(u32 i = 0; i < map->slotCount; i++) {
+        TilemapCacheSlot* slot = map->slots + i;
+        if(slot->chunk != TILEMAP_NO_SLOT) {
+            map->chunks[slot->chunk].slot = TILEMAP_NO_SLOT;
+            slot->chunk = TILEMAP_NO_SLOT;
+            slot->lastUsed = 0;
+        }
+    }
+}
+
+// pixels the whole map covers with its bottom left corner at xPos, yPos
+Rect32
+TilemapBounds(Tilemap* map, int32 xPos, int32 yPos) {
+    Rect32 bounds = { xPos, yPos, xPos + map->chunksX * TILEMAP_CHUNK_PIXELS, yPos + map->chunksY * TILEMAP_CHUNK_PIXELS };
+    return bounds;
+}
+
+// the chunks under a rect of buffer pixels, inclusive. the rect has to be inside TilemapBounds and not empty
+struct TilemapChunkRange {
+    int32 minX, minY;
+    int32 maxX, maxY;
+};
+
+TilemapChunkRange
+TilemapChunksUnder(Rect32 area, int32 xPos, int32 yPos) {
+    TilemapChunkRange range;
+    range.minX = (area.minX - xPos) / TILEMAP_CHUNK_PIXELS;
+    range.minY = (area.minY - yPos) / TILEMAP_CHUNK_PIXELS;
+    range.maxX = (area.maxX - 1 - xPos) / TILEMAP_CHUNK_PIXELS;
+    range.maxY = (area.maxY - 1 - yPos) / TILEMAP_CHUNK_PIXELS;
+    return range;
+}
+
+// one pixel row per row of tiles, copied up the rest of the tiles' height
+void
+RasterizeTilemapChunk(Tilemap* map, TilemapChunk* chunk, u32* pixels) {
+    PROFILE_ZONE("RasterizeTilemapChunk");
+
+    for(int32 tileY = 0; tileY < TILEMAP_CHUNK_TILES; tileY++) {
+        u32* row = pixels + tileY * TILEMAP_TILE_SIZE * TILEMAP_CHUNK_PIXELS;
+        u8* tiles = chunk->tiles + tileY * TILEMAP_CHUNK_TILES;
+
+        for(int32 tileX = 0; tileX < TILEMAP_CHUNK_TILES; tileX++) {
+            FillSpan(row + tileX * TILEMAP_TILE_SIZE, TILEMAP_TILE_SIZE, map->palette[tiles[tileX]]);
+        }
+
+        for(int32 y = 1; y < TILEMAP_TILE_SIZE; y++) {
+            memcpy(row + y * TILEMAP_CHUNK_PIXELS, row, TILEMAP_CHUNK_PIXELS * sizeof(u32));
+        }
+    }
+}
+
+// the chunk's bitmap, rasterized first when it isn't cached or is stale. a chunk that isn't cached takes
+// the least recently used slot, empty slots were never used and go first
+TilemapCacheSlot*
+FetchTilemapChunk(Tilemap* map, u32 index) {
+    TilemapChunk* chunk = map->chunks + index;
+    TilemapCacheSlot* slot;
+
+    if(chunk->slot != TILEMAP_NO_SLOT) {
+        slot = map->slots + chunk->slot;
+        if(slot->version == chunk->version) {
+            map->stats.hits++;
+        } else {
+            map->stats.rebuilds++;
+            RasterizeTilemapChunk(map, chunk, slot->pixels);
+            slot->version = chunk->version;
+        }
+    } else {
+        u32 oldest = 0;
+        for(u32 i = 1; i < map->slotCount; i++) {
+            if(map->slots[i].lastUsed < map->slots[oldest].lastUsed) {
+                oldest = i;
+            }
+        }
+
+        slot = map->slots + oldest;
+        if(slot->chunk != TILEMAP_NO_SLOT) {
+            map->chunks[slot->chunk].slot = TILEMAP_NO_SLOT;
+            map->stats.evictions++;
+        }
+        map->stats.misses++;
+
+        slot->chunk = index;
+        chunk->slot = oldest;
+        RasterizeTilemapChunk(map, chunk, slot->pixels);
+        slot->version = chunk->version;
+    }
+
+    slot->lastUsed = ++map->useClock;
+    return slot;
+}
+
+// makes every chunk under area current in the cache, for drawing the map with its bottom left corner at xPos, yPos.
+// they are all used after this, so the cache has to hold every one of them at once
+void
+PrepareTilemap(Tilemap* map, Rect32 area, int32 xPos, int32 yPos) {
+    PROFILE_ZONE("PrepareTilemap");
+
+    area = Intersect(area, TilemapBounds(map, xPos, yPos));
+    if(IsEmpty(area)) {
+        return;
+    }
+
+    TilemapChunkRange range = TilemapChunksUnder(area, xPos, yPos);
+    assert((u32)((range.maxX - range.minX + 1) * (range.maxY - range.minY + 1)) <= map->slotCount);
+
+    for(int32 chunkY = range.minY; chunkY <= range.maxY; chunkY++) {
+        for(int32 chunkX = range.minX; chunkX <= range.maxX; chunkX++) {
+            FetchTilemapChunk(map, chunkY * map->chunksX + chunkX);
+        }
+    }
+}
+
+// copies the cached chunks under clip, row by row. PrepareTilemap has to have covered clip since the map last changed
+void
+DrawTilemap(GraphicsBuffer* buffer, Rect32 clip, Tilemap* map, int32 xPos, int32 yPos) {
+    PROFILE_ZONE("DrawTilemap");
+
+    clip = Intersect(Intersect(clip, BufferRect(buffer)), TilemapBounds(map, xPos, yPos));
+    if(IsEmpty(clip)) {
+        return;
+    }
+
+    TilemapChunkRange range = TilemapChunksUnder(clip, xPos, yPos);
+    for(int32 chunkY = range.minY; chunkY <= range.maxY; chunkY++) {
+        for(int32 chunkX = range.minX; chunkX <= range.maxX; chunkX++) {
+            TilemapChunk* chunk = map->chunks + chunkY * map->chunksX + chunkX;
+            assert(chunk->slot != TILEMAP_NO_SLOT && map->slots[chunk->slot].version == chunk->version);
+
+            TilemapCacheSlot* slot = map->slots + chunk->slot;
+            BlitPixels(buffer, clip, slot->pixels, TILEMAP_CHUNK_PIXELS, TILEMAP_CHUNK_PIXELS, TILEMAP_CHUNK_PIXELS, true,
+                       xPos + chunkX * TILEMAP_CHUNK_PIXELS, yPos + chunkY * TILEMAP_CHUNK_PIXELS);
+        }
+    }
+}
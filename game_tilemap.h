@@ -0,0 +1,51 @@
+#ifndef GAME_TILEMAP_H
+#define GAME_TILEMAP_H
+
+// tilemap: a world of square tiles, each one byte naming a color in the map's palette.
+// tiles are stored in square chunks. a chunk is rasterized once into a bitmap in a small cache and drawn from there
+// with row copies, so a frame costs one copy per visible pixel however many tiles it shows. a chunk is only
+// rasterized again when its tiles change or it was evicted, the cache keeps the most recently used ones
+
+const int32 TILEMAP_TILE_SIZE = 16;   // pixels each way
+const int32 TILEMAP_CHUNK_TILES = 16; // tiles each way
+const int32 TILEMAP_CHUNK_PIXELS = TILEMAP_TILE_SIZE * TILEMAP_CHUNK_TILES; // 256, one cached chunk is 256 KB
+
+const u32 TILEMAP_NO_SLOT = 0xFFFFFFFF;
+
+struct TilemapChunk {
+    u8 tiles[TILEMAP_CHUNK_TILES * TILEMAP_CHUNK_TILES]; // bottom row first like the buffer
+    u32 version; // bumped when a tile changes, a cached bitmap of an older version is stale
+    u32 slot;    // cache slot holding its bitmap, or TILEMAP_NO_SLOT
+};
+
+struct TilemapCacheSlot {
+    u32* pixels;  // TILEMAP_CHUNK_PIXELS squared, bottom row first, 32 byte aligned
+    u32 chunk;    // index of the chunk in here, or TILEMAP_NO_SLOT when empty
+    u32 version;  // of the chunk when it was rasterized
+    u64 lastUsed; // use clock when it was last drawn, the smallest goes first
+};
+
+// totals since the map was initialized. one lookup per visible chunk per frame
+struct TilemapStats {
+    u64 hits;      // cached and current
+    u64 misses;    // not cached, rasterized into a free or evicted slot
+    u64 rebuilds;  // cached but its tiles changed, rasterized again in place
+    u64 evictions; // misses that pushed out another chunk
+};
+
+struct Tilemap {
+    int32 chunksX, chunksY;
+    TilemapChunk* chunks; // rows of chunks, bottom first
+
+    u32 palette[256]; // packed bgra of every tile value, opaque
+
+    u32 slotCount;
+    TilemapCacheSlot* slots;
+    u64 useClock;
+
+    TilemapStats stats;
+
+    u32 version; // bumped by every change to tiles or palette, the renderer redraws when it moves on
+};
+
+#endif
@@ -0,0 +1,182 @@
+// tile parallel rendering
+// the buffer is split into tiles small enough to stay in cache while they are drawn
+// every command is clipped to the tile, so tiles never touch each other's pixels
+
+const int32 TILE_SIZE = 64;         // 64x64 pixels = 16 KB, half of a typical L1
+const int32 MAX_TILES_PER_AXIS = 16; // bigger buffers get bigger tiles instead of more of them
+
+// tile columns start on a multiple of this many pixels, 16 pixels = one 64 byte cache line,
+// so two tiles never write the same cache line
+const int32 TILE_ALIGN = 16;
+
+struct RenderTileWork {
+    RenderGroup* group;
+    GraphicsBuffer* buffer;
+    Rect32 clip;
+
+    // indices of the commands that touch this tile, in draw order. null means check every command
+    u32* bin;
+    u32 binCount;
+};
+
+void
+RenderTile(RenderTileWork* work) {
+    PROFILE_ZONE("RenderTile");
+
+    RenderGroup* group = work->group;
+
+    if(work->bin) {
+        for(u32 i = 0; i < work->binCount; i++) {
+            ExecuteRenderCommand(work->buffer, work->clip, group->commands + work->bin[i]);
+        }
+    } else {
+        for(u32 i = 0; i < group->commandCount; i++) {
+            ExecuteRenderCommand(work->buffer, work->clip, group->commands + i);
+        }
+    }
+}
+
+void
+RenderTileCallback(void* data) {
+    RenderTile((RenderTileWork*)data);
+}
+
+int32
+TileSpan(int32 pixels, int32 align) {
+    int32 tileCount = (pixels + TILE_SIZE - 1) / TILE_SIZE;
+    if(tileCount > MAX_TILES_PER_AXIS) {
+        tileCount = MAX_TILES_PER_AXIS;
+    }
+
+    int32 span = (pixels + tileCount - 1) / tileCount;
+    return ((span + align - 1) / align) * align;
+}
+
+// bins every command into the tiles it touches. two passes like a counting sort: count, then place
+// returns false when the bins don't fit in what is left of the group's arena
+bool
+BinRenderCommands(RenderGroup* group, Rect32 area, RenderTileWork* tiles, int32 tileCountX, int32 tileCountY, int32 tileWidth, int32 tileHeight) {
+    int32 tileCount = tileCountX * tileCountY;
+
+    for(int32 i = 0; i < tileCount; i++) {
+        tiles[i].binCount = 0;
+    }
+
+    u64 pairCount = 0;
+    for(u32 c = 0; c < group->commandCount; c++) {
+        Rect32 bounds = Intersect(group->commands[c].bounds, area);
+        if(IsEmpty(bounds)) {
+            continue;
+        }
+
+        for(int32 ty = (bounds.minY - area.minY) / tileHeight; ty <= (bounds.maxY - 1 - area.minY) / tileHeight; ty++) {
+            for(int32 tx = (bounds.minX - area.minX) / tileWidth; tx <= (bounds.maxX - 1 - area.minX) / tileWidth; tx++) {
+                tiles[ty * tileCountX + tx].binCount++;
+                pairCount++;
+            }
+        }
+    }
+
+    if(pairCount * sizeof(u32) > GetArenaSizeRemaining(group->arena, alignof(u32))) {
+        return false;
+    }
+
+    u32* next = PushArray(group->arena, pairCount, u32);
+    for(int32 i = 0; i < tileCount; i++) {
+        tiles[i].bin = next;
+        next += tiles[i].binCount;
+        tiles[i].binCount = 0;
+    }
+
+    // commands are visited in draw order, so every bin comes out in draw order too
+    for(u32 c = 0; c < group->commandCount; c++) {
+        Rect32 bounds = Intersect(group->commands[c].bounds, area);
+        if(IsEmpty(bounds)) {
+            continue;
+        }
+
+        for(int32 ty = (bounds.minY - area.minY) / tileHeight; ty <= (bounds.maxY - 1 - area.minY) / tileHeight; ty++) {
+            for(int32 tx = (bounds.minX - area.minX) / tileWidth; tx <= (bounds.maxX - 1 - area.minX) / tileWidth; tx++) {
+                RenderTileWork* tile = tiles + (ty * tileCountX + tx);
+                tile->bin[tile->binCount++] = c;
+            }
+        }
+    }
+
+    return true;
+}
+
+// draws the pixels in area, split into tiles the same way the whole buffer would be.
+// tile columns are laid out from the TILE_ALIGN column at or left of the area, so they still start on cache lines
+void
+RenderTiled(WorkQueue* queue, RenderGroup* group, GraphicsBuffer* buffer, Rect32 area) {
+    if(IsEmpty(area)) {
+        return;
+    }
+
+    if(!queue) {
+        // single threaded path, the whole area is one tile
+        RenderTileWork work = {};
+        work.group = group;
+        work.buffer = buffer;
+        work.clip = area;
+        RenderTile(&work);
+        return;
+    }
+
+    // the first column may start left of the area, it is clipped to it below
+    Rect32 layout = area;
+    layout.minX -= area.minX % TILE_ALIGN;
+
+    int32 layoutWidth = layout.maxX - layout.minX;
+    int32 layoutHeight = layout.maxY - layout.minY;
+    int32 tileWidth = TileSpan(layoutWidth, TILE_ALIGN);
+    int32 tileHeight = TileSpan(layoutHeight, 1);
+    int32 tileCountX = (layoutWidth + tileWidth - 1) / tileWidth;
+    int32 tileCountY = (layoutHeight + tileHeight - 1) / tileHeight;
+
+    RenderTileWork work[MAX_TILES_PER_AXIS * MAX_TILES_PER_AXIS];
+
+    for(int32 ty = 0; ty < tileCountY; ty++) {
+        for(int32 tx = 0; tx < tileCountX; tx++) {
+            RenderTileWork* tile = &work[ty * tileCountX + tx];
+            tile->group = group;
+            tile->buffer = buffer;
+            tile->clip.minX = layout.minX + tx * tileWidth;
+            tile->clip.minY = layout.minY + ty * tileHeight;
+            tile->clip.maxX = clamp(tile->clip.minX + tileWidth, area.minX, area.maxX);
+            tile->clip.maxY = clamp(tile->clip.minY + tileHeight, area.minY, area.maxY);
+            tile->clip.minX = clamp(tile->clip.minX, area.minX, area.maxX);
+            tile->bin = 0;
+            tile->binCount = 0;
+        }
+    }
+
+    // the bins only live until the join below
+    TemporaryMemory binMemory = BeginTemporaryMemory(group->arena);
+    
+    if(!BinRenderCommands(group, layout, work, tileCountX, tileCountY, tileWidth, tileHeight)) {
+        for(int32 i = 0; i < tileCountX * tileCountY; i++) {
+            work[i].bin = 0;
+        }
+    }
+
+    for(int32 i = 0; i < tileCountX * tileCountY; i++) {
+        // nothing to draw here this frame
+        if(work[i].bin && work[i].binCount == 0) {
+            continue;
+        }
+
+        WorkQueueAdd(queue, RenderTileCallback, &work[i]);
+    }
+
+    // single join, the buffer is complete once this returns
+    WorkQueueCompleteAll(queue);
+    
+    EndTemporaryMemory(binMemory);
+}
+
+void
+RenderTiled(WorkQueue* queue, RenderGroup* group, GraphicsBuffer* buffer) {
+    RenderTiled(queue, group, buffer, BufferRect(buffer));
+}
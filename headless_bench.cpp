@@ -0,0 +1,3181 @@
+// micro benchmarks for engine and game kernels, run with: headless --bench <name>
+// every benchmark checks its output against a plain scalar reference before reporting numbers
+
+typedef bool BenchmarkFunc(HeadlessOptions* options);
+
+struct Benchmark {
+    const char* name;
+    BenchmarkFunc* run;
+};
+
+// best of n runs, in milliseconds. the minimum is the least noisy estimate on a shared box
+struct BenchTimer {
+    u64 start;
+    f64 best;
+};
+
+void
+BenchBegin(BenchTimer* timer) {
+    timer->start = Headless_GetNanoseconds();
+}
+
+void
+BenchEnd(BenchTimer* timer) {
+    f64 elapsed = Headless_MillisecondsSince(timer->start);
+    if(timer->best == 0 || elapsed < timer->best) {
+        timer->best = elapsed;
+    }
+}
+
+GraphicsBuffer
+BenchCreateBuffer(int32 width, int32 height) {
+    GraphicsBuffer buffer = {};
+    buffer.width = width;
+    buffer.height = height;
+    buffer.bytesPerPixel = BYTES_PER_PIXEL;
+    buffer.bytesPerRow = width * BYTES_PER_PIXEL;
+    buffer.data = (u8*)aligned_alloc(4096, ((width * height * BYTES_PER_PIXEL) + 4095) & ~4095);
+    return buffer;
+}
+
+bool
+BenchBuffersMatch(GraphicsBuffer* a, GraphicsBuffer* b) {
+    for(int32 y = 0; y < a->height; y++) {
+        if(memcmp(a->data + y * a->bytesPerRow, b->data + y * b->bytesPerRow, a->width * a->bytesPerPixel) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Fill
+// ---------------------------------------------------------------------------------
+
+bool
+Bench_Fill(HeadlessOptions* options) {
+    const int32 SIZES[] = { 256, 512, 1024, 2048 };
+    const int REPEATS = 50;
+
+    struct FillKernel {
+        const char* name;
+        FillSpanFunc* span;
+        bool avx2;
+    };
+
+    FillKernel kernels[] = {
+        { "scalar", FillSpan_Scalar, false },
+        { "sse2",   FillSpan_SSE2,   false },
+        { "avx2",   FillSpan_AVX2,   true  },
+    };
+
+    InitFillKernels();
+    bool hasAVX2 = FillUseAVX2;
+    bool ok = true;
+
+    printf("%-7s %-10s %12s %12s %12s\n", "kernel", "size", "clear GB/s", "rects GB/s", "frame ms");
+
+    for(int32 size : SIZES) {
+        GraphicsBuffer reference = BenchCreateBuffer(size, size);
+        GraphicsBuffer buffer = BenchCreateBuffer(size, size);
+
+        for(FillKernel& kernel : kernels) {
+            if(kernel.avx2 && !hasAVX2) {
+                continue;
+            }
+
+            FillSpan = kernel.span;
+            FillUseAVX2 = kernel.avx2;
+
+            Color32 background, player;
+            background.packed = 0xFF000000;
+            player.packed = 0xFF0000FF;
+
+            // scalar clears never stream, so time them the way the old loop ran
+            BenchTimer clear = {};
+            for(int i = 0; i < REPEATS; i++) {
+                BenchBegin(&clear);
+                if(kernel.span == FillSpan_Scalar) {
+                    for(int32 y = 0; y < size; y++) {
+                        FillSpan_Scalar((u32*)(buffer.data + y * buffer.bytesPerRow), size, background.packed);
+                    }
+                } else {
+                    ClearBufferWithColor(&buffer, background);
+                }
+                BenchEnd(&clear);
+            }
+
+            // a mix of rect sizes, most of them partially off screen
+            BenchTimer rects = {};
+            u64 rectPixels = 0;
+            for(int i = 0; i < REPEATS; i++) {
+                rectPixels = 0;
+                BenchBegin(&rects);
+                for(int32 r = 0; r < 64; r++) {
+                    int32 x = ((r * 97) % (size + 64)) - 32;
+                    int32 y = ((r * 61) % (size + 64)) - 32;
+                    int32 w = 8 + (r * 37) % (size / 2);
+                    DrawRectangle(&buffer, x, y, w, w, player);
+
+                    // only count what lands on screen
+                    int32 visibleX = clamp(x + w, 0, size) - clamp(x, 0, size);
+                    int32 visibleY = clamp(y + w, 0, size) - clamp(y, 0, size);
+                    rectPixels += (u64)visibleX * visibleY;
+                }
+                BenchEnd(&rects);
+            }
+
+            BenchTimer frame = {};
+            for(int i = 0; i < REPEATS; i++) {
+                BenchBegin(&frame);
+                ClearBufferWithColor(&buffer, background);
+                DrawRectangle(&buffer, size / 3, size / 3, 50, 50, player);
+                DrawBorder(&buffer, player);
+                BenchEnd(&frame);
+            }
+
+            // reference frame with the scalar kernel, compared pixel for pixel
+            FillSpanFunc* kernelSpan = FillSpan;
+            bool kernelAVX2 = FillUseAVX2;
+            FillSpan = FillSpan_Scalar;
+            FillUseAVX2 = false;
+            for(int32 y = 0; y < size; y++) {
+                FillSpan_Scalar((u32*)(reference.data + y * reference.bytesPerRow), size, background.packed);
+            }
+            DrawRectangle(&reference, size / 3, size / 3, 50, 50, player);
+            DrawBorder(&reference, player);
+            FillSpan = kernelSpan;
+            FillUseAVX2 = kernelAVX2;
+
+            if(!BenchBuffersMatch(&reference, &buffer)) {
+                printf("%s: output differs from scalar at %dx%d\n", kernel.name, size, size);
+                ok = false;
+            }
+
+            f64 clearBytes = (f64)size * size * BYTES_PER_PIXEL;
+            char sizeName[32];
+            snprintf(sizeName, sizeof(sizeName), "%dx%d", size, size);
+            printf("%-7s %-10s %12.2f %12.2f %12.4f\n", kernel.name, sizeName,
+                   clearBytes / (clear.best * 1e6),
+                   (rectPixels * BYTES_PER_PIXEL) / (rects.best * 1e6),
+                   frame.best);
+        }
+
+        free(reference.data);
+        free(buffer.data);
+    }
+
+    InitFillKernels();
+    return ok;
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Tiles
+// ---------------------------------------------------------------------------------
+
+// a frame's worth of commands: background, a stale layer that gets covered, a strip of
+// same colored cells that merge, the player and the border. without a group it draws immediately
+void
+BenchScene(RenderGroup* group, GraphicsBuffer* buffer) {
+    int32 size = buffer->width;
+    
+    Color32 background, covered, cell, player;
+    background.packed = 0xFF000000;
+    covered.packed = 0xFF00FF00;
+    cell.packed = 0xFF404040;
+    player.packed = 0xFF0000FF;
+    
+    int32 cellSize = size / 16;
+    
+    if(group) {
+        PushClear(group, LAYER_BACKGROUND, covered);
+        PushClear(group, LAYER_BACKGROUND, background);
+        for(int32 y = 0; y < 16; y += 2) {
+            for(int32 x = 0; x < 16; x++) {
+                PushRect(group, LAYER_BACKGROUND, x * cellSize, y * cellSize, cellSize, cellSize, cell);
+            }
+        }
+        PushRect(group, LAYER_PLAYER, size / 3, size / 2, 50, 50, player);
+        PushRect(group, LAYER_PLAYER, -100, -100, 50, 50, player);
+        PushBorder(group, LAYER_OVERLAY, player);
+    } else {
+        ClearBufferWithColor(buffer, covered);
+        ClearBufferWithColor(buffer, background);
+        for(int32 y = 0; y < 16; y += 2) {
+            for(int32 x = 0; x < 16; x++) {
+                DrawRectangle(buffer, x * cellSize, y * cellSize, cellSize, cellSize, cell);
+            }
+        }
+        DrawRectangle(buffer, size / 3, size / 2, 50, 50, player);
+        DrawRectangle(buffer, -100, -100, 50, 50, player);
+        DrawBorder(buffer, player);
+    }
+}
+
+bool
+Bench_Tiles(HeadlessOptions* options) {
+    const int32 SIZES[] = { 512, 1024, 2048 };
+    const int REPEATS = 100;
+    
+    InitFillKernels();
+    
+    int processors = options->threads; // every core unless --threads says otherwise
+    bool ok = true;
+    
+    // thread counts 1, 2, 4... up to every core
+    int threadCounts[32];
+    int threadCountCount = 0;
+    for(int threads = 1; threads < processors && threadCountCount < 31; threads *= 2) {
+        threadCounts[threadCountCount++] = threads;
+    }
+    threadCounts[threadCountCount++] = processors;
+    
+    // one queue per thread count, the workers stay parked on their own queue's semaphore
+    WorkQueue* queues = (WorkQueue*)calloc(threadCountCount, sizeof(WorkQueue));
+    for(int i = 0; i < threadCountCount; i++) {
+        Headless_CreateWorkQueue(&queues[i], threadCounts[i] - 1);
+    }
+    
+    u64 groupMemorySize = 1024 * 1024 * 4;
+    void* groupMemory = malloc(groupMemorySize);
+    MemoryArena groupArena;
+    InitializeArena(&groupArena, groupMemory, groupMemorySize);
+    
+    printf("%-10s %8s %12s %10s %9s %7s %7s\n", "size", "threads", "frame ms", "speedup", "commands", "culled", "merged");
+    
+    for(int32 size : SIZES) {
+        GraphicsBuffer reference = BenchCreateBuffer(size, size);
+        GraphicsBuffer buffer = BenchCreateBuffer(size, size);
+        
+        // immediate mode reference, no command buffer, no culling or merging
+        BenchScene(0, &reference);
+        
+        f64 singleThreaded = 0;
+        
+        for(int i = 0; i < threadCountCount; i++) {
+            // one thread means the plain untiled path, that is what the speedup is measured against
+            WorkQueue* queue = threadCounts[i] > 1 ? &queues[i] : 0;
+            
+            BenchTimer frame = {};
+            RenderStats stats = {};
+            for(int r = 0; r < REPEATS; r++) {
+                BenchBegin(&frame);
+                ResetArena(&groupArena);
+                RenderGroup* group = BeginRenderGroup(&groupArena, &buffer, MAX_RENDER_COMMANDS);
+                BenchScene(group, &buffer);
+                EndRenderGroup(group);
+                RenderTiled(queue, group, &buffer);
+                BenchEnd(&frame);
+                
+                stats = group->stats;
+            }
+            
+            if(!BenchBuffersMatch(&reference, &buffer)) {
+                printf("%d threads: output differs from immediate mode at %dx%d\n", threadCounts[i], size, size);
+                ok = false;
+            }
+            
+            if(threadCounts[i] == 1) {
+                singleThreaded = frame.best;
+            }
+            
+            char sizeName[32];
+            snprintf(sizeName, sizeof(sizeName), "%dx%d", size, size);
+            printf("%-10s %8d %12.4f %9.2fx %9u %7u %7u\n", sizeName, threadCounts[i], frame.best, singleThreaded / frame.best,
+                   stats.issued, stats.culled, stats.merged);
+        }
+        
+        free(reference.data);
+        free(buffer.data);
+    }
+    
+    free(groupMemory);
+    return ok;
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Mixer
+// ---------------------------------------------------------------------------------
+
+// a spread of every voice kind: tones, looping mono samples and stereo one shots
+void
+BenchStartVoices(Mixer* mixer, u32 voiceCount, SoundSamples* mono, SoundSamples* stereo) {
+    InitializeMixer(mixer);
+    mixer->masterVolume = 1.0f / 16; // enough headroom that most of the mix doesn't clip
+
+    for(u32 v = 0; v < voiceCount; v++) {
+        f32 pan = ((v % 9) / 4.0f) - 1.0f;
+        f32 volume = 0.25f + (v % 4) * 0.25f;
+
+        switch(v % 3) {
+            case 0: PlayTone(mixer, 110.0f + v * 13.0f, volume, pan); break;
+            case 1: PlaySamples(mixer, mono, volume, pan, true); break;
+            case 2: PlaySamples(mixer, stereo, volume, pan, false); break;
+        }
+    }
+}
+
+// straight per frame loop, same math as the mixer without vectors
+void
+BenchMixReference(Mixer* mixer, SoundBuffer* soundBuffer) {
+    for(int i = 0; i < soundBuffer->numSamplesToWrite; i++) {
+        f32 left = 0;
+        f32 right = 0;
+
+        for(u32 v = 0; v < MAX_VOICES; v++) {
+            MixerVoice* voice = mixer->voices + v;
+            if(voice->type == Voice_Off) {
+                continue;
+            }
+
+            f32 gainLeft, gainRight;
+            VoiceGains(mixer, voice, &gainLeft, &gainRight);
+
+            if(voice->type == Voice_Tone) {
+                f32 t = (f32)(voice->phase + (f64)i * voice->frequency / soundBuffer->samplesPerSecond);
+                f32 value = FastSinCycles(t);
+                left += value * gainLeft * FULL_SCALE;
+                right += value * gainRight * FULL_SCALE;
+            } else {
+                SoundSamples* sound = voice->sound;
+                u32 position = voice->position + i;
+                if(position >= sound->frameCount) {
+                    if(!voice->loop) {
+                        continue;
+                    }
+                    position %= sound->frameCount;
+                }
+
+                if(sound->channelCount == 1) {
+                    left += sound->samples[position] * gainLeft;
+                    right += sound->samples[position] * gainRight;
+                } else {
+                    left += sound->samples[position * 2] * gainLeft;
+                    right += sound->samples[position * 2 + 1] * gainRight;
+                }
+            }
+        }
+
+        left = left > 32767.0f ? 32767.0f : (left < -32768.0f ? -32768.0f : left);
+        right = right > 32767.0f ? 32767.0f : (right < -32768.0f ? -32768.0f : right);
+        soundBuffer->samples[i * 2] = (int16)lrintf(left);
+        soundBuffer->samples[i * 2 + 1] = (int16)lrintf(right);
+    }
+}
+
+bool
+Bench_Mixer(HeadlessOptions* options) {
+    const u32 VOICE_COUNTS[] = { 1, 16, 64, MAX_VOICES };
+    const int REPEATS = 200;
+    const int SAMPLES_PER_SECOND = 48000;
+    const int FRAME_SAMPLES = SAMPLES_PER_SECOND / 60;
+
+    // noise like sources, odd lengths so loops wrap mid vector
+    SoundSamples mono = {};
+    mono.frameCount = 1237;
+    mono.channelCount = 1;
+    mono.samples = (int16*)malloc(mono.frameCount * sizeof(int16));
+
+    SoundSamples stereo = {};
+    stereo.frameCount = 4 * FRAME_SAMPLES + 3;
+    stereo.channelCount = 2;
+    stereo.samples = (int16*)malloc(stereo.frameCount * 2 * sizeof(int16));
+
+    u32 seed = 0x12345678;
+    for(u32 i = 0; i < mono.frameCount; i++) {
+        seed = seed * 1664525 + 1013904223;
+        mono.samples[i] = (int16)(seed >> 16);
+    }
+    for(u32 i = 0; i < stereo.frameCount * 2; i++) {
+        seed = seed * 1664525 + 1013904223;
+        stereo.samples[i] = (int16)(seed >> 16);
+    }
+
+    u64 scratchSize = 1024 * 1024;
+    void* scratchMemory = malloc(scratchSize);
+    MemoryArena scratch;
+    InitializeArena(&scratch, scratchMemory, scratchSize);
+
+    int16* output = (int16*)malloc(FRAME_SAMPLES * 2 * sizeof(int16));
+    int16* expected = (int16*)malloc(FRAME_SAMPLES * 2 * sizeof(int16));
+
+    SoundBuffer soundBuffer = {};
+    soundBuffer.samplesPerSecond = SAMPLES_PER_SECOND;
+    soundBuffer.numSamplesToWrite = FRAME_SAMPLES;
+
+    Mixer* mixer = (Mixer*)malloc(sizeof(Mixer));
+    Mixer* start = (Mixer*)malloc(sizeof(Mixer));
+
+    bool ok = true;
+    f64 frameBudget = 1000.0 / 60;
+
+    printf("%-7s %10s %12s %14s %10s\n", "voices", "frame ms", "% of frame", "ns per sample", "max error");
+
+    for(u32 voiceCount : VOICE_COUNTS) {
+        BenchStartVoices(start, voiceCount, &mono, &stereo);
+
+        // several frames in a row so loops wrap and one shots finish, each checked against the reference
+        int maxError = 0;
+        *mixer = *start;
+        for(int frame = 0; frame < 6; frame++) {
+            soundBuffer.samples = expected;
+            BenchMixReference(mixer, &soundBuffer);
+
+            soundBuffer.samples = output;
+            MixSound(mixer, &scratch, &soundBuffer);
+
+            for(int i = 0; i < FRAME_SAMPLES * 2; i++) {
+                int error = abs(output[i] - expected[i]);
+                maxError = error > maxError ? error : maxError;
+            }
+        }
+
+        // float sums in a different order, a couple of lsb is rounding, more is a bug
+        if(maxError > 4) {
+            printf("%u voices: mix differs from the scalar reference by %d\n", voiceCount, maxError);
+            ok = false;
+        }
+
+        BenchTimer timer = {};
+        for(int r = 0; r < REPEATS; r++) {
+            *mixer = *start;
+            BenchBegin(&timer);
+            MixSound(mixer, &scratch, &soundBuffer);
+            BenchEnd(&timer);
+        }
+
+        f64 nsPerSample = timer.best * 1000000.0 / ((f64)FRAME_SAMPLES * voiceCount);
+        printf("%-7u %10.4f %11.3f%% %14.3f %10d\n", voiceCount, timer.best, 100.0 * timer.best / frameBudget, nsPerSample, maxError);
+    }
+
+    free(start);
+    free(mixer);
+    free(expected);
+    free(output);
+    free(scratchMemory);
+    free(stereo.samples);
+    free(mono.samples);
+    return ok;
+}
+
+
+
+
+
+// ---------------------------------------------------------------------------------
+// Audio
+// ---------------------------------------------------------------------------------
+
+// the audio side of a headless run without the game: every frame tops the ring up to its target with a ramp and
+// moves the simulated device's clock on by the frame. nothing stalls, so any underrun is the latency controllers' fault,
+// and so is a margin left above its minimum by the end
+bool
+Bench_Audio(HeadlessOptions* options) {
+    const f64 SECONDS = 60; // from startup until the device margin has shrunk from 50 ms to its minimum
+
+    struct AudioSetup {
+        const char* name;
+        f64 frameMs;
+        f64 cursorStepMs;
+        f64 writeGapMs;
+    };
+
+    AudioSetup setups[] = {
+        { "60 hz",         1000.0 / 60,   0, 0 },
+        { "144 hz",        1000.0 / 144,  0, 0 },
+        { "30 hz",         1000.0 / 30,   0, 0 },
+        { "coarse cursor", 1000.0 / 60,  10, 5 },
+    };
+
+    int16* ringMemory = (int16*)calloc(AUDIO_RING_FRAMES, sizeof(int16) * 2);
+    int16* frames = (int16*)malloc(AUDIO_RING_FRAMES * sizeof(int16) * 2);
+    for(u32 i = 0; i < AUDIO_RING_FRAMES * 2; i++) {
+        frames[i] = (int16)(i * 7);
+    }
+
+    bool ok = true;
+
+    printf("%-14s %9s %8s %7s %10s %9s %11s %11s\n", "setup", "frame ms", "step ms", "gap ms", "underruns", "silence", "lowest ms", "latency ms");
+
+    for(AudioSetup& setup : setups) {
+        static SimulatedAudioDevice device;
+        InitializeSimulatedAudioDevice(&device, SAMPLES_PER_SECOND, (u32)(setup.cursorStepMs * SAMPLES_PER_SECOND / 1000),
+                                       (u32)(setup.writeGapMs * SAMPLES_PER_SECOND / 1000), Headless_SleepMicroseconds);
+
+        static AudioOutput output;
+        InitializeAudioOutput(&output, &device.device, ringMemory, AUDIO_RING_FRAMES, AUDIO_TARGET_FILL);
+
+        pthread_t audioThread;
+        pthread_create(&audioThread, 0, Headless_AudioThreadProc, &output);
+        SyncSimulatedAudioDevice(&device);
+
+        u32 frameCount = (u32)(SECONDS * 1000 / setup.frameMs);
+        f64 samplesOwed = 0;
+        for(u32 frame = 0; frame < frameCount; frame++) {
+            UpdateAudioLatency(&output, (f32)(setup.frameMs / 1000));
+            AudioOutputWrite(&output, frames, AudioOutputFramesWanted(&output));
+
+            samplesOwed += SAMPLES_PER_SECOND * setup.frameMs / 1000;
+            u32 samplesThisFrame = (u32)samplesOwed;
+            samplesOwed -= samplesThisFrame;
+
+            AdvanceSimulatedAudioDevice(&device, samplesThisFrame);
+            SyncSimulatedAudioDevice(&device);
+        }
+
+        StopAudioOutput(&output);
+        pthread_join(audioThread, 0);
+
+        AudioOutputStats stats = GetAudioOutputStats(&output);
+        f32 framesToMs = 1000.0f / SAMPLES_PER_SECOND;
+        printf("%-14s %9.2f %8.1f %7.1f %10u %9u %11.1f %11.1f\n", setup.name, setup.frameMs, setup.cursorStepMs, setup.writeGapMs,
+               stats.underruns, stats.underrunFrames, stats.ringLowest * framesToMs, stats.totalLatencyMs);
+
+        if(stats.underruns > 0) {
+            printf("%s: %u underruns in a steady run, %u frames of silence\n", setup.name, stats.underruns, stats.underrunFrames);
+            ok = false;
+        }
+        if(device.device.latency.margin.frames != device.device.latency.margin.minFrames ||
+           output.ringMargin.frames != output.ringMargin.minFrames) {
+            printf("%s: margins still at %u device and %u ring frames, not down to their minimum\n", setup.name,
+                   device.device.latency.margin.frames, output.ringMargin.frames);
+            ok = false;
+        }
+    }
+
+    free(frames);
+    free(ringMemory);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------------
+// Pacing
+// ---------------------------------------------------------------------------------
+
+typedef void BenchWorkFunc(PacingClock* clock, u64 ticks);
+
+void
+BenchMockWork(PacingClock* clock, u64 ticks) {
+    AdvanceMockClock((MockClock*)clock, ticks);
+}
+
+void
+BenchBusyWork(PacingClock* clock, u64 ticks) {
+    u64 end = clock->now(clock) + ticks;
+    while(clock->now(clock) < end) {
+        _mm_pause();
+    }
+}
+
+struct BenchPacingRun {
+    u32 steps;
+    f32 lowestInterpolation;
+    f32 highestInterpolation;
+};
+
+// a game loop with random frame work. one frame can be made to stall, the catch-up limit has to deal with it
+BenchPacingRun
+BenchRunPacer(FramePacer* pacer, int frames, f64 minWorkMs, f64 maxWorkMs, int stallFrame, BenchWorkFunc* work) {
+    BenchPacingRun run = {};
+    run.lowestInterpolation = 1;
+
+    u32 seed = 0x2545F491;
+    u64 elapsed = pacer->stepTicks;
+
+    for(int frame = 0; frame < frames; frame++) {
+        run.steps += BeginFrameSteps(pacer, elapsed);
+
+        f32 interpolation = PacerInterpolation(pacer);
+        run.lowestInterpolation = interpolation < run.lowestInterpolation ? interpolation : run.lowestInterpolation;
+        run.highestInterpolation = interpolation > run.highestInterpolation ? interpolation : run.highestInterpolation;
+
+        seed = seed * 1664525 + 1013904223;
+        f64 workMs = minWorkMs + (maxWorkMs - minWorkMs) * (seed >> 8) / 16777216.0;
+        if(frame == stallFrame) {
+            workMs = 100;
+        }
+        work(pacer->clock, SecondsToTicks(pacer->clock, workMs / 1000.0));
+
+        elapsed = WaitForFrameDeadline(pacer);
+    }
+
+    return run;
+}
+
+void
+BenchReportPacing(const char name[], f64 refreshHz, PacingStats* stats) {
+    printf("%-14s %6.0f %9.3f %9.3f %9.3f %10.3f %10.3f %7u %8u\n", name, refreshHz, stats->meanMs, stats->minMs, stats->maxMs,
+           stats->jitterMs, stats->sleepMarginMs, stats->missedDeadlines, stats->droppedSteps);
+}
+
+bool
+Bench_Pacing(HeadlessOptions* options) {
+    const int FRAMES = 1000;     // the stats cover the last PACING_HISTORY_FRAMES, after the sleep margin has settled
+    const f32 MAX_JITTER_MS = 0.5f;
+    const u64 QPC_FREQUENCY = 10000000;
+
+    // schedulers on a mock clock: a 1 ms timer period, the 15.6 ms default, and a noisy one.
+    // every clock read costs 1 us, so spinning moves time forward like it does on a real machine
+    struct MockScheduler {
+        const char* name;
+        f64 refreshHz;
+        f64 oversleepMs;
+        f64 noiseMs;
+        int stallFrame;
+    };
+
+    MockScheduler schedulers[] = {
+        { "1ms timer",     60,  0.3, 0.7, -1  },
+        { "15.6ms timer",  60, 14.6, 1.0, -1  },
+        { "noisy",         60,  0.5, 4.0, -1  },
+        { "1ms timer",    144,  0.3, 0.7, -1  },
+        { "stall",         60,  0.3, 0.7, 300 },
+    };
+
+    bool ok = true;
+
+    printf("%-14s %6s %9s %9s %9s %10s %10s %7s %8s\n", "clock", "hz", "mean ms", "min ms", "max ms", "jitter ms", "margin ms", "missed", "dropped");
+
+    for(MockScheduler& scheduler : schedulers) {
+        MockClock mock;
+        InitializeMockClock(&mock, QPC_FREQUENCY, QPC_FREQUENCY / 1000000,
+                            (u64)(scheduler.oversleepMs * QPC_FREQUENCY / 1000), (u64)(scheduler.noiseMs * QPC_FREQUENCY / 1000));
+
+        FramePacer pacer;
+        InitializeFramePacer(&pacer, &mock.clock, scheduler.refreshHz, GAME_UPDATE_HZ);
+
+        // work leaves at least a couple of ms to sleep in, even at 144 hz
+        f64 frameMs = 1000.0 / scheduler.refreshHz;
+        BenchPacingRun run = BenchRunPacer(&pacer, FRAMES, frameMs * 0.1, frameMs * 0.6, scheduler.stallFrame, BenchMockWork);
+
+        PacingStats stats = GetPacingStats(&pacer);
+        BenchReportPacing(scheduler.name, scheduler.refreshHz, &stats);
+
+        if(stats.jitterMs >= MAX_JITTER_MS) {
+            printf("%s at %.0f hz: jitter %.3fms, over %.1fms\n", scheduler.name, scheduler.refreshHz, stats.jitterMs, MAX_JITTER_MS);
+            ok = false;
+        }
+
+        // the simulation keeps game time, one step per 1 / GAME_UPDATE_HZ whatever the display rate
+        f64 seconds = FRAMES / scheduler.refreshHz;
+        u32 expectedSteps = (u32)(seconds * GAME_UPDATE_HZ);
+        u32 stallSteps = scheduler.stallFrame >= 0 ? (u32)(0.1 * GAME_UPDATE_HZ) : 0;
+        if(run.steps + stats.droppedSteps + 2 < expectedSteps || run.steps > expectedSteps + stallSteps + 2) {
+            printf("%s at %.0f hz: %u update steps, expected about %u\n", scheduler.name, scheduler.refreshHz, run.steps, expectedSteps);
+            ok = false;
+        }
+
+        if(run.lowestInterpolation < 0 || run.highestInterpolation >= 1) {
+            printf("%s at %.0f hz: interpolation left 0..1 (%f to %f)\n", scheduler.name, scheduler.refreshHz,
+                   run.lowestInterpolation, run.highestInterpolation);
+            ok = false;
+        }
+
+        if(scheduler.stallFrame >= 0 && (stats.missedDeadlines != 1 || stats.droppedSteps == 0)) {
+            printf("stall: %u missed deadlines and %u dropped steps, expected one miss and some dropped\n",
+                   stats.missedDeadlines, stats.droppedSteps);
+            ok = false;
+        }
+    }
+
+    // the real clock, for a look at this machine. a shared box can't promise anything so it isn't checked
+    PacingClock clock = {};
+    clock.ticksPerSecond = 1000000000;
+    clock.now = Headless_ClockNow;
+    clock.sleep = Headless_ClockSleep;
+    clock.canSleep = true;
+
+    FramePacer pacer;
+    InitializeFramePacer(&pacer, &clock, 60, GAME_UPDATE_HZ);
+    BenchRunPacer(&pacer, 120, 2, 8, -1, BenchBusyWork);
+
+    PacingStats stats = GetPacingStats(&pacer);
+    BenchReportPacing("real", 60, &stats);
+
+    return ok;
+}
+
+
+// ---------------------------------------------------------------------------------
+// IO
+// ---------------------------------------------------------------------------------
+
+u8
+BenchFileByte(u32 file, u64 i) {
+    return (u8)(file * 31 + i * 7 + (i >> 9));
+}
+
+// one frame of busy work, with every outstanding read polled at the end of it like a game would.
+// returns the milliseconds spent submitting and polling, the part of the frame the reads cost
+f64
+BenchIoFrame(FileReadHandle* handles, FileReadStatus* results, u64* bytesRead, u32 count, u32* outstanding, f64 workMs) {
+    u64 workEnd = Headless_GetNanoseconds() + (u64)(workMs * 1000000);
+    while(Headless_GetNanoseconds() < workEnd) {
+        _mm_pause();
+    }
+
+    u64 pollStart = Headless_GetNanoseconds();
+    DispatchFileReads();
+    for(u32 i = 0; i < count; i++) {
+        if(results[i] == FileRead_Pending) {
+            results[i] = FileReadPoll(handles[i], bytesRead + i);
+            if(results[i] != FileRead_Pending) {
+                (*outstanding)--;
+            }
+        }
+    }
+    return Headless_MillisecondsSince(pollStart);
+}
+
+bool
+Bench_Io(HeadlessOptions* options) {
+    const u32 SMALL_FILES = 480; // 0.5 to 64 KB, like sprites and sounds
+    const u32 LARGE_FILES = 8;   // 2 MB, like music or a tilemap
+    const u32 FILE_COUNT = SMALL_FILES + LARGE_FILES;
+    const u32 LARGE_BYTES = 2 * 1024 * 1024;
+    const int REPEATS = 5;
+    const f64 FRAME_WORK_MS = 4;
+
+    char directory[] = "/tmp/headless_io_XXXXXX";
+    if(!mkdtemp(directory)) {
+        printf("error creating %s\n", directory);
+        return false;
+    }
+
+    static WorkQueue ioQueue;
+    Headless_CreateWorkQueue(&ioQueue, IO_THREAD_COUNT);
+
+    // the files, written once so every run reads from the page cache and only the loading path is measured
+    static char paths[FILE_COUNT][64];
+    u64 sizes[FILE_COUNT];
+    u64 offsets[FILE_COUNT];
+    u64 totalBytes = 0;
+    u32 seed = 0x2545F491;
+
+    u8* scratch = (u8*)malloc(LARGE_BYTES);
+    for(u32 file = 0; file < FILE_COUNT; file++) {
+        seed = seed * 1664525 + 1013904223;
+        sizes[file] = file < SMALL_FILES ? 512 + (seed >> 8) % (64 * 1024 - 512) : LARGE_BYTES;
+        offsets[file] = totalBytes;
+        totalBytes += (sizes[file] + 15) & ~15ull;
+
+        for(u64 i = 0; i < sizes[file]; i++) {
+            scratch[i] = BenchFileByte(file, i);
+        }
+        snprintf(paths[file], sizeof(paths[file]), "%s/%u.bin", directory, file);
+        FileWriteAll(paths[file], scratch, sizes[file]);
+    }
+    free(scratch);
+
+    // the caller's arena, every file lands at its own offset
+    u8* arena = (u8*)malloc(totalBytes);
+    FileReadHandle* handles = (FileReadHandle*)calloc(FILE_COUNT + 1, sizeof(FileReadHandle));
+    FileReadStatus* results = (FileReadStatus*)calloc(FILE_COUNT + 1, sizeof(FileReadStatus));
+    u64* bytesRead = (u64*)calloc(FILE_COUNT + 1, sizeof(u64));
+
+    bool ok = true;
+
+    // blocking, one after another on the main thread
+    BenchTimer blockingTimer = {};
+    for(int repeat = 0; repeat < REPEATS; repeat++) {
+        BenchBegin(&blockingTimer);
+        for(u32 file = 0; file < FILE_COUNT; file++) {
+            FileContent content = FileReadAll(paths[file]);
+            memcpy(arena + offsets[file], content.data, content.byteCount);
+            FileReleaseMemory(content.data);
+        }
+        BenchEnd(&blockingTimer);
+    }
+
+    // async, submitted at once and waited on, the main thread reads alongside the io threads
+    BenchTimer waitTimer = {};
+    FileReadStats waitStats = {};
+    for(int repeat = 0; repeat < REPEATS; repeat++) {
+        InitializeFileReads(&ioQueue);
+        memset(arena, 0, totalBytes);
+
+        BenchBegin(&waitTimer);
+        for(u32 file = 0; file < FILE_COUNT; file++) {
+            handles[file] = FileReadAsync(paths[file], 0, arena + offsets[file], sizes[file]);
+        }
+        for(u32 file = 0; file < FILE_COUNT; file++) {
+            results[file] = FileReadWait(handles[file], bytesRead + file);
+        }
+        BenchEnd(&waitTimer);
+        waitStats = GetFileReadStats();
+    }
+
+    for(u32 file = 0; file < FILE_COUNT && ok; file++) {
+        for(u64 i = 0; i < sizes[file]; i++) {
+            if(results[file] != FileRead_Done || bytesRead[file] != sizes[file] || arena[offsets[file] + i] != BenchFileByte(file, i)) {
+                printf("wait: file %u doesn't match what was written\n", file);
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    // async under frames: the game keeps running its frames, reads finish in between. a missing file fails on its own
+    InitializeFileReads(&ioQueue);
+    memset(arena, 0, totalBytes);
+
+    char missing[80];
+    snprintf(missing, sizeof(missing), "%s/missing.bin", directory);
+
+    u64 frameStart = Headless_GetNanoseconds();
+    for(u32 file = 0; file < FILE_COUNT; file++) {
+        handles[file] = FileReadAsync(paths[file], 0, arena + offsets[file], sizes[file]);
+        results[file] = FileRead_Pending;
+    }
+    handles[FILE_COUNT] = FileReadAsync(missing, 0, arena, 16);
+    results[FILE_COUNT] = FileRead_Pending;
+    f64 submitMs = Headless_MillisecondsSince(frameStart);
+
+    u32 outstanding = FILE_COUNT + 1;
+    u32 frames = 0;
+    f64 longestPollMs = 0;
+    while(outstanding > 0 && frames < 10000) {
+        f64 pollMs = BenchIoFrame(handles, results, bytesRead, FILE_COUNT + 1, &outstanding, FRAME_WORK_MS);
+        longestPollMs = pollMs > longestPollMs ? pollMs : longestPollMs;
+        frames++;
+    }
+    f64 framesMs = Headless_MillisecondsSince(frameStart);
+    FileReadStats frameStats = GetFileReadStats();
+
+    for(u32 file = 0; file < FILE_COUNT && ok; file++) {
+        for(u64 i = 0; i < sizes[file]; i++) {
+            if(results[file] != FileRead_Done || bytesRead[file] != sizes[file] || arena[offsets[file] + i] != BenchFileByte(file, i)) {
+                printf("frames: file %u doesn't match what was written\n", file);
+                ok = false;
+                break;
+            }
+        }
+    }
+    if(results[FILE_COUNT] != FileRead_Failed) {
+        printf("frames: the missing file didn't fail\n");
+        ok = false;
+    }
+    if(FileReadPoll(handles[0], 0) != FileRead_Invalid) {
+        printf("frames: a finished handle still answers\n");
+        ok = false;
+    }
+
+    // the budget can only be passed by a single request bigger than all of it
+    if(waitStats.maxInFlightBytes > FILE_READ_MAX_IN_FLIGHT_BYTES || frameStats.maxInFlightBytes > FILE_READ_MAX_IN_FLIGHT_BYTES) {
+        printf("in flight: %u bytes at once, over the %u byte budget\n", frameStats.maxInFlightBytes, FILE_READ_MAX_IN_FLIGHT_BYTES);
+        ok = false;
+    }
+    if(frameStats.batches * 4 > frameStats.submitted) {
+        printf("batches: %u for %u requests, small reads aren't being grouped\n", frameStats.batches, frameStats.submitted);
+        ok = false;
+    }
+
+    f64 megabytes = totalBytes / (1024.0 * 1024.0);
+    printf("%u files, %.1f MB, %u io threads, in flight budget %.1f MB\n", FILE_COUNT, megabytes, IO_THREAD_COUNT,
+           FILE_READ_MAX_IN_FLIGHT_BYTES / (1024.0 * 1024.0));
+    printf("%-10s %10s %10s\n", "load", "ms", "MB/s");
+    printf("%-10s %10.3f %10.1f\n", "blocking", blockingTimer.best, megabytes * 1000.0 / blockingTimer.best);
+    printf("%-10s %10.3f %10.1f\n", "async", waitTimer.best, megabytes * 1000.0 / waitTimer.best);
+    printf("under frames: %u frames of %.0fms work, %.1fms to load, submit %.3fms, longest poll %.3fms\n",
+           frames, FRAME_WORK_MS, framesMs, submitMs, longestPollMs);
+    printf("requests: %u submitted, %u done, %u failed, %u batches, at most %.1f MB and %u batches in flight\n",
+           frameStats.submitted, frameStats.completed, frameStats.failed, frameStats.batches,
+           frameStats.maxInFlightBytes / (1024.0 * 1024.0), frameStats.maxInFlightBatches);
+
+    for(u32 file = 0; file < FILE_COUNT; file++) {
+        unlink(paths[file]);
+    }
+    rmdir(directory);
+
+    free(bytesRead);
+    free(results);
+    free(handles);
+    free(arena);
+
+    return ok;
+}
+
+
+// ---------------------------------------------------------------------------------
+// Blit
+// ---------------------------------------------------------------------------------
+
+// the pattern every test image is made of, rows counted from the bottom
+void
+BenchImagePixel(int32 x, int32 y, u8 bgra[4]) {
+    bgra[0] = (u8)(x * 7);
+    bgra[1] = (u8)(y * 5);
+    bgra[2] = (u8)(x + y);
+    bgra[3] = (u8)((x * y) | 1);
+}
+
+// writes a test image as a bmp or tga into data, returns its size
+u64
+BenchWriteImage(u8* data, bool tga, u32 bytesPerPixel, bool topDown, bool bitfields, int32 width, int32 height) {
+    u8* at = data;
+    u64 rowBytes = (u64)width * bytesPerPixel;
+
+    if(tga) {
+        memset(at, 0, 18);
+        at[2] = TGA_TRUECOLOR;
+        at[12] = (u8)width; at[13] = (u8)(width >> 8);
+        at[14] = (u8)height; at[15] = (u8)(height >> 8);
+        at[16] = (u8)(bytesPerPixel * 8);
+        at[17] = (u8)((bytesPerPixel == 4 ? 8 : 0) | (topDown ? TGA_TOP_ORIGIN : 0));
+        at += 18;
+    } else {
+        rowBytes = (rowBytes + 3) & ~3ull;
+        u32 headerBytes = 14 + (bitfields ? 108 : 40); // a v4 header carries the masks, alpha included
+
+        memset(at, 0, headerBytes);
+        u32 fields[] = { 0, headerBytes, bitfields ? 108u : 40u, (u32)width, (u32)(topDown ? -height : height) };
+        at[0] = 'B'; at[1] = 'M';
+        memcpy(at + 10, &fields[1], 4);
+        memcpy(at + 14, &fields[2], 4);
+        memcpy(at + 18, &fields[3], 4);
+        memcpy(at + 22, &fields[4], 4);
+        at[26] = 1;
+        at[28] = (u8)(bytesPerPixel * 8);
+        if(bitfields) {
+            // bgra in memory is argb as a little endian u32
+            u32 compression = BMP_BITFIELDS;
+            u32 masks[] = { 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000 };
+            memcpy(at + 30, &compression, 4);
+            memcpy(at + 54, masks, sizeof(masks));
+        }
+        at += headerBytes;
+    }
+
+    for(int32 row = 0; row < height; row++) {
+        int32 y = topDown ? height - 1 - row : row;
+        memset(at, 0, rowBytes);
+        for(int32 x = 0; x < width; x++) {
+            u8 bgra[4];
+            BenchImagePixel(x, y, bgra);
+            memcpy(at + x * bytesPerPixel, bgra, bytesPerPixel);
+        }
+        at += rowBytes;
+    }
+
+    return at - data;
+}
+
+// a round 64x64 sprite: opaque in the middle, a soft edge, fully transparent corners
+void
+BenchMakeSprite(MemoryArena* arena, LoadedBitmap* sprite, int32 size, bool opaque) {
+    *sprite = {};
+    sprite->width = size;
+    sprite->height = size;
+    sprite->pitch = size;
+    sprite->pixels = PushArrayAligned(arena, size * size, u32, 32);
+    sprite->opaque = opaque;
+
+    f32 radius = size * 0.5f;
+    for(int32 y = 0; y < size; y++) {
+        for(int32 x = 0; x < size; x++) {
+            f32 dx = x + 0.5f - radius;
+            f32 dy = y + 0.5f - radius;
+            f32 edge = (radius - sqrtf(dx * dx + dy * dy)) / 6.0f;
+            u32 alpha = opaque ? 255 : (u32)(255 * (edge < 0 ? 0 : edge > 1 ? 1 : edge));
+            sprite->pixels[y * size + x] = Premultiply((u32)(x * 4), (u32)(y * 4), 200, alpha);
+        }
+    }
+}
+
+// a gradient under the sprites, so every blended pixel has something different to blend with
+void
+BenchBlitBackground(GraphicsBuffer* buffer) {
+    for(int32 y = 0; y < buffer->height; y++) {
+        u32* row = (u32*)(buffer->data + y * buffer->bytesPerRow);
+        for(int32 x = 0; x < buffer->width; x++) {
+            row[x] = 0xFF000000 | ((u32)(x & 0xFF) << 8) | (u32)(y & 0xFF);
+        }
+    }
+}
+
+// draws count sprites at fixed pseudo random spots, some hanging off the edges. returns the pixels drawn
+u64
+BenchBlitScene(GraphicsBuffer* buffer, LoadedBitmap* sprite, int32 count) {
+    u32 seed = 0x2545F491;
+    u64 pixels = 0;
+    Rect32 target = BufferRect(buffer);
+
+    for(int32 i = 0; i < count; i++) {
+        seed = seed * 1664525 + 1013904223;
+        int32 x = (int32)((seed >> 8) % (buffer->width + sprite->width)) - sprite->width / 2;
+        seed = seed * 1664525 + 1013904223;
+        int32 y = (int32)((seed >> 8) % (buffer->height + sprite->height)) - sprite->height / 2;
+
+        Rect32 bounds = Intersect(target, { x, y, x + sprite->width, y + sprite->height });
+        if(!IsEmpty(bounds)) {
+            pixels += (u64)(bounds.maxX - bounds.minX) * (bounds.maxY - bounds.minY);
+        }
+
+        DrawBitmap(buffer, sprite, x, y);
+    }
+
+    return pixels;
+}
+
+bool
+Bench_Blit(HeadlessOptions* options) {
+    const int32 SPRITE_COUNTS[] = { 256, 512, 1024 };
+    const int32 SPRITE_SIZE = 64;
+    const int REPEATS = 30;
+
+    u64 arenaSize = 1024 * 1024 * 4;
+    void* arenaMemory = malloc(arenaSize);
+    MemoryArena arena;
+    InitializeArena(&arena, arenaMemory, arenaSize);
+
+    bool ok = true;
+
+    // loaders: every supported layout of the same image has to come out as the same premultiplied pixels
+    struct ImageFormat {
+        const char* name;
+        bool tga;
+        u32 bytesPerPixel;
+        bool topDown;
+        bool bitfields;
+    };
+
+    ImageFormat formats[] = {
+        { "bmp 24",           false, 3, false, false },
+        { "bmp 24 top down",  false, 3, true,  false },
+        { "bmp 32",           false, 4, false, false },
+        { "bmp 32 bitfields", false, 4, true,  true  },
+        { "tga 24",           true,  3, false, false },
+        { "tga 32 top down",  true,  4, true,  false },
+    };
+
+    const int32 IMAGE_WIDTH = 37; // odd, so bmp rows need padding
+    const int32 IMAGE_HEIGHT = 23;
+    u8* file = PushArray(&arena, 64 * 1024, u8);
+
+    for(ImageFormat& format : formats) {
+        u64 fileBytes = BenchWriteImage(file, format.tga, format.bytesPerPixel, format.topDown, format.bitfields, IMAGE_WIDTH, IMAGE_HEIGHT);
+
+        TemporaryMemory temp = BeginTemporaryMemory(&arena);
+        LoadedBitmap bitmap;
+        bool loaded = LoadBitmap(&arena, file, fileBytes, &bitmap);
+        bool matches = loaded && bitmap.width == IMAGE_WIDTH && bitmap.height == IMAGE_HEIGHT;
+
+        for(int32 y = 0; y < IMAGE_HEIGHT && matches; y++) {
+            for(int32 x = 0; x < IMAGE_WIDTH; x++) {
+                u8 bgra[4];
+                BenchImagePixel(x, y, bgra);
+                u32 alpha = format.bytesPerPixel == 4 ? bgra[3] : 255;
+                if(bitmap.pixels[y * bitmap.pitch + x] != Premultiply(bgra[0], bgra[1], bgra[2], alpha)) {
+                    matches = false;
+                    break;
+                }
+            }
+        }
+
+        if(!matches) {
+            printf("%s: loaded image doesn't match what was written\n", format.name);
+            ok = false;
+        }
+        EndTemporaryMemory(temp);
+    }
+
+    // a truncated file is refused, not read past its end
+    u64 fileBytes = BenchWriteImage(file, false, 4, false, false, IMAGE_WIDTH, IMAGE_HEIGHT);
+    LoadedBitmap truncated;
+    if(LoadBitmap(&arena, file, fileBytes - 1, &truncated)) {
+        printf("a truncated bmp loaded\n");
+        ok = false;
+    }
+
+    // blits
+    LoadedBitmap sprite;
+    LoadedBitmap opaqueSprite;
+    BenchMakeSprite(&arena, &sprite, SPRITE_SIZE, false);
+    BenchMakeSprite(&arena, &opaqueSprite, SPRITE_SIZE, true);
+
+    struct BlendKernel {
+        const char* name;
+        BlendSpanFunc* span;
+        bool avx2;
+    };
+
+    BlendKernel kernels[] = {
+        { "scalar", BlendSpan_Scalar, false },
+        { "sse2",   BlendSpan_SSE2,   false },
+        { "avx2",   BlendSpan_AVX2,   true  },
+    };
+
+    bool hasAVX2 = QueryCpuFeatures().avx2;
+    GraphicsBuffer reference = BenchCreateBuffer(options->width, options->height);
+    GraphicsBuffer buffer = BenchCreateBuffer(options->width, options->height);
+
+    printf("%-7s %-8s %8s %12s %12s\n", "kernel", "sprites", "alpha", "frame ms", "Mpixels/s");
+
+    for(int32 count : SPRITE_COUNTS) {
+        BlendSpan = BlendSpan_Scalar;
+        BenchBlitBackground(&reference);
+        BenchBlitScene(&reference, &sprite, count);
+
+        for(BlendKernel& kernel : kernels) {
+            if(kernel.avx2 && !hasAVX2) {
+                continue;
+            }
+            BlendSpan = kernel.span;
+
+            BenchTimer timer = {};
+            u64 pixels = 0;
+            for(int r = 0; r < REPEATS; r++) {
+                BenchBlitBackground(&buffer);
+                BenchBegin(&timer);
+                pixels = BenchBlitScene(&buffer, &sprite, count);
+                BenchEnd(&timer);
+            }
+
+            if(!BenchBuffersMatch(&reference, &buffer)) {
+                printf("%s: %d sprites differ from the scalar blend\n", kernel.name, count);
+                ok = false;
+            }
+
+            printf("%-7s %-8d %8s %12.4f %12.1f\n", kernel.name, count, "blended", timer.best, pixels / (timer.best * 1000.0));
+        }
+
+        // the opaque fast path is plain row copies
+        BenchTimer timer = {};
+        u64 pixels = 0;
+        for(int r = 0; r < REPEATS; r++) {
+            BenchBegin(&timer);
+            pixels = BenchBlitScene(&buffer, &opaqueSprite, count);
+            BenchEnd(&timer);
+        }
+        printf("%-7s %-8d %8s %12.4f %12.1f\n", "copy", count, "opaque", timer.best, pixels / (timer.best * 1000.0));
+    }
+
+    InitBlitKernels();
+
+    free(reference.data);
+    free(buffer.data);
+    free(arenaMemory);
+    return ok;
+}
+
+
+// ---------------------------------------------------------------------------------
+// Atlas
+// ---------------------------------------------------------------------------------
+
+// a sprite of its own size and colour, soft edged like BenchMakeSprite so most rows have something to blend
+void
+BenchMakeAtlasImage(MemoryArena* arena, LoadedBitmap* image, int32 width, int32 height, u32 seed) {
+    *image = {};
+    image->width = width;
+    image->height = height;
+    image->pitch = width;
+    image->pixels = PushArrayAligned(arena, width * height, u32, 32);
+
+    for(int32 y = 0; y < height; y++) {
+        for(int32 x = 0; x < width; x++) {
+            int32 edgeX = x < width - 1 - x ? x : width - 1 - x;
+            int32 edgeY = y < height - 1 - y ? y : height - 1 - y;
+            int32 edge = edgeX < edgeY ? edgeX : edgeY;
+            u32 alpha = edge >= 3 ? 255 : (u32)(edge * 80);
+            image->pixels[y * width + x] = Premultiply((seed + x * 3) & 0xFF, (seed >> 8) & 0xFF, (u32)(y * 5) & 0xFF, alpha);
+        }
+    }
+}
+
+// every sprite on the page has to hold exactly its image, which also means no two of them overlap
+bool
+BenchAtlasMatches(SpriteAtlas* atlas, LoadedBitmap* images, AssetId* ids, u32 count) {
+    for(u32 i = 0; i < count; i++) {
+        u32 index = FindSprite(atlas, ids[i]);
+        if(index == ATLAS_NO_SPRITE) {
+            return false;
+        }
+
+        AtlasSprite* sprite = atlas->sprites + index;
+        if(sprite->width != images[i].width || sprite->height != images[i].height ||
+           sprite->x + sprite->width > atlas->page.width || sprite->y + sprite->height > atlas->page.height) {
+            return false;
+        }
+
+        for(int32 y = 0; y < sprite->height; y++) {
+            u32* pageRow = atlas->page.pixels + (u64)(sprite->y + y) * atlas->page.pitch + sprite->x;
+            if(memcmp(pageRow, images[i].pixels + y * images[i].pitch, sprite->width * sizeof(u32)) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool
+Bench_Atlas(HeadlessOptions* options) {
+    const u32 IMAGE_COUNT = 256;
+    const int32 MIN_IMAGE_SIZE = 8;
+    const int32 MAX_IMAGE_SIZE = 48;
+    const u32 DRAW_COUNTS[] = { 256, 1024, 4096 };
+    const int REPEATS = 30;
+
+    u64 arenaSize = 1024 * 1024 * 32;
+    void* arenaMemory = malloc(arenaSize);
+    MemoryArena arena;
+    InitializeArena(&arena, arenaMemory, arenaSize);
+
+    bool ok = true;
+
+    // the images, each in its own spot in the arena like bitmaps loaded one by one
+    LoadedBitmap* images = PushArray(&arena, IMAGE_COUNT, LoadedBitmap);
+    AssetId* ids = PushArray(&arena, IMAGE_COUNT, AssetId);
+    u32 seed = 0x9E3779B9;
+    u64 imagePixels = 0;
+    for(u32 i = 0; i < IMAGE_COUNT; i++) {
+        seed = seed * 1664525 + 1013904223;
+        int32 width = MIN_IMAGE_SIZE + (int32)((seed >> 8) % (MAX_IMAGE_SIZE - MIN_IMAGE_SIZE + 1));
+        seed = seed * 1664525 + 1013904223;
+        int32 height = MIN_IMAGE_SIZE + (int32)((seed >> 8) % (MAX_IMAGE_SIZE - MIN_IMAGE_SIZE + 1));
+
+        BenchMakeAtlasImage(&arena, images + i, width, height, seed);
+        ids[i] = i + 1;
+        imagePixels += (u64)width * height;
+    }
+
+    // packing at load time
+    BenchTimer packTimer = {};
+    SpriteAtlas atlas = {};
+    for(int r = 0; r < REPEATS; r++) {
+        TemporaryMemory temp = BeginTemporaryMemory(&arena);
+        BenchBegin(&packTimer);
+        bool packed = BuildSpriteAtlas(&arena, images, ids, IMAGE_COUNT, &atlas);
+        BenchEnd(&packTimer);
+        EndTemporaryMemory(temp);
+
+        if(!packed) {
+            printf("%u images didn't fit on one page\n", IMAGE_COUNT);
+            free(arenaMemory);
+            return false;
+        }
+    }
+
+    // the last build stays for the draws
+    BuildSpriteAtlas(&arena, images, ids, IMAGE_COUNT, &atlas);
+    if(!BenchAtlasMatches(&atlas, images, ids, IMAGE_COUNT)) {
+        printf("packed atlas doesn't hold the images it was built from\n");
+        ok = false;
+    }
+
+    printf("packed %u images of %d to %d pixels on a %dx%d page in %.3f ms, %.1f%% of the page used\n",
+           IMAGE_COUNT, MIN_IMAGE_SIZE, MAX_IMAGE_SIZE, atlas.page.width, atlas.page.height, packTimer.best,
+           100.0 * imagePixels / ((u64)atlas.page.width * atlas.page.height));
+
+    // the offline layout: written like the asset packer writes it, loaded like the game loads it from the archive
+    u64 assetBytes = AtlasAssetBytes(atlas.spriteCount, atlas.page.width, atlas.page.height);
+    u8* asset = PushArrayAligned(&arena, assetBytes, u8, ASSET_ALIGNMENT);
+    WriteAtlasAsset(asset, atlas.sprites, atlas.spriteCount, atlas.page.pixels, atlas.page.width, atlas.page.height);
+
+    SpriteAtlas loaded;
+    if(!LoadSpriteAtlas(asset, assetBytes, &loaded) || !BenchAtlasMatches(&loaded, images, ids, IMAGE_COUNT)) {
+        printf("atlas asset didn't load back\n");
+        ok = false;
+    }
+    if(LoadSpriteAtlas(asset, assetBytes - 1, &loaded)) {
+        printf("a truncated atlas asset loaded\n");
+        ok = false;
+    }
+
+    // draws: the same sprites at the same spots, one bitmap each against one page
+    GraphicsBuffer reference = BenchCreateBuffer(options->width, options->height);
+    GraphicsBuffer buffer = BenchCreateBuffer(options->width, options->height);
+    Rect32 target = BufferRect(&reference);
+
+    printf("%-10s %8s %12s %12s\n", "draw", "sprites", "frame ms", "speedup");
+
+    for(u32 count : DRAW_COUNTS) {
+        TemporaryMemory temp = BeginTemporaryMemory(&arena);
+
+        SpriteDraw* draws = PushArray(&arena, count, SpriteDraw);
+        for(u32 i = 0; i < count; i++) {
+            seed = seed * 1664525 + 1013904223;
+            draws[i].sprite = FindSprite(&atlas, ids[(seed >> 8) % IMAGE_COUNT]);
+            seed = seed * 1664525 + 1013904223;
+            draws[i].xPos = (int32)((seed >> 8) % (buffer.width + MAX_IMAGE_SIZE)) - MAX_IMAGE_SIZE / 2;
+            seed = seed * 1664525 + 1013904223;
+            draws[i].yPos = (int32)((seed >> 8) % (buffer.height + MAX_IMAGE_SIZE)) - MAX_IMAGE_SIZE / 2;
+        }
+
+        // naive: one DrawBitmap per sprite, from wherever its image was loaded
+        BenchTimer naive = {};
+        for(int r = 0; r < REPEATS; r++) {
+            BenchBlitBackground(&reference);
+            BenchBegin(&naive);
+            for(u32 i = 0; i < count; i++) {
+                AssetId id = atlas.sprites[draws[i].sprite].id;
+                DrawBitmap(&reference, images + (id - 1), draws[i].xPos, draws[i].yPos);
+            }
+            BenchEnd(&naive);
+        }
+
+        // the atlas, still one sprite after the other
+        BenchTimer inOrder = {};
+        for(int r = 0; r < REPEATS; r++) {
+            BenchBlitBackground(&buffer);
+            BenchBegin(&inOrder);
+            for(u32 i = 0; i < count; i++) {
+                DrawSprite(&buffer, target, &atlas, draws[i].sprite, draws[i].xPos, draws[i].yPos);
+            }
+            BenchEnd(&inOrder);
+        }
+        if(!BenchBuffersMatch(&reference, &buffer)) {
+            printf("%u sprites drawn from the atlas differ from the bitmaps\n", count);
+            ok = false;
+        }
+
+        // batched into row bands
+        BenchTimer batched = {};
+        for(int r = 0; r < REPEATS; r++) {
+            BenchBlitBackground(&buffer);
+            BenchBegin(&batched);
+            DrawSprites(&buffer, target, &atlas, draws, count, &arena);
+            BenchEnd(&batched);
+        }
+        if(!BenchBuffersMatch(&reference, &buffer)) {
+            printf("%u batched sprites differ from the bitmaps\n", count);
+            ok = false;
+        }
+
+        printf("%-10s %8u %12.4f %12s\n", "bitmaps", count, naive.best, "");
+        printf("%-10s %8u %12.4f %11.2fx\n", "atlas", count, inOrder.best, naive.best / inOrder.best);
+        printf("%-10s %8u %12.4f %11.2fx\n", "batched", count, batched.best, naive.best / batched.best);
+
+        EndTemporaryMemory(temp);
+    }
+
+    free(reference.data);
+    free(buffer.data);
+    free(arenaMemory);
+    return ok;
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Dirty
+// ---------------------------------------------------------------------------------
+
+// a mostly static scene: a grid of cells that never move, a few things that do, and a border that changes color now and then
+void
+BenchDirtyScene(RenderGroup* group, GraphicsBuffer* buffer, LoadedBitmap* sprite, int frame) {
+    Color32 background = { 0xFF102030 };
+    Color32 cell = { 0xFF405060 };
+    Color32 mover = { 0xFFC08040 };
+    Color32 border = { (frame / 30) % 2 ? 0xFFFFFFFFu : 0xFF00FF00u };
+
+    PushClear(group, LAYER_BACKGROUND, background);
+
+    int32 cellSize = buffer->width / 16;
+    for(int32 y = 0; y < 16; y += 2) {
+        for(int32 x = (y / 2) % 2; x < 16; x += 2) {
+            PushRect(group, LAYER_BACKGROUND, x * cellSize, y * cellSize, cellSize - 2, cellSize - 2, cell);
+        }
+    }
+
+    for(int32 i = 0; i < 3; i++) {
+        int32 x = (frame * (3 + i) + i * 150) % buffer->width;
+        int32 y = buffer->height / 4 + i * buffer->height / 4;
+        PushRect(group, LAYER_PLAYER, x, y, 40, 40, mover);
+    }
+
+    int32 spriteX = buffer->width / 2 + (int32)(buffer->width / 3 * cosf(frame * 0.05f));
+    int32 spriteY = buffer->height / 2 + (int32)(buffer->height / 3 * sinf(frame * 0.05f));
+    PushBitmap(group, LAYER_PLAYER, sprite, spriteX, spriteY);
+
+    PushBorder(group, LAYER_OVERLAY, border);
+}
+
+bool
+Bench_Dirty(HeadlessOptions* options) {
+    const int32 SIZES[] = { 512, 1024, 2048 };
+    const int FRAMES = 240;
+    const int OVERDRAW_EVERY = 50; // the engine scribbles over a corner, like the profile overlay does
+
+    InitFillKernels();
+    InitBlitKernels();
+
+    // threads - 1 workers, the tiled path runs even with none
+    static WorkQueue queue;
+    Headless_CreateWorkQueue(&queue, options->threads - 1);
+
+    u64 arenaSize = 1024 * 1024 * 4;
+    void* arenaMemory = malloc(arenaSize);
+    MemoryArena arena;
+    InitializeArena(&arena, arenaMemory, arenaSize);
+
+    LoadedBitmap sprite;
+    BenchMakeSprite(&arena, &sprite, 64, false);
+
+    RenderHistory history;
+    InitializeRenderHistory(&history, &arena, MAX_RENDER_COMMANDS);
+
+    MemoryArena frameArena;
+    SubArena(&frameArena, &arena, GetArenaSizeRemaining(&arena));
+
+    bool ok = true;
+    printf("%-10s %-8s %12s %12s %10s %10s %8s\n", "size", "queue", "full ms", "dirty ms", "speedup", "redrawn", "full");
+
+    for(int32 size : SIZES) {
+        GraphicsBuffer reference = BenchCreateBuffer(size, size);
+        GraphicsBuffer buffer = BenchCreateBuffer(size, size);
+
+        for(int tiled = 0; tiled < 2; tiled++) {
+            WorkQueue* workers = tiled ? &queue : 0;
+            history.valid = false;
+
+            DirtyRegion dirty = {};
+            DirtyRegion overdrawn = {};
+            f64 fullMs = 0;
+            f64 dirtyMs = 0;
+            u64 redrawnPixels = 0;
+            u32 fullRedraws = 0;
+            bool matches = true;
+
+            for(int frame = 0; frame < FRAMES; frame++) {
+                // every frame drawn from scratch
+                ResetArena(&frameArena);
+                u64 start = Headless_GetNanoseconds();
+                RenderGroup* group = BeginRenderGroup(&frameArena, &reference, MAX_RENDER_COMMANDS);
+                BenchDirtyScene(group, &reference, &sprite, frame);
+                EndRenderGroup(group);
+                RenderTiled(workers, group, &reference);
+                fullMs += Headless_MillisecondsSince(start);
+
+                // only what changed, the way GameRender does it
+                ResetArena(&frameArena);
+                start = Headless_GetNanoseconds();
+                group = BeginRenderGroup(&frameArena, &buffer, MAX_RENDER_COMMANDS);
+                BenchDirtyScene(group, &buffer, &sprite, frame);
+                EndRenderGroup(group);
+
+                ClearDirtyRegion(&dirty);
+                AddDirtyRegion(&dirty, &overdrawn);
+                ClearDirtyRegion(&overdrawn);
+                TrackRenderChanges(&history, group, &buffer, &dirty);
+                RenderDirty(workers, group, &buffer, &dirty);
+                dirtyMs += Headless_MillisecondsSince(start);
+
+                redrawnPixels += group->stats.redrawnPixels;
+                fullRedraws += group->stats.fullRedraws;
+
+                if(!BenchBuffersMatch(&reference, &buffer)) {
+                    if(matches) {
+                        printf("%dx%d frame %d: dirty rects differ from a full redraw\n", size, size, frame);
+                    }
+                    matches = false;
+                }
+
+                if(frame % OVERDRAW_EVERY == OVERDRAW_EVERY - 1) {
+                    Rect32 scribble = { size - 100, size - 60, size - 10, size - 5 };
+                    for(int32 y = scribble.minY; y < scribble.maxY; y++) {
+                        FillSpan((u32*)(buffer.data + y * buffer.bytesPerRow) + scribble.minX, scribble.maxX - scribble.minX, 0xFFFF00FF);
+                    }
+                    AddDirtyRect(&overdrawn, scribble);
+                }
+            }
+
+            ok = ok && matches;
+
+            char sizeName[32];
+            snprintf(sizeName, sizeof(sizeName), "%dx%d", size, size);
+            printf("%-10s %-8s %12.4f %12.4f %9.2fx %9.1f%% %8u\n", sizeName, tiled ? "tiled" : "none", fullMs / FRAMES, dirtyMs / FRAMES,
+                   fullMs / dirtyMs, 100.0 * redrawnPixels / ((f64)size * size * FRAMES), fullRedraws);
+        }
+
+        free(reference.data);
+        free(buffer.data);
+    }
+
+    free(arenaMemory);
+    return ok;
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Scale
+// ---------------------------------------------------------------------------------
+
+// what every scaled pixel should be, straight from the definition: nearest by division,
+// bilinear as two horizontal blends and a vertical one, in the same order and precision as the scaler
+void
+BenchScaleReference(Scaler* scaler, GraphicsBuffer* source, GraphicsBuffer* reference) {
+    for(int32 y = 0; y < reference->height; y++) {
+        u32* dest = (u32*)(reference->data + (u64)y * reference->bytesPerRow);
+        for(int32 x = 0; x < reference->width; x++) {
+            if(scaler->filter == ScaleFilter_Nearest) {
+                u32* row = (u32*)(source->data + (u64)(y / scaler->factorY) * source->bytesPerRow);
+                dest[x] = row[x / scaler->factorX];
+            } else {
+                ScaleTap* tapX = scaler->tapsX + x;
+                ScaleTap* tapY = scaler->tapsY + y;
+                u32* row0 = (u32*)(source->data + (u64)tapY->index0 * source->bytesPerRow);
+                u32* row1 = (u32*)(source->data + (u64)tapY->index1 * source->bytesPerRow);
+                u32 a = ScaleBlendPixel(row0[tapX->index0], row0[tapX->index1], tapX->weight);
+                u32 b = ScaleBlendPixel(row1[tapX->index0], row1[tapX->index1], tapX->weight);
+                dest[x] = ScaleBlendPixel(a, b, tapY->weight);
+            }
+        }
+    }
+}
+
+// every channel different from its neighbours, so a tap that is off by one shows
+void
+BenchScaleSource(GraphicsBuffer* source, u32 seed) {
+    for(int32 y = 0; y < source->height; y++) {
+        u32* row = (u32*)(source->data + (u64)y * source->bytesPerRow);
+        for(int32 x = 0; x < source->width; x++) {
+            seed = seed * 1664525 + 1013904223;
+            row[x] = seed ^ ((u32)x << 4) ^ ((u32)y << 20);
+        }
+    }
+}
+
+bool
+Bench_Scale(HeadlessOptions* options) {
+    const int32 SOURCE_SIZE = 512;
+    const int REPEATS = 20;
+
+    struct ScaleCase {
+        const char* name;
+        int32 outputWidth, outputHeight;
+        ScaleFilter filter;
+    };
+
+    ScaleCase cases[] = {
+        { "nearest 2x",  SOURCE_SIZE * 2, SOURCE_SIZE * 2, ScaleFilter_Nearest  },
+        { "nearest 3x",  SOURCE_SIZE * 3, SOURCE_SIZE * 3, ScaleFilter_Nearest  },
+        { "bilinear 2x", SOURCE_SIZE * 2, SOURCE_SIZE * 2, ScaleFilter_Bilinear },
+        { "bilinear 3x", SOURCE_SIZE * 3, SOURCE_SIZE * 3, ScaleFilter_Bilinear },
+        { "1000x750",    1000,            750,             ScaleFilter_Nearest  }, // not whole, falls back to bilinear
+        { "1920x1080",   1920,            1080,            ScaleFilter_Nearest  },
+    };
+
+    struct ScaleKernels {
+        const char* name;
+        ScaleBlendRowsFunc* blendRows;
+        ScaleFilterRowFunc* filterRow;
+        bool avx2;
+    };
+
+    ScaleKernels kernels[] = {
+        { "scalar", ScaleBlendRows_Scalar, ScaleFilterRow_Scalar, false },
+        { "sse2",   ScaleBlendRows_SSE2,   ScaleFilterRow_SSE2,   false },
+        { "avx2",   ScaleBlendRows_AVX2,   ScaleFilterRow_AVX2,   true  },
+    };
+
+    bool hasAVX2 = QueryCpuFeatures().avx2;
+
+    // threads - 1 workers, the banded path runs even with none
+    static WorkQueue queue;
+    Headless_CreateWorkQueue(&queue, options->threads - 1);
+
+    GraphicsBuffer source = BenchCreateBuffer(SOURCE_SIZE, SOURCE_SIZE);
+    BenchScaleSource(&source, 0x9E3779B9);
+
+    bool ok = true;
+    printf("%-12s %-10s %-7s %-7s %10s %12s\n", "scale", "output", "blend", "queue", "ms", "Mpixels/s");
+
+    for(ScaleCase& scaleCase : cases) {
+        void* memory = malloc(ScalerMemoryBytes(scaleCase.outputWidth, scaleCase.outputHeight));
+        Scaler scaler;
+        InitializeScaler(&scaler, memory, SOURCE_SIZE, SOURCE_SIZE, scaleCase.outputWidth, scaleCase.outputHeight, scaleCase.filter);
+
+        GraphicsBuffer reference = BenchCreateBuffer(scaleCase.outputWidth, scaleCase.outputHeight);
+        BenchScaleReference(&scaler, &source, &reference);
+
+        DirtyRegion full = {};
+        MarkDirtyFull(&full);
+        DirtyRegion presented;
+
+        char outputName[32];
+        snprintf(outputName, sizeof(outputName), "%dx%d", scaleCase.outputWidth, scaleCase.outputHeight);
+        u64 outputPixels = (u64)scaleCase.outputWidth * scaleCase.outputHeight;
+
+        for(ScaleKernels& kernel : kernels) {
+            if(kernel.avx2 && !hasAVX2) {
+                continue;
+            }
+            // nearest never blends, one kernel is enough
+            if(scaler.filter == ScaleFilter_Nearest && kernel.blendRows != ScaleBlendRows_SSE2) {
+                continue;
+            }
+            scaler.blendRows = kernel.blendRows;
+            scaler.filterRow = kernel.filterRow;
+
+            for(int tiled = 0; tiled < 2; tiled++) {
+                WorkQueue* workers = tiled ? &queue : 0;
+
+                BenchTimer timer = {};
+                for(int r = 0; r < REPEATS; r++) {
+                    memset(scaler.output.data, 0, outputPixels * sizeof(u32));
+                    BenchBegin(&timer);
+                    ScaleBuffer(&scaler, workers, &source, &full, &presented);
+                    BenchEnd(&timer);
+                }
+
+                if(!BenchBuffersMatch(&reference, &scaler.output)) {
+                    printf("%s %s: output differs from the reference\n", scaleCase.name, kernel.name);
+                    ok = false;
+                }
+
+                printf("%-12s %-10s %-7s %-7s %10.4f %12.1f\n", scaleCase.name, outputName,
+                       scaler.filter == ScaleFilter_Nearest ? "-" : kernel.name, tiled ? "bands" : "none",
+                       timer.best, outputPixels / (timer.best * 1000.0));
+            }
+        }
+
+        // a few dirty source rects, some on the edges: only what they reach is scaled, and that matches a full pass
+        Rect32 changed[] = { { 0, 0, 7, 300 }, { 100, 37, 151, 88 }, { 505, 500, 512, 512 }, { 240, 0, 241, 512 } };
+        DirtyRegion dirty = {};
+        for(Rect32 rect : changed) {
+            AddDirtyRect(&dirty, rect);
+            for(int32 y = rect.minY; y < rect.maxY; y++) {
+                u32* row = (u32*)(source.data + (u64)y * source.bytesPerRow);
+                for(int32 x = rect.minX; x < rect.maxX; x++) {
+                    row[x] = ~row[x];
+                }
+            }
+        }
+
+        scaler.blendRows = hasAVX2 ? ScaleBlendRows_AVX2 : ScaleBlendRows_SSE2;
+        scaler.filterRow = hasAVX2 ? ScaleFilterRow_AVX2 : ScaleFilterRow_SSE2;
+        ScaleBuffer(&scaler, &queue, &source, &dirty, &presented);
+        BenchScaleReference(&scaler, &source, &reference);
+        if(!BenchBuffersMatch(&reference, &scaler.output) || presented.full) {
+            printf("%s: scaling only the dirty rects differs from scaling everything\n", scaleCase.name);
+            ok = false;
+        }
+
+        free(reference.data);
+        free(memory);
+    }
+
+    free(source.data);
+    return ok;
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Raster
+// ---------------------------------------------------------------------------------
+
+u32
+BenchRandom(u32* seed) {
+    *seed = *seed * 1664525 + 1013904223;
+    return *seed >> 8;
+}
+
+// pixel centres inside by the fill rule, straight from the edge functions in 64 bits
+u64
+BenchCoveredPixels(RasterTriangle* triangle, Rect32 clip) {
+    Rect32 area = Intersect(clip, triangle->bounds);
+    u64 covered = 0;
+    for(int32 y = area.minY; y < area.maxY; y++) {
+        for(int32 x = area.minX; x < area.maxX; x++) {
+            bool inside = true;
+            for(int i = 0; i < 3; i++) {
+                inside = inside && triangle->stepX[i] * x + triangle->stepY[i] * y + triangle->offset[i] >= 0;
+            }
+            covered += inside;
+        }
+    }
+    return covered;
+}
+
+// a grid of cells split into two triangles each, inner corners moved by up to a quarter of a cell so no cell folds over. the outer corners
+// stay on whole pixels, so the mesh covers exactly the pixel centres of its rect. quarter pixel steps put
+// plenty of corners and edges right on pixel centres, where the fill rule decides
+u32
+BenchMakeMesh(RasterVertex* vertices, Rect32 rect, int32 cells, u32 seed) {
+    f32 cellWidth = (f32)(rect.maxX - rect.minX) / cells;
+    f32 cellHeight = (f32)(rect.maxY - rect.minY) / cells;
+
+    RasterVertex* grid = vertices + cells * cells * 6;
+    for(int32 y = 0; y <= cells; y++) {
+        for(int32 x = 0; x <= cells; x++) {
+            RasterVertex* v = grid + y * (cells + 1) + x;
+            v->x = rect.minX + x * cellWidth;
+            v->y = rect.minY + y * cellHeight;
+            v->color = BenchRandom(&seed) | 0xFF000000;
+
+            if(x > 0 && x < cells && y > 0 && y < cells) {
+                v->x = floorf(v->x + ((f32)(BenchRandom(&seed) % 5) - 2) * cellWidth / 8) + (BenchRandom(&seed) % 4) * 0.25f;
+                v->y = floorf(v->y + ((f32)(BenchRandom(&seed) % 5) - 2) * cellHeight / 8) + (BenchRandom(&seed) % 4) * 0.25f;
+            }
+        }
+    }
+
+    u32 count = 0;
+    for(int32 y = 0; y < cells; y++) {
+        for(int32 x = 0; x < cells; x++) {
+            RasterVertex* corner = grid + y * (cells + 1) + x;
+            RasterVertex a = corner[0], b = corner[1], c = corner[cells + 2], d = corner[cells + 1];
+
+            // both diagonals, and both windings
+            if((x + y) & 1) {
+                vertices[count++] = a; vertices[count++] = b; vertices[count++] = c;
+                vertices[count++] = a; vertices[count++] = c; vertices[count++] = d;
+            } else {
+                vertices[count++] = a; vertices[count++] = d; vertices[count++] = b;
+                vertices[count++] = b; vertices[count++] = d; vertices[count++] = c;
+            }
+        }
+    }
+    return count / 3;
+}
+
+void
+BenchRasterFill(GraphicsBuffer* buffer, u32 color) {
+    for(int32 y = 0; y < buffer->height; y++) {
+        FillSpan_Scalar((u32*)(buffer->data + (u64)y * buffer->bytesPerRow), buffer->width, color);
+    }
+}
+
+// how many triangles drew each pixel. each one is drawn on its own into a clear buffer, so overlaps count
+void
+BenchCountCoverage(GraphicsBuffer* buffer, u8* coverage, RasterVertex* vertices, u32 count, RasterSpanFunc* span) {
+    Rect32 whole = BufferRect(buffer);
+    memset(coverage, 0, (u64)buffer->width * buffer->height);
+    BenchRasterFill(buffer, 0);
+
+    for(u32 i = 0; i < count; i++) {
+        RasterTriangle triangle;
+        RasterVertex* v = vertices + i * 3;
+        if(!SetupRasterTriangle(&triangle, v, v + 1, v + 2, 1, false)) {
+            continue;
+        }
+
+        RasterizeTriangle(buffer, whole, &triangle, span);
+        Rect32 area = Intersect(whole, triangle.bounds);
+        for(int32 y = area.minY; y < area.maxY; y++) {
+            u32* row = (u32*)(buffer->data + (u64)y * buffer->bytesPerRow);
+            for(int32 x = area.minX; x < area.maxX; x++) {
+                coverage[y * buffer->width + x] += (u8)row[x];
+                row[x] = 0;
+            }
+        }
+    }
+}
+
+// count is triangles, three vertices each
+u64
+BenchRasterScene(GraphicsBuffer* buffer, Rect32 clip, RasterVertex* vertices, u32 count, bool shaded, RasterSpanFunc* span) {
+    u64 pixels = 0;
+    for(u32 i = 0; i < count; i++) {
+        RasterTriangle triangle;
+        RasterVertex* v = vertices + i * 3;
+        if(SetupRasterTriangle(&triangle, v, v + 1, v + 2, v->color, shaded)) {
+            RasterizeTriangle(buffer, clip, &triangle, span);
+            pixels += (u64)RectArea(Intersect(clip, triangle.bounds));
+        }
+    }
+    return pixels;
+}
+
+bool
+Bench_Raster(HeadlessOptions* options) {
+    const int REPEATS = 20;
+
+    u32 seed = 0x2545F491;
+    bool ok = true;
+
+    struct RasterKernel {
+        const char* name;
+        RasterSpanFunc* span;
+        bool avx2;
+    };
+
+    RasterKernel kernels[] = {
+        { "scalar", RasterSpan_Scalar, false },
+        { "sse2",   RasterSpan_SSE2,   false },
+        { "avx2",   RasterSpan_AVX2,   true  },
+    };
+    bool hasAVX2 = QueryCpuFeatures().avx2;
+
+    GraphicsBuffer reference = BenchCreateBuffer(options->width, options->height);
+    GraphicsBuffer buffer = BenchCreateBuffer(options->width, options->height);
+    Rect32 whole = BufferRect(&buffer);
+
+    // fill rule: a mesh has to draw every pixel centre in its rect exactly once, with every kernel
+    const int32 MESH_CELLS = 12;
+    u32 meshVertexCount = MESH_CELLS * MESH_CELLS * 6 + (MESH_CELLS + 1) * (MESH_CELLS + 1);
+    RasterVertex* mesh = (RasterVertex*)malloc(meshVertexCount * sizeof(RasterVertex));
+    u8* coverage = (u8*)malloc((u64)buffer.width * buffer.height);
+
+    Rect32 meshRect = { 13, 7, buffer.width - 21, buffer.height - 10 };
+    u32 meshTriangles = BenchMakeMesh(mesh, meshRect, MESH_CELLS, seed);
+
+    for(RasterKernel& kernel : kernels) {
+        if(kernel.avx2 && !hasAVX2) {
+            continue;
+        }
+
+        BenchCountCoverage(&buffer, coverage, mesh, meshTriangles, kernel.span);
+
+        u64 wrong = 0;
+        for(int32 y = 0; y < buffer.height; y++) {
+            for(int32 x = 0; x < buffer.width; x++) {
+                bool inside = x >= meshRect.minX && x < meshRect.maxX && y >= meshRect.minY && y < meshRect.maxY;
+                wrong += coverage[y * buffer.width + x] != (inside ? 1 : 0);
+            }
+        }
+        if(wrong) {
+            printf("%s: %llu pixels of a %u triangle mesh drawn twice or not at all\n", kernel.name, (unsigned long long)wrong, meshTriangles);
+            ok = false;
+        }
+    }
+
+    // triangles far bigger than the buffer take the 64 bit path, their shared diagonal still splits the pixels exactly
+    RasterVertex huge[6] = {
+        { -3000.3f, -2000.0f, 0 }, { 4000.0f, -2500.5f, 0 }, { 3500.0f, 3000.25f, 0 },
+        { -3000.3f, -2000.0f, 0 }, { 3500.0f, 3000.25f, 0 }, { -2000.0f, 2600.0f, 0 },
+    };
+    BenchCountCoverage(&buffer, coverage, huge, 2, RasterSpan);
+    for(int32 i = 0; i < buffer.width * buffer.height; i++) {
+        if(coverage[i] != 1) {
+            printf("two triangles bigger than the buffer drew pixel %d, %d %u times\n", i % buffer.width, i / buffer.width, coverage[i]);
+            ok = false;
+            break;
+        }
+    }
+
+    // shading: within a level of the exact barycentric blend, on a triangle with every corner a different color
+    RasterVertex shadedCorners[3] = {
+        { 20.3f, 30.6f, 0xFF0000FF }, { (f32)buffer.width - 40.1f, 50.2f, 0x80FF0000 }, { 200.7f, (f32)buffer.height - 20.9f, 0x0000FF00 },
+    };
+    RasterTriangle shadedTriangle;
+    SetupRasterTriangle(&shadedTriangle, shadedCorners, shadedCorners + 1, shadedCorners + 2, 0, true);
+    BenchRasterFill(&buffer, 0x12345678);
+    RasterizeTriangle(&buffer, whole, &shadedTriangle, RasterSpan_Scalar);
+
+    u32 worst = 0;
+    for(int32 y = 0; y < buffer.height; y++) {
+        u32* row = (u32*)(buffer.data + (u64)y * buffer.bytesPerRow);
+        for(int32 x = 0; x < buffer.width; x++) {
+            f64 px = x + 0.5, py = y + 0.5;
+            RasterVertex* v = shadedCorners;
+            f64 area = (f64)(v[1].x - v[0].x) * (v[2].y - v[0].y) - (f64)(v[1].y - v[0].y) * (v[2].x - v[0].x);
+            f64 w0 = ((v[2].x - v[1].x) * (py - v[1].y) - (v[2].y - v[1].y) * (px - v[1].x)) / area;
+            f64 w1 = ((v[0].x - v[2].x) * (py - v[2].y) - (v[0].y - v[2].y) * (px - v[2].x)) / area;
+            f64 w2 = 1 - w0 - w1;
+            if(w0 < 0.01 || w1 < 0.01 || w2 < 0.01) {
+                continue; // near an edge the fixed point corners decide, not the exact ones
+            }
+
+            for(u32 shift = 0; shift < 32; shift += 8) {
+                f64 exact = w0 * ((v[0].color >> shift) & 0xFF) + w1 * ((v[1].color >> shift) & 0xFF) + w2 * ((v[2].color >> shift) & 0xFF);
+                int32 got = (row[x] >> shift) & 0xFF;
+                u32 error = (u32)fabs(got - exact + 0.0);
+                worst = error > worst ? error : worst;
+            }
+        }
+    }
+    if(worst > 1) {
+        printf("shaded triangle is %u levels off the exact blend\n", worst);
+        ok = false;
+    }
+
+    // tiles: drawing through any clip gives the same pixels as one pass, render commands included
+    const u32 POLYGON_COUNT = 64;
+    RasterVertex* polygons = (RasterVertex*)malloc(POLYGON_COUNT * 4 * sizeof(RasterVertex));
+    for(u32 i = 0; i < POLYGON_COUNT; i++) {
+        f32 size = 4.0f + (f32)(BenchRandom(&seed) % 200);
+        MakeRotatedQuad(polygons + i * 4, (f32)(BenchRandom(&seed) % (buffer.width + 100)) - 50.0f,
+                        (f32)(BenchRandom(&seed) % (buffer.height + 100)) - 50.0f, size, size * 0.5f,
+                        (BenchRandom(&seed) % 1000) * 0.00628f, BenchRandom(&seed) | 0xFF000000);
+    }
+
+    Color32 black = {};
+    black.packed = 0xFF000000;
+    BenchRasterFill(&reference, black.packed);
+    for(u32 i = 0; i < POLYGON_COUNT; i++) {
+        Color32 color;
+        color.packed = polygons[i * 4].color;
+        DrawConvexPolygon(&reference, whole, polygons + i * 4, (i & 3) == 3 ? 3 : 4, color, i & 1);
+    }
+
+    u64 groupMemorySize = 1024 * 1024;
+    void* groupMemory = malloc(groupMemorySize);
+    MemoryArena groupArena;
+    InitializeArena(&groupArena, groupMemory, groupMemorySize);
+
+    RenderGroup* group = BeginRenderGroup(&groupArena, &buffer, MAX_RENDER_COMMANDS);
+    PushClear(group, LAYER_BACKGROUND, black);
+    for(u32 i = 0; i < POLYGON_COUNT; i++) {
+        Color32 color;
+        color.packed = polygons[i * 4].color;
+        PushPolygon(group, LAYER_PLAYER, polygons + i * 4, (i & 3) == 3 ? 3 : 4, color, i & 1);
+    }
+    EndRenderGroup(group);
+
+    // an odd tile size, so tile edges cut every step width
+    const int32 TILE = 37;
+    for(int32 y = 0; y < buffer.height; y += TILE) {
+        for(int32 x = 0; x < buffer.width; x += TILE) {
+            Rect32 tile = { x, y, x + TILE, y + TILE };
+            for(u32 i = 0; i < group->commandCount; i++) {
+                if(!IsEmpty(Intersect(tile, group->commands[i].bounds))) {
+                    ExecuteRenderCommand(&buffer, Intersect(tile, whole), group->commands + i);
+                }
+            }
+        }
+    }
+    if(!BenchBuffersMatch(&reference, &buffer)) {
+        printf("polygons drawn tile by tile differ from one pass\n");
+        ok = false;
+    }
+
+    // fill rate: triangles of one size scattered over the buffer, flat and shaded, against the scalar output
+    struct RasterCase {
+        const char* name;
+        f32 size;
+        u32 count;
+    };
+
+    RasterCase cases[] = {
+        { "tiny 4px",    4.0f,   8192 },
+        { "small 16px",  16.0f,  4096 },
+        { "medium 64px", 64.0f,  1024 },
+        { "large 256px", 256.0f, 128  },
+    };
+
+    RasterVertex* triangles = (RasterVertex*)malloc(8192 * 3 * sizeof(RasterVertex));
+
+    printf("%-12s %-7s %-7s %12s %12s %12s\n", "triangles", "color", "kernel", "frame ms", "Mpixels/s", "box filled");
+
+    for(RasterCase& test : cases) {
+        for(u32 i = 0; i < test.count * 3; i += 3) {
+            f32 x = (f32)(BenchRandom(&seed) % buffer.width);
+            f32 y = (f32)(BenchRandom(&seed) % buffer.height);
+            for(u32 j = 0; j < 3; j++) {
+                triangles[i + j].x = x + (BenchRandom(&seed) % 1024) * test.size / 1024.0f;
+                triangles[i + j].y = y + (BenchRandom(&seed) % 1024) * test.size / 1024.0f;
+                triangles[i + j].color = BenchRandom(&seed) | 0xFF000000;
+            }
+        }
+
+        u64 covered = 0;
+        for(u32 i = 0; i < test.count; i++) {
+            RasterTriangle triangle;
+            if(SetupRasterTriangle(&triangle, triangles + i * 3, triangles + i * 3 + 1, triangles + i * 3 + 2, 0, false)) {
+                covered += BenchCoveredPixels(&triangle, whole);
+            }
+        }
+
+        for(int shaded = 0; shaded < 2; shaded++) {
+            BenchRasterFill(&reference, 0);
+            u64 boxed = BenchRasterScene(&reference, whole, triangles, test.count, shaded, RasterSpan_Scalar);
+
+            for(RasterKernel& kernel : kernels) {
+                if(kernel.avx2 && !hasAVX2) {
+                    continue;
+                }
+
+                BenchTimer timer = {};
+                for(int r = 0; r < REPEATS; r++) {
+                    BenchRasterFill(&buffer, 0);
+                    BenchBegin(&timer);
+                    BenchRasterScene(&buffer, whole, triangles, test.count, shaded, kernel.span);
+                    BenchEnd(&timer);
+                }
+
+                if(!BenchBuffersMatch(&reference, &buffer)) {
+                    printf("%s: %s %s triangles differ from the scalar kernel\n", kernel.name, test.name, shaded ? "shaded" : "flat");
+                    ok = false;
+                }
+
+                // box filled: drawn pixels over pixels in the bounding boxes, the rest is stepped over
+                printf("%-12s %-7s %-7s %12.4f %12.1f %11.1f%%\n", test.name, shaded ? "vertex" : "flat", kernel.name,
+                       timer.best, covered / (timer.best * 1000.0), 100.0 * covered / (boxed ? boxed : 1));
+            }
+        }
+    }
+
+    free(triangles);
+    free(groupMemory);
+    free(polygons);
+    free(coverage);
+    free(mesh);
+    free(reference.data);
+    free(buffer.data);
+    return ok;
+}
+
+
+// ---------------------------------------------------------------------------------
+// Entities
+// ---------------------------------------------------------------------------------
+
+// a store in its own malloc'd block, returned for the caller to free
+void*
+BenchCreateEntityStore(EntityStore* store, u32 capacity) {
+    u64 size = (u64)capacity * 64 + 4096;
+    void* memory = malloc(size);
+    MemoryArena arena;
+    InitializeArena(&arena, memory, size);
+    InitializeEntityStore(store, &arena, capacity, 0, 0, ENTITY_AREA_SIZE, ENTITY_AREA_SIZE);
+    return memory;
+}
+
+// some start outside the area, some are frozen, speeds are big enough that plenty bounce every step
+void
+BenchSpawnEntities(EntityStore* store, u32 count, u32 seed) {
+    for(u32 i = 0; i < count; i++) {
+        f32 x = (f32)(BenchRandom(&seed) % 600) - 40.0f + (BenchRandom(&seed) % 256) / 256.0f;
+        f32 y = (f32)(BenchRandom(&seed) % 600) - 40.0f + (BenchRandom(&seed) % 256) / 256.0f;
+        f32 velocityX = (f32)(BenchRandom(&seed) % 4001) - 2000.0f;
+        f32 velocityY = (f32)(BenchRandom(&seed) % 4001) - 2000.0f;
+        u32 flags = BenchRandom(&seed) % 16 == 0 ? ENTITY_FROZEN : 0;
+        CreateEntity(store, x, y, velocityX, velocityY, BenchRandom(&seed) | 0xFF000000, flags);
+    }
+}
+
+bool
+BenchEntityStoresMatch(EntityStore* a, EntityStore* b) {
+    u64 floats = a->count * sizeof(f32);
+    return a->count == b->count && memcmp(a->x, b->x, floats) == 0 && memcmp(a->y, b->y, floats) == 0 &&
+           memcmp(a->velocityX, b->velocityX, floats) == 0 && memcmp(a->velocityY, b->velocityY, floats) == 0 &&
+           memcmp(a->flags, b->flags, a->count * sizeof(u32)) == 0;
+}
+
+bool
+Bench_Entities(HeadlessOptions* options) {
+    const u32 ENTITY_COUNT = 100000;
+    const int REPEATS = 50;
+    const f32 STEP = (f32)(1.0 / GAME_UPDATE_HZ);
+
+    u32 seed = 0x1F123BB5;
+    bool ok = true;
+
+    struct EntityKernel {
+        const char* name;
+        UpdateEntitiesFunc* update;
+        bool avx2;
+    };
+
+    EntityKernel kernels[] = {
+        { "scalar", UpdateEntities_Scalar, false },
+        { "sse2",   UpdateEntities_SSE2,   false },
+        { "avx2",   UpdateEntities_AVX2,   true  },
+    };
+    bool hasAVX2 = QueryCpuFeatures().avx2;
+
+    // handles: the store fills up, stale ids stop resolving, slots come back with a new generation,
+    // and after every removal the dense arrays hold exactly the live entities
+    const u32 SMALL_CAPACITY = 64;
+    EntityStore small;
+    void* smallMemory = BenchCreateEntityStore(&small, SMALL_CAPACITY);
+
+    EntityId ids[SMALL_CAPACITY];
+    for(u32 i = 0; i < SMALL_CAPACITY; i++) {
+        ids[i] = CreateEntity(&small, (f32)i, 0, 0, 0, i, 0);
+    }
+    if(CreateEntity(&small, 0, 0, 0, 0, 0, 0).value != 0 || IsEntityAlive(&small, {}) || small.count != SMALL_CAPACITY) {
+        printf("a full store handed out an entity\n");
+        ok = false;
+    }
+
+    bool alive[SMALL_CAPACITY];
+    for(u32 i = 0; i < SMALL_CAPACITY; i++) {
+        alive[i] = true;
+    }
+
+    for(u32 round = 0; round < 1000; round++) {
+        u32 pick = BenchRandom(&seed) % SMALL_CAPACITY;
+        EntityId old = ids[pick];
+
+        if(alive[pick]) {
+            DestroyEntity(&small, old);
+            DestroyEntity(&small, old); // twice is harmless
+            alive[pick] = false;
+        } else {
+            ids[pick] = CreateEntity(&small, (f32)pick, 0, 0, 0, pick, 0);
+            alive[pick] = true;
+            if(ids[pick].value == old.value || IsEntityAlive(&small, old)) {
+                printf("a reused slot kept its old id %08X\n", old.value);
+                ok = false;
+            }
+        }
+
+        u32 liveCount = 0;
+        for(u32 i = 0; i < SMALL_CAPACITY; i++) {
+            u32 index = GetEntityIndex(&small, ids[i]);
+            if((index != ENTITY_NONE) != alive[i] || (alive[i] && (index >= small.count || small.color[index] != i ||
+                                                                    small.x[index] != (f32)i))) {
+                printf("id %08X resolves to the wrong entity after %u changes\n", ids[i].value, round);
+                ok = false;
+                round = 1000;
+                break;
+            }
+            liveCount += alive[i];
+        }
+        if(liveCount != small.count) {
+            printf("store counts %u entities, %u are alive\n", small.count, liveCount);
+            ok = false;
+            break;
+        }
+    }
+    free(smallMemory);
+
+    // every kernel moves, bounces and flags exactly like the scalar one. an odd count leaves a partial last step
+    const u32 CHECK_COUNT = 10007;
+    EntityStore reference;
+    void* referenceMemory = BenchCreateEntityStore(&reference, CHECK_COUNT);
+    BenchSpawnEntities(&reference, CHECK_COUNT, seed);
+    for(int step = 0; step < 30; step++) {
+        UpdateEntities_Scalar(&reference, STEP);
+    }
+
+    for(EntityKernel& kernel : kernels) {
+        if(kernel.avx2 && !hasAVX2) {
+            continue;
+        }
+
+        EntityStore store;
+        void* storeMemory = BenchCreateEntityStore(&store, CHECK_COUNT);
+        BenchSpawnEntities(&store, CHECK_COUNT, seed);
+        for(int step = 0; step < 30; step++) {
+            kernel.update(&store, STEP);
+        }
+
+        if(!BenchEntityStoresMatch(&reference, &store)) {
+            printf("%s: entities differ from the scalar kernel\n", kernel.name);
+            ok = false;
+        }
+        free(storeMemory);
+    }
+    free(referenceMemory);
+
+    // the game itself: GameUpdate with a full store and no sound to mix
+    GameMemory memory = {};
+    memory.permanentSize = 1024 * 1024 * 64;
+    memory.transientSize = 1024 * 1024 * 1;
+    memory.permanent = calloc(1, memory.permanentSize);
+    memory.transient = calloc(1, memory.transientSize);
+    memory.permanentCommitted = memory.permanentSize; // heap memory is backed whole, the arena never commits
+
+    GameInit(&memory);
+    GameState* state = (GameState*)memory.permanent;
+    BenchSpawnEntities(&state->entities, ENTITY_COUNT, seed);
+
+    GameInput input = {};
+    SoundBuffer soundBuffer = {};
+
+    u32 frozen = 0;
+    for(u32 i = 0; i < state->entities.count; i++) {
+        frozen += (state->entities.flags[i] & ENTITY_FROZEN) != 0;
+    }
+    printf("%u entities, %u frozen\n", state->entities.count, frozen);
+    printf("%-7s %14s %12s %14s\n", "kernel", "GameUpdate ms", "kernel ms", "ns/entity");
+
+    for(EntityKernel& kernel : kernels) {
+        if(kernel.avx2 && !hasAVX2) {
+            continue;
+        }
+
+        UpdateEntities = kernel.update;
+
+        BenchTimer game = {};
+        for(int r = 0; r < REPEATS; r++) {
+            BenchBegin(&game);
+            GameUpdate(&memory, input, &soundBuffer, STEP);
+            BenchEnd(&game);
+        }
+
+        BenchTimer update = {};
+        for(int r = 0; r < REPEATS; r++) {
+            BenchBegin(&update);
+            UpdateEntities(&state->entities, STEP);
+            BenchEnd(&update);
+        }
+
+        printf("%-7s %14.4f %12.4f %14.2f\n", kernel.name, game.best, update.best, update.best * 1000000.0 / ENTITY_COUNT);
+    }
+
+    // the entity grid: the first query after an update builds it, and finds what a look at every entity finds
+    const u32 MAX_NEAR = 256;
+    u32 near[MAX_NEAR];
+    f32 queryX = ENTITY_AREA_SIZE / 2, queryY = ENTITY_AREA_SIZE / 2, queryRadius = 8;
+
+    BenchTimer firstQuery = {};
+    BenchTimer query = {};
+    u32 found = 0;
+    for(int r = 0; r < REPEATS; r++) {
+        GameUpdate(&memory, input, &soundBuffer, STEP);
+
+        BenchBegin(&firstQuery);
+        found = QueryEntitiesNear(state, queryX, queryY, queryRadius, near, MAX_NEAR);
+        BenchEnd(&firstQuery);
+
+        BenchBegin(&query);
+        QueryEntitiesNear(state, queryX, queryY, queryRadius, near, MAX_NEAR);
+        BenchEnd(&query);
+    }
+
+    f32 reach = queryRadius + ENTITY_RADIUS;
+    u32 expected = 0;
+    for(u32 i = 0; i < state->entities.count; i++) {
+        f32 dx = state->entities.x[i] - queryX, dy = state->entities.y[i] - queryY;
+        expected += dx * dx + dy * dy <= reach * reach;
+    }
+    if(found != expected) {
+        printf("entity grid found %u entities near %.0f %.0f, there are %u\n", found, queryX, queryY, expected);
+        ok = false;
+    }
+    printf("entity grid: first query after an update %.4f ms, the next %.4f ms, %u found\n", firstQuery.best, query.best, found);
+
+    InitEntityKernels();
+    GameSuspend(&memory);
+    free(memory.transient);
+    free(memory.permanent);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------------
+// Spatial
+// ---------------------------------------------------------------------------------
+
+int
+BenchCompareU32(const void* a, const void* b) {
+    u32 x = *(u32*)a, y = *(u32*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+int
+BenchComparePairs(const void* a, const void* b) {
+    SpatialPair* x = (SpatialPair*)a;
+    SpatialPair* y = (SpatialPair*)b;
+    if(x->a != y->a) {
+        return x->a < y->a ? -1 : 1;
+    }
+    return x->b < y->b ? -1 : (x->b > y->b ? 1 : 0);
+}
+
+// every object against every later one, the loop the grid replaces
+u32
+BenchNaivePairs(f32* x, f32* y, u32 count, f32 radius, SpatialPair* pairs, u32 maxPairs) {
+    f32 reachSquared = radius * radius * 4;
+    u32 found = 0;
+    for(u32 i = 0; i < count; i++) {
+        for(u32 j = i + 1; j < count; j++) {
+            f32 dx = x[j] - x[i];
+            f32 dy = y[j] - y[i];
+            if(dx * dx + dy * dy <= reachSquared) {
+                if(found < maxPairs) {
+                    pairs[found].a = i;
+                    pairs[found].b = j;
+                }
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+// a few percent of the objects outside the area, where the edge cells take them
+void
+BenchScatterObjects(f32* x, f32* y, u32 count, f32 size, u32 seed) {
+    for(u32 i = 0; i < count; i++) {
+        x[i] = (BenchRandom(&seed) % 65536) * (size + 40) / 65536.0f - 20;
+        y[i] = (BenchRandom(&seed) % 65536) * (size + 40) / 65536.0f - 20;
+    }
+}
+
+// results of a query, sorted, against the same question asked of every object
+bool
+BenchQueryMatches(u32* results, u32 found, u32 maxResults, u32* expected, u32 expectedCount) {
+    if(found != expectedCount || found > maxResults) {
+        return false;
+    }
+    qsort(results, found, sizeof(u32), BenchCompareU32);
+    return memcmp(results, expected, found * sizeof(u32)) == 0;
+}
+
+bool
+Bench_Spatial(HeadlessOptions* options) {
+    const u32 OBJECT_COUNT = 50000;
+    const u32 CHECK_COUNT = 5000;
+    const u32 MAX_PAIRS = 4 * 1024 * 1024;
+    const int REPEATS = 20;
+    const f32 AREA = ENTITY_AREA_SIZE;
+
+    u32 seed = 0x7A3C2F11;
+    bool ok = true;
+
+    u64 gridMemorySize = 16 * 1024 * 1024;
+    void* gridMemory = malloc(gridMemorySize);
+
+    f32* x = (f32*)malloc(OBJECT_COUNT * sizeof(f32));
+    f32* y = (f32*)malloc(OBJECT_COUNT * sizeof(f32));
+    SpatialPair* pairs = (SpatialPair*)malloc(MAX_PAIRS * sizeof(SpatialPair));
+    SpatialPair* expectedPairs = (SpatialPair*)malloc(MAX_PAIRS * sizeof(SpatialPair));
+    u32* results = (u32*)malloc(OBJECT_COUNT * sizeof(u32));
+    u32* expected = (u32*)malloc(OBJECT_COUNT * sizeof(u32));
+
+    struct SpatialCase {
+        f32 radius;
+        f32 cellSize;
+    };
+
+    // the cell at its smallest and at a few times that, where each cell holds more objects
+    SpatialCase cases[] = {
+        { 1.0f, 2.0f }, { 2.0f, 4.0f }, { 2.0f, 16.0f }, { 4.0f, 8.0f },
+    };
+
+    // pairs and queries find exactly what asking every object finds
+    BenchScatterObjects(x, y, CHECK_COUNT, AREA, seed);
+    for(SpatialCase& test : cases) {
+        MemoryArena arena;
+        InitializeArena(&arena, gridMemory, gridMemorySize);
+        SpatialGrid grid;
+        InitializeSpatialGrid(&grid, &arena, CHECK_COUNT, 0, 0, AREA, AREA, test.cellSize);
+        f32 radius = test.radius;
+        BuildSpatialGrid(&grid, x, y, CHECK_COUNT, radius);
+
+        u32 found = FindSpatialGridPairs(&grid, pairs, MAX_PAIRS);
+        u32 expectedCount = BenchNaivePairs(x, y, CHECK_COUNT, radius, expectedPairs, MAX_PAIRS);
+        qsort(pairs, found < MAX_PAIRS ? found : MAX_PAIRS, sizeof(SpatialPair), BenchComparePairs);
+        if(found != expectedCount || memcmp(pairs, expectedPairs, found * sizeof(SpatialPair)) != 0) {
+            printf("radius %.1f cell %.1f: grid found %u pairs, every object against every other %u\n", radius, test.cellSize,
+                   found, expectedCount);
+            ok = false;
+        }
+
+        // a short pair buffer gets the first pairs the full one does, and the count of all of them
+        const u32 SHORT_PAIRS = 1001;
+        u32 shortFound = FindSpatialGridPairs(&grid, expectedPairs, SHORT_PAIRS);
+        found = FindSpatialGridPairs(&grid, pairs, MAX_PAIRS);
+        u32 compared = found < SHORT_PAIRS ? found : SHORT_PAIRS;
+        if(shortFound != found || memcmp(pairs, expectedPairs, compared * sizeof(SpatialPair)) != 0) {
+            printf("radius %.1f: %u pairs with room for %u, %u with room for all\n", radius, shortFound, SHORT_PAIRS, found);
+            ok = false;
+        }
+
+        for(u32 q = 0; q < 200; q++) {
+            f32 qx = (BenchRandom(&seed) % 600) - 40.0f;
+            f32 qy = (BenchRandom(&seed) % 600) - 40.0f;
+            f32 qw = (f32)(BenchRandom(&seed) % 100);
+            f32 qh = (f32)(BenchRandom(&seed) % 100);
+
+            u32 count = 0;
+            for(u32 i = 0; i < CHECK_COUNT; i++) {
+                f32 dx = x[i] < qx ? qx - x[i] : (x[i] > qx + qw ? x[i] - qx - qw : 0);
+                f32 dy = y[i] < qy ? qy - y[i] : (y[i] > qy + qh ? y[i] - qy - qh : 0);
+                if(dx * dx + dy * dy <= radius * radius) {
+                    expected[count++] = i;
+                }
+            }
+            u32 rectFound = QuerySpatialGridRect(&grid, qx, qy, qx + qw, qy + qh, results, OBJECT_COUNT);
+            if(!BenchQueryMatches(results, rectFound, OBJECT_COUNT, expected, count)) {
+                printf("radius %.1f: rect query found %u objects, expected %u\n", radius, rectFound, count);
+                ok = false;
+                break;
+            }
+
+            f32 reach = qw / 2 + radius;
+            count = 0;
+            for(u32 i = 0; i < CHECK_COUNT; i++) {
+                f32 dx = x[i] - qx;
+                f32 dy = y[i] - qy;
+                if(dx * dx + dy * dy <= reach * reach) {
+                    expected[count++] = i;
+                }
+            }
+            u32 radiusFound = QuerySpatialGridRadius(&grid, qx, qy, qw / 2, results, OBJECT_COUNT);
+            if(!BenchQueryMatches(results, radiusFound, OBJECT_COUNT, expected, count)) {
+                printf("radius %.1f: radius query found %u objects, expected %u\n", radius, radiusFound, count);
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    // broadphase at full size: building the grid plus finding the pairs, against the naive loop once
+    BenchScatterObjects(x, y, OBJECT_COUNT, AREA, seed);
+
+    printf("%u objects in %.0f x %.0f\n", OBJECT_COUNT, AREA, AREA);
+    printf("%-7s %-7s %10s %10s %10s %10s %12s\n", "radius", "cell", "pairs", "build ms", "pairs ms", "total ms", "naive ms");
+
+    for(u32 c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        SpatialCase& test = cases[c];
+
+        MemoryArena arena;
+        InitializeArena(&arena, gridMemory, gridMemorySize);
+        SpatialGrid grid;
+        InitializeSpatialGrid(&grid, &arena, OBJECT_COUNT, 0, 0, AREA, AREA, test.cellSize);
+
+        BenchTimer build = {};
+        BenchTimer find = {};
+        BenchTimer total = {};
+        u32 found = 0;
+        for(int r = 0; r < REPEATS; r++) {
+            BenchBegin(&total);
+            BenchBegin(&build);
+            BuildSpatialGrid(&grid, x, y, OBJECT_COUNT, test.radius);
+            BenchEnd(&build);
+            BenchBegin(&find);
+            found = FindSpatialGridPairs(&grid, pairs, MAX_PAIRS);
+            BenchEnd(&find);
+            BenchEnd(&total);
+        }
+
+        // quadratic, a second or so. once is enough to show the gap
+        char naive[32] = "-";
+        if(c == 1) {
+            BenchTimer timer = {};
+            BenchBegin(&timer);
+            u32 expectedCount = BenchNaivePairs(x, y, OBJECT_COUNT, test.radius, expectedPairs, MAX_PAIRS);
+            BenchEnd(&timer);
+            snprintf(naive, sizeof(naive), "%.1f", timer.best);
+
+            if(expectedCount != found) {
+                printf("grid found %u pairs of %u objects, the naive loop %u\n", found, OBJECT_COUNT, expectedCount);
+                ok = false;
+            }
+        }
+
+        printf("%-7.1f %-7.1f %10u %10.4f %10.4f %10.4f %12s\n", test.radius, test.cellSize, found, build.best, find.best,
+               total.best, naive);
+    }
+
+    free(expected);
+    free(results);
+    free(expectedPairs);
+    free(pairs);
+    free(y);
+    free(x);
+    free(gridMemory);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------------
+// Particles
+// ---------------------------------------------------------------------------------
+
+// a pool in its own malloc'd block over the buffer, returned for the caller to free
+void*
+BenchCreateParticlePool(ParticlePool* pool, u32 capacity, GraphicsBuffer* buffer) {
+    u64 size = (u64)capacity * 64 + 1024 * 1024;
+    void* memory = malloc(size);
+    MemoryArena arena;
+    InitializeArena(&arena, memory, size);
+    InitializeParticlePool(pool, &arena, capacity, 0, 0, (f32)buffer->width, (f32)buffer->height);
+    pool->accelerationY = -200;
+    return memory;
+}
+
+void
+BenchCopyParticles(ParticlePool* dest, ParticlePool* source) {
+    u32 count = source->count;
+    memcpy(dest->x, source->x, count * sizeof(f32));
+    memcpy(dest->y, source->y, count * sizeof(f32));
+    memcpy(dest->velocityX, source->velocityX, count * sizeof(f32));
+    memcpy(dest->velocityY, source->velocityY, count * sizeof(f32));
+    memcpy(dest->life, source->life, count * sizeof(f32));
+    memcpy(dest->color, source->color, count * sizeof(u32));
+    memcpy(dest->fade, source->fade, count * sizeof(u32));
+    dest->count = count;
+    dest->version++;
+}
+
+bool
+BenchParticlesMatch(ParticlePool* a, ParticlePool* b) {
+    u64 bytes = a->count * sizeof(f32);
+    return a->count == b->count && memcmp(a->x, b->x, bytes) == 0 && memcmp(a->y, b->y, bytes) == 0 &&
+           memcmp(a->velocityX, b->velocityX, bytes) == 0 && memcmp(a->velocityY, b->velocityY, bytes) == 0 &&
+           memcmp(a->life, b->life, bytes) == 0 && memcmp(a->color, b->color, bytes) == 0 &&
+           memcmp(a->fade, b->fade, bytes) == 0;
+}
+
+// particles scattered over the buffer, living long enough to last a benchmark
+void
+BenchScatterParticles(ParticlePool* pool, u32 count, GraphicsBuffer* buffer, u32 seed) {
+    for(u32 i = 0; i < count; i++) {
+        f32 x = (BenchRandom(&seed) % 65536) * buffer->width / 65536.0f;
+        f32 y = (BenchRandom(&seed) % 65536) * buffer->height / 65536.0f;
+        f32 velocityX = (f32)(BenchRandom(&seed) % 201) - 100.0f;
+        f32 velocityY = (f32)(BenchRandom(&seed) % 201) - 100.0f;
+        SpawnParticle(pool, x, y, velocityX, velocityY, 1000.0f, BenchRandom(&seed) & 0x3F3F3F3F, 0x01010101);
+    }
+}
+
+// every pixel of every live particle, added one channel at a time
+void
+BenchSplatReference(GraphicsBuffer* buffer, ParticlePool* pool) {
+    for(u32 i = 0; i < pool->count; i++) {
+        int32 px = (int32)pool->x[i];
+        int32 py = (int32)pool->y[i];
+        for(int32 y = py; y < py + PARTICLE_SPLAT_SIZE && y < buffer->height; y++) {
+            for(int32 x = px; x < px + PARTICLE_SPLAT_SIZE && x < buffer->width; x++) {
+                u32* pixel = (u32*)(buffer->data + (u64)y * buffer->bytesPerRow) + x;
+                u32 result = 0;
+                for(u32 shift = 0; shift < 32; shift += 8) {
+                    u32 channel = ((*pixel >> shift) & 0xFF) + ((pool->color[i] >> shift) & 0xFF);
+                    result |= (channel > 255 ? 255 : channel) << shift;
+                }
+                *pixel = result;
+            }
+        }
+    }
+}
+
+bool
+Bench_Particles(HeadlessOptions* options) {
+    const u32 PARTICLE_COUNT = 200000;
+    const int REPEATS = 20;
+    const f32 STEP = (f32)(1.0 / GAME_UPDATE_HZ);
+
+    u32 seed = 0x4D2B79F5;
+    bool ok = true;
+
+    struct ParticleKernel {
+        const char* name;
+        UpdateParticlesFunc* update;
+        bool avx2;
+    };
+
+    ParticleKernel kernels[] = {
+        { "scalar", UpdateParticles_Scalar, false },
+        { "sse2",   UpdateParticles_SSE2,   false },
+        { "avx2",   UpdateParticles_AVX2,   true  },
+    };
+    bool hasAVX2 = QueryCpuFeatures().avx2;
+
+    GraphicsBuffer reference = BenchCreateBuffer(options->width, options->height);
+    GraphicsBuffer buffer = BenchCreateBuffer(options->width, options->height);
+    Rect32 whole = BufferRect(&buffer);
+
+    // compaction: every third particle dies, the rest keep their order. an odd count leaves a partial last step
+    const u32 ORDER_COUNT = 1003;
+    for(ParticleKernel& kernel : kernels) {
+        if(kernel.avx2 && !hasAVX2) {
+            continue;
+        }
+
+        ParticlePool pool;
+        void* poolMemory = BenchCreateParticlePool(&pool, ORDER_COUNT, &buffer);
+        for(u32 i = 0; i < ORDER_COUNT; i++) {
+            SpawnParticle(&pool, 1.0f + i % 100, 200.0f, 0, 0, i % 3 == 1 ? STEP / 2 : 10.0f, i, 0);
+        }
+        kernel.update(&pool, STEP);
+
+        bool kept = pool.count == ORDER_COUNT - (ORDER_COUNT + 1) / 3;
+        for(u32 i = 0, expect = 0; kept && i < pool.count; i++, expect++) {
+            expect += expect % 3 == 1;
+            kept = pool.color[i] == expect;
+        }
+        if(!kept) {
+            printf("%s: survivors out of order or missing, %u of %u left\n", kernel.name, pool.count, ORDER_COUNT);
+            ok = false;
+        }
+        free(poolMemory);
+    }
+
+    // emitters outside the area, like one at the mouse cursor off the window, spawn nothing and binning stays in bounds
+    {
+        ParticlePool pool;
+        void* poolMemory = BenchCreateParticlePool(&pool, 1000, &buffer);
+        f32 outside[][2] = {
+            { -400.0f, 300.0f }, { -0.5f, 10.0f }, { 10.0f, -0.5f }, { (f32)buffer.width, 10.0f },
+            { 10.0f, (f32)buffer.height }, { 1e9f, -1e9f }, { NAN, 10.0f },
+        };
+        for(u32 e = 0; e < sizeof(outside) / sizeof(outside[0]); e++) {
+            ParticleEmitter emitter = {};
+            emitter.x = outside[e][0];
+            emitter.y = outside[e][1];
+            emitter.rate = 1000 / STEP;
+            emitter.speed = 100.0f;
+            emitter.life = 1.0f;
+            emitter.color = 0x00FFFFFF;
+            emitter.seed = seed + e;
+            EmitParticles(&pool, &emitter, STEP);
+        }
+        BinParticles(&pool);
+        DrawParticles(&buffer, whole, &pool);
+        if(pool.count != 0) {
+            printf("%u particles spawned outside the area\n", pool.count);
+            ok = false;
+        }
+        free(poolMemory);
+    }
+
+    // every kernel moves, fades and kills exactly like the scalar one, emitters spawning all along
+    ParticlePool expected;
+    void* expectedMemory = BenchCreateParticlePool(&expected, PARTICLE_COUNT, &buffer);
+
+    for(ParticleKernel& kernel : kernels) {
+        if(kernel.avx2 && !hasAVX2) {
+            continue;
+        }
+
+        ParticlePool pool;
+        void* poolMemory = BenchCreateParticlePool(&pool, PARTICLE_COUNT, &buffer);
+
+        ParticleEmitter emitters[3] = {};
+        for(u32 e = 0; e < 3; e++) {
+            emitters[e].x = buffer.width * (e + 1) / 4.0f;
+            emitters[e].y = buffer.height / 2.0f;
+            emitters[e].rate = 20000;
+            emitters[e].speed = 100.0f + 150.0f * e;
+            emitters[e].life = 0.5f + 0.5f * e;
+            emitters[e].color = 0x20406080 >> e;
+            emitters[e].seed = seed + e;
+        }
+
+        for(int step = 0; step < 90; step++) {
+            kernel.update(&pool, STEP);
+            for(ParticleEmitter& emitter : emitters) {
+                EmitParticles(&pool, &emitter, STEP);
+            }
+        }
+
+        if(&kernel == kernels) {
+            BenchCopyParticles(&expected, &pool);
+        } else if(!BenchParticlesMatch(&expected, &pool)) {
+            printf("%s: %u particles differ from the scalar kernel's %u\n", kernel.name, pool.count, expected.count);
+            ok = false;
+        }
+        free(poolMemory);
+    }
+
+    for(u32 i = 0; i < expected.count; i++) {
+        if(!(expected.life[i] > 0) || expected.x[i] < 0 || expected.x[i] >= buffer.width || expected.y[i] < 0 ||
+           expected.y[i] >= buffer.height) {
+            printf("particle %u is dead or outside the area and still in the pool\n", i);
+            ok = false;
+            break;
+        }
+    }
+
+    // splats: one pass and tile by tile both add up to the per channel reference
+    BenchRasterFill(&reference, 0xFF101010);
+    BenchSplatReference(&reference, &expected);
+
+    BenchRasterFill(&buffer, 0xFF101010);
+    BinParticles(&expected);
+    DrawParticles(&buffer, whole, &expected);
+    if(!BenchBuffersMatch(&reference, &buffer)) {
+        printf("particles differ from the per channel reference\n");
+        ok = false;
+    }
+
+    Rect32 bounds = { INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN };
+    for(u32 i = 0; i < expected.count; i++) {
+        int32 x = (int32)expected.x[i], y = (int32)expected.y[i];
+        bounds.minX = x < bounds.minX ? x : bounds.minX;
+        bounds.minY = y < bounds.minY ? y : bounds.minY;
+        bounds.maxX = x + PARTICLE_SPLAT_SIZE > bounds.maxX ? x + PARTICLE_SPLAT_SIZE : bounds.maxX;
+        bounds.maxY = y + PARTICLE_SPLAT_SIZE > bounds.maxY ? y + PARTICLE_SPLAT_SIZE : bounds.maxY;
+    }
+    Rect32 binned = ParticleBounds(&expected);
+    if(binned.minX != bounds.minX || binned.minY != bounds.minY || binned.maxX != bounds.maxX || binned.maxY != bounds.maxY) {
+        printf("particle bounds %d %d %d %d, the particles cover %d %d %d %d\n", binned.minX, binned.minY, binned.maxX,
+               binned.maxY, bounds.minX, bounds.minY, bounds.maxX, bounds.maxY);
+        ok = false;
+    }
+
+    const int32 TILE = 37;
+    BenchRasterFill(&buffer, 0xFF101010);
+    for(int32 y = 0; y < buffer.height; y += TILE) {
+        for(int32 x = 0; x < buffer.width; x += TILE) {
+            Rect32 tile = { x, y, x + TILE, y + TILE };
+            DrawParticles(&buffer, tile, &expected);
+        }
+    }
+    if(!BenchBuffersMatch(&reference, &buffer)) {
+        printf("particles drawn tile by tile differ from one pass\n");
+        ok = false;
+    }
+
+    // a frame's work at full size: the update, then binning and drawing
+    ParticlePool start;
+    ParticlePool pool;
+    void* startMemory = BenchCreateParticlePool(&start, PARTICLE_COUNT, &buffer);
+    void* poolMemory = BenchCreateParticlePool(&pool, PARTICLE_COUNT, &buffer);
+    BenchScatterParticles(&start, PARTICLE_COUNT, &buffer, seed);
+
+    printf("%u particles, %d x %d\n", start.count, buffer.width, buffer.height);
+    printf("%-7s %10s %10s %10s %10s %10s\n", "kernel", "update ms", "ns/part", "bin ms", "draw ms", "frame ms");
+
+    for(ParticleKernel& kernel : kernels) {
+        if(kernel.avx2 && !hasAVX2) {
+            continue;
+        }
+
+        BenchTimer update = {};
+        BenchTimer bin = {};
+        BenchTimer draw = {};
+        for(int r = 0; r < REPEATS; r++) {
+            BenchCopyParticles(&pool, &start);
+            BenchRasterFill(&buffer, 0xFF000000);
+
+            BenchBegin(&update);
+            kernel.update(&pool, STEP);
+            BenchEnd(&update);
+
+            BenchBegin(&bin);
+            BinParticles(&pool);
+            BenchEnd(&bin);
+
+            BenchBegin(&draw);
+            DrawParticles(&buffer, whole, &pool);
+            BenchEnd(&draw);
+        }
+
+        printf("%-7s %10.4f %10.2f %10.4f %10.4f %10.4f\n", kernel.name, update.best, update.best * 1000000.0 / PARTICLE_COUNT,
+               bin.best, draw.best, update.best + bin.best + draw.best);
+    }
+
+    free(poolMemory);
+    free(startMemory);
+    free(expectedMemory);
+    free(reference.data);
+    free(buffer.data);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------------
+// Tilemap
+// ---------------------------------------------------------------------------------
+
+// a map in its own malloc'd block with random tiles from a 16 color palette, returned for the caller to free
+void*
+BenchCreateTilemap(Tilemap* map, int32 chunksX, int32 chunksY, u32 slotCount, u32 seed) {
+    u64 size = (u64)chunksX * chunksY * sizeof(TilemapChunk) +
+               (u64)slotCount * (TILEMAP_CHUNK_PIXELS * TILEMAP_CHUNK_PIXELS * sizeof(u32) + 64) + 64 * 1024;
+    void* memory = malloc(size);
+    MemoryArena arena;
+    InitializeArena(&arena, memory, size);
+    InitializeTilemap(map, &arena, chunksX, chunksY, slotCount);
+
+    for(u32 tile = 0; tile < 16; tile++) {
+        SetTileColor(map, (u8)tile, BenchRandom(&seed));
+    }
+    for(int32 y = 0; y < chunksY * TILEMAP_CHUNK_TILES; y++) {
+        for(int32 x = 0; x < chunksX * TILEMAP_CHUNK_TILES; x++) {
+            SetTile(map, x, y, (u8)(BenchRandom(&seed) % 16));
+        }
+    }
+    return memory;
+}
+
+// the per tile way: one DrawRectangle for every tile on screen
+void
+BenchTilemapReference(GraphicsBuffer* buffer, Tilemap* map, int32 xPos, int32 yPos) {
+    Rect32 visible = Intersect(BufferRect(buffer), TilemapBounds(map, xPos, yPos));
+    if(IsEmpty(visible)) {
+        return;
+    }
+
+    for(int32 tileY = (visible.minY - yPos) / TILEMAP_TILE_SIZE; tileY <= (visible.maxY - 1 - yPos) / TILEMAP_TILE_SIZE; tileY++) {
+        for(int32 tileX = (visible.minX - xPos) / TILEMAP_TILE_SIZE; tileX <= (visible.maxX - 1 - xPos) / TILEMAP_TILE_SIZE; tileX++) {
+            Color32 color;
+            color.packed = map->palette[GetTile(map, tileX, tileY)];
+            DrawRectangle(buffer, visible, xPos + tileX * TILEMAP_TILE_SIZE, yPos + tileY * TILEMAP_TILE_SIZE,
+                          TILEMAP_TILE_SIZE, TILEMAP_TILE_SIZE, color);
+        }
+    }
+}
+
+bool
+Bench_Tilemap(HeadlessOptions* options) {
+    const int32 WORLD_CHUNKS = 32; // 8192 pixels each way
+    const int REPEATS = 50;
+    const u32 BACKGROUND = 0xFF202020;
+
+    u32 seed = 0x2545F491;
+    bool ok = true;
+
+    GraphicsBuffer reference = BenchCreateBuffer(options->width, options->height);
+    GraphicsBuffer buffer = BenchCreateBuffer(options->width, options->height);
+    Rect32 whole = BufferRect(&buffer);
+
+    // a screen can straddle one more chunk than fits across it, both ways
+    int32 screenChunksX = (buffer.width + TILEMAP_CHUNK_PIXELS - 1) / TILEMAP_CHUNK_PIXELS + 1;
+    int32 screenChunksY = (buffer.height + TILEMAP_CHUNK_PIXELS - 1) / TILEMAP_CHUNK_PIXELS + 1;
+    u32 slotCount = screenChunksX * screenChunksY + 8;
+    int32 worldPixels = WORLD_CHUNKS * TILEMAP_CHUNK_PIXELS;
+
+    Tilemap map;
+    void* mapMemory = BenchCreateTilemap(&map, WORLD_CHUNKS, WORLD_CHUNKS, slotCount, seed);
+
+    u64 groupMemorySize = 1024 * 1024;
+    void* groupMemory = malloc(groupMemorySize);
+    MemoryArena groupArena;
+    InitializeArena(&groupArena, groupMemory, groupMemorySize);
+
+    // the cached copies match a rect per tile, scrolled to odd offsets, past the edges and in one pass or tile by tile
+    struct TilemapOffset {
+        int32 x, y;
+    };
+    TilemapOffset offsets[] = {
+        { 0, 0 }, { -13, -5 }, { -1000, -777 }, { 100, 60 }, { -(worldPixels - 100), -(worldPixels - 50) },
+        { -TILEMAP_CHUNK_PIXELS, -3 * TILEMAP_CHUNK_PIXELS },
+    };
+    for(TilemapOffset& offset : offsets) {
+        BenchRasterFill(&reference, BACKGROUND);
+        BenchTilemapReference(&reference, &map, offset.x, offset.y);
+
+        BenchRasterFill(&buffer, BACKGROUND);
+        PrepareTilemap(&map, whole, offset.x, offset.y);
+        DrawTilemap(&buffer, whole, &map, offset.x, offset.y);
+        if(!BenchBuffersMatch(&reference, &buffer)) {
+            printf("tilemap at %d %d differs from a rect per tile\n", offset.x, offset.y);
+            ok = false;
+        }
+
+        // through a render group: the clear under a map that covers the buffer is culled
+        ResetArena(&groupArena);
+        RenderGroup* group = BeginRenderGroup(&groupArena, &buffer, MAX_RENDER_COMMANDS);
+        Color32 background;
+        background.packed = BACKGROUND;
+        PushClear(group, LAYER_BACKGROUND, background);
+        PushTilemap(group, LAYER_BACKGROUND, &map, offset.x, offset.y);
+        EndRenderGroup(group);
+
+        bool covers = Contains(TilemapBounds(&map, offset.x, offset.y), whole);
+        if(group->commandCount != (covers ? 1u : 2u)) {
+            printf("tilemap at %d %d left %u commands\n", offset.x, offset.y, group->commandCount);
+            ok = false;
+        }
+
+        const int32 TILE = 37;
+        BenchRasterFill(&buffer, 0);
+        for(int32 y = 0; y < buffer.height; y += TILE) {
+            for(int32 x = 0; x < buffer.width; x += TILE) {
+                Rect32 tile = Intersect({ x, y, x + TILE, y + TILE }, whole);
+                for(u32 i = 0; i < group->commandCount; i++) {
+                    ExecuteRenderCommand(&buffer, tile, group->commands + i);
+                }
+            }
+        }
+        if(!BenchBuffersMatch(&reference, &buffer)) {
+            printf("tilemap at %d %d drawn tile by tile differs from a rect per tile\n", offset.x, offset.y);
+            ok = false;
+        }
+    }
+
+    // an edit rasterizes only its own chunk again, a tile set to what it already is changes nothing
+    {
+        int32 x = -300, y = -200;
+        PrepareTilemap(&map, whole, x, y);
+
+        u32 version = map.version;
+        SetTile(&map, 20, 20, GetTile(&map, 20, 20));
+        if(map.version != version) {
+            printf("setting a tile to its own value changed the map\n");
+            ok = false;
+        }
+
+        for(int32 i = 0; i < 5; i++) {
+            SetTile(&map, 20 + i, 20 + i, (u8)((GetTile(&map, 20 + i, 20 + i) + 1) % 16));
+        }
+
+        TilemapStats before = map.stats;
+        BenchRasterFill(&reference, BACKGROUND);
+        BenchTilemapReference(&reference, &map, x, y);
+        BenchRasterFill(&buffer, BACKGROUND);
+        PrepareTilemap(&map, whole, x, y);
+        DrawTilemap(&buffer, whole, &map, x, y);
+
+        if(map.stats.rebuilds - before.rebuilds != 1 || map.stats.misses != before.misses) {
+            printf("an edit in one chunk rebuilt %llu and missed %llu\n", (unsigned long long)(map.stats.rebuilds - before.rebuilds),
+                   (unsigned long long)(map.stats.misses - before.misses));
+            ok = false;
+        }
+        if(!BenchBuffersMatch(&reference, &buffer)) {
+            printf("edited tilemap differs from a rect per tile\n");
+            ok = false;
+        }
+    }
+
+    // scrolling one way, every chunk is rasterized once, when it first comes into view
+    {
+        const int32 STEP = 7;
+        u8* seen = (u8*)calloc(WORLD_CHUNKS * WORLD_CHUNKS, 1);
+        u32 seenCount = 0;
+
+        SetTileColor(&map, 0, map.palette[0] ^ 0x00010101); // drops the whole cache
+        map.stats = {};
+
+        u32 frames = 0;
+        for(int32 scroll = 0; scroll + buffer.width <= worldPixels && scroll + buffer.height <= worldPixels; scroll += STEP) {
+            PrepareTilemap(&map, whole, -scroll, -scroll / 2);
+            frames++;
+
+            for(int32 chunkY = (scroll / 2) / TILEMAP_CHUNK_PIXELS; chunkY <= (scroll / 2 + buffer.height - 1) / TILEMAP_CHUNK_PIXELS; chunkY++) {
+                for(int32 chunkX = scroll / TILEMAP_CHUNK_PIXELS; chunkX <= (scroll + buffer.width - 1) / TILEMAP_CHUNK_PIXELS; chunkX++) {
+                    u8* chunkSeen = seen + chunkY * WORLD_CHUNKS + chunkX;
+                    seenCount += !*chunkSeen;
+                    *chunkSeen = 1;
+                }
+            }
+        }
+
+        TilemapStats stats = map.stats;
+        printf("scrolling %u frames: %llu hits, %llu misses, %llu evictions, %.1f%% hit rate, %u chunks seen\n", frames,
+               (unsigned long long)stats.hits, (unsigned long long)stats.misses, (unsigned long long)stats.evictions,
+               100.0 * stats.hits / (stats.hits + stats.misses), seenCount);
+        if(stats.misses != seenCount || stats.rebuilds != 0) {
+            printf("scrolling missed %llu times for %u chunks\n", (unsigned long long)stats.misses, seenCount);
+            ok = false;
+        }
+
+        // back and forth over what fits in the cache, nothing is rasterized after the first pass
+        map.stats = {};
+        for(int32 pass = 0; pass < 4; pass++) {
+            for(int32 scroll = 0; scroll < TILEMAP_CHUNK_PIXELS * 8 / 10; scroll += STEP) {
+                int32 x = pass & 1 ? -(TILEMAP_CHUNK_PIXELS * 8 / 10 - scroll) : -scroll;
+                PrepareTilemap(&map, whole, x, 0);
+            }
+            if(pass == 0) {
+                map.stats.misses = 0;
+            }
+        }
+        if(map.stats.misses != 0) {
+            printf("scrolling back over cached chunks missed %llu times\n", (unsigned long long)map.stats.misses);
+            ok = false;
+        }
+
+        free(seen);
+    }
+
+    // a frame's worth of map: a rect per tile against copies out of the cache, warm and cold, and a plain buffer copy
+    BenchTimer perTile = {};
+    BenchTimer cached = {};
+    BenchTimer cold = {};
+    BenchTimer copy = {};
+    for(int r = 0; r < REPEATS; r++) {
+        int32 x = -(r * 37 % (worldPixels - buffer.width));
+        int32 y = -(r * 23 % (worldPixels - buffer.height));
+
+        BenchBegin(&perTile);
+        BenchTilemapReference(&reference, &map, x, y);
+        BenchEnd(&perTile);
+
+        PrepareTilemap(&map, whole, x, y);
+        BenchBegin(&cached);
+        PrepareTilemap(&map, whole, x, y);
+        DrawTilemap(&buffer, whole, &map, x, y);
+        BenchEnd(&cached);
+
+        SetTileColor(&map, 0, map.palette[0] ^ 0x00010101);
+        BenchBegin(&cold);
+        PrepareTilemap(&map, whole, x, y);
+        DrawTilemap(&buffer, whole, &map, x, y);
+        BenchEnd(&cold);
+
+        BenchBegin(&copy);
+        memcpy(buffer.data, reference.data, (u64)buffer.height * buffer.bytesPerRow);
+        BenchEnd(&copy);
+    }
+
+    f64 pixels = (f64)buffer.width * buffer.height;
+    printf("%d x %d over a %d x %d world, %u cache slots\n", buffer.width, buffer.height, worldPixels, worldPixels, slotCount);
+    printf("%-10s %10s %10s\n", "path", "ms", "ns/pixel");
+    printf("%-10s %10.4f %10.3f\n", "per tile", perTile.best, perTile.best * 1000000.0 / pixels);
+    printf("%-10s %10.4f %10.3f\n", "cached", cached.best, cached.best * 1000000.0 / pixels);
+    printf("%-10s %10.4f %10.3f\n", "cold", cold.best, cold.best * 1000000.0 / pixels);
+    printf("%-10s %10.4f %10.3f\n", "copy", copy.best, copy.best * 1000000.0 / pixels);
+
+    free(groupMemory);
+    free(mapMemory);
+    free(reference.data);
+    free(buffer.data);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------------
+// Text
+// ---------------------------------------------------------------------------------
+
+// one pixel at a time straight from the glyph bits, the same layout as DrawString
+void
+BenchStringReference(GraphicsBuffer* buffer, BitmapFont* font, const char text[], int32 xPos, int32 yPos, u32 color) {
+    int32 x = xPos, top = yPos;
+    for(const char* at = text; *at; at++) {
+        if(*at == '\n') {
+            x = xPos;
+            top -= font->lineHeight;
+            continue;
+        }
+
+        u32 glyph = (u8)*at - font->firstChar;
+        for(int32 r = 0; glyph < font->glyphCount && r < font->glyphHeight; r++) {
+            for(int32 i = 0; i < font->glyphWidth; i++) {
+                int32 px = x + i, py = top - 1 - r;
+                if((font->glyphs[glyph * font->glyphHeight + r] >> i) & 1 && px >= 0 && px < buffer->width && py >= 0 && py < buffer->height) {
+                    ((u32*)(buffer->data + (u64)py * buffer->bytesPerRow))[px] = color;
+                }
+            }
+        }
+        x += font->advance;
+    }
+}
+
+bool
+Bench_Text(HeadlessOptions* options) {
+    const int REPEATS = 200;
+    const u32 BACKGROUND = 0xFF102030;
+    const u32 TEXT_COLOR = 0xFFFFFFFF;
+
+    bool ok = true;
+
+    GraphicsBuffer reference = BenchCreateBuffer(options->width, options->height);
+    GraphicsBuffer buffer = BenchCreateBuffer(options->width, options->height);
+    Rect32 whole = BufferRect(&buffer);
+
+    BitmapFont font = BuiltinFont();
+
+    // every printable character, a few lines of it
+    char charset[256];
+    u32 length = 0;
+    for(u32 c = ' '; c <= '~'; c++) {
+        charset[length++] = (char)c;
+        if(c % 32 == 31) {
+            charset[length++] = '\n';
+        }
+    }
+    charset[length] = 0;
+
+    // inside, straddling every edge of the buffer and entirely off it
+    struct TextPlace {
+        int32 x, y;
+    };
+    TextPlace places[] = {
+        { 10, buffer.height - 10 }, { -13, buffer.height + 5 }, { buffer.width - 100, 20 }, { 3, 9 },
+        { -1000, 100 }, { 50, -50 },
+    };
+    for(TextPlace& place : places) {
+        BenchRasterFill(&reference, BACKGROUND);
+        BenchStringReference(&reference, &font, charset, place.x, place.y, TEXT_COLOR);
+
+        BenchRasterFill(&buffer, BACKGROUND);
+        DrawString(&buffer, whole, &font, charset, place.x, place.y, TEXT_COLOR);
+        if(!BenchBuffersMatch(&reference, &buffer)) {
+            printf("text at %d %d differs from the per pixel reference\n", place.x, place.y);
+            ok = false;
+        }
+
+        const int32 TILE = 37;
+        BenchRasterFill(&buffer, BACKGROUND);
+        for(int32 y = 0; y < buffer.height; y += TILE) {
+            for(int32 x = 0; x < buffer.width; x += TILE) {
+                Rect32 tile = { x, y, x + TILE, y + TILE };
+                DrawString(&buffer, tile, &font, charset, place.x, place.y, TEXT_COLOR);
+            }
+        }
+        if(!BenchBuffersMatch(&reference, &buffer)) {
+            printf("text at %d %d drawn tile by tile differs from one pass\n", place.x, place.y);
+            ok = false;
+        }
+    }
+
+    Rect32 bounds = StringBounds(&font, "ab\ncdef\n", 10, 100);
+    if(bounds.minX != 10 || bounds.maxX != 10 + 4 * font.advance || bounds.maxY != 100 ||
+       bounds.minY != 100 - (2 * font.lineHeight + font.glyphHeight)) {
+        printf("string bounds %d %d %d %d\n", bounds.minX, bounds.minY, bounds.maxX, bounds.maxY);
+        ok = false;
+    }
+
+    // a sheet of the built in glyphs, 16 cells across with some ink below half alpha, cuts back out to the same masks
+    LoadedBitmap sheet = {};
+    sheet.width = 16 * 8;
+    sheet.height = 6 * 8;
+    sheet.pitch = sheet.width;
+    sheet.pixels = (u32*)calloc((u64)sheet.width * sheet.height, sizeof(u32));
+    for(u32 glyph = 0; glyph < font.glyphCount; glyph++) {
+        for(int32 r = 0; r < 8; r++) {
+            u32* row = sheet.pixels + (u64)(sheet.height - 1 - (glyph / 16) * 8 - r) * sheet.pitch + (glyph % 16) * 8;
+            for(int32 i = 0; i < 8; i++) {
+                row[i] = (font.glyphs[glyph * 8 + r] >> i) & 1 ? 0xFFFFFFFF : 0x7F7F7F7F;
+            }
+        }
+    }
+
+    u64 arenaSize = 64 * 1024;
+    void* arenaMemory = malloc(arenaSize);
+    MemoryArena arena;
+    InitializeArena(&arena, arenaMemory, arenaSize);
+
+    BitmapFont loaded;
+    if(!LoadBitmapFont(&arena, &sheet, 8, 8, ' ', font.glyphCount, &loaded) ||
+       memcmp(loaded.glyphs, font.glyphs, font.glyphCount * 8) != 0) {
+        printf("font cut from a sheet differs from the built in one\n");
+        ok = false;
+    }
+    if(LoadBitmapFont(&arena, &sheet, 9, 8, ' ', 10, &loaded) || LoadBitmapFont(&arena, &sheet, 8, 8, ' ', 97, &loaded)) {
+        printf("a font with glyphs too wide or more glyphs than cells loaded\n");
+        ok = false;
+    }
+
+    // an overlay's worth: lines of stats like the engine's, several hundred characters
+    char overlay[2048];
+    u32 at = 0;
+    u32 characters = 0;
+    for(u32 line = 0; line < 16; line++) {
+        int written = snprintf(overlay + at, sizeof(overlay) - at, "zone %2u %8.3fms %6u calls %5.1f%%\n", line, line * 0.137,
+                               line * 97 + 3, line * 6.25);
+        at += written;
+        characters += written - 1;
+    }
+
+    BenchTimer timer = {};
+    for(int r = 0; r < REPEATS; r++) {
+        BenchBegin(&timer);
+        DrawString(&buffer, whole, &font, overlay, 8, buffer.height - 8, TEXT_COLOR);
+        BenchEnd(&timer);
+    }
+    printf("%u characters in %.4fms, %.1f ns each\n", characters, timer.best, timer.best * 1000000.0 / characters);
+
+    free(arenaMemory);
+    free(sheet.pixels);
+    free(reference.data);
+    free(buffer.data);
+    return ok;
+}
+
+Benchmark Benchmarks[] = {
+    { "fill", Bench_Fill },
+    { "tiles", Bench_Tiles },
+    { "mixer", Bench_Mixer },
+    { "audio", Bench_Audio },
+    { "pacing", Bench_Pacing },
+    { "io", Bench_Io },
+    { "blit", Bench_Blit },
+    { "atlas", Bench_Atlas },
+    { "dirty", Bench_Dirty },
+    { "scale", Bench_Scale },
+    { "raster", Bench_Raster },
+    { "entities", Bench_Entities },
+    { "spatial", Bench_Spatial },
+    { "particles", Bench_Particles },
+    { "tilemap", Bench_Tilemap },
+    { "text", Bench_Text },
+};
+
+bool
+Headless_RunBenchmark(HeadlessOptions* options) {
+    for(Benchmark& benchmark : Benchmarks) {
+        if(strcmp(benchmark.name, options->bench) == 0) {
+            return benchmark.run(options);
+        }
+    }
+
+    printf("unknown benchmark: %s\n", options->bench);
+    return false;
+}
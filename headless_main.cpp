@@ -0,0 +1,1063 @@
+// headless platform layer
+// runs the game without a window or sound device so frames can be profiled on linux build boxes
+// build: g++ -O2 -g headless_main.cpp -o headless -lpthread
+
+// os includes
+#include <fcntl.h>     // open
+#include <sys/stat.h>  // fstat
+#include <unistd.h>    // read, write, close
+#include <time.h>      // clock_gettime
+#include <pthread.h>   // worker threads
+#include <semaphore.h> // work queue wakeups
+#include <sys/mman.h>  // mmap
+
+#include <cstdio>    // printf
+#include <cstdlib>   // malloc, qsort
+#include <cstring>   // memcmp, strcmp
+#include "cstdint"   // uint32_t
+#include "math.h"    // sinf
+
+// write to the null pointer to halt the program
+#define assert(expression) if(!(expression)) (*(int *) 0 = 0)
+
+// typedefs
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int8_t int8;
+typedef int16_t int16;
+typedef int32_t int32;
+typedef int64_t int64;
+
+typedef float f32;
+typedef double f64;
+
+const float PI = 3.14159265358;
+
+#include "main.h"
+
+// game includes
+// must come after typedefs
+#include "game.h"
+#include "game.cpp"
+
+#include "engine_replay.h"
+#include "engine_audio.h"
+#include "engine_pacing.h"
+#include "engine_io.h"
+#include "engine_scale.h"
+#include "engine_memory.h"
+
+struct WorkQueueEntry {
+    WorkQueueCallback* callback;
+    void* data;
+};
+
+const u32 WORK_QUEUE_CAPACITY = 512;
+const u32 IO_THREAD_COUNT = 2;
+
+struct WorkQueue {
+    u32 volatile completionGoal;
+    u32 volatile completionCount;
+    
+    u32 volatile nextEntryToWrite;
+    u32 volatile nextEntryToRead;
+    
+    sem_t semaphore;
+    WorkQueueEntry entries[WORK_QUEUE_CAPACITY];
+};
+
+struct HeadlessReplay {
+    ReplayMode mode;
+    int file;
+    ReplayHeader header;
+    
+    // playback maps the whole file
+    u8* view;
+    u64 viewSize;
+    RecordedFrame* frames;
+    u64 playIndex;
+    u32 loopCount;
+};
+
+// in-memory stand-in for the window's graphics buffer
+struct HeadlessGraphicsBuffer {
+    int width, height;
+    int bytesPerPixel;
+    int bytesPerRow;
+    u8* data;
+};
+
+// per phase timings, in milliseconds, one entry per frame
+struct HeadlessTimings {
+    int count;
+    f64* update;
+    f64* render;
+    f64* audio;
+};
+
+struct HeadlessOptions {
+    int frames;
+    int width, height;
+    int threads; // including the main thread
+    const char* bench;
+    const char* record;
+    const char* replay;
+    const char* profile; // chrome trace written at the end, profiling is off without it
+
+    // every stallEvery frames, one frame takes stallMs longer. shows what a hitch does to the audio
+    int stallEvery;
+    int stallMs;
+
+    // simulated device cursors, in ms: how far the play cursor jumps at a time, how far ahead the write cursor sits
+    int cursorStepMs;
+    int writeGapMs;
+};
+
+// forward declarations
+u64 Headless_GetNanoseconds();
+f64 Headless_MillisecondsSince(u64 startNanoseconds);
+
+void Headless_CreateGraphicsBuffer(HeadlessGraphicsBuffer* buffer, int width, int height);
+void Headless_ScriptInput(int frame, GameInput* input);
+void Headless_SleepMicroseconds(u32 microseconds);
+u64 Headless_ClockNow(PacingClock* clock);
+f64 Headless_MeasureCycleRate();
+void Headless_ClockSleep(PacingClock* clock, u32 milliseconds);
+void* Headless_AudioThreadProc(void* param);
+
+void Headless_CreateWorkQueue(WorkQueue* queue, u32 threadCount);
+
+bool Headless_BeginRecording(HeadlessReplay* replay, const char path[], GameMemory* memory);
+void Headless_RecordFrame(HeadlessReplay* replay, GameInput* input, f32 dt);
+void Headless_EndRecording(HeadlessReplay* replay);
+bool Headless_BeginPlayback(HeadlessReplay* replay, const char path[], GameMemory* memory);
+void Headless_PlaybackFrame(HeadlessReplay* replay, GameMemory* memory, GameInput* input, f32* dt);
+void Headless_EndPlayback(HeadlessReplay* replay);
+int Headless_ProcessorCount();
+
+void Headless_ReportTimings(const char name[], f64* samples, int count);
+bool Headless_ParseOptions(int argc, char** argv, HeadlessOptions* options);
+
+// consts
+const int BYTES_PER_PIXEL = 4;
+
+const int BUFFER_WIDTH = 512;
+const int BUFFER_HEIGHT = 512;
+
+// the game still thinks in screen coordinates for the mouse
+const int SCREEN_WIDTH = 1024;
+const int SCREEN_HEIGHT = 1024;
+
+// 2 TB, well away from anything the loader or the heap would pick
+const u64 GAME_MEMORY_BASE = 2ull * 1024 * 1024 * 1024 * 1024;
+
+const f64 TARGET_FRAMERATE = 60.0;
+
+const u32 SAMPLES_PER_SECOND = 48000;
+const u32 AUDIO_RING_FRAMES = 16384;                  // about 340 ms, a power of two
+const u32 AUDIO_TARGET_FILL = SAMPLES_PER_SECOND / 20; // where the ring starts, the latency controller takes it from there
+
+#include "headless_bench.cpp"
+
+int
+main(int argc, char** argv) {
+    HeadlessOptions options = {};
+    options.frames = 600;
+    options.width = BUFFER_WIDTH;
+    options.height = BUFFER_HEIGHT;
+    options.threads = Headless_ProcessorCount();
+
+    if(!Headless_ParseOptions(argc, argv, &options)) {
+        printf("usage: headless [--frames N] [--size WxH] [--threads N] [--record file | --replay file] [--stall everyN:ms] [--cursor stepMs:gapMs] [--profile trace.json] [--bench fill|tiles|mixer|audio|pacing|io|blit|atlas|dirty|scale|raster|entities|spatial|particles|tilemap|text]\n");
+        return 1;
+    }
+
+    if(options.bench) {
+        return Headless_RunBenchmark(&options) ? 0 : 1;
+    }
+
+    ProfileNameThread("main");
+    if(options.profile) {
+        ProfileSetCycleRate(Headless_MeasureCycleRate());
+        ProfileSetEnabled(true);
+    }
+
+    // engine allocations
+    HeadlessGraphicsBuffer graphicsBuffer;
+    Headless_CreateGraphicsBuffer(&graphicsBuffer, options.width, options.height);
+
+    // the game writes at most a ring's worth of stereo samples per frame
+    int16* soundMemory = (int16*)calloc(AUDIO_RING_FRAMES, sizeof(int16) * 2);
+
+    // simulated device on its own audio thread, its clock follows the simulated frame times
+    static SimulatedAudioDevice audioDevice;
+    InitializeSimulatedAudioDevice(&audioDevice, SAMPLES_PER_SECOND, options.cursorStepMs * SAMPLES_PER_SECOND / 1000,
+                                   options.writeGapMs * SAMPLES_PER_SECOND / 1000, Headless_SleepMicroseconds);
+
+    static AudioOutput audioOutput;
+    int16* audioRingMemory = (int16*)calloc(AUDIO_RING_FRAMES, sizeof(int16) * 2);
+    InitializeAudioOutput(&audioOutput, &audioDevice.device, audioRingMemory, AUDIO_RING_FRAMES, AUDIO_TARGET_FILL);
+
+    pthread_t audioThread;
+    pthread_create(&audioThread, 0, Headless_AudioThreadProc, &audioOutput);
+    SyncSimulatedAudioDevice(&audioDevice); // the device fills its write-ahead with silence before the game's first frame
+
+    // one thread is the main thread, which helps out while it waits on the queue
+    static WorkQueue renderQueue;
+    Headless_CreateWorkQueue(&renderQueue, options.threads - 1);
+
+    // one thread for slow jobs like streaming reads, so they never hold up a render join
+    static WorkQueue backgroundQueue;
+    Headless_CreateWorkQueue(&backgroundQueue, 1);
+    
+    // io threads for the game's async reads. they mostly wait on the disk, a couple keep requests queued on it
+    static WorkQueue ioQueue;
+    Headless_CreateWorkQueue(&ioQueue, IO_THREAD_COUNT);
+    InitializeFileReads(&ioQueue);
+    
+    // game allocations, reserved at a fixed address and committed as the game grows into them
+    u64 gamePermanentSize = 1024 * 1024 * 64; // 64 MB
+    u64 gameTransientSize = 1024 * 1024 * 1;  // 1 MB
+    GameMemory gameMemory = {};
+    GameMemoryLayout memoryLayout;
+    if(!ReserveGameMemory(&gameMemory, GAME_MEMORY_BASE, gamePermanentSize, gameTransientSize, &memoryLayout)) {
+        printf("error reserving game memory at %llx\n", (unsigned long long)GAME_MEMORY_BASE);
+        return 1;
+    }
+    
+    gameMemory.renderQueue = options.threads > 1 ? &renderQueue : 0;
+    gameMemory.backgroundQueue = &backgroundQueue;
+
+    HeadlessTimings timings = {};
+    timings.update = (f64*)calloc(options.frames, sizeof(f64));
+    timings.render = (f64*)calloc(options.frames, sizeof(f64));
+    timings.audio = (f64*)calloc(options.frames, sizeof(f64));
+
+    GameInput gameInput = {};
+
+    GameInit(&gameMemory);
+    
+    HeadlessReplay replay = {};
+    if(options.record && !Headless_BeginRecording(&replay, options.record, &gameMemory)) {
+        return 1;
+    }
+    if(options.replay && !Headless_BeginPlayback(&replay, options.replay, &gameMemory)) {
+        return 1;
+    }
+
+    // simulated time: every frame is exactly on target unless it is a stall, the loop never sleeps.
+    // the pacer only turns frame time into fixed update steps here
+    PacingClock clock = {};
+    clock.ticksPerSecond = 1000000000; // nanoseconds
+    clock.now = Headless_ClockNow;
+    clock.sleep = Headless_ClockSleep;
+    clock.canSleep = true;
+    
+    FramePacer pacer;
+    InitializeFramePacer(&pacer, &clock, TARGET_FRAMERATE, GAME_UPDATE_HZ);
+    f32 stepSeconds = PacerStepSeconds(&pacer);
+    
+    u64 elapsedTicks = pacer.stepTicks; // the first frame runs one update, so there is something to render
+    f64 samplesOwed = 0;
+    f32 secondsSinceAudio = 0;
+    u32 updateSteps = 0;
+
+    RenderStats renderTotals = {};
+    u64 redrawnPixels = 0;
+    
+    u64 runStart = Headless_GetNanoseconds();
+
+    for(int frame = 0; frame < options.frames; frame++) {
+        ProfileBeginFrame();
+        
+        // [input]
+        PROFILE_BEGIN(inputZone, "input");
+        DispatchFileReads(); // reads queued behind the in flight budget move on even when the game isn't polling
+        Headless_ScriptInput(frame, &gameInput);
+        
+        // the last frame's time turns into update steps
+        u32 steps = BeginFrameSteps(&pacer, elapsedTicks);
+        secondsSinceAudio += (f32)TicksToSeconds(&clock, elapsedTicks);
+        
+        u64 frameTicks = pacer.frameTicks;
+        if(options.stallEvery > 0 && (frame % options.stallEvery) == options.stallEvery - 1) {
+            frameTicks += SecondsToTicks(&clock, options.stallMs / 1000.0);
+        }
+        
+        PROFILE_END(inputZone);
+        
+        // [update]
+        // audio goes out with the frame's last step, so it is still once a frame however many steps there are
+        PROFILE_BEGIN(updateZone, "update");
+        u64 phaseStart = Headless_GetNanoseconds();
+        timings.audio[frame] = 0;
+        
+        for(u32 step = 0; step < steps; step++) {
+            bool lastStep = (step == steps - 1);
+            
+            // recording keeps every step, playback replaces them one by one
+            GameInput stepInput = gameInput;
+            f32 dt = stepSeconds;
+            if(replay.mode == Replay_Recording) {
+                Headless_RecordFrame(&replay, &stepInput, dt);
+            } else if(replay.mode == Replay_Playing) {
+                Headless_PlaybackFrame(&replay, &gameMemory, &stepInput, &dt);
+            }
+            
+            // the game tops the ring up to its target, the audio thread drains it
+            SoundBuffer gameSoundBuffer = {};
+            gameSoundBuffer.samplesPerSecond = SAMPLES_PER_SECOND;
+            gameSoundBuffer.samples = soundMemory;
+            if(lastStep) {
+                UpdateAudioLatency(&audioOutput, secondsSinceAudio);
+                secondsSinceAudio = 0;
+                gameSoundBuffer.numSamplesToWrite = AudioOutputFramesWanted(&audioOutput);
+            }
+            
+            GameUpdate(&gameMemory, stepInput, &gameSoundBuffer, dt);
+            updateSteps++;
+            
+            if(lastStep) {
+                PROFILE_ZONE("sound");
+                u64 audioStart = Headless_GetNanoseconds();
+                AudioOutputWrite(&audioOutput, gameSoundBuffer.samples, gameSoundBuffer.numSamplesToWrite);
+                timings.audio[frame] = Headless_MillisecondsSince(audioStart);
+            }
+        }
+        timings.update[frame] = Headless_MillisecondsSince(phaseStart) - timings.audio[frame];
+        PROFILE_END(updateZone);
+
+        // [render]
+        GraphicsBuffer gameGraphicsBuffer = {};
+        gameGraphicsBuffer.width           = graphicsBuffer.width;
+        gameGraphicsBuffer.height          = graphicsBuffer.height;
+        gameGraphicsBuffer.bytesPerPixel   = graphicsBuffer.bytesPerPixel;
+        gameGraphicsBuffer.bytesPerRow     = graphicsBuffer.bytesPerRow;
+        gameGraphicsBuffer.data            = graphicsBuffer.data;
+
+        PROFILE_BEGIN(renderZone, "render");
+        phaseStart = Headless_GetNanoseconds();
+        GameRender(&gameMemory, &gameGraphicsBuffer, PacerInterpolation(&pacer));
+        timings.render[frame] = Headless_MillisecondsSince(phaseStart);
+        PROFILE_END(renderZone);
+        
+        // drawn like the window would show it, so its cost is in the numbers. the game paints over it next frame
+        Rect32 overlay = ProfileDrawOverlay(&gameGraphicsBuffer, (f32)TicksToSeconds(&clock, pacer.frameTicks));
+        AddDirtyRect(&gameMemory.overdrawn, overlay);
+
+        timings.count++;
+        
+        renderTotals.issued += gameMemory.stats.render.issued;
+        renderTotals.culled += gameMemory.stats.render.culled;
+        renderTotals.merged += gameMemory.stats.render.merged;
+        renderTotals.executed += gameMemory.stats.render.executed;
+        renderTotals.fullRedraws += gameMemory.stats.render.fullRedraws;
+        redrawnPixels += gameMemory.stats.render.redrawnPixels;
+        
+        // [present]
+        // the frame's simulated time passes, the device plays that much of what is queued
+        PROFILE_ZONE("present");
+        samplesOwed += SAMPLES_PER_SECOND * TicksToSeconds(&clock, frameTicks);
+        u32 samplesThisFrame = (u32)samplesOwed;
+        samplesOwed -= samplesThisFrame;
+        
+        AdvanceSimulatedAudioDevice(&audioDevice, samplesThisFrame);
+        SyncSimulatedAudioDevice(&audioDevice);
+        
+        elapsedTicks = frameTicks;
+    }
+    
+    StopAudioOutput(&audioOutput);
+    pthread_join(audioThread, 0);
+
+    f64 runMilliseconds = Headless_MillisecondsSince(runStart);
+    
+    if(replay.mode == Replay_Recording) {
+        printf("recorded %llu frames to %s\n", (unsigned long long)replay.header.frameCount, options.record);
+        Headless_EndRecording(&replay);
+    } else if(replay.mode == Replay_Playing) {
+        printf("replayed %s, %u full loops of %llu frames\n", options.replay, replay.loopCount, (unsigned long long)replay.header.frameCount);
+        Headless_EndPlayback(&replay);
+    }
+
+    printf("%d frames at %dx%d on %d threads in %.2fms\n", timings.count, graphicsBuffer.width, graphicsBuffer.height, options.threads, runMilliseconds);
+    printf("%-8s %10s %10s %10s %10s\n", "phase", "min", "median", "p99", "max");
+    Headless_ReportTimings("update", timings.update, timings.count);
+    Headless_ReportTimings("render", timings.render, timings.count);
+    Headless_ReportTimings("audio", timings.audio, timings.count);
+    printf("updates: %u fixed steps of %.2fms, %u dropped by the catch-up limit\n", updateSteps, stepSeconds * 1000.0f, pacer.droppedSteps);
+    printf("render commands: %u issued, %u culled, %u merged, %u executed\n",
+           renderTotals.issued, renderTotals.culled, renderTotals.merged, renderTotals.executed);
+    printf("dirty rects: %.1f%% of the pixels redrawn, %u of %d frames redrawn in full\n",
+           100.0 * redrawnPixels / ((f64)graphicsBuffer.width * graphicsBuffer.height * (timings.count ? timings.count : 1)),
+           renderTotals.fullRedraws, timings.count);
+    MemoryStats* memoryStats = &gameMemory.stats.memory;
+    printf("memory: permanent %llu bytes used (high water %llu), %llu committed of %llu reserved\n",
+           (unsigned long long)memoryStats->permanentUsed, (unsigned long long)memoryStats->permanentHighWater,
+           (unsigned long long)memoryStats->permanentCommitted, (unsigned long long)memoryStats->permanentSize);
+    printf("memory: transient high water %llu of %llu bytes per frame, %s\n",
+           (unsigned long long)memoryStats->transientHighWater, (unsigned long long)memoryStats->transientSize,
+           memoryLayout.transientLargePages ? "large pages" : "small pages");
+    AudioOutputStats audioStats = GetAudioOutputStats(&audioOutput);
+    f32 framesToMs = 1000.0f / SAMPLES_PER_SECOND;
+    printf("audio: %u samples played, checksum %016llx\n", audioStats.framesPlayed, (unsigned long long)audioDevice.checksum);
+    printf("audio: %u underruns, %u samples of silence, ring lowest %u of target %u samples (%.1fms of %.1fms)\n",
+           audioStats.underruns, audioStats.underrunFrames, audioStats.ringLowest, audioStats.targetFill,
+           audioStats.ringLowest * framesToMs, audioStats.targetFill * framesToMs);
+    printf("latency: %.1fms total, device %.1fms (cursor step %.1fms, write gap %.1fms), ring %.1fms (longest frame %.1fms)\n",
+           audioStats.totalLatencyMs, audioStats.deviceLatencyMs, audioStats.cursorStepMs, audioStats.writeGapMs,
+           audioStats.ringLatencyMs, audioStats.frameTimeMs);
+    printf("latency: %u ring near misses, %u device near misses, %u device misses\n",
+           audioStats.ringNearMisses, audioStats.deviceNearMisses, audioStats.deviceMisses);
+    printf("audio: %u voices in the last mix, %u stream underruns\n", gameMemory.stats.audio.voicesMixed, gameMemory.stats.audio.streamUnderruns);
+
+    if(options.profile) {
+        u64 capacity = ProfileChromeTraceMaxBytes();
+        char* trace = (char*)malloc(capacity);
+        u64 traceBytes = ProfileFormatChromeTrace(trace, capacity);
+        FileWriteAll(options.profile, trace, traceBytes);
+        printf("profile: %u threads, %llu bytes of trace written to %s\n", ProfileThreadCount(), (unsigned long long)traceBytes, options.profile);
+        free(trace);
+    }
+
+    free(timings.update);
+    free(timings.render);
+    free(timings.audio);
+    ReleaseGameMemory(&gameMemory, &memoryLayout);
+    free(audioRingMemory);
+    free(soundMemory);
+    free(graphicsBuffer.data);
+
+    return 0;
+}
+
+bool
+Headless_ParseOptions(int argc, char** argv, HeadlessOptions* options) {
+    for(int i = 1; i < argc; i++) {
+        bool hasValue = (i + 1) < argc;
+
+        if(strcmp(argv[i], "--frames") == 0 && hasValue) {
+            options->frames = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--size") == 0 && hasValue) {
+            if(sscanf(argv[++i], "%dx%d", &options->width, &options->height) != 2) {
+                return false;
+            }
+        } else if(strcmp(argv[i], "--threads") == 0 && hasValue) {
+            options->threads = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--record") == 0 && hasValue) {
+            options->record = argv[++i];
+        } else if(strcmp(argv[i], "--replay") == 0 && hasValue) {
+            options->replay = argv[++i];
+        } else if(strcmp(argv[i], "--stall") == 0 && hasValue) {
+            if(sscanf(argv[++i], "%d:%d", &options->stallEvery, &options->stallMs) != 2) {
+                return false;
+            }
+        } else if(strcmp(argv[i], "--cursor") == 0 && hasValue) {
+            if(sscanf(argv[++i], "%d:%d", &options->cursorStepMs, &options->writeGapMs) != 2) {
+                return false;
+            }
+        } else if(strcmp(argv[i], "--profile") == 0 && hasValue) {
+            options->profile = argv[++i];
+        } else if(strcmp(argv[i], "--bench") == 0 && hasValue) {
+            options->bench = argv[++i];
+        } else {
+            return false;
+        }
+    }
+
+    if(options->record && options->replay) {
+        return false;
+    }
+
+    return options->frames > 0 && options->width > 0 && options->height > 0 && options->threads > 0;
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Timing
+// ---------------------------------------------------------------------------------
+
+u64
+Headless_GetNanoseconds() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000000ull + (u64)now.tv_nsec;
+}
+
+f64
+Headless_MillisecondsSince(u64 startNanoseconds) {
+    return (Headless_GetNanoseconds() - startNanoseconds) / 1000000.0;
+}
+
+// pacing clock in nanoseconds
+u64
+Headless_ClockNow(PacingClock* clock) {
+    return Headless_GetNanoseconds();
+}
+
+void
+Headless_ClockSleep(PacingClock* clock, u32 milliseconds) {
+    usleep(milliseconds * 1000);
+}
+
+// cycle counter ticks per second, against the monotonic clock over a short sleep
+f64
+Headless_MeasureCycleRate() {
+    u64 startNanoseconds = Headless_GetNanoseconds();
+    u64 startCycles = ReadCycleCounter();
+    usleep(20000);
+    u64 cycles = ReadCycleCounter() - startCycles;
+    u64 nanoseconds = Headless_GetNanoseconds() - startNanoseconds;
+    return cycles * 1000000000.0 / nanoseconds;
+}
+
+int
+Headless_CompareF64(const void* a, const void* b) {
+    f64 left = *(const f64*)a;
+    f64 right = *(const f64*)b;
+    return (left > right) - (left < right);
+}
+
+void
+Headless_ReportTimings(const char name[], f64* samples, int count) {
+    if(count == 0) {
+        return;
+    }
+
+    // sort a copy so the per frame order stays intact
+    f64* sorted = (f64*)malloc(count * sizeof(f64));
+    memcpy(sorted, samples, count * sizeof(f64));
+    qsort(sorted, count, sizeof(f64), Headless_CompareF64);
+
+    int p99 = (int)(0.99 * (count - 1));
+
+    printf("%-8s %8.4fms %8.4fms %8.4fms %8.4fms\n", name, sorted[0], sorted[count / 2], sorted[p99], sorted[count - 1]);
+
+    free(sorted);
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Threads
+// ---------------------------------------------------------------------------------
+
+int
+Headless_ProcessorCount() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+void
+WorkQueueAdd(WorkQueue* queue, WorkQueueCallback* callback, void* data) {
+    // only the main thread adds, so the write index needs no atomics
+    u32 newNextEntryToWrite = (queue->nextEntryToWrite + 1) % WORK_QUEUE_CAPACITY;
+    assert(newNextEntryToWrite != __atomic_load_n(&queue->nextEntryToRead, __ATOMIC_ACQUIRE));
+    
+    WorkQueueEntry* entry = queue->entries + queue->nextEntryToWrite;
+    entry->callback = callback;
+    entry->data = data;
+    
+    __atomic_add_fetch(&queue->completionGoal, 1, __ATOMIC_RELAXED);
+    
+    // the entry has to be visible before the index that publishes it
+    __atomic_store_n(&queue->nextEntryToWrite, newNextEntryToWrite, __ATOMIC_RELEASE);
+    sem_post(&queue->semaphore);
+}
+
+// returns false when there was nothing to do
+bool
+Headless_DoNextWorkQueueEntry(WorkQueue* queue) {
+    u32 originalNextEntryToRead = __atomic_load_n(&queue->nextEntryToRead, __ATOMIC_ACQUIRE);
+    u32 newNextEntryToRead = (originalNextEntryToRead + 1) % WORK_QUEUE_CAPACITY;
+    
+    if(originalNextEntryToRead == __atomic_load_n(&queue->nextEntryToWrite, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    
+    // several threads race for the same entry, only the one that moves the read index runs it
+    if(__atomic_compare_exchange_n(&queue->nextEntryToRead, &originalNextEntryToRead, newNextEntryToRead,
+                                   false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        WorkQueueEntry entry = queue->entries[originalNextEntryToRead];
+        entry.callback(entry.data);
+        
+        __atomic_add_fetch(&queue->completionCount, 1, __ATOMIC_RELEASE);
+    }
+    
+    return true;
+}
+
+void
+WorkQueueCompleteAll(WorkQueue* queue) {
+    while(__atomic_load_n(&queue->completionCount, __ATOMIC_ACQUIRE) != queue->completionGoal) {
+        Headless_DoNextWorkQueueEntry(queue);
+    }
+    
+    queue->completionGoal = 0;
+    queue->completionCount = 0;
+}
+
+void*
+Headless_WorkerThreadProc(void* param) {
+    WorkQueue* queue = (WorkQueue*)param;
+    ProfileNameThread("worker");
+    
+    for(;;) {
+        if(!Headless_DoNextWorkQueueEntry(queue)) {
+            sem_wait(&queue->semaphore);
+        }
+    }
+    
+    return 0;
+}
+
+void
+Headless_CreateWorkQueue(WorkQueue* queue, u32 threadCount) {
+    queue->completionGoal = 0;
+    queue->completionCount = 0;
+    queue->nextEntryToWrite = 0;
+    queue->nextEntryToRead = 0;
+    
+    sem_init(&queue->semaphore, 0, 0);
+    
+    for(u32 i = 0; i < threadCount; i++) {
+        pthread_t thread;
+        pthread_create(&thread, 0, Headless_WorkerThreadProc, queue);
+        pthread_detach(thread);
+    }
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Graphics
+// ---------------------------------------------------------------------------------
+
+void
+Headless_CreateGraphicsBuffer(HeadlessGraphicsBuffer* buffer, int width, int height) {
+    buffer->width = width;
+    buffer->height = height;
+    buffer->bytesPerRow = (width*BYTES_PER_PIXEL);
+    buffer->bytesPerPixel = BYTES_PER_PIXEL;
+
+    // page aligned like VirtualAlloc, the fill kernels like aligned rows
+    buffer->data = (u8*)aligned_alloc(4096, ((width*height*BYTES_PER_PIXEL) + 4095) & ~4095);
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Input
+// ---------------------------------------------------------------------------------
+
+void
+Headless_ScriptInput(int frame, GameInput* input) {
+    // mouse circles the screen once every 4 seconds
+    f32 angle = 2.0f * PI * (frame % 240) / 240.0f;
+    input->mouseX = (int32)(SCREEN_WIDTH * (0.5f + 0.35f * cosf(angle)));
+    input->mouseY = (int32)(SCREEN_HEIGHT * (0.5f + 0.35f * sinf(angle)));
+
+    // hold each key for a while in turn, so every input path in GameUpdate runs
+    int phase = (frame / 30) % 8;
+    input->Alpha1.isDown = (phase == 0);
+    input->Alpha2.isDown = (phase == 1);
+    input->Alpha3.isDown = (phase == 2);
+    input->Up.isDown     = (phase == 3);
+    input->Down.isDown   = (phase == 4);
+    input->Left.isDown   = (phase == 5);
+    input->Right.isDown  = (phase == 6);
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Sound
+// ---------------------------------------------------------------------------------
+
+void
+Headless_SleepMicroseconds(u32 microseconds) {
+    usleep(microseconds);
+}
+
+void*
+Headless_AudioThreadProc(void* param) {
+    ProfileNameThread("audio");
+    RunAudioOutput((AudioOutput*)param);
+    return 0;
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Replay
+// ---------------------------------------------------------------------------------
+
+// written from a copy: gcc loses track of the header's size through the struct and warns about overreading it
+void
+Headless_WriteReplayHeader(HeadlessReplay* replay) {
+    ReplayHeader header = replay->header;
+    pwrite(replay->file, &header, sizeof(header), 0);
+}
+
+bool
+Headless_BeginRecording(HeadlessReplay* replay, const char path[], GameMemory* memory) {
+    replay->file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(replay->file < 0) {
+        printf("error creating recording: %s\n", path);
+        return false;
+    }
+    
+    ReplayHeader* header = &replay->header;
+    header->magic = REPLAY_MAGIC;
+    header->version = REPLAY_VERSION;
+    header->permanentSize = memory->permanentSize;
+    header->snapshotBytes = ReplaySnapshotBytes(memory);
+    header->frameOffset = REPLAY_SNAPSHOT_OFFSET + header->snapshotBytes;
+    header->frameCount = 0;
+    header->frameSize = sizeof(RecordedFrame);
+    
+    // snapshot through a shared mapping of the file, the kernel writes it back on its own time
+    if(ftruncate(replay->file, header->frameOffset) != 0) {
+        printf("error sizing recording: %s\n", path);
+        close(replay->file);
+        return false;
+    }
+    
+    void* snapshot = mmap(0, header->snapshotBytes, PROT_READ | PROT_WRITE, MAP_SHARED, replay->file, REPLAY_SNAPSHOT_OFFSET);
+    if(snapshot == MAP_FAILED) {
+        printf("error mapping recording: %s\n", path);
+        close(replay->file);
+        return false;
+    }
+    
+    GameSuspend(memory);
+    memcpy(snapshot, memory->permanent, header->snapshotBytes);
+    GameResume(memory);
+    munmap(snapshot, header->snapshotBytes);
+    
+    Headless_WriteReplayHeader(replay);
+    
+    replay->mode = Replay_Recording;
+    return true;
+}
+
+void
+Headless_RecordFrame(HeadlessReplay* replay, GameInput* input, f32 dt) {
+    RecordedFrame frame;
+    frame.input = *input;
+    frame.dt = dt;
+    
+    u64 offset = replay->header.frameOffset + replay->header.frameCount * sizeof(RecordedFrame);
+    if(pwrite(replay->file, &frame, sizeof(frame), offset) == sizeof(frame)) {
+        replay->header.frameCount++;
+    }
+}
+
+void
+Headless_EndRecording(HeadlessReplay* replay) {
+    // the frame count is only known now
+    Headless_WriteReplayHeader(replay);
+    close(replay->file);
+    
+    replay->mode = Replay_Idle;
+}
+
+void
+Headless_RestoreSnapshot(HeadlessReplay* replay, GameMemory* memory) {
+    // map the snapshot copy-on-write right over permanent memory. nothing is copied,
+    // pages are faulted in from the page cache when the game touches them
+    GameSuspend(memory);
+    void* restored = mmap(memory->permanent, replay->header.snapshotBytes, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_FIXED, replay->file, REPLAY_SNAPSHOT_OFFSET);
+    assert(restored == memory->permanent);
+    GameResume(memory);
+}
+
+bool
+Headless_BeginPlayback(HeadlessReplay* replay, const char path[], GameMemory* memory) {
+    replay->file = open(path, O_RDONLY);
+    if(replay->file < 0) {
+        printf("error opening recording: %s\n", path);
+        return false;
+    }
+    
+    struct stat fileInfo;
+    fstat(replay->file, &fileInfo);
+    
+    replay->viewSize = fileInfo.st_size;
+    replay->view = (u8*)mmap(0, replay->viewSize, PROT_READ, MAP_PRIVATE, replay->file, 0);
+    if(replay->view == MAP_FAILED) {
+        printf("error mapping recording: %s\n", path);
+        close(replay->file);
+        return false;
+    }
+    
+    replay->header = *(ReplayHeader*)replay->view;
+    ReplayHeader* header = &replay->header;
+    
+    if(!ReplayHeaderIsValid(header, memory) ||
+       header->frameOffset + header->frameCount * sizeof(RecordedFrame) > replay->viewSize) {
+        printf("recording doesn't match this build: %s\n", path);
+        munmap(replay->view, replay->viewSize);
+        close(replay->file);
+        return false;
+    }
+    
+    replay->frames = (RecordedFrame*)(replay->view + header->frameOffset);
+    replay->playIndex = 0;
+    replay->loopCount = 0;
+    
+    Headless_RestoreSnapshot(replay, memory);
+    
+    replay->mode = Replay_Playing;
+    return true;
+}
+
+void
+Headless_PlaybackFrame(HeadlessReplay* replay, GameMemory* memory, GameInput* input, f32* dt) {
+    if(replay->playIndex == replay->header.frameCount) {
+        // end of the recording, rewind and go again
+        Headless_RestoreSnapshot(replay, memory);
+        replay->playIndex = 0;
+        replay->loopCount++;
+    }
+    
+    RecordedFrame* frame = replay->frames + replay->playIndex++;
+    *input = frame->input;
+    *dt = frame->dt;
+}
+
+void
+Headless_EndPlayback(HeadlessReplay* replay) {
+    munmap(replay->view, replay->viewSize);
+    close(replay->file);
+    
+    replay->mode = Replay_Idle;
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Memory
+// ---------------------------------------------------------------------------------
+
+u64
+MemoryPageSize() {
+    return (u64)sysconf(_SC_PAGESIZE);
+}
+
+// what MAP_HUGETLB hands out on x64. whether the kernel has any set aside is only known by asking
+u64
+MemoryLargePageSize() {
+    return 2 * 1024 * 1024;
+}
+
+// no access and no swap charged until a commit
+void*
+MemoryReserve(void* address, u64 byteCount) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | (address ? MAP_FIXED_NOREPLACE : 0);
+    void* result = mmap(address, byteCount, PROT_NONE, flags, -1, 0);
+    if(result == MAP_FAILED) {
+        return 0;
+    }
+
+    // kernels before 4.17 take the address as a hint
+    if(address && result != address) {
+        munmap(result, byteCount);
+        return 0;
+    }
+    return result;
+}
+
+// pages are only really backed when they are first touched, this makes them touchable
+bool
+MemoryCommit(void* address, u64 byteCount) {
+    if(byteCount == 0) {
+        return true;
+    }
+
+    u64 pageSize = MemoryPageSize();
+    u64 start = (u64)address & ~(pageSize - 1);
+    u64 end = ((u64)address + byteCount + pageSize - 1) & ~(pageSize - 1);
+    return mprotect((void*)start, end - start, PROT_READ | PROT_WRITE) == 0;
+}
+
+void*
+MemoryAllocateLarge(void* address, u64 byteCount) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (address ? MAP_FIXED_NOREPLACE : 0);
+    void* result = mmap(address, byteCount, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if(result == MAP_FAILED) {
+        return 0;
+    }
+
+    if(address && result != address) {
+        munmap(result, byteCount);
+        return 0;
+    }
+    return result;
+}
+
+void
+MemoryRelease(void* address, u64 byteCount) {
+    munmap(address, byteCount);
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// FILE IO
+// ---------------------------------------------------------------------------------
+
+FileContent
+FileReadAll(const char path[]) {
+    FileContent content = {};
+
+    int handle = open(path, O_RDONLY);
+    if(handle < 0) {
+        printf("error opening file: %s\n", path);
+        return content;
+    }
+
+    struct stat fileInfo;
+    if(fstat(handle, &fileInfo) != 0) {
+        printf("error reading file size: %s\n", path);
+        close(handle);
+        return content;
+    }
+
+    content.data = malloc(fileInfo.st_size);
+
+    // read can return early, keep going until the whole file is in
+    u64 bytesRead = 0;
+    while(bytesRead < (u64)fileInfo.st_size) {
+        ssize_t result = read(handle, (u8*)content.data + bytesRead, fileInfo.st_size - bytesRead);
+        if(result <= 0) {
+            printf("error reading file: %s\n", path);
+            break;
+        }
+        bytesRead += result;
+    }
+
+    content.byteCount = bytesRead;
+
+    if(close(handle) != 0) {
+        printf("error closing file handle: %s\n", path);
+    }
+
+    return content;
+}
+
+void
+FileWriteAll(const char path[], void* data, u64 byteCount) {
+    int handle = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if(handle < 0) {
+        printf("error writing file: %s\n", path);
+        return;
+    }
+
+    u64 bytesWritten = 0;
+    while(bytesWritten < byteCount) {
+        ssize_t result = write(handle, (u8*)data + bytesWritten, byteCount - bytesWritten);
+        if(result <= 0) {
+            printf("error writing file: %s\n", path);
+            break;
+        }
+        bytesWritten += result;
+    }
+
+    if(close(handle) != 0) {
+        printf("error closing file handle: %s\n", path);
+    }
+}
+
+void
+FileReleaseMemory(void* data) {
+    free(data);
+}
+
+FileMapping
+FileMapReadOnly(const char path[]) {
+    FileMapping mapping = {};
+
+    int descriptor = open(path, O_RDONLY);
+    if(descriptor < 0) {
+        printf("error opening file: %s\n", path);
+        return mapping;
+    }
+
+    struct stat fileInfo;
+    if(fstat(descriptor, &fileInfo) == 0 && fileInfo.st_size > 0) {
+        void* view = mmap(0, fileInfo.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if(view != MAP_FAILED) {
+            mapping.data = view;
+            mapping.byteCount = fileInfo.st_size;
+        } else {
+            printf("error mapping file: %s\n", path);
+        }
+    }
+
+    // the mapping keeps the file alive on its own
+    close(descriptor);
+    return mapping;
+}
+
+void
+FileUnmap(FileMapping* mapping) {
+    if(mapping->data) {
+        munmap(mapping->data, mapping->byteCount);
+    }
+    *mapping = {};
+}
+
+struct FileHandle {
+    int descriptor;
+};
+
+FileHandle*
+FileOpen(const char path[]) {
+    int descriptor = open(path, O_RDONLY);
+    if(descriptor < 0) {
+        printf("error opening file: %s\n", path);
+        return 0;
+    }
+
+    FileHandle* file = (FileHandle*)malloc(sizeof(FileHandle));
+    file->descriptor = descriptor;
+    return file;
+}
+
+u64
+FileGetSize(FileHandle* file) {
+    struct stat fileInfo;
+    if(fstat(file->descriptor, &fileInfo) != 0) {
+        return 0;
+    }
+
+    return fileInfo.st_size;
+}
+
+u32
+FileReadAt(FileHandle* file, u64 offset, void* destination, u32 byteCount) {
+    // pread can return early, short only at the end of the file
+    u32 bytesRead = 0;
+    while(bytesRead < byteCount) {
+        ssize_t result = pread(file->descriptor, (u8*)destination + bytesRead, byteCount - bytesRead, offset + bytesRead);
+        if(result <= 0) {
+            break;
+        }
+        bytesRead += result;
+    }
+
+    return bytesRead;
+}
+
+void
+FileClose(FileHandle* file) {
+    close(file->descriptor);
+    free(file);
+}
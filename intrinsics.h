@@ -0,0 +1,136 @@
+#ifndef INTRINSICS_H
+#define INTRINSICS_H
+
+// compiler specific intrinsics shared by the engine and the game
+// x64 only: SSE2 is always present there, so it is the baseline. wider paths are picked at runtime
+
+#include <emmintrin.h> // sse2
+#include <immintrin.h> // avx, avx2
+
+#if defined(_MSC_VER)
+#include <intrin.h>    // __cpuid, _xgetbv
+
+// msvc emits any instruction set from intrinsics, no per-function opt-in needed
+#define TARGET_AVX2
+#define CALLED_FROM_AVX2
+#else
+#include <cpuid.h>     // __get_cpuid
+
+// gcc/clang only emit avx2 instructions inside functions marked for it
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+// for sse kernels an avx2 kernel hands its tail to. gcc puts a vzeroupper before a call only when the callee
+// could see the upper halves, and for a callee in the same file it looks at the registers it actually uses:
+// sse code never touches them, so none is emitted and the callee's legacy sse instructions pay the transition.
+// noipa hides the callee's insides, gcc clears the halves before the call again
+#define CALLED_FROM_AVX2 __attribute__((noipa))
+#endif
+
+struct CpuFeatures {
+    bool queried;
+    bool avx2;
+};
+
+CpuFeatures GlobalCpuFeatures;
+
+u64
+ReadXCR0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    u32 lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((u64)hi << 32) | lo;
+#endif
+}
+
+void
+Cpuid(u32 leaf, u32 subleaf, u32 regs[4]) {
+#if defined(_MSC_VER)
+    __cpuidex((int*)regs, leaf, subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+CpuFeatures
+QueryCpuFeatures() {
+    if(GlobalCpuFeatures.queried) {
+        return GlobalCpuFeatures;
+    }
+
+    CpuFeatures features = {};
+    features.queried = true;
+
+    u32 regs[4]; // eax, ebx, ecx, edx
+    Cpuid(0, 0, regs);
+    u32 maxLeaf = regs[0];
+
+    if(maxLeaf >= 7) {
+        Cpuid(1, 0, regs);
+        bool osxsave = (regs[2] & (1 << 27)) != 0;
+        bool avx     = (regs[2] & (1 << 28)) != 0;
+
+        // the os has to save the ymm registers on context switch, otherwise avx is unusable
+        bool ymmEnabled = osxsave && ((ReadXCR0() & 0x6) == 0x6);
+
+        Cpuid(7, 0, regs);
+        features.avx2 = avx && ymmEnabled && ((regs[1] & (1 << 5)) != 0);
+    }
+
+    GlobalCpuFeatures = features;
+    return features;
+}
+
+// atomics for handing data between the game and the engine's threads
+// loads acquire and stores release, so everything written before a store is visible after the matching load
+u32
+AtomicLoad(u32 volatile* value) {
+#if defined(_MSC_VER)
+    u32 result = *value; // x64 loads already have acquire ordering, the barrier stops the compiler
+    _ReadWriteBarrier();
+    return result;
+#else
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void
+AtomicStore(u32 volatile* value, u32 newValue) {
+#if defined(_MSC_VER)
+    _ReadWriteBarrier();
+    *value = newValue;
+#else
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+#endif
+}
+
+// returns the new value
+u32
+AtomicAdd(u32 volatile* value, u32 addend) {
+#if defined(_MSC_VER)
+    return (u32)_InterlockedExchangeAdd((long volatile*)value, (long)addend) + addend;
+#else
+    return __atomic_add_fetch(value, addend, __ATOMIC_ACQ_REL);
+#endif
+}
+
+// index of the lowest set bit, value can't be 0
+u32
+FindLowestSetBit(u32 value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return index;
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+// time stamp counter. invariant on anything x64 from the last decade, so it ticks at a fixed rate on every core
+u64
+ReadCycleCounter() {
+    return __rdtsc();
+}
+
+#endif
@@ -10,6 +10,7 @@
 
 
 #include <cstdio>    // printf
+#include <cstring>   // memcpy
 #include "cstdint"   // uint32_t
 #include "math.h"    // fmod
 
@@ -39,6 +40,13 @@ const float PI = 3.14159265358; // TODO is this the right place for this? game n
 #include "game.h"
 #include "game.cpp"
 
+#include "engine_replay.h"
+#include "engine_audio.h"
+#include "engine_pacing.h"
+#include "engine_io.h"
+#include "engine_scale.h"
+#include "engine_memory.h"
+
 // game has a similar structure, but the game cannot have any Windows dependencies (i.e. BITMAPINFO)
 struct Win32GraphicsBuffer {
     int width, height;
@@ -48,9 +56,16 @@ struct Win32GraphicsBuffer {
     u8* data;
 };
 
+// the game's frame scaled to the window's client size, so WM_PAINT copies it 1:1
+struct Win32PresentBuffer {
+    Scaler scaler;
+    BITMAPINFO bitmapInfo;
+    void* memory;
+    DirtyRegion dirty; // output rects that changed this frame
+};
+
 struct Win32SoundBuffer {
     u32 sampleIndex;
-    u32 latencySampleCount;
     
     u32 samplesPerSecond;
     u8 bytesPerSample;
@@ -59,20 +74,81 @@ struct Win32SoundBuffer {
     LPDIRECTSOUNDBUFFER secondary;
 };
 
+// directsound behind the engine's AudioDevice interface, driven by the audio thread
+struct Win32AudioDevice {
+    AudioDevice device;
+    Win32SoundBuffer* buffer;
+    u32 lastPlayCursor; // in samples
+};
+
+struct WorkQueueEntry {
+    WorkQueueCallback* callback;
+    void* data;
+};
+
+const u32 WORK_QUEUE_CAPACITY = 512;
+const u32 IO_THREAD_COUNT = 2;
+
+struct WorkQueue {
+    u32 volatile completionGoal;
+    u32 volatile completionCount;
+    
+    u32 volatile nextEntryToWrite;
+    u32 volatile nextEntryToRead;
+    
+    HANDLE semaphore;
+    WorkQueueEntry entries[WORK_QUEUE_CAPACITY];
+};
+
+struct Win32Replay {
+    ReplayMode mode;
+    HANDLE file;
+    ReplayHeader header;
+    
+    // playback maps the whole file
+    HANDLE mapping;
+    u8* view;
+    RecordedFrame* frames;
+    u64 playIndex;
+};
+
 // forward declarations
 LRESULT CALLBACK Win32_WindowProc(HWND windowHandle, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
+void Win32_CreateWorkQueue(WorkQueue* queue, u32 threadCount);
+
+bool Win32_EnableLargePages();
+
+bool Win32_BeginRecording(Win32Replay* replay, const char path[], GameMemory* memory);
+void Win32_RecordFrame(Win32Replay* replay, GameInput* input, f32 dt);
+void Win32_EndRecording(Win32Replay* replay);
+bool Win32_BeginPlayback(Win32Replay* replay, const char path[], GameMemory* memory);
+void Win32_PlaybackFrame(Win32Replay* replay, GameMemory* memory, GameInput* input, f32* dt);
+void Win32_EndPlayback(Win32Replay* replay);
+
 void Win32_CreateGraphicsBuffer(Win32GraphicsBuffer* buffer, int width, int height);
-void Win32_DrawBufferToWindow(Win32GraphicsBuffer* buffer, HWND windowHandle, RECT clientRect);
+void Win32_ResizePresentBuffer(Win32PresentBuffer* present, int sourceWidth, int sourceHeight, int width, int height);
+void Win32_DrawBufferToWindow(Win32PresentBuffer* present, HWND windowHandle);
+void Win32_InvalidateDirtyRegion(HWND windowHandle, Win32PresentBuffer* present);
 
 // debug graphics
 void Win32_DebugDrawVerticalLine(Win32GraphicsBuffer* buffer, int32 xPos, int32 height, u32 color);
 void Win32_DebugDrawCursorPositions(Win32GraphicsBuffer* buffer);
+Rect32 Win32_DebugDrawStats(GraphicsBuffer* buffer, BitmapFont* font, GameStats* stats, f32 frameSeconds);
 
 
 bool Win32_CreateSoundBuffer(Win32SoundBuffer* buffer, HWND windowHandle);
 void Win32_WriteSoundToDevice(DWORD startingByte, DWORD byteCount, Win32SoundBuffer* buffer, SoundBuffer* gameSound);
 void Win32_WriteSoundBlock(DWORD sampleCount, int16* destinationSamples, int16* sourceSamples, u32& sampleIndex);
+void Win32_CreateAudioDevice(Win32AudioDevice* device, Win32SoundBuffer* buffer);
+DWORD WINAPI Win32_AudioThreadProc(LPVOID param);
+
+u64 Win32_ClockNow(PacingClock* clock);
+void Win32_ClockSleep(PacingClock* clock, u32 milliseconds);
+f64 Win32_QueryRefreshRate(HWND windowHandle);
+f64 Win32_MeasureCycleRate();
+
+void Win32_WriteProfileTrace(const char path[]);
 
 // consts
 const int BYTES_PER_PIXEL = 4;
@@ -83,19 +159,30 @@ const int SCREEN_HEIGHT = 1024;
 const int BUFFER_WIDTH = 512;
 const int BUFFER_HEIGHT = 512;
 
+// 2 TB, well away from anything the loader or the heap would pick
+const u64 GAME_MEMORY_BASE = 2ull * 1024 * 1024 * 1024 * 1024;
+
+const char REPLAY_PATH[] = "loop.rec";
+const char PROFILE_TRACE_PATH[] = "profile.json"; // open in chrome://tracing or ui.perfetto.dev
+
+const u32 AUDIO_RING_FRAMES = 16384; // about 340 ms at 48 kHz, a power of two
+
 // globals
 bool IsGameRunning = true;
 Win32GraphicsBuffer graphicsBuffer;
+Win32PresentBuffer presentBuffer;
 Win32SoundBuffer soundBuffer;
+Win32AudioDevice audioDevice;
+AudioOutput audioOutput;
+WorkQueue renderQueue;
+WorkQueue backgroundQueue;
+bool LargePagesEnabled;
+WorkQueue ioQueue;
+Win32Replay replay;
 GameInput gameInput;
 bool DebugSound;
 
 
-// TODO monitor refresh rate?
-const float MONITOR_REFRESH_RATE = 60.0f; // TODO does windows have an API for this?
-const float TARGET_FRAMERATE = MONITOR_REFRESH_RATE;
-const float TARGET_FRAME_SECONDS = 1.0f / TARGET_FRAMERATE;
-
 int
 main() {
     const wchar_t CLASS_NAME[] = L"Sample Window Class";
@@ -141,19 +228,46 @@ main() {
         return false;
     }
     
-    // game allocations
-    int gamePermanentSize = 1024 * 1024 * 1024; // 1 GB
-    int gameTransientSize = 1024 * 1024 * 1;    // 1 MB
-    GameMemory gameMemory;
+    // worker threads for the game's render queue. the main thread helps out while it waits, so it counts as one
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    u32 workerCount = systemInfo.dwNumberOfProcessors - 1;
+    Win32_CreateWorkQueue(&renderQueue, workerCount);
+    
+    // one thread for slow jobs like streaming reads, so they never hold up a render join
+    Win32_CreateWorkQueue(&backgroundQueue, 1);
+    
+    // io threads for the game's async reads. they mostly wait on the disk, a couple keep requests queued on it
+    Win32_CreateWorkQueue(&ioQueue, IO_THREAD_COUNT);
+    InitializeFileReads(&ioQueue);
     
-    gameMemory.permanent = VirtualAlloc(NULL, gamePermanentSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-    gameMemory.transient = VirtualAlloc(NULL, gameTransientSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    // game allocations. permanent is only reserved, its arena commits it as it grows
+    u64 gamePermanentSize = 1024 * 1024 * 1024; // 1 GB
+    u64 gameTransientSize = 1024 * 1024 * 1;    // 1 MB
+    GameMemory gameMemory = {};
+    GameMemoryLayout memoryLayout;
     
-    gameMemory.permanentSize = gamePermanentSize;
-    gameMemory.transientSize = gameTransientSize;
+    // large pages need the lock pages in memory privilege, without it transient is on small pages
+    LargePagesEnabled = Win32_EnableLargePages();
+    
+    if(!ReserveGameMemory(&gameMemory, GAME_MEMORY_BASE, gamePermanentSize, gameTransientSize, &memoryLayout)) {
+        printf("Failed to allocate game memory\n");
+        return 0;
+    }
+    
+    gameMemory.renderQueue = workerCount > 0 ? &renderQueue : NULL;
+    gameMemory.backgroundQueue = &backgroundQueue;
     
     int16* soundMemory = (int16*)VirtualAlloc(NULL, soundBuffer.bufferSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
     
+    // the game fills the ring once a frame, the audio thread feeds directsound from it on its own schedule
+    // the ring starts at 50 ms of game audio, the latency controller shrinks or grows it to what this machine needs
+    int16* audioRingMemory = (int16*)VirtualAlloc(NULL, AUDIO_RING_FRAMES * soundBuffer.bytesPerSample, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    Win32_CreateAudioDevice(&audioDevice, &soundBuffer);
+    InitializeAudioOutput(&audioOutput, &audioDevice.device, audioRingMemory, AUDIO_RING_FRAMES, soundBuffer.samplesPerSecond / 20);
+    
+    HANDLE audioThread = CreateThread(NULL, 0, Win32_AudioThreadProc, &audioOutput, 0, NULL);
+    
     gameInput = {};
 
     GameInit(&gameMemory);
@@ -161,26 +275,38 @@ main() {
     MSG msg = {};
     
     // timing
-    double time = 0.0;
-    double MAX_DT = 1.0 / 60.0;
-    LARGE_INTEGER lastFrameTime;
-    LARGE_INTEGER frequency; // ticks per second
-    
-    QueryPerformanceCounter(&lastFrameTime);
-    QueryPerformanceFrequency(&frequency); // fixed at system boot, need only query once
-    
     // attempt to have scheduler wake us up every 1 ms
     const u8 TARGET_SCHEDULER_MS = 1;
     bool allowSleeping = (timeBeginPeriod(TARGET_SCHEDULER_MS) == TIMERR_NOERROR);
     
+    LARGE_INTEGER frequency; // ticks per second
+    QueryPerformanceFrequency(&frequency); // fixed at system boot, need only query once
+    
+    PacingClock clock = {};
+    clock.ticksPerSecond = frequency.QuadPart;
+    clock.now = Win32_ClockNow;
+    clock.sleep = Win32_ClockSleep;
+    clock.canSleep = allowSleeping; // without the 1 ms period a sleep can take 15 ms, spinning is the only way to hit a deadline
+    
+    // frames go at the display's rate, the game updates at its own fixed rate in between
+    FramePacer pacer;
+    InitializeFramePacer(&pacer, &clock, Win32_QueryRefreshRate(windowHandle), GAME_UPDATE_HZ);
+    f32 stepSeconds = PacerStepSeconds(&pacer);
+    
+    u64 elapsedTicks = pacer.stepTicks; // the first frame runs one update, so there is something to render
+    f32 secondsSinceAudio = 0;
+    
+    // profiling is off until F2, zones cost a branch until then. the stats text goes with it
+    ProfileNameThread("main");
+    BitmapFont debugFont = BuiltinFont();
+    ProfileSetCycleRate(Win32_MeasureCycleRate());
+    
     while(IsGameRunning) {
-        LARGE_INTEGER frameStartTime;
-        QueryPerformanceCounter(&frameStartTime);
-        
-        f32 deltaSeconds = ((f32)frameStartTime.QuadPart - (f32)lastFrameTime.QuadPart) / (f32)frequency.QuadPart;
-        lastFrameTime = frameStartTime;
+        ProfileBeginFrame();
         
         // [input]
+        PROFILE_BEGIN(inputZone, "input");
+        DispatchFileReads(); // reads queued behind the in flight budget move on even when the game isn't polling
         POINT mousePos;
         GetCursorPos(&mousePos);
         ScreenToClient(windowHandle, &mousePos);
@@ -237,6 +363,48 @@ main() {
                             case VK_F1:
                                 if(isDown) { // toggle on down
                                     DebugSound = !DebugSound;
+                                    
+                                    if(DebugSound) {
+                                        AudioOutputStats stats = GetAudioOutputStats(&audioOutput);
+                                        printf("audio: %u underruns (%u samples of silence), ring %u of %u samples, lowest %u\n",
+                                               stats.underruns, stats.underrunFrames, stats.ringFill, stats.targetFill, stats.ringLowest);
+                                        printf("latency: %.1fms total, device %.1fms (cursor step %.1fms, write gap %.1fms), ring %.1fms (longest frame %.1fms)\n",
+                                               stats.totalLatencyMs, stats.deviceLatencyMs, stats.cursorStepMs, stats.writeGapMs,
+                                               stats.ringLatencyMs, stats.frameTimeMs);
+                                        printf("latency: %u ring near misses, %u device near misses, %u device misses\n",
+                                               stats.ringNearMisses, stats.deviceNearMisses, stats.deviceMisses);
+                                        
+                                        PacingStats pacing = GetPacingStats(&pacer);
+                                        printf("pacing: %.3fms frames (%.3f to %.3f, target %.3f), jitter %.3fms, sleep margin %.2fms, %u missed, %u steps dropped\n",
+                                               pacing.meanMs, pacing.minMs, pacing.maxMs, pacing.targetMs, pacing.jitterMs,
+                                               pacing.sleepMarginMs, pacing.missedDeadlines, pacing.droppedSteps);
+                                    }
+                                }
+                                break;
+                                
+                            case VK_F2:
+                                if(isDown) {
+                                    ProfileSetEnabled(!ProfileIsEnabled());
+                                }
+                                break;
+                                
+                            case VK_F3:
+                                if(isDown) {
+                                    Win32_WriteProfileTrace(PROFILE_TRACE_PATH);
+                                }
+                                break;
+                                
+                            case 'L':
+                                // idle -> recording -> looping playback -> idle
+                                if(isDown) {
+                                    if(replay.mode == Replay_Idle) {
+                                        Win32_BeginRecording(&replay, REPLAY_PATH, &gameMemory);
+                                    } else if(replay.mode == Replay_Recording) {
+                                        Win32_EndRecording(&replay);
+                                        Win32_BeginPlayback(&replay, REPLAY_PATH, &gameMemory);
+                                    } else {
+                                        Win32_EndPlayback(&replay);
+                                    }
                                 }
                                 break;
                         }
@@ -252,38 +420,51 @@ main() {
             }
         }
         
-        DWORD playCursor, writeCursor;
-        if(!SUCCEEDED(soundBuffer.secondary->GetCurrentPosition(&playCursor, &writeCursor))) {
-            printf("Failed to get sound cursor position\n");
-        }
-        
-        // cursor is greater unless circular buffer wraps around
-        DWORD startingByte = (soundBuffer.sampleIndex*soundBuffer.bytesPerSample) % soundBuffer.bufferSize;
-        DWORD targetByte = (playCursor + (soundBuffer.latencySampleCount*soundBuffer.bytesPerSample)) % soundBuffer.bufferSize;
-        
-        DWORD byteCount;
-        
-        if(startingByte > targetByte) { // detect wrap around. sound buffer is circular
-            byteCount = soundBuffer.bufferSize - startingByte;
-            byteCount += targetByte;
-        } else {
-            byteCount = targetByte - startingByte;
-        }
-        
-        // transfer to game sound
-        // this must occur after getting cursor positions, but before GameUpdate
-        SoundBuffer gameSoundBuffer = {};
-        gameSoundBuffer.samplesPerSecond = soundBuffer.samplesPerSecond;
-        gameSoundBuffer.numSamplesToWrite = byteCount / soundBuffer.bytesPerSample;
-        gameSoundBuffer.samples = soundMemory;
-        
+        PROFILE_END(inputZone);
         
         // [update]
-        GameUpdate(&gameMemory, gameInput, &gameSoundBuffer, deltaSeconds);
+        // the last frame's time turns into fixed steps. a fast display runs some frames with none,
+        // a slow frame runs several to catch up
+        PROFILE_BEGIN(updateZone, "update");
+        u32 steps = BeginFrameSteps(&pacer, elapsedTicks);
+        secondsSinceAudio += (f32)TicksToSeconds(&clock, elapsedTicks);
         
-        Win32_WriteSoundToDevice(startingByte, byteCount, &soundBuffer, &gameSoundBuffer);
+        for(u32 step = 0; step < steps; step++) {
+            bool lastStep = (step == steps - 1);
+            
+            // [replay]
+            // recording keeps what the player did, playback replaces it for this step only
+            GameInput stepInput = gameInput;
+            f32 dt = stepSeconds;
+            
+            if(replay.mode == Replay_Recording) {
+                Win32_RecordFrame(&replay, &stepInput, dt);
+            } else if(replay.mode == Replay_Playing) {
+                Win32_PlaybackFrame(&replay, &gameMemory, &stepInput, &dt);
+            }
+            
+            // transfer to game sound
+            // the last step tops the ring back up to its target, whatever the audio thread drained since the last write
+            SoundBuffer gameSoundBuffer = {};
+            gameSoundBuffer.samplesPerSecond = soundBuffer.samplesPerSecond;
+            gameSoundBuffer.samples = soundMemory;
+            if(lastStep) {
+                UpdateAudioLatency(&audioOutput, secondsSinceAudio);
+                secondsSinceAudio = 0;
+                gameSoundBuffer.numSamplesToWrite = AudioOutputFramesWanted(&audioOutput);
+            }
+            
+            GameUpdate(&gameMemory, stepInput, &gameSoundBuffer, dt);
+            
+            if(lastStep) {
+                PROFILE_ZONE("sound");
+                AudioOutputWrite(&audioOutput, gameSoundBuffer.samples, gameSoundBuffer.numSamplesToWrite);
+            }
+        }
+        PROFILE_END(updateZone);
         
         // [render]
+        PROFILE_BEGIN(renderZone, "render");
         // pass along revelant data to the game
         GraphicsBuffer gameGraphicsBuffer = {};
         gameGraphicsBuffer.width           = graphicsBuffer.width;
@@ -292,32 +473,65 @@ main() {
         gameGraphicsBuffer.bytesPerRow     = graphicsBuffer.bytesPerRow;
         gameGraphicsBuffer.data            = graphicsBuffer.data; // pointer to the engine's graphics buffer data. Game writes to it, and engine knows how to display it
         
-        GameRender(&gameMemory, &gameGraphicsBuffer);
-        
-        // sleep the remainder of the frame
-        if(deltaSeconds < TARGET_FRAME_SECONDS) {
-            if(allowSleeping) {
-                Sleep((TARGET_FRAME_SECONDS - deltaSeconds)*1000.0f);
-            }
-        } else {
-            // TODO probably doesn't make sense to print a log when we're behind... that will make us further behind
-            // printf("frame took %fms -- target is %fms\n", elapsedMS, TARGET_FRAME_SECONDS);
-        }
+        GameRender(&gameMemory, &gameGraphicsBuffer, PacerInterpolation(&pacer));
         
+        // whatever the engine draws itself is presented with the game's changes and painted over next frame
         if(DebugSound) {
             Win32_DebugDrawCursorPositions(&graphicsBuffer);
+            MarkDirtyFull(&gameMemory.dirty);
+            MarkDirtyFull(&gameMemory.overdrawn);
         }
+        PROFILE_END(renderZone);
         
-        // queue WM_PAINT, forces the entire window to redraw
-        RECT rect;
-        GetClientRect(windowHandle, &rect);
-        InvalidateRect(windowHandle, &rect, true);
+        Rect32 overlay = ProfileDrawOverlay(&gameGraphicsBuffer, (f32)TicksToSeconds(&clock, pacer.frameTicks));
+        AddDirtyRect(&gameMemory.dirty, overlay);
+        AddDirtyRect(&gameMemory.overdrawn, overlay);
+        
+        if(ProfileIsEnabled()) {
+            Rect32 statsText = Win32_DebugDrawStats(&gameGraphicsBuffer, &debugFont, &gameMemory.stats, (f32)TicksToSeconds(&clock, elapsedTicks));
+            AddDirtyRect(&gameMemory.dirty, statsText);
+            AddDirtyRect(&gameMemory.overdrawn, statsText);
+        }
+        
+        // scale to the client size. a new size needs every output pixel, a minimized window has none to draw
+        RECT client;
+        GetClientRect(windowHandle, &client);
+        int clientWidth = client.right - client.left;
+        int clientHeight = client.bottom - client.top;
+        if(clientWidth != presentBuffer.scaler.output.width || clientHeight != presentBuffer.scaler.output.height) {
+            Win32_ResizePresentBuffer(&presentBuffer, graphicsBuffer.width, graphicsBuffer.height, clientWidth, clientHeight);
+            MarkDirtyFull(&gameMemory.dirty);
+        }
+        
+        bool presenting = presentBuffer.memory != NULL;
+        if(presenting) {
+            ScaleBuffer(&presentBuffer.scaler, gameMemory.renderQueue, &gameGraphicsBuffer, &gameMemory.dirty, &presentBuffer.dirty);
+        }
+        
+        // wait out the rest of the frame, then present right on the deadline
+        PROFILE_BEGIN(waitZone, "wait");
+        elapsedTicks = WaitForFrameDeadline(&pacer);
+        PROFILE_END(waitZone);
+        
+        // [present]
+        // only the scaled dirty rects are invalidated, WM_PAINT copies just those. UpdateWindow paints them now rather than
+        // on the next message pump, so the frame goes out on its deadline and the time shows up here
+        PROFILE_ZONE("present");
+        if(presenting) {
+            Win32_InvalidateDirtyRegion(windowHandle, &presentBuffer);
+            UpdateWindow(windowHandle);
+        }
     }
     
+    StopAudioOutput(&audioOutput);
+    WaitForSingleObject(audioThread, INFINITE);
+    CloseHandle(audioThread);
+    
     VirtualFree(graphicsBuffer.data, 0, MEM_RELEASE);
-    VirtualFree(gameMemory.permanent, 0, MEM_RELEASE);
-    VirtualFree(gameMemory.transient, 0, MEM_RELEASE);
+    Win32_ResizePresentBuffer(&presentBuffer, graphicsBuffer.width, graphicsBuffer.height, 0, 0);
+    ReleaseGameMemory(&gameMemory, &memoryLayout);
     VirtualFree(soundMemory, 0 , MEM_RELEASE);
+    VirtualFree(audioRingMemory, 0, MEM_RELEASE);
     
     // ms docs -> timeBeginPeriod should be paired with a timeEndPeriod. not clear if needed at end of program
     timeEndPeriod(TARGET_SCHEDULER_MS); 
@@ -339,11 +553,7 @@ Win32_WindowProc(HWND windowHandle, UINT uMsg, WPARAM wParam, LPARAM lParam) {
             break;
             
         case WM_PAINT:
-            {
-                RECT rect;
-                GetClientRect(windowHandle, &rect);
-                Win32_DrawBufferToWindow(&graphicsBuffer, windowHandle, rect);
-            }
+            Win32_DrawBufferToWindow(&presentBuffer, windowHandle);
             return 0;
     }
     
@@ -352,33 +562,177 @@ Win32_WindowProc(HWND windowHandle, UINT uMsg, WPARAM wParam, LPARAM lParam) {
 
 
 
+// ---------------------------------------------------------------------------------
+// Threads
+// ---------------------------------------------------------------------------------
+
+void
+WorkQueueAdd(WorkQueue* queue, WorkQueueCallback* callback, void* data) {
+    // only the main thread adds, so the write index needs no interlocked ops
+    u32 newNextEntryToWrite = (queue->nextEntryToWrite + 1) % WORK_QUEUE_CAPACITY;
+    assert(newNextEntryToWrite != queue->nextEntryToRead);
+    
+    WorkQueueEntry* entry = queue->entries + queue->nextEntryToWrite;
+    entry->callback = callback;
+    entry->data = data;
+    
+    queue->completionGoal++;
+    
+    // the entry has to be visible before the index that publishes it
+    _WriteBarrier();
+    queue->nextEntryToWrite = newNextEntryToWrite;
+    ReleaseSemaphore(queue->semaphore, 1, NULL);
+}
+
+// returns false when there was nothing to do
+bool
+Win32_DoNextWorkQueueEntry(WorkQueue* queue) {
+    u32 originalNextEntryToRead = queue->nextEntryToRead;
+    u32 newNextEntryToRead = (originalNextEntryToRead + 1) % WORK_QUEUE_CAPACITY;
+    
+    if(originalNextEntryToRead == queue->nextEntryToWrite) {
+        return false;
+    }
+    
+    // several threads race for the same entry, only the one that moves the read index runs it
+    u32 index = InterlockedCompareExchange((LONG volatile*)&queue->nextEntryToRead, newNextEntryToRead, originalNextEntryToRead);
+    if(index == originalNextEntryToRead) {
+        WorkQueueEntry entry = queue->entries[index];
+        entry.callback(entry.data);
+        
+        InterlockedIncrement((LONG volatile*)&queue->completionCount);
+    }
+    
+    return true;
+}
+
+void
+WorkQueueCompleteAll(WorkQueue* queue) {
+    while(queue->completionGoal != queue->completionCount) {
+        Win32_DoNextWorkQueueEntry(queue);
+    }
+    
+    queue->completionGoal = 0;
+    queue->completionCount = 0;
+}
+
+DWORD WINAPI
+Win32_WorkerThreadProc(LPVOID param) {
+    WorkQueue* queue = (WorkQueue*)param;
+    ProfileNameThread("worker");
+    
+    for(;;) {
+        if(!Win32_DoNextWorkQueueEntry(queue)) {
+            WaitForSingleObjectEx(queue->semaphore, INFINITE, FALSE);
+        }
+    }
+    
+    return 0;
+}
+
+void
+Win32_CreateWorkQueue(WorkQueue* queue, u32 threadCount) {
+    queue->completionGoal = 0;
+    queue->completionCount = 0;
+    queue->nextEntryToWrite = 0;
+    queue->nextEntryToRead = 0;
+    
+    queue->semaphore = CreateSemaphoreEx(NULL, 0, WORK_QUEUE_CAPACITY, NULL, 0, SEMAPHORE_ALL_ACCESS);
+    
+    for(u32 i = 0; i < threadCount; i++) {
+        HANDLE thread = CreateThread(NULL, 0, Win32_WorkerThreadProc, queue, 0, NULL);
+        CloseHandle(thread);
+    }
+}
+
+
+
 // ---------------------------------------------------------------------------------
 // Graphics
 // ---------------------------------------------------------------------------------
 
+// the scaler's output is the client size, so this is a straight copy. the paint dc is clipped to what was
+// invalidated, so a frame with a few dirty rects only copies those
 void 
-Win32_DrawBufferToWindow(Win32GraphicsBuffer* buffer, HWND windowHandle, RECT windowRect) {
+Win32_DrawBufferToWindow(Win32PresentBuffer* present, HWND windowHandle) {
     PAINTSTRUCT ps;
     HDC deviceContext = BeginPaint(windowHandle, &ps);
     
-    int width = (windowRect.right - windowRect.left);
-    int height = (windowRect.bottom - windowRect.top);
+    // nothing scaled yet, or minimized. the window keeps whatever it showed
+    if(present->memory) {
+        GraphicsBuffer* output = &present->scaler.output;
+        SetDIBitsToDevice(deviceContext,
+            // destination
+            0, 0, output->width, output->height,
+            
+            // source, every scan line
+            0, 0, 0, output->height,
+            
+            output->data,
+            &present->bitmapInfo,
+            DIB_RGB_COLORS
+        );
+    }
+    
+    EndPaint(windowHandle, &ps);
+}
+
+// output rows count up from the bottom, window rows down from the top. the output is the client size, so
+// that is the only conversion
+void
+Win32_InvalidateDirtyRegion(HWND windowHandle, Win32PresentBuffer* present) {
+    if(present->dirty.full) {
+        InvalidateRect(windowHandle, NULL, false);
+        return;
+    }
     
-    // stretch the graphics buffer pixels onto the window
-    StretchDIBits(deviceContext,
-        // destination
-        windowRect.left, windowRect.top, width, height,
+    int32 height = present->scaler.output.height;
+    for(u32 i = 0; i < present->dirty.rectCount; i++) {
+        Rect32 dirtyRect = present->dirty.rects[i];
         
-        // source
-        0, 0, buffer->width, buffer->height,
+        RECT rect;
+        rect.left   = dirtyRect.minX;
+        rect.right  = dirtyRect.maxX;
+        rect.top    = height - dirtyRect.maxY;
+        rect.bottom = height - dirtyRect.minY;
         
-        buffer->data,
-        &buffer->bitmapInfo,
-        DIB_RGB_COLORS,
-        SRCCOPY
-    );
+        // erasing first would flash the background, WM_PAINT covers every invalid pixel anyway
+        InvalidateRect(windowHandle, &rect, false);
+    }
+}
+
+// frees the old output and scales into a new one of width x height. zero on either side leaves it freed.
+// whole number factors get nearest, so pixel art stays sharp, anything else is filtered
+void
+Win32_ResizePresentBuffer(Win32PresentBuffer* present, int sourceWidth, int sourceHeight, int width, int height) {
+    if(present->memory) {
+        VirtualFree(present->memory, 0, MEM_RELEASE);
+    }
+    present->memory = NULL;
+    present->scaler.output.width = width;
+    present->scaler.output.height = height;
     
-    EndPaint(windowHandle, &ps);
+    if(width <= 0 || height <= 0) {
+        return;
+    }
+    
+    present->memory = VirtualAlloc(NULL, ScalerMemoryBytes(width, height), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if(!present->memory) {
+        printf("Failed to allocate the present buffer\n");
+        return;
+    }
+    InitializeScaler(&present->scaler, present->memory, sourceWidth, sourceHeight, width, height, ScaleFilter_Nearest);
+    
+    BITMAPINFO bitmapInfo = {};
+    bitmapInfo.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bitmapInfo.bmiHeader.biWidth = width;
+    bitmapInfo.bmiHeader.biHeight = height; // positive, bottom row first like the game's buffer
+    bitmapInfo.bmiHeader.biPlanes = 1;
+    bitmapInfo.bmiHeader.biBitCount = 8*BYTES_PER_PIXEL;
+    bitmapInfo.bmiHeader.biCompression = BI_RGB;
+    present->bitmapInfo = bitmapInfo;
+    
+    MarkDirtyFull(&present->dirty);
 }
 
 void 
@@ -454,6 +808,39 @@ Win32_DebugDrawCursorPositions(Win32GraphicsBuffer* buffer) {
     }
 }
 
+// the game's last stats as text in the top left corner, on a black box so it reads over anything.
+// returns the pixels it drew over
+Rect32
+Win32_DebugDrawStats(GraphicsBuffer* buffer, BitmapFont* font, GameStats* stats, f32 frameSeconds) {
+    const int32 MARGIN = 4;
+    const u32 TEXT_COLOR = 0xFFFFFFFF;
+    
+    char text[512];
+    snprintf(text, sizeof(text),
+             "frame %.2fms\n"
+             "render %u issued, %u culled, %u merged, %u drawn\n"
+             "redrawn %u px in %u rects%s\n"
+             "memory %.1f of %.1f MB committed, %.0f reserved, transient peak %.0f KB\n"
+             "audio %u voices, %u underruns",
+             frameSeconds * 1000.0f,
+             stats->render.issued, stats->render.culled, stats->render.merged, stats->render.executed,
+             stats->render.redrawnPixels, stats->render.dirtyRects, stats->render.fullRedraws ? " (full)" : "",
+             stats->memory.permanentUsed / (1024.0 * 1024.0), stats->memory.permanentCommitted / (1024.0 * 1024.0),
+             stats->memory.permanentSize / (1024.0 * 1024.0),
+             stats->memory.transientPeak / 1024.0,
+             stats->audio.voicesMixed, stats->audio.streamUnderruns);
+    
+    Rect32 textBounds = StringBounds(font, text, 2 * MARGIN, buffer->height - 2 * MARGIN);
+    Rect32 box = { textBounds.minX - MARGIN, textBounds.minY - MARGIN, textBounds.maxX + MARGIN, textBounds.maxY + MARGIN };
+    box = Intersect(box, BufferRect(buffer));
+    
+    Color32 black = {};
+    black.packed = 0xFF000000;
+    ClearBufferWithColor(buffer, box, black);
+    DrawString(buffer, box, font, text, textBounds.minX, textBounds.maxY, TEXT_COLOR);
+    return box;
+}
+
 
 // ---------------------------------------------------------------------------------
 // Sound
@@ -512,7 +899,6 @@ Win32_CreateSoundBuffer(Win32SoundBuffer* buffer, HWND windowHandle) {
      
     buffer->samplesPerSecond = samplesPerSecond;
     buffer->bytesPerSample = bytesPerSample;
-    buffer->latencySampleCount = buffer->samplesPerSecond / 20; // TODO const? not exactly sure why 20 works
     buffer->bufferSize = samplesPerSecond * bytesPerSample;
     buffer->secondary = secondaryBuffer;
     
@@ -540,10 +926,11 @@ Win32_WriteSoundToDevice(DWORD startingByte, DWORD byteCount, Win32SoundBuffer*
     // w = write cursor
     // |------p---------w--|
     // |2-----p---------1--|
+    int16* block2Source = gameSound->samples + (block1Count / buffer->bytesPerSample) * 2; // continues where block 1 stopped
     sampleCount = block2Count / buffer->bytesPerSample;
     if(sampleCount > 0) {
         // block 2
-        Win32_WriteSoundBlock(sampleCount, (int16*)block2, gameSound->samples, buffer->sampleIndex);
+        Win32_WriteSoundBlock(sampleCount, (int16*)block2, block2Source, buffer->sampleIndex);
     }
     
     buffer->sampleIndex %= buffer->bufferSize;
@@ -565,6 +952,377 @@ Win32_WriteSoundBlock(DWORD sampleCount, int16* destinationSamples, int16* sourc
     }
 }
 
+// frames the device can take right now, enough to keep the latency controller's write-ahead queued past the play cursor
+u32
+Win32_AudioDeviceWait(AudioDevice* device) {
+    Win32AudioDevice* win32Device = (Win32AudioDevice*)device;
+    Win32SoundBuffer* buffer = win32Device->buffer;
+    
+    // the play cursor moves in steps of a few ms at best, polling faster than this finds nothing new
+    Sleep(1);
+    
+    DWORD playCursor, writeCursor;
+    if(FAILED(buffer->secondary->GetCurrentPosition(&playCursor, &writeCursor))) {
+        return 0;
+    }
+    
+    // everything in samples from here, the buffer is circular so every distance wraps
+    u32 bufferSamples = buffer->bufferSize / buffer->bytesPerSample;
+    u32 play = playCursor / buffer->bytesPerSample;
+    u32 write = writeCursor / buffer->bytesPerSample;
+    u32 queuedEnd = buffer->sampleIndex % bufferSamples;
+    
+    u32 cursorStep = (play + bufferSamples - win32Device->lastPlayCursor) % bufferSamples;
+    u32 writeGap = (write + bufferSamples - play) % bufferSamples;
+    win32Device->lastPlayCursor = play;
+    
+    // how far our data reaches past the write cursor. more than half the buffer away means it is behind instead
+    u32 ahead = (queuedEnd + bufferSamples - write) % bufferSamples;
+    int32 headroom = ahead < bufferSamples / 2 ? (int32)ahead : (int32)ahead - (int32)bufferSamples;
+    
+    u32 writeAhead = UpdateDeviceLatency(device, cursorStep, writeGap, headroom);
+    
+    if(headroom < 0) {
+        // the hardware already played past our data, pick up again at the first sample we can still change
+        buffer->sampleIndex = write;
+        queuedEnd = write;
+    }
+    
+    u32 targetSample = (play + writeAhead) % bufferSamples;
+    u32 due = (targetSample + bufferSamples - queuedEnd) % bufferSamples;
+    
+    // more than half the buffer means we are already ahead of the target, not behind it
+    if(due > bufferSamples / 2) {
+        return 0;
+    }
+    
+    return due;
+}
+
+void
+Win32_AudioDeviceSubmit(AudioDevice* device, int16* frames, u32 frameCount) {
+    Win32SoundBuffer* buffer = ((Win32AudioDevice*)device)->buffer;
+    
+    SoundBuffer source = {};
+    source.samplesPerSecond = buffer->samplesPerSecond;
+    source.numSamplesToWrite = frameCount;
+    source.samples = frames;
+    
+    DWORD startingByte = (buffer->sampleIndex*buffer->bytesPerSample) % buffer->bufferSize;
+    Win32_WriteSoundToDevice(startingByte, frameCount * buffer->bytesPerSample, buffer, &source);
+}
+
+void
+Win32_CreateAudioDevice(Win32AudioDevice* device, Win32SoundBuffer* buffer) {
+    device->device.samplesPerSecond = buffer->samplesPerSecond;
+    device->device.wait = Win32_AudioDeviceWait;
+    device->device.submit = Win32_AudioDeviceSubmit;
+    InitializeDeviceLatency(&device->device.latency, buffer->samplesPerSecond);
+    device->buffer = buffer;
+    device->lastPlayCursor = 0;
+}
+
+DWORD WINAPI
+Win32_AudioThreadProc(LPVOID param) {
+    ProfileNameThread("audio");
+    
+    // a late wakeup here is an audible glitch, a late frame is not
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+    
+    RunAudioOutput((AudioOutput*)param);
+    return 0;
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Timing
+// ---------------------------------------------------------------------------------
+
+u64
+Win32_ClockNow(PacingClock* clock) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+void
+Win32_ClockSleep(PacingClock* clock, u32 milliseconds) {
+    Sleep(milliseconds);
+}
+
+f64
+Win32_QueryRefreshRate(HWND windowHandle) {
+    // the rate of the monitor the window is on. 0 and 1 mean the hardware default, which windows won't say
+    HDC deviceContext = GetDC(windowHandle);
+    int refreshRate = GetDeviceCaps(deviceContext, VREFRESH);
+    ReleaseDC(windowHandle, deviceContext);
+
+    return refreshRate > 1 ? refreshRate : 60.0;
+}
+
+// cycle counter ticks per second, against the performance counter over a short sleep
+f64
+Win32_MeasureCycleRate() {
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    
+    QueryPerformanceCounter(&start);
+    u64 startCycles = ReadCycleCounter();
+    Sleep(20);
+    u64 cycles = ReadCycleCounter() - startCycles;
+    QueryPerformanceCounter(&end);
+    
+    return cycles * (f64)frequency.QuadPart / (f64)(end.QuadPart - start.QuadPart);
+}
+
+void
+Win32_WriteProfileTrace(const char path[]) {
+    u64 capacity = ProfileChromeTraceMaxBytes();
+    char* trace = (char*)VirtualAlloc(NULL, capacity, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if(!trace) {
+        return;
+    }
+    
+    u64 traceBytes = ProfileFormatChromeTrace(trace, capacity);
+    FileWriteAll(path, trace, traceBytes);
+    printf("profile: %u threads, %llu bytes of trace written to %s\n", ProfileThreadCount(), (unsigned long long)traceBytes, path);
+    
+    VirtualFree(trace, 0, MEM_RELEASE);
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Replay
+// ---------------------------------------------------------------------------------
+
+bool
+Win32_WriteAt(HANDLE file, u64 offset, void* data, DWORD byteCount) {
+    // an offset in the overlapped struct positions a synchronous write too
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = (DWORD)offset;
+    overlapped.OffsetHigh = (DWORD)(offset >> 32);
+    
+    DWORD bytesWritten;
+    return WriteFile(file, data, byteCount, &bytesWritten, &overlapped) && bytesWritten == byteCount;
+}
+
+bool
+Win32_BeginRecording(Win32Replay* replay, const char path[], GameMemory* memory) {
+    replay->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    
+    if(replay->file == INVALID_HANDLE_VALUE) {
+        printf("error creating recording: %s\n", path);
+        return false;
+    }
+    
+    ReplayHeader* header = &replay->header;
+    header->magic = REPLAY_MAGIC;
+    header->version = REPLAY_VERSION;
+    header->permanentSize = memory->permanentSize;
+    header->snapshotBytes = ReplaySnapshotBytes(memory);
+    header->frameOffset = REPLAY_SNAPSHOT_OFFSET + header->snapshotBytes;
+    header->frameCount = 0;
+    header->frameSize = sizeof(RecordedFrame);
+    
+    // snapshot through a mapping of the file, the system writes it back on its own time
+    HANDLE mapping = CreateFileMappingA(replay->file, NULL, PAGE_READWRITE,
+                                        (DWORD)(header->frameOffset >> 32), (DWORD)header->frameOffset, NULL);
+    if(!mapping) {
+        printf("error mapping recording: %s\n", path);
+        CloseHandle(replay->file);
+        return false;
+    }
+    
+    void* snapshot = MapViewOfFile(mapping, FILE_MAP_WRITE,
+                                   (DWORD)(REPLAY_SNAPSHOT_OFFSET >> 32), (DWORD)REPLAY_SNAPSHOT_OFFSET, header->snapshotBytes);
+    if(snapshot) {
+        GameSuspend(memory);
+        CopyMemory(snapshot, memory->permanent, header->snapshotBytes);
+        GameResume(memory);
+        UnmapViewOfFile(snapshot);
+    }
+    CloseHandle(mapping);
+    
+    if(!snapshot || !Win32_WriteAt(replay->file, 0, header, sizeof(ReplayHeader))) {
+        printf("error writing recording: %s\n", path);
+        CloseHandle(replay->file);
+        return false;
+    }
+    
+    replay->mode = Replay_Recording;
+    return true;
+}
+
+void
+Win32_RecordFrame(Win32Replay* replay, GameInput* input, f32 dt) {
+    RecordedFrame frame;
+    frame.input = *input;
+    frame.dt = dt;
+    
+    u64 offset = replay->header.frameOffset + replay->header.frameCount * sizeof(RecordedFrame);
+    if(Win32_WriteAt(replay->file, offset, &frame, sizeof(frame))) {
+        replay->header.frameCount++;
+    }
+}
+
+void
+Win32_EndRecording(Win32Replay* replay) {
+    // the frame count is only known now
+    Win32_WriteAt(replay->file, 0, &replay->header, sizeof(ReplayHeader));
+    CloseHandle(replay->file);
+    
+    replay->mode = Replay_Idle;
+}
+
+void
+Win32_RestoreSnapshot(Win32Replay* replay, GameMemory* memory) {
+    // windows can't map a view over memory that is already allocated, so this is a copy out of the
+    // system file cache. only the used pages are in the snapshot, which keeps it small
+    // the snapshot may cover more than this run has committed so far
+    GameSuspend(memory);
+    bool committed = MemoryCommit(memory->permanent, replay->header.snapshotBytes);
+    assert(committed);
+    CopyMemory(memory->permanent, replay->view + REPLAY_SNAPSHOT_OFFSET, replay->header.snapshotBytes);
+    GameResume(memory);
+}
+
+bool
+Win32_BeginPlayback(Win32Replay* replay, const char path[], GameMemory* memory) {
+    replay->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    
+    if(replay->file == INVALID_HANDLE_VALUE) {
+        printf("error opening recording: %s\n", path);
+        return false;
+    }
+    
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(replay->file, &fileSize);
+    
+    replay->mapping = CreateFileMappingA(replay->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    replay->view = replay->mapping ? (u8*)MapViewOfFile(replay->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    
+    if(!replay->view) {
+        printf("error mapping recording: %s\n", path);
+        if(replay->mapping) {
+            CloseHandle(replay->mapping);
+        }
+        CloseHandle(replay->file);
+        return false;
+    }
+    
+    replay->header = *(ReplayHeader*)replay->view;
+    ReplayHeader* header = &replay->header;
+    
+    if(!ReplayHeaderIsValid(header, memory) ||
+       header->frameOffset + header->frameCount * sizeof(RecordedFrame) > (u64)fileSize.QuadPart) {
+        printf("recording doesn't match this build: %s\n", path);
+        UnmapViewOfFile(replay->view);
+        CloseHandle(replay->mapping);
+        CloseHandle(replay->file);
+        return false;
+    }
+    
+    replay->frames = (RecordedFrame*)(replay->view + header->frameOffset);
+    replay->playIndex = 0;
+    
+    Win32_RestoreSnapshot(replay, memory);
+    
+    replay->mode = Replay_Playing;
+    return true;
+}
+
+void
+Win32_PlaybackFrame(Win32Replay* replay, GameMemory* memory, GameInput* input, f32* dt) {
+    if(replay->playIndex == replay->header.frameCount) {
+        // end of the recording, rewind and go again
+        Win32_RestoreSnapshot(replay, memory);
+        replay->playIndex = 0;
+    }
+    
+    RecordedFrame* frame = replay->frames + replay->playIndex++;
+    *input = frame->input;
+    *dt = frame->dt;
+}
+
+void
+Win32_EndPlayback(Win32Replay* replay) {
+    UnmapViewOfFile(replay->view);
+    CloseHandle(replay->mapping);
+    CloseHandle(replay->file);
+    
+    replay->mode = Replay_Idle;
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Memory
+// https://learn.microsoft.com/en-us/windows/win32/memory/large-page-support
+// ---------------------------------------------------------------------------------
+
+// large pages can only be allocated with SeLockMemoryPrivilege turned on in the process token. the account
+// has to hold it already (local security policy, lock pages in memory), this only turns it on
+bool
+Win32_EnableLargePages() {
+    HANDLE token;
+    if(!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+        return false;
+    }
+    
+    TOKEN_PRIVILEGES privileges = {};
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    
+    bool enabled = false;
+    if(LookupPrivilegeValueA(NULL, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)) {
+        // succeeds without the privilege too, only the last error tells
+        AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL);
+        enabled = GetLastError() == ERROR_SUCCESS;
+    }
+    
+    CloseHandle(token);
+    return enabled;
+}
+
+u64
+MemoryPageSize() {
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    return systemInfo.dwPageSize;
+}
+
+u64
+MemoryLargePageSize() {
+    return LargePagesEnabled ? GetLargePageMinimum() : 0;
+}
+
+void*
+MemoryReserve(void* address, u64 byteCount) {
+    return VirtualAlloc(address, byteCount, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+bool
+MemoryCommit(void* address, u64 byteCount) {
+    if(byteCount == 0) {
+        return true;
+    }
+    
+    return VirtualAlloc(address, byteCount, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+
+void*
+MemoryAllocateLarge(void* address, u64 byteCount) {
+    return VirtualAlloc(address, byteCount, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+}
+
+// windows frees a reservation whole, by its base
+void
+MemoryRelease(void* address, u64 byteCount) {
+    VirtualFree(address, 0, MEM_RELEASE);
+}
+
 
 
 // ---------------------------------------------------------------------------------
@@ -665,4 +1423,107 @@ FileWriteAll(const char path[], void* data, u64 byteCount) {
 void
 FileReleaseMemory(void* data) {
     VirtualFree(data, 0, MEM_RELEASE);
-}
\ No newline at end of file
+}
+
+FileMapping
+FileMapReadOnly(const char path[]) {
+    FileMapping mapping = {};
+    
+    HANDLE handle = CreateFileA(
+        path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    
+    if(handle == INVALID_HANDLE_VALUE) {
+        printf("error opening file: %s\n", path);
+        return mapping;
+    }
+    
+    // a zero sized file can't be mapped, it fails here
+    LARGE_INTEGER fileSize;
+    HANDLE section = NULL;
+    if(GetFileSizeEx(handle, &fileSize) && fileSize.QuadPart > 0) {
+        section = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    
+    void* view = section ? MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if(view) {
+        mapping.data = view;
+        mapping.byteCount = fileSize.QuadPart;
+    } else {
+        printf("error mapping file: %s\n", path);
+    }
+    
+    // the view keeps the section and the file alive on its own
+    if(section) {
+        CloseHandle(section);
+    }
+    CloseHandle(handle);
+    
+    return mapping;
+}
+
+void
+FileUnmap(FileMapping* mapping) {
+    if(mapping->data) {
+        UnmapViewOfFile(mapping->data);
+    }
+    *mapping = {};
+}
+
+// the handle is the win32 handle itself, FileHandle is never defined on this platform
+FileHandle*
+FileOpen(const char path[]) {
+    HANDLE handle = CreateFileA(
+        path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL
+    );
+    
+    if(handle == INVALID_HANDLE_VALUE) {
+        printf("error opening file: %s\n", path);
+        return NULL;
+    }
+    
+    return (FileHandle*)handle;
+}
+
+u64
+FileGetSize(FileHandle* file) {
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx((HANDLE)file, &fileSize)) {
+        return 0;
+    }
+    
+    return fileSize.QuadPart;
+}
+
+u32
+FileReadAt(FileHandle* file, u64 offset, void* destination, u32 byteCount) {
+    // an offset in the overlapped struct positions a synchronous read, so threads don't share a file pointer
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = (DWORD)offset;
+    overlapped.OffsetHigh = (DWORD)(offset >> 32);
+    
+    DWORD bytesRead;
+    if(!ReadFile((HANDLE)file, destination, byteCount, &bytesRead, &overlapped)) {
+        // reading at or past the end is not an error, just nothing to read
+        return 0;
+    }
+    
+    return bytesRead;
+}
+
+void
+FileClose(FileHandle* file) {
+    CloseHandle((HANDLE)file);
+}
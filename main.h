@@ -6,4 +6,55 @@ struct FileContent {
 
 FileContent FileReadAll(const char path[]);
 void FileWriteAll(const char path[], void* data, u64 byteCount);
-void FileReleaseMemory(void* data);
\ No newline at end of file
+void FileReleaseMemory(void* data);
+
+// read only view of a whole file: one open and one map, pages come in from the page cache when they are touched
+struct FileMapping {
+    void* data; // null when the file can't be mapped, empty files included
+    u64 byteCount;
+};
+
+FileMapping FileMapReadOnly(const char path[]);
+void FileUnmap(FileMapping* mapping);
+
+// address space, reserved up front and committed as it is needed. a reserved page that isn't committed faults
+// when it is touched. addresses and sizes are rounded out to whole pages
+u64 MemoryPageSize();
+u64 MemoryLargePageSize(); // 0 when the system won't hand out large pages
+void* MemoryReserve(void* address, u64 byteCount); // null when the range is taken
+bool MemoryCommit(void* address, u64 byteCount);   // inside a reservation, zeroed the first time. committed pages can be committed again
+void* MemoryAllocateLarge(void* address, u64 byteCount); // reserved and committed at once on large pages, null when they can't be had
+void MemoryRelease(void* address, u64 byteCount);  // a whole reservation
+
+// streaming reads, for files too big to load in one go. safe to call from worker threads
+struct FileHandle;
+
+FileHandle* FileOpen(const char path[]); // null when the file can't be opened
+u64 FileGetSize(FileHandle* file);
+u32 FileReadAt(FileHandle* file, u64 offset, void* destination, u32 byteCount); // bytes read, short at the end of the file
+void FileClose(FileHandle* file);
+
+// work queue, serviced by the engine's worker threads
+// entries may run in any order and on any thread, including the one calling WorkQueueCompleteAll
+struct WorkQueue;
+typedef void WorkQueueCallback(void* data);
+
+void WorkQueueAdd(WorkQueue* queue, WorkQueueCallback* callback, void* data);
+void WorkQueueCompleteAll(WorkQueue* queue); // the caller helps out until every added entry has run
+
+// asynchronous reads into memory the caller owns, serviced by the engine's io threads. game thread only.
+// every handle is polled until it stops being pending, or waited on, that gives its slot back
+struct FileReadHandle {
+    u32 value; // 0 is no read, submit returns it when the request can't be taken
+};
+
+enum FileReadStatus {
+    FileRead_Pending,
+    FileRead_Done,    // bytesRead is set, short when the file ends before offset + byteCount
+    FileRead_Failed,  // the file couldn't be opened
+    FileRead_Invalid, // a null handle, or one whose final status was already returned
+};
+
+FileReadHandle FileReadAsync(const char path[], u64 offset, void* destination, u64 byteCount);
+FileReadStatus FileReadPoll(FileReadHandle handle, u64* bytesRead);
+FileReadStatus FileReadWait(FileReadHandle handle, u64* bytesRead); // reads along with the io threads until it is done
@@ -0,0 +1,383 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// instrumented timing zones, shared by the engine and the game
+// PROFILE_ZONE("name") times the rest of the enclosing scope with the cycle counter.
+//
+//   recording  every thread writes finished zones into its own ring, found through a thread local. only the owner
+//              writes, readers take what is below its published count, so recording needs no lock and no allocation
+//   frames     the main thread marks where each frame starts, the last PROFILE_HISTORY_FRAMES are kept
+//   output     ProfileDrawOverlay draws the recent frames as bars into a graphics buffer,
+//              ProfileFormatChromeTrace writes the rings as chrome://tracing json
+//
+// PROFILE=0 compiles every zone out. compiled in, recording is off until ProfileSetEnabled and a zone costs one branch
+
+#ifndef PROFILE
+#define PROFILE 1
+#endif
+
+const u32 PROFILE_MAX_THREADS = 32;       // threads past this don't record
+const u32 PROFILE_THREAD_EVENTS = 32768;  // per thread, a power of two. a few hundred frames at today's zone counts
+const u32 PROFILE_HISTORY_FRAMES = 256;
+const u32 PROFILE_NAME_LENGTH = 32;
+
+struct ProfileEvent {
+    const char* name; // string literal, it is the zone's identity
+    u64 start;        // cycles
+    u32 duration;     // cycles, a zone over four billion of them is clamped
+    u32 depth;        // nesting on its thread, 0 is outermost
+};
+
+struct ProfileThread {
+    u32 volatile eventCount; // events ever recorded. the owner publishes with a release, so everything below is complete
+    u32 depth;
+    char name[PROFILE_NAME_LENGTH];
+    ProfileEvent events[PROFILE_THREAD_EVENTS];
+};
+
+struct Profiler {
+    u32 volatile enabled;
+    u32 volatile threadCount; // threads that claimed a ring, may run past PROFILE_MAX_THREADS
+    f64 cyclesPerSecond;      // from the platform, the cycle counter has no rate of its own
+
+    // written by the main thread only
+    ProfileThread* frameThread;
+    u32 frameCount;
+    u64 frameStarts[PROFILE_HISTORY_FRAMES];
+
+    ProfileThread threads[PROFILE_MAX_THREADS];
+};
+
+// zero pages until a thread records, the rings cost nothing until they are used
+Profiler GlobalProfiler;
+thread_local ProfileThread* ProfileCurrentThread;
+
+void
+ProfileSetEnabled(bool enabled) {
+    AtomicStore(&GlobalProfiler.enabled, enabled ? 1 : 0);
+}
+
+bool
+ProfileIsEnabled() {
+    return GlobalProfiler.enabled != 0;
+}
+
+void
+ProfileSetCycleRate(f64 cyclesPerSecond) {
+    GlobalProfiler.cyclesPerSecond = cyclesPerSecond;
+}
+
+// claims a ring on the thread's first zone. null once every ring is taken
+ProfileThread*
+ProfileGetThread() {
+    if(!ProfileCurrentThread) {
+        u32 index = AtomicAdd(&GlobalProfiler.threadCount, 1) - 1;
+        if(index >= PROFILE_MAX_THREADS) {
+            return 0;
+        }
+        ProfileCurrentThread = GlobalProfiler.threads + index;
+    }
+    return ProfileCurrentThread;
+}
+
+// names the calling thread's track in the trace. call it before the thread's first zone
+void
+ProfileNameThread(const char name[]) {
+    ProfileThread* thread = ProfileGetThread();
+    if(!thread) {
+        return;
+    }
+
+    u32 length = 0;
+    while(name[length] && length < PROFILE_NAME_LENGTH - 1) {
+        thread->name[length] = name[length];
+        length++;
+    }
+    thread->name[length] = 0;
+}
+
+// called by the main thread as each frame starts
+void
+ProfileBeginFrame() {
+    Profiler* profiler = &GlobalProfiler;
+    if(!profiler->enabled) {
+        return;
+    }
+
+    profiler->frameThread = ProfileGetThread();
+    profiler->frameStarts[profiler->frameCount % PROFILE_HISTORY_FRAMES] = ReadCycleCounter();
+    profiler->frameCount++;
+}
+
+struct ProfileScope {
+    ProfileThread* thread;
+    const char* name;
+    u64 start;
+
+    ProfileScope(const char zoneName[]) {
+        thread = 0;
+        if(GlobalProfiler.enabled) {
+            thread = ProfileGetThread();
+            if(thread) {
+                name = zoneName;
+                thread->depth++;
+                start = ReadCycleCounter();
+            }
+        }
+    }
+
+    ~ProfileScope() {
+        End();
+    }
+
+    // ends the zone before the scope does, for phases that don't sit in a block of their own
+    void
+    End() {
+        if(!thread) {
+            return;
+        }
+
+        u64 end = ReadCycleCounter();
+        thread->depth--;
+
+        u32 index = thread->eventCount;
+        ProfileEvent* event = thread->events + (index & (PROFILE_THREAD_EVENTS - 1));
+        event->name = name;
+        event->start = start;
+        event->duration = end - start > 0xFFFFFFFF ? 0xFFFFFFFF : (u32)(end - start);
+        event->depth = thread->depth;
+
+        AtomicStore(&thread->eventCount, index + 1);
+        thread = 0;
+    }
+};
+
+#define PROFILE_JOIN_(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN_(a, b)
+
+#if PROFILE
+#define PROFILE_ZONE(name) ProfileScope PROFILE_JOIN(profileZone, __LINE__)(name)
+#define PROFILE_BEGIN(zone, name) ProfileScope zone(name)
+#define PROFILE_END(zone) zone.End()
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_BEGIN(zone, name)
+#define PROFILE_END(zone)
+#endif
+
+// the range of a thread's events that is safe to read. the owner may be overwriting the oldest slots while
+// we look, so only the newer half of the ring is handed out
+void
+ProfileReadableEvents(ProfileThread* thread, u32* first, u32* count) {
+    *count = AtomicLoad(&thread->eventCount);
+    u32 window = PROFILE_THREAD_EVENTS / 2;
+    *first = *count > window ? *count - window : 0;
+}
+
+u32
+ProfileThreadCount() {
+    u32 count = AtomicLoad(&GlobalProfiler.threadCount);
+    return count < PROFILE_MAX_THREADS ? count : PROFILE_MAX_THREADS;
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Overlay
+// ---------------------------------------------------------------------------------
+
+const u32 PROFILE_OVERLAY_FRAMES = 128;
+
+// stable per zone, so a zone keeps its color frame to frame
+u32
+ProfileZoneColor(const char name[]) {
+    const u32 PALETTE[] = {
+        0xFFE6194B, 0xFF3CB44B, 0xFFFFE119, 0xFF4363D8, 0xFFF58231,
+        0xFF911EB4, 0xFF46F0F0, 0xFFF032E6, 0xFFBCF60C, 0xFF008080,
+    };
+
+    u32 hash = 2166136261;
+    for(const char* c = name; *c; c++) {
+        hash = (hash ^ (u8)*c) * 16777619;
+    }
+    return PALETTE[hash % (sizeof(PALETTE) / sizeof(PALETTE[0]))];
+}
+
+void
+ProfileFillRect(GraphicsBuffer* buffer, int32 minX, int32 minY, int32 maxX, int32 maxY, u32 color) {
+    minX = minX < 0 ? 0 : minX;
+    minY = minY < 0 ? 0 : minY;
+    maxX = maxX > buffer->width ? buffer->width : maxX;
+    maxY = maxY > buffer->height ? buffer->height : maxY;
+
+    for(int32 y = minY; y < maxY; y++) {
+        u32* pixel = (u32*)(buffer->data + y * buffer->bytesPerRow) + minX;
+        for(int32 x = minX; x < maxX; x++) {
+            *pixel++ = color;
+        }
+    }
+}
+
+// one bar per frame along the bottom of the buffer, newest on the right. a bar is as tall as its frame,
+// split into the main thread's outermost zones. the white line is the target frame time.
+// returns the pixels it drew over, empty when it drew nothing
+Rect32
+ProfileDrawOverlay(GraphicsBuffer* buffer, f32 targetSeconds) {
+    PROFILE_ZONE("profile overlay");
+
+    Rect32 drawn = {};
+    Profiler* profiler = &GlobalProfiler;
+    ProfileThread* thread = profiler->frameThread;
+    if(!profiler->enabled || !thread || profiler->cyclesPerSecond == 0 || profiler->frameCount < 2) {
+        return drawn;
+    }
+
+    const u32 FRAME_COLOR = 0xFF303030;
+    const u32 TARGET_COLOR = 0xFFFFFFFF;
+
+    int32 barWidth = buffer->width / (int32)PROFILE_OVERLAY_FRAMES;
+    barWidth = barWidth < 1 ? 1 : barWidth;
+
+    // the target sits at two thirds of the strip, so slow frames have room to show how slow
+    int32 stripHeight = buffer->height / 4;
+    f64 targetPixels = stripHeight * 2.0 / 3.0;
+    f64 pixelsPerCycle = targetPixels / (targetSeconds * profiler->cyclesPerSecond);
+
+    // the newest frame is still running, the ones before it are complete
+    u32 lastFrame = profiler->frameCount - 1;
+    u32 frames = lastFrame < PROFILE_OVERLAY_FRAMES ? lastFrame : PROFILE_OVERLAY_FRAMES;
+    frames = frames < PROFILE_HISTORY_FRAMES - 1 ? frames : PROFILE_HISTORY_FRAMES - 1;
+    u32 firstFrame = lastFrame - frames;
+    int32 stripWidth = (int32)frames * barWidth;
+
+    ProfileFillRect(buffer, 0, 0, stripWidth, stripHeight, 0xFF000000);
+
+    for(u32 frame = firstFrame; frame < lastFrame; frame++) {
+        u64 frameStart = profiler->frameStarts[frame % PROFILE_HISTORY_FRAMES];
+        u64 frameEnd = profiler->frameStarts[(frame + 1) % PROFILE_HISTORY_FRAMES];
+        int32 x = (frame - firstFrame) * barWidth;
+
+        f64 height = (frameEnd - frameStart) * pixelsPerCycle;
+        ProfileFillRect(buffer, x, 0, x + barWidth - 1, height < stripHeight ? (int32)height : stripHeight, FRAME_COLOR);
+    }
+
+    // events are in the order they ended, and so are the frames, one pass places every event
+    u32 first, count;
+    ProfileReadableEvents(thread, &first, &count);
+
+    u32 frame = firstFrame;
+    for(u32 i = first; i < count; i++) {
+        ProfileEvent* event = thread->events + (i & (PROFILE_THREAD_EVENTS - 1));
+        if(event->depth != 0) {
+            continue;
+        }
+
+        while(frame < lastFrame && event->start >= profiler->frameStarts[(frame + 1) % PROFILE_HISTORY_FRAMES]) {
+            frame++;
+        }
+        if(frame == lastFrame) {
+            break;
+        }
+
+        u64 frameStart = profiler->frameStarts[frame % PROFILE_HISTORY_FRAMES];
+        if(event->start < frameStart) {
+            continue; // older than anything shown
+        }
+
+        // a frame slower than the strip is cut off at its top
+        f64 eventMinY = (event->start - frameStart) * pixelsPerCycle;
+        f64 eventMaxY = (event->start + event->duration - frameStart) * pixelsPerCycle;
+        if(eventMinY >= stripHeight) {
+            continue;
+        }
+
+        int32 x = (frame - firstFrame) * barWidth;
+        int32 minY = (int32)eventMinY;
+        int32 maxY = eventMaxY < stripHeight ? (int32)eventMaxY : stripHeight;
+        ProfileFillRect(buffer, x, minY, x + barWidth - 1, maxY > minY ? maxY : minY + 1, ProfileZoneColor(event->name));
+    }
+
+    ProfileFillRect(buffer, 0, (int32)targetPixels, stripWidth, (int32)targetPixels + 1, TARGET_COLOR);
+
+    drawn.maxX = stripWidth < buffer->width ? stripWidth : buffer->width;
+    drawn.maxY = stripHeight;
+    return drawn;
+}
+
+
+
+// ---------------------------------------------------------------------------------
+// Chrome trace
+// ---------------------------------------------------------------------------------
+
+// enough for every readable event, for sizing the buffer handed to ProfileFormatChromeTrace
+u64
+ProfileChromeTraceMaxBytes() {
+    const u64 EVENT_BYTES = 128 + PROFILE_NAME_LENGTH; // one event line, names are short literals
+    return 256 + (u64)ProfileThreadCount() * (EVENT_BYTES + (PROFILE_THREAD_EVENTS / 2) * EVENT_BYTES);
+}
+
+// complete events ("ph":"X") in microseconds, one track per thread. returns the bytes written
+u64
+ProfileFormatChromeTrace(char* destination, u64 capacity) {
+    Profiler* profiler = &GlobalProfiler;
+    if(profiler->cyclesPerSecond == 0) {
+        return 0;
+    }
+
+    f64 microsecondsPerCycle = 1000000.0 / profiler->cyclesPerSecond;
+
+    // timestamps start at the oldest event, the trace viewer doesn't like huge ones
+    u32 threadCount = ProfileThreadCount();
+    u64 origin = ~0ull;
+    for(u32 t = 0; t < threadCount; t++) {
+        ProfileThread* thread = profiler->threads + t;
+        u32 first, count;
+        ProfileReadableEvents(thread, &first, &count);
+        for(u32 i = first; i < count; i++) {
+            u64 start = thread->events[i & (PROFILE_THREAD_EVENTS - 1)].start;
+            origin = start < origin ? start : origin;
+        }
+    }
+
+    u64 used = 0;
+    bool comma = false;
+
+#define PROFILE_APPEND(...) \
+    if(used < capacity) { \
+        int written = snprintf(destination + used, capacity - used, __VA_ARGS__); \
+        used += written > 0 ? (u64)written : 0; \
+        used = used < capacity ? used : capacity; \
+    }
+
+    PROFILE_APPEND("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    for(u32 t = 0; t < threadCount; t++) {
+        ProfileThread* thread = profiler->threads + t;
+
+        if(thread->name[0]) {
+            PROFILE_APPEND("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                           comma ? ",\n" : "", t, thread->name);
+            comma = true;
+        }
+
+        u32 first, count;
+        ProfileReadableEvents(thread, &first, &count);
+        for(u32 i = first; i < count; i++) {
+            ProfileEvent* event = thread->events + (i & (PROFILE_THREAD_EVENTS - 1));
+            PROFILE_APPEND("%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                           comma ? ",\n" : "", event->name, t,
+                           (event->start - origin) * microsecondsPerCycle, event->duration * microsecondsPerCycle);
+            comma = true;
+        }
+    }
+
+    PROFILE_APPEND("\n]}\n");
+
+#undef PROFILE_APPEND
+
+    // snprintf stops at the end of the buffer, a full buffer means a cut off trace
+    return used < capacity ? used : 0;
+}
+
+#endif